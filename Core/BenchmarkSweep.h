@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "ScenePreset.h"
+
+namespace ISV
+{
+    // A grid of presets for PresetBenchmark: every combination of particle
+    // count, step count and rendering method applied on top of a base
+    // preset, which supplies everything else including the camera path.
+    //
+    //  {
+    //      "base": { ...a preset... },
+    //      "particleCounts": [ 500, 1000, 2000 ],
+    //      "stepCounts": [ 1, 2, 3, 4 ],
+    //      "renderingMethods": [ "SphericalProxy", "Vanilla" ]
+    //  }
+    //
+    // An empty or missing list keeps the base preset's value.
+    struct BenchmarkSweep
+    {
+        ScenePreset Base;
+        std::vector<uint32_t> ParticleCounts;
+        std::vector<uint32_t> StepCounts;
+        std::vector<uint32_t> RenderingMethods;
+
+        // Rendering method outermost, particle count innermost, so rows for
+        // one curve in plots.ipynb come out next to each other
+        std::vector<ScenePreset> Expand() const;
+
+        static BenchmarkSweep FromJson(const nlohmann::json& json);
+        static BenchmarkSweep Load(const std::string& path);
+
+    private:
+        static std::vector<uint32_t> OrBase(const std::vector<uint32_t>& values, uint32_t base);
+    };
+
+    inline std::vector<ScenePreset> BenchmarkSweep::Expand() const
+    {
+        std::vector<ScenePreset> presets;
+
+        for (uint32_t method : OrBase(RenderingMethods, Base.RenderingMethod))
+        {
+            for (uint32_t stepCount : OrBase(StepCounts, Base.StepCount))
+            {
+                for (uint32_t particleCount : OrBase(ParticleCounts, Base.ParticleCount))
+                {
+                    ScenePreset preset = Base;
+                    preset.RenderingMethod = method;
+                    preset.StepCount = stepCount;
+                    preset.ParticleCount = particleCount;
+                    preset.Name = Base.Name
+                        + " " + ScenePreset::RenderingMethodNames.at(method)
+                        + " steps=" + std::to_string(stepCount)
+                        + " particles=" + std::to_string(particleCount);
+
+                    presets.push_back(std::move(preset));
+                }
+            }
+        }
+
+        return presets;
+    }
+
+    inline BenchmarkSweep BenchmarkSweep::FromJson(const nlohmann::json& json)
+    {
+        if (!json.is_object())
+        {
+            throw std::runtime_error("Expected an object for the sweep");
+        }
+
+        BenchmarkSweep sweep;
+
+        for (const auto& item : json.items())
+        {
+            if (item.key() == "base")
+            {
+                sweep.Base = ScenePreset::FromJson(item.value());
+            }
+            else if (item.key() == "particleCounts")
+            {
+                item.value().get_to(sweep.ParticleCounts);
+            }
+            else if (item.key() == "stepCounts")
+            {
+                item.value().get_to(sweep.StepCounts);
+            }
+            else if (item.key() == "renderingMethods")
+            {
+                for (const auto& name : item.value().get<std::vector<std::string>>())
+                {
+                    const auto& names = ScenePreset::RenderingMethodNames;
+                    const auto found = std::find(names.begin(), names.end(), name);
+                    if (found == names.end())
+                    {
+                        throw std::runtime_error("Unknown value \"" + name + "\" for renderingMethods");
+                    }
+
+                    sweep.RenderingMethods.push_back(static_cast<uint32_t>(found - names.begin()));
+                }
+            }
+            else
+            {
+                throw std::runtime_error("Unknown key \"" + item.key() + "\" in sweep");
+            }
+        }
+
+        return sweep;
+    }
+
+    inline BenchmarkSweep BenchmarkSweep::Load(const std::string& path)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            throw std::runtime_error("Could not open sweep " + path);
+        }
+
+        try
+        {
+            return FromJson(nlohmann::json::parse(file));
+        }
+        catch (const std::exception& e)
+        {
+            throw std::runtime_error("Invalid sweep " + path + ": " + e.what());
+        }
+    }
+
+    inline std::vector<uint32_t> BenchmarkSweep::OrBase(const std::vector<uint32_t>& values, uint32_t base)
+    {
+        return values.empty() ? std::vector<uint32_t>{ base } : values;
+    }
+}
@@ -0,0 +1,293 @@
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ISV
+{
+    // CPU mirror of Shaders/FourierOpacity.hlsli.
+    //
+    // Each texel stores a truncated Fourier series of the extinction density
+    // along the light ray, over normalised light depth z in [0, 1]:
+    //     sigma(z) ~ a0 + sum_k (a_k cos(2 pi k z) + b_k sin(2 pi k z))
+    // The optical thickness at any depth is the integral of that series,
+    // so it can be reconstructed in closed form at arbitrary z instead of
+    // interpolating between a handful of depth slices.
+    class FourierOpacityMap
+    {
+    public:
+        static constexpr uint32_t HarmonicCount = 3;
+
+        // Packed the same way as the two RGBA render targets:
+        // Low = (a0, a1, b1, a2), High = (b2, a3, b3, unused)
+        struct Coefficients
+        {
+            std::array<float, 4> Low = { 0, 0, 0, 0 };
+            std::array<float, 4> High = { 0, 0, 0, 0 };
+
+            float A(uint32_t k) const;
+            float B(uint32_t k) const;
+            void AddA(uint32_t k, float value);
+            void AddB(uint32_t k, float value);
+        };
+
+        FourierOpacityMap(uint32_t width, uint32_t height);
+
+        // Adds an interval [zmin, zmax] of the ray that holds the given
+        // optical thickness, spread uniformly along it.
+        static void AddInterval(Coefficients& coefficients,
+            float zmin,
+            float zmax,
+            float opticalThickness);
+
+        static float Reconstruct(const Coefficients& coefficients, float z);
+
+        // Encodes one column of a slice volume. Slice i holds the cumulative
+        // optical thickness sampled at the texel centre (i + 0.5) / depth,
+        // which is where the hardware sampler reads it back from.
+        static Coefficients EncodeColumn(const float* cumulativeOpticalThickness,
+            uint32_t depth,
+            std::size_t stride = 1);
+
+        // The volume is laid out like a D3D12 3D subresource: x fastest, then y, then z.
+        void EncodeSliceVolume(const float* volume,
+            uint32_t depth);
+
+        Coefficients& At(uint32_t x, uint32_t y);
+        const Coefficients& At(uint32_t x, uint32_t y) const;
+
+        // Bilinearly filters the coefficients like the GPU's linear clamp
+        // sampler does, then reconstructs at depth z.
+        float SampleOpticalThickness(float u, float v, float z) const;
+
+        uint32_t GetWidth() const;
+        uint32_t GetHeight() const;
+        std::size_t GetSizeInBytes() const;
+
+    private:
+        uint32_t m_width;
+        uint32_t m_height;
+        std::vector<Coefficients> m_texels;
+    };
+
+    inline float FourierOpacityMap::Coefficients::A(uint32_t k) const
+    {
+        switch (k)
+        {
+        case 0: return Low[0];
+        case 1: return Low[1];
+        case 2: return Low[3];
+        case 3: return High[1];
+        default: return 0.f;
+        }
+    }
+
+    inline float FourierOpacityMap::Coefficients::B(uint32_t k) const
+    {
+        switch (k)
+        {
+        case 1: return Low[2];
+        case 2: return High[0];
+        case 3: return High[2];
+        default: return 0.f;
+        }
+    }
+
+    inline void FourierOpacityMap::Coefficients::AddA(uint32_t k, float value)
+    {
+        switch (k)
+        {
+        case 0: Low[0] += value; break;
+        case 1: Low[1] += value; break;
+        case 2: Low[3] += value; break;
+        case 3: High[1] += value; break;
+        default: break;
+        }
+    }
+
+    inline void FourierOpacityMap::Coefficients::AddB(uint32_t k, float value)
+    {
+        switch (k)
+        {
+        case 1: Low[2] += value; break;
+        case 2: High[0] += value; break;
+        case 3: High[2] += value; break;
+        default: break;
+        }
+    }
+
+    inline FourierOpacityMap::FourierOpacityMap(uint32_t width, uint32_t height)
+        : m_width(width), m_height(height), m_texels(static_cast<std::size_t>(width) * height)
+    {
+    }
+
+    inline void FourierOpacityMap::AddInterval(Coefficients& coefficients,
+        float zmin,
+        float zmax,
+        float opticalThickness)
+    {
+        constexpr float twoPi = 6.28318530718f;
+        constexpr float epsilon = 0.00001f;
+
+        const float width = zmax - zmin;
+        const float zCentre = 0.5f * (zmin + zmax);
+
+        coefficients.AddA(0, opticalThickness);
+
+        for (uint32_t k = 1; k <= HarmonicCount; k++)
+        {
+            const float w = twoPi * k;
+
+            if (std::abs(width) > epsilon)
+            {
+                coefficients.AddA(k, 2.f * opticalThickness
+                    * (std::sin(w * zmax) - std::sin(w * zmin)) / (w * width));
+                coefficients.AddB(k, 2.f * opticalThickness
+                    * (std::cos(w * zmin) - std::cos(w * zmax)) / (w * width));
+            }
+            else
+            {
+                coefficients.AddA(k, 2.f * opticalThickness * std::cos(w * zCentre));
+                coefficients.AddB(k, 2.f * opticalThickness * std::sin(w * zCentre));
+            }
+        }
+    }
+
+    inline float FourierOpacityMap::Reconstruct(const Coefficients& coefficients, float z)
+    {
+        constexpr float pi = 3.14159265359f;
+        constexpr float twoPi = 2.f * pi;
+
+        z = std::clamp(z, 0.f, 1.f);
+
+        float ot = coefficients.A(0) * z;
+
+        for (uint32_t k = 1; k <= HarmonicCount; k++)
+        {
+            const float w = twoPi * k;
+
+            // Lanczos sigma factor to damp the ringing from truncating the series
+            const float x = pi * k / (HarmonicCount + 1.f);
+            const float sigma = std::sin(x) / x;
+
+            ot += sigma * (coefficients.A(k) * std::sin(w * z)
+                + coefficients.B(k) * (1.f - std::cos(w * z))) / w;
+        }
+
+        return std::max(0.f, ot);
+    }
+
+    inline FourierOpacityMap::Coefficients FourierOpacityMap::EncodeColumn(
+        const float* cumulativeOpticalThickness,
+        uint32_t depth,
+        std::size_t stride)
+    {
+        Coefficients out;
+
+        if (depth == 0)
+        {
+            return out;
+        }
+
+        float previousZ = 0.f;
+        float previousOT = 0.f;
+
+        for (uint32_t i = 0; i < depth; i++)
+        {
+            const float z = (i + 0.5f) / depth;
+            const float ot = cumulativeOpticalThickness[i * stride];
+            const float increment = ot - previousOT;
+
+            if (increment != 0.f)
+            {
+                AddInterval(out, previousZ, z, increment);
+            }
+
+            previousZ = z;
+            previousOT = ot;
+        }
+
+        return out;
+    }
+
+    inline void FourierOpacityMap::EncodeSliceVolume(const float* volume,
+        uint32_t depth)
+    {
+        const std::size_t sliceStride = static_cast<std::size_t>(m_width) * m_height;
+
+        for (uint32_t y = 0; y < m_height; y++)
+        {
+            for (uint32_t x = 0; x < m_width; x++)
+            {
+                At(x, y) = EncodeColumn(volume + y * m_width + x, depth, sliceStride);
+            }
+        }
+    }
+
+    inline FourierOpacityMap::Coefficients& FourierOpacityMap::At(uint32_t x, uint32_t y)
+    {
+        return m_texels[static_cast<std::size_t>(y) * m_width + x];
+    }
+
+    inline const FourierOpacityMap::Coefficients& FourierOpacityMap::At(uint32_t x, uint32_t y) const
+    {
+        return m_texels[static_cast<std::size_t>(y) * m_width + x];
+    }
+
+    inline float FourierOpacityMap::SampleOpticalThickness(float u, float v, float z) const
+    {
+        const float fx = std::clamp(u, 0.f, 1.f) * m_width - 0.5f;
+        const float fy = std::clamp(v, 0.f, 1.f) * m_height - 0.5f;
+
+        const float floorX = std::floor(fx);
+        const float floorY = std::floor(fy);
+        const float tx = fx - floorX;
+        const float ty = fy - floorY;
+
+        const int maxX = static_cast<int>(m_width) - 1;
+        const int maxY = static_cast<int>(m_height) - 1;
+        const uint32_t x0 = static_cast<uint32_t>(std::clamp(static_cast<int>(floorX), 0, maxX));
+        const uint32_t x1 = static_cast<uint32_t>(std::clamp(static_cast<int>(floorX) + 1, 0, maxX));
+        const uint32_t y0 = static_cast<uint32_t>(std::clamp(static_cast<int>(floorY), 0, maxY));
+        const uint32_t y1 = static_cast<uint32_t>(std::clamp(static_cast<int>(floorY) + 1, 0, maxY));
+
+        Coefficients filtered;
+        const Coefficients* corners[4] = { &At(x0, y0), &At(x1, y0), &At(x0, y1), &At(x1, y1) };
+        const float weights[4] = {
+            (1 - tx) * (1 - ty),
+            tx * (1 - ty),
+            (1 - tx) * ty,
+            tx * ty
+        };
+
+        for (int c = 0; c < 4; c++)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                filtered.Low[i] += weights[c] * corners[c]->Low[i];
+                filtered.High[i] += weights[c] * corners[c]->High[i];
+            }
+        }
+
+        return Reconstruct(filtered, z);
+    }
+
+    inline uint32_t FourierOpacityMap::GetWidth() const
+    {
+        return m_width;
+    }
+
+    inline uint32_t FourierOpacityMap::GetHeight() const
+    {
+        return m_height;
+    }
+
+    inline std::size_t FourierOpacityMap::GetSizeInBytes() const
+    {
+        return m_texels.size() * sizeof(Coefficients);
+    }
+}
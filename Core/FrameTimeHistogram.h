@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+namespace ISV
+{
+    // Rolling record of the last WindowSize frame times, summarised as
+    // percentiles and binned into a histogram on demand. Adding a frame is
+    // O(1), so it can sit inside the timer and see every frame; summaries
+    // sort a copy of the window and are meant to be taken a few times per
+    // second at most.
+    class FrameTimeHistogram
+    {
+    public:
+        struct Summary
+        {
+            uint32_t Frames = 0;
+            double MeanMs = 0.0;
+            double P50Ms = 0.0;
+            double P95Ms = 0.0;
+            double P99Ms = 0.0;
+            double MinMs = 0.0;
+            double MaxMs = 0.0;
+        };
+
+        explicit FrameTimeHistogram(uint32_t windowSize = 1024);
+
+        void AddFrame(double seconds);
+        void Reset();
+
+        uint32_t GetWindowSize() const;
+        // Frames currently in the window
+        uint32_t GetFrameCount() const;
+        // Frames added since the last Reset, including ones that have
+        // left the window
+        uint64_t GetTotalFrameCount() const;
+
+        Summary GetSummary() const;
+
+        // Frame times in ms, oldest first
+        std::vector<float> GetHistory() const;
+
+        // Frame counts in bucketCount equal buckets over [0, maxMs). Frames
+        // of maxMs or longer land in the last bucket.
+        std::vector<float> GetHistogram(uint32_t bucketCount, double maxMs) const;
+
+        // Nearest rank percentiles of a set of frame times in ms
+        static Summary Summarize(std::vector<double> frameMs);
+
+    private:
+        std::vector<double> m_frameMs;
+        uint32_t m_next = 0;
+        uint32_t m_count = 0;
+        uint64_t m_totalCount = 0;
+    };
+
+    inline FrameTimeHistogram::FrameTimeHistogram(uint32_t windowSize)
+        : m_frameMs(std::max(1u, windowSize), 0.0)
+    {
+    }
+
+    inline void FrameTimeHistogram::AddFrame(double seconds)
+    {
+        m_frameMs[m_next] = seconds * 1000.0;
+        m_next = (m_next + 1) % GetWindowSize();
+        m_count = std::min(m_count + 1, GetWindowSize());
+        m_totalCount++;
+    }
+
+    inline void FrameTimeHistogram::Reset()
+    {
+        m_next = 0;
+        m_count = 0;
+        m_totalCount = 0;
+    }
+
+    inline uint32_t FrameTimeHistogram::GetWindowSize() const
+    {
+        return static_cast<uint32_t>(m_frameMs.size());
+    }
+
+    inline uint32_t FrameTimeHistogram::GetFrameCount() const
+    {
+        return m_count;
+    }
+
+    inline uint64_t FrameTimeHistogram::GetTotalFrameCount() const
+    {
+        return m_totalCount;
+    }
+
+    inline FrameTimeHistogram::Summary FrameTimeHistogram::GetSummary() const
+    {
+        // Order doesn't matter for the summary
+        return Summarize(std::vector<double>(m_frameMs.begin(), m_frameMs.begin() + m_count));
+    }
+
+    inline std::vector<float> FrameTimeHistogram::GetHistory() const
+    {
+        std::vector<float> history;
+        history.reserve(m_count);
+
+        const uint32_t first = (m_next + GetWindowSize() - m_count) % GetWindowSize();
+        for (uint32_t i = 0; i < m_count; i++)
+        {
+            history.push_back(static_cast<float>(m_frameMs[(first + i) % GetWindowSize()]));
+        }
+
+        return history;
+    }
+
+    inline std::vector<float> FrameTimeHistogram::GetHistogram(uint32_t bucketCount, double maxMs) const
+    {
+        std::vector<float> buckets(bucketCount, 0.f);
+        if (bucketCount == 0 || maxMs <= 0.0)
+        {
+            return buckets;
+        }
+
+        for (uint32_t i = 0; i < m_count; i++)
+        {
+            const double bucket = std::floor(m_frameMs[i] / maxMs * bucketCount);
+            buckets[static_cast<uint32_t>(std::clamp(bucket, 0.0, bucketCount - 1.0))] += 1.f;
+        }
+
+        return buckets;
+    }
+
+    inline FrameTimeHistogram::Summary FrameTimeHistogram::Summarize(std::vector<double> frameMs)
+    {
+        Summary summary;
+        summary.Frames = static_cast<uint32_t>(frameMs.size());
+
+        if (frameMs.empty())
+        {
+            return summary;
+        }
+
+        std::sort(frameMs.begin(), frameMs.end());
+
+        auto percentile = [&frameMs](double p)
+            {
+                const auto rank = static_cast<std::size_t>(std::ceil(p * frameMs.size()));
+                return frameMs[std::clamp<std::size_t>(rank, 1, frameMs.size()) - 1];
+            };
+
+        summary.MeanMs = std::accumulate(frameMs.begin(), frameMs.end(), 0.0) / frameMs.size();
+        summary.P50Ms = percentile(0.5);
+        summary.P95Ms = percentile(0.95);
+        summary.P99Ms = percentile(0.99);
+        summary.MinMs = frameMs.front();
+        summary.MaxMs = frameMs.back();
+
+        return summary;
+    }
+}
@@ -0,0 +1,104 @@
+#include "pch.h"
+
+#include "Core/GpuTimer.h"
+
+namespace ISV
+{
+    GpuTimer::GpuTimer(ID3D12Device* device,
+        ID3D12CommandQueue* queue,
+        uint32_t framesInFlight,
+        uint32_t maxZonesPerFrame)
+        : m_ring(*this, framesInFlight, maxZonesPerFrame)
+    {
+        DX::ThrowIfFailed(queue->GetTimestampFrequency(&m_frequency));
+
+        D3D12_QUERY_HEAP_DESC heapDesc = {};
+        heapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+        heapDesc.Count = m_ring.GetQueryCount();
+
+        DX::ThrowIfFailed(
+            device->CreateQueryHeap(&heapDesc, IID_PPV_ARGS(m_queryHeap.ReleaseAndGetAddressOf())));
+        m_queryHeap->SetName(L"GPU Timer Queries");
+
+        auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK);
+        auto desc = CD3DX12_RESOURCE_DESC::Buffer(static_cast<UINT64>(m_ring.GetQueryCount()) * sizeof(uint64_t));
+
+        DX::ThrowIfFailed(
+            device->CreateCommittedResource(
+                &heapProperties,
+                D3D12_HEAP_FLAG_NONE,
+                &desc,
+                D3D12_RESOURCE_STATE_COPY_DEST,
+                nullptr,
+                IID_PPV_ARGS(m_readback.ReleaseAndGetAddressOf())));
+        m_readback->SetName(L"GPU Timer Readback");
+
+        DX::ThrowIfFailed(
+            device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(m_fence.ReleaseAndGetAddressOf())));
+        m_fence->SetName(L"GPU Timer Fence");
+    }
+
+    void GpuTimer::BeginFrame(ID3D12GraphicsCommandList* cl)
+    {
+        m_cl = cl;
+        m_frame = m_ring.BeginFrame(m_fence->GetCompletedValue());
+    }
+
+    GpuTimestampRing::ZoneHandle GpuTimer::BeginZone(const char* name)
+    {
+        return m_ring.BeginZone(name);
+    }
+
+    void GpuTimer::EndZone(GpuTimestampRing::ZoneHandle zone)
+    {
+        m_ring.EndZone(zone);
+    }
+
+    void GpuTimer::EndFrame()
+    {
+        m_ring.EndFrame();
+        m_cl = nullptr;
+    }
+
+    void GpuTimer::Signal(ID3D12CommandQueue* queue)
+    {
+        DX::ThrowIfFailed(queue->Signal(m_fence.Get(), m_frame));
+    }
+
+    const GpuTimestampRing& GpuTimer::GetResults() const
+    {
+        return m_ring;
+    }
+
+    void GpuTimer::WriteTimestamp(uint32_t query)
+    {
+        m_cl->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, query);
+    }
+
+    void GpuTimer::ResolveTimestamps(uint32_t first, uint32_t count)
+    {
+        m_cl->ResolveQueryData(m_queryHeap.Get(),
+            D3D12_QUERY_TYPE_TIMESTAMP,
+            first,
+            count,
+            m_readback.Get(),
+            static_cast<UINT64>(first) * sizeof(uint64_t));
+    }
+
+    void GpuTimer::ReadTimestamps(uint32_t first, uint32_t count, uint64_t* timestamps)
+    {
+        const auto readRange = CD3DX12_RANGE(first * sizeof(uint64_t), (first + count) * sizeof(uint64_t));
+        void* mapped = nullptr;
+        DX::ThrowIfFailed(m_readback->Map(0, &readRange, &mapped));
+
+        std::memcpy(timestamps, static_cast<const uint64_t*>(mapped) + first, count * sizeof(uint64_t));
+
+        const auto writeRange = CD3DX12_RANGE(0, 0);
+        m_readback->Unmap(0, &writeRange);
+    }
+
+    uint64_t GpuTimer::GetFrequency() const
+    {
+        return m_frequency;
+    }
+}
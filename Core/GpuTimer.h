@@ -0,0 +1,54 @@
+#pragma once
+
+#include "pch.h"
+#include "Core/GpuTimestampRing.h"
+
+namespace ISV
+{
+    // D3D12 timestamp queries behind GpuTimestampRing. One query heap
+    // holds every frame in flight's queries and resolves into a readback
+    // buffer with the same layout. A fence signalled with the frame number
+    // after each frame is submitted tells the ring which frames it can
+    // read, so results arrive a couple of frames late but never stall.
+    //
+    //  m_gpuTimer->BeginFrame(cl);
+    //  auto zone = m_gpuTimer->BeginZone("render");
+    //  ...
+    //  m_gpuTimer->EndZone(zone);
+    //  m_gpuTimer->EndFrame();
+    //  // execute cl
+    //  m_gpuTimer->Signal(queue);
+    class GpuTimer : private GpuTimestampRing::QuerySource
+    {
+    public:
+        GpuTimer(ID3D12Device* device,
+            ID3D12CommandQueue* queue,
+            uint32_t framesInFlight,
+            uint32_t maxZonesPerFrame = 32);
+
+        void BeginFrame(ID3D12GraphicsCommandList* cl);
+        GpuTimestampRing::ZoneHandle BeginZone(const char* name);
+        void EndZone(GpuTimestampRing::ZoneHandle zone);
+        void EndFrame();
+
+        // Call after the frame's command list has been executed
+        void Signal(ID3D12CommandQueue* queue);
+
+        const GpuTimestampRing& GetResults() const;
+
+    private:
+        void WriteTimestamp(uint32_t query) override;
+        void ResolveTimestamps(uint32_t first, uint32_t count) override;
+        void ReadTimestamps(uint32_t first, uint32_t count, uint64_t* timestamps) override;
+        uint64_t GetFrequency() const override;
+
+        Microsoft::WRL::ComPtr<ID3D12QueryHeap> m_queryHeap;
+        Microsoft::WRL::ComPtr<ID3D12Resource> m_readback;
+        Microsoft::WRL::ComPtr<ID3D12Fence> m_fence;
+        uint64_t m_frequency = 0;
+
+        GpuTimestampRing m_ring;
+        ID3D12GraphicsCommandList* m_cl = nullptr;
+        uint64_t m_frame = 0;
+    };
+}
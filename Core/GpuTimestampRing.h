@@ -0,0 +1,372 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "FrameTimeHistogram.h"
+
+namespace ISV
+{
+    // Frame and zone bookkeeping for GPU timestamp queries, independent of
+    // the graphics API. The backend supplies a QuerySource that writes and
+    // resolves timestamps; this class decides which queries each zone uses
+    // and when a frame's results can be read.
+    //
+    // The query range is split into one slot per frame in flight. A frame
+    // writes a begin and an end timestamp per zone into its slot and
+    // resolves the slot at the end of the frame. Results are read once
+    // the caller reports that the GPU has finished the frame, which takes
+    // framesInFlight - 1 frames or so, so reading never waits on the GPU.
+    // If a slot comes round again before its frame has finished, that
+    // frame's results are dropped rather than waited for.
+    //
+    //  const uint64_t frame = ring.BeginFrame(completedFrame);
+    //  auto zone = ring.BeginZone("render");
+    //  ...
+    //  ring.EndZone(zone);
+    //  ring.EndFrame();
+    //  // signal frame on the GPU once the frame's work is submitted
+    //
+    // Frame numbers start at 1, so a fence starting at 0 can be passed
+    // straight in as the completed frame.
+    class GpuTimestampRing
+    {
+    public:
+        class QuerySource
+        {
+        public:
+            virtual ~QuerySource() = default;
+
+            // Record a timestamp into query on the GPU
+            virtual void WriteTimestamp(uint32_t query) = 0;
+            // Record copying queries [first, first + count) to where
+            // ReadTimestamps can see them once the GPU is done
+            virtual void ResolveTimestamps(uint32_t first, uint32_t count) = 0;
+            // Read resolved queries from a frame the GPU has finished
+            virtual void ReadTimestamps(uint32_t first, uint32_t count, uint64_t* timestamps) = 0;
+            // Timestamp ticks per second, or 0 if the queue has no
+            // timestamps. Frames are then retired without results.
+            virtual uint64_t GetFrequency() const = 0;
+        };
+
+        struct ZoneHandle
+        {
+            uint32_t Index = UINT32_MAX;
+        };
+
+        struct ZoneStats
+        {
+            std::string Name;
+            // Time in the most recently read frame that had this zone
+            double LastMs = 0.0;
+            // The frame LastMs came from
+            uint64_t LastFrame = 0;
+            // Rolling window of the zone's times, summed over every zone
+            // with the same name in a frame
+            FrameTimeHistogram History;
+        };
+
+        GpuTimestampRing(QuerySource& source,
+            uint32_t framesInFlight,
+            uint32_t maxZonesPerFrame,
+            uint32_t historyFrames = 128);
+
+        // Total queries the backend needs
+        uint32_t GetQueryCount() const;
+        uint32_t GetFramesInFlight() const;
+        uint32_t GetMaxZonesPerFrame() const;
+
+        // Reads every finished frame, then starts the next one. Returns
+        // its frame number.
+        uint64_t BeginFrame(uint64_t completedFrame);
+
+        // Zones may nest and overlap. Names must outlive the frame's
+        // results, string literals are the intended use. Zones past
+        // maxZonesPerFrame are ignored and counted in GetDroppedZones().
+        ZoneHandle BeginZone(const char* name);
+        void EndZone(ZoneHandle zone);
+
+        void EndFrame();
+
+        // Reads frames up to completedFrame without starting a new one
+        void ReadCompletedFrames(uint64_t completedFrame);
+
+        // In order of first appearance
+        const std::vector<ZoneStats>& GetZoneStats() const;
+        const ZoneStats* FindZone(const std::string& name) const;
+
+        // The newest frame whose results have been read
+        uint64_t GetLastReadFrame() const;
+        uint64_t GetDroppedFrames() const;
+        uint64_t GetDroppedZones() const;
+
+    private:
+        struct PendingZone
+        {
+            const char* Name;
+            bool Ended;
+        };
+
+        struct Slot
+        {
+            uint64_t Frame = 0;
+            bool Pending = false;
+            std::vector<PendingZone> Zones;
+        };
+
+        uint32_t GetFirstQuery(uint32_t slot) const;
+        void ReadSlot(Slot& slot, uint32_t slotIndex);
+        ZoneStats& GetOrAddZone(const char* name);
+
+        QuerySource& m_source;
+        uint32_t m_maxZonesPerFrame;
+        uint32_t m_historyFrames;
+
+        std::vector<Slot> m_slots;
+        std::vector<uint64_t> m_timestamps;
+        std::vector<ZoneStats> m_zones;
+
+        uint64_t m_nextFrame = 1;
+        uint32_t m_currentSlot = UINT32_MAX;
+        uint64_t m_lastReadFrame = 0;
+        uint64_t m_droppedFrames = 0;
+        uint64_t m_droppedZones = 0;
+    };
+
+    inline GpuTimestampRing::GpuTimestampRing(QuerySource& source,
+        uint32_t framesInFlight,
+        uint32_t maxZonesPerFrame,
+        uint32_t historyFrames)
+        : m_source(source),
+        m_maxZonesPerFrame(maxZonesPerFrame),
+        m_historyFrames(historyFrames),
+        m_slots(framesInFlight),
+        m_timestamps(static_cast<std::size_t>(maxZonesPerFrame) * 2)
+    {
+        if (framesInFlight == 0 || maxZonesPerFrame == 0)
+        {
+            throw std::runtime_error("GpuTimestampRing needs at least one frame and one zone");
+        }
+
+        for (auto& slot : m_slots)
+        {
+            slot.Zones.reserve(maxZonesPerFrame);
+        }
+    }
+
+    inline uint32_t GpuTimestampRing::GetQueryCount() const
+    {
+        return GetFramesInFlight() * m_maxZonesPerFrame * 2;
+    }
+
+    inline uint32_t GpuTimestampRing::GetFramesInFlight() const
+    {
+        return static_cast<uint32_t>(m_slots.size());
+    }
+
+    inline uint32_t GpuTimestampRing::GetMaxZonesPerFrame() const
+    {
+        return m_maxZonesPerFrame;
+    }
+
+    inline uint64_t GpuTimestampRing::BeginFrame(uint64_t completedFrame)
+    {
+        if (m_currentSlot != UINT32_MAX)
+        {
+            throw std::runtime_error("GpuTimestampRing::BeginFrame called twice without EndFrame");
+        }
+
+        ReadCompletedFrames(completedFrame);
+
+        const uint64_t frame = m_nextFrame++;
+        m_currentSlot = static_cast<uint32_t>(frame % m_slots.size());
+
+        auto& slot = m_slots[m_currentSlot];
+        if (slot.Pending)
+        {
+            // The GPU is further behind than the ring is deep
+            m_droppedFrames++;
+        }
+
+        slot.Frame = frame;
+        slot.Pending = false;
+        slot.Zones.clear();
+
+        return frame;
+    }
+
+    inline GpuTimestampRing::ZoneHandle GpuTimestampRing::BeginZone(const char* name)
+    {
+        if (m_currentSlot == UINT32_MAX)
+        {
+            throw std::runtime_error("GpuTimestampRing::BeginZone called outside a frame");
+        }
+
+        auto& slot = m_slots[m_currentSlot];
+        if (slot.Zones.size() >= m_maxZonesPerFrame)
+        {
+            m_droppedZones++;
+            return {};
+        }
+
+        const auto index = static_cast<uint32_t>(slot.Zones.size());
+        slot.Zones.push_back({ name, false });
+        m_source.WriteTimestamp(GetFirstQuery(m_currentSlot) + index * 2);
+
+        return { index };
+    }
+
+    inline void GpuTimestampRing::EndZone(ZoneHandle zone)
+    {
+        if (m_currentSlot == UINT32_MAX || zone.Index == UINT32_MAX)
+            return;
+
+        auto& slot = m_slots[m_currentSlot];
+        if (zone.Index >= slot.Zones.size() || slot.Zones[zone.Index].Ended)
+            return;
+
+        slot.Zones[zone.Index].Ended = true;
+        m_source.WriteTimestamp(GetFirstQuery(m_currentSlot) + zone.Index * 2 + 1);
+    }
+
+    inline void GpuTimestampRing::EndFrame()
+    {
+        if (m_currentSlot == UINT32_MAX)
+        {
+            throw std::runtime_error("GpuTimestampRing::EndFrame called outside a frame");
+        }
+
+        auto& slot = m_slots[m_currentSlot];
+
+        // Zones left open are closed at the end of the frame
+        for (uint32_t i = 0; i < slot.Zones.size(); i++)
+        {
+            EndZone({ i });
+        }
+
+        if (!slot.Zones.empty())
+        {
+            m_source.ResolveTimestamps(GetFirstQuery(m_currentSlot),
+                static_cast<uint32_t>(slot.Zones.size()) * 2);
+        }
+
+        slot.Pending = true;
+        m_currentSlot = UINT32_MAX;
+    }
+
+    inline void GpuTimestampRing::ReadCompletedFrames(uint64_t completedFrame)
+    {
+        // Oldest first, so LastMs ends up holding the newest frame
+        std::vector<uint32_t> ready;
+        for (uint32_t i = 0; i < m_slots.size(); i++)
+        {
+            if (m_slots[i].Pending && m_slots[i].Frame <= completedFrame)
+            {
+                ready.push_back(i);
+            }
+        }
+
+        std::sort(ready.begin(), ready.end(), [this](uint32_t a, uint32_t b)
+            {
+                return m_slots[a].Frame < m_slots[b].Frame;
+            });
+
+        for (uint32_t i : ready)
+        {
+            ReadSlot(m_slots[i], i);
+        }
+    }
+
+    inline const std::vector<GpuTimestampRing::ZoneStats>& GpuTimestampRing::GetZoneStats() const
+    {
+        return m_zones;
+    }
+
+    inline const GpuTimestampRing::ZoneStats* GpuTimestampRing::FindZone(const std::string& name) const
+    {
+        const auto found = std::find_if(m_zones.begin(), m_zones.end(), [&name](const ZoneStats& zone)
+            {
+                return zone.Name == name;
+            });
+
+        return found != m_zones.end() ? &*found : nullptr;
+    }
+
+    inline uint64_t GpuTimestampRing::GetLastReadFrame() const
+    {
+        return m_lastReadFrame;
+    }
+
+    inline uint64_t GpuTimestampRing::GetDroppedFrames() const
+    {
+        return m_droppedFrames;
+    }
+
+    inline uint64_t GpuTimestampRing::GetDroppedZones() const
+    {
+        return m_droppedZones;
+    }
+
+    inline uint32_t GpuTimestampRing::GetFirstQuery(uint32_t slot) const
+    {
+        return slot * m_maxZonesPerFrame * 2;
+    }
+
+    inline void GpuTimestampRing::ReadSlot(Slot& slot, uint32_t slotIndex)
+    {
+        slot.Pending = false;
+        m_lastReadFrame = std::max(m_lastReadFrame, slot.Frame);
+
+        const uint64_t frequency = m_source.GetFrequency();
+        if (slot.Zones.empty() || frequency == 0)
+            return;
+
+        const auto queryCount = static_cast<uint32_t>(slot.Zones.size()) * 2;
+        m_source.ReadTimestamps(GetFirstQuery(slotIndex), queryCount, m_timestamps.data());
+
+        const double msPerTick = 1000.0 / static_cast<double>(frequency);
+
+        // Zones with the same name are summed, so a pass split over several
+        // zones reads as one
+        std::vector<double> frameMs(m_zones.size(), -1.0);
+
+        for (std::size_t i = 0; i < slot.Zones.size(); i++)
+        {
+            const uint64_t begin = m_timestamps[i * 2];
+            const uint64_t end = m_timestamps[i * 2 + 1];
+            const double ms = end > begin ? (end - begin) * msPerTick : 0.0;
+
+            auto& zone = GetOrAddZone(slot.Zones[i].Name);
+            const auto zoneIndex = static_cast<std::size_t>(&zone - m_zones.data());
+            frameMs.resize(m_zones.size(), -1.0);
+            frameMs[zoneIndex] = std::max(frameMs[zoneIndex], 0.0) + ms;
+        }
+
+        for (std::size_t i = 0; i < m_zones.size(); i++)
+        {
+            if (frameMs[i] < 0.0)
+                continue;
+
+            m_zones[i].LastMs = frameMs[i];
+            m_zones[i].LastFrame = slot.Frame;
+            m_zones[i].History.AddFrame(frameMs[i] / 1000.0);
+        }
+    }
+
+    inline GpuTimestampRing::ZoneStats& GpuTimestampRing::GetOrAddZone(const char* name)
+    {
+        for (auto& zone : m_zones)
+        {
+            if (zone.Name == name)
+            {
+                return zone;
+            }
+        }
+
+        m_zones.push_back({ name, 0.0, 0, FrameTimeHistogram(m_historyFrames) });
+        return m_zones.back();
+    }
+}
@@ -0,0 +1,311 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "InstanceLayout.h"
+#include "ParallelFor.h"
+#include "VolShadowEncoding.h"
+
+namespace ISV
+{
+    // CPU mirror of Shaders/InstanceCompression.hlsli, used to check how much
+    // precision the 16 byte instance encoding loses against InstanceData.
+    class InstanceCompression
+    {
+    public:
+        using RenderInstance = InstanceLayout::RenderInstance;
+        using CompressedInstance = std::array<uint32_t, 4>;
+
+        static constexpr uint32_t ClusterSize = 256;
+        static constexpr float MaxExtinctionScale = 8.f;
+
+        // Same layout as the HLSL InstanceCluster
+        struct Cluster
+        {
+            std::array<float, 3> Origin;
+            float Extent;
+        };
+
+        static_assert(sizeof(CompressedInstance) == 16, "Must match the HLSL uint4 stride");
+        static_assert(sizeof(Cluster) == 16, "Must match the HLSL InstanceCluster stride");
+
+        struct Report
+        {
+            float MaxPositionError = 0.f;
+            float MaxScaleError = 0.f;
+            // Angle between the original and decoded rotations, in radians
+            float MaxRotationError = 0.f;
+            float MaxExtinctionError = 0.f;
+            std::size_t RawBytes = 0;
+            std::size_t CompressedBytes = 0;
+        };
+
+        static uint32_t GetClusterCount(std::size_t instanceCount);
+
+        static Cluster ComputeCluster(const RenderInstance* instances, std::size_t count);
+
+        static CompressedInstance Encode(const RenderInstance& instance, const Cluster& cluster);
+        static RenderInstance Decode(const CompressedInstance& packed, const Cluster& cluster);
+
+        static void EncodeAll(const std::vector<RenderInstance>& instances,
+            std::vector<CompressedInstance>& compressed,
+            std::vector<Cluster>& clusters,
+            uint32_t threadCount = 1);
+
+        static void DecodeAll(const std::vector<CompressedInstance>& compressed,
+            const std::vector<Cluster>& clusters,
+            std::vector<RenderInstance>& instances,
+            uint32_t threadCount = 1);
+
+        // Round trips every instance and reports the worst error per field
+        static Report Measure(const std::vector<RenderInstance>& instances);
+
+        // Smallest three, 10 bits per component plus the dropped index
+        static uint32_t EncodeQuaternion(const std::array<float, 4>& q);
+        static std::array<float, 4> DecodeQuaternion(uint32_t packed);
+
+    private:
+        static uint32_t QuantizeUnorm(float value, float maxValue, uint32_t bits);
+    };
+
+    inline uint32_t InstanceCompression::GetClusterCount(std::size_t instanceCount)
+    {
+        return static_cast<uint32_t>((instanceCount + ClusterSize - 1) / ClusterSize);
+    }
+
+    inline InstanceCompression::Cluster InstanceCompression::ComputeCluster(
+        const RenderInstance* instances,
+        std::size_t count)
+    {
+        std::array<float, 3> boundsMin = { 1e30f, 1e30f, 1e30f };
+        std::array<float, 3> boundsMax = { -1e30f, -1e30f, -1e30f };
+
+        for (std::size_t i = 0; i < count; i++)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                boundsMin[axis] = std::min(boundsMin[axis], instances[i].Position[axis]);
+                boundsMax[axis] = std::max(boundsMax[axis], instances[i].Position[axis]);
+            }
+        }
+
+        Cluster cluster;
+        cluster.Origin = boundsMin;
+        cluster.Extent = std::max({ boundsMax[0] - boundsMin[0],
+            boundsMax[1] - boundsMin[1],
+            boundsMax[2] - boundsMin[2],
+            1e-6f });
+
+        return cluster;
+    }
+
+    inline InstanceCompression::CompressedInstance InstanceCompression::Encode(
+        const RenderInstance& instance,
+        const Cluster& cluster)
+    {
+        std::array<uint32_t, 3> position;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            position[axis] = QuantizeUnorm(instance.Position[axis] - cluster.Origin[axis], cluster.Extent, 16);
+        }
+
+        const uint32_t scale = VolShadowEncoding::FloatToHalf(instance.Scale);
+        const uint32_t extinction = QuantizeUnorm(instance.ExtinctionScale, MaxExtinctionScale, 8);
+
+        return {
+            position[0] | (position[1] << 16),
+            position[2] | (scale << 16),
+            EncodeQuaternion(instance.RotationQuat),
+            extinction
+        };
+    }
+
+    inline InstanceCompression::RenderInstance InstanceCompression::Decode(
+        const CompressedInstance& packed,
+        const Cluster& cluster)
+    {
+        const std::array<uint32_t, 3> position = {
+            packed[0] & 0xffff,
+            packed[0] >> 16,
+            packed[1] & 0xffff
+        };
+
+        RenderInstance instance;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            instance.Position[axis] = cluster.Origin[axis] + position[axis] / 65535.f * cluster.Extent;
+        }
+
+        instance.Scale = VolShadowEncoding::HalfToFloat(static_cast<uint16_t>(packed[1] >> 16));
+        instance.RotationQuat = DecodeQuaternion(packed[2]);
+        instance.ExtinctionScale = (packed[3] & 0xff) / 255.f * MaxExtinctionScale;
+
+        return instance;
+    }
+
+    inline void InstanceCompression::EncodeAll(const std::vector<RenderInstance>& instances,
+        std::vector<CompressedInstance>& compressed,
+        std::vector<Cluster>& clusters,
+        uint32_t threadCount)
+    {
+        const uint32_t clusterCount = GetClusterCount(instances.size());
+
+        compressed.resize(instances.size());
+        clusters.resize(clusterCount);
+
+        ParallelFor(clusterCount, threadCount, [&](uint32_t begin, uint32_t end, uint32_t)
+            {
+                for (uint32_t c = begin; c < end; c++)
+                {
+                    const std::size_t first = static_cast<std::size_t>(c) * ClusterSize;
+                    const std::size_t last = std::min(instances.size(), first + ClusterSize);
+
+                    clusters[c] = ComputeCluster(&instances[first], last - first);
+
+                    for (std::size_t i = first; i < last; i++)
+                    {
+                        compressed[i] = Encode(instances[i], clusters[c]);
+                    }
+                }
+            });
+    }
+
+    inline void InstanceCompression::DecodeAll(const std::vector<CompressedInstance>& compressed,
+        const std::vector<Cluster>& clusters,
+        std::vector<RenderInstance>& instances,
+        uint32_t threadCount)
+    {
+        instances.resize(compressed.size());
+
+        ParallelFor(static_cast<uint32_t>(compressed.size()), threadCount,
+            [&](uint32_t begin, uint32_t end, uint32_t)
+            {
+                for (uint32_t i = begin; i < end; i++)
+                {
+                    instances[i] = Decode(compressed[i], clusters[i / ClusterSize]);
+                }
+            });
+    }
+
+    inline InstanceCompression::Report InstanceCompression::Measure(
+        const std::vector<RenderInstance>& instances)
+    {
+        std::vector<CompressedInstance> compressed;
+        std::vector<Cluster> clusters;
+        std::vector<RenderInstance> decoded;
+
+        EncodeAll(instances, compressed, clusters);
+        DecodeAll(compressed, clusters, decoded);
+
+        Report report;
+        report.RawBytes = instances.size() * sizeof(RenderInstance);
+        report.CompressedBytes = compressed.size() * sizeof(CompressedInstance)
+            + clusters.size() * sizeof(Cluster);
+
+        for (std::size_t i = 0; i < instances.size(); i++)
+        {
+            const auto& a = instances[i];
+            const auto& b = decoded[i];
+
+            for (int axis = 0; axis < 3; axis++)
+            {
+                report.MaxPositionError = std::max(report.MaxPositionError,
+                    std::abs(a.Position[axis] - b.Position[axis]));
+            }
+
+            report.MaxScaleError = std::max(report.MaxScaleError, std::abs(a.Scale - b.Scale));
+            report.MaxExtinctionError = std::max(report.MaxExtinctionError,
+                std::abs(std::min(a.ExtinctionScale, MaxExtinctionScale) - b.ExtinctionScale));
+
+            // q and -q are the same rotation
+            float dot = 0.f;
+            float lengthSquared = 0.f;
+            for (int j = 0; j < 4; j++)
+            {
+                dot += a.RotationQuat[j] * b.RotationQuat[j];
+                lengthSquared += a.RotationQuat[j] * a.RotationQuat[j];
+            }
+
+            const float cosHalfAngle = std::min(1.f, std::abs(dot) / std::sqrt(lengthSquared));
+            report.MaxRotationError = std::max(report.MaxRotationError, 2.f * std::acos(cosHalfAngle));
+        }
+
+        return report;
+    }
+
+    inline uint32_t InstanceCompression::EncodeQuaternion(const std::array<float, 4>& q)
+    {
+        // Same as PackQuaternion in Quaternion.hlsli, which keeps the last
+        // of equally large components
+        uint32_t maxIndex = 0;
+        float maxAbs = -1.f;
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            if (std::abs(q[i]) >= maxAbs)
+            {
+                maxAbs = std::abs(q[i]);
+                maxIndex = i;
+            }
+        }
+
+        const float sign = q[maxIndex] < 0.f ? -1.f : 1.f;
+        const float maxRange = 0.70710678f;
+
+        uint32_t packed = maxIndex << 30;
+        uint32_t shift = 0;
+
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            if (i == maxIndex)
+                continue;
+
+            const float unorm = (sign * q[i] / maxRange) * 0.5f + 0.5f;
+            packed |= QuantizeUnorm(unorm, 1.f, 10) << shift;
+            shift += 10;
+        }
+
+        return packed;
+    }
+
+    inline std::array<float, 4> InstanceCompression::DecodeQuaternion(uint32_t packed)
+    {
+        const float maxRange = 0.70710678f;
+        const uint32_t maxIndex = packed >> 30;
+
+        std::array<float, 4> q;
+        float sumSquares = 0.f;
+        uint32_t shift = 0;
+
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            if (i == maxIndex)
+                continue;
+
+            const float unorm = ((packed >> shift) & 0x3ff) / 1023.f;
+            q[i] = (unorm * 2.f - 1.f) * maxRange;
+            sumSquares += q[i] * q[i];
+            shift += 10;
+        }
+
+        q[maxIndex] = std::sqrt(1.f - std::clamp(sumSquares, 0.f, 1.f));
+
+        const float length = std::sqrt(sumSquares + q[maxIndex] * q[maxIndex]);
+        for (auto& component : q)
+        {
+            component /= length;
+        }
+
+        return q;
+    }
+
+    inline uint32_t InstanceCompression::QuantizeUnorm(float value, float maxValue, uint32_t bits)
+    {
+        const float unorm = std::clamp(value / maxValue, 0.f, 1.f);
+        return static_cast<uint32_t>(std::round(unorm * static_cast<float>((1u << bits) - 1)));
+    }
+}
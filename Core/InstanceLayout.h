@@ -0,0 +1,207 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+#include "ParticleSimulation.h"
+
+namespace ISV
+{
+    // CPU mirror of the particle instance streams in CommonPipeline.hlsli,
+    // plus a model of how many bytes each GPU pass pulls in for a given
+    // instance layout.
+    class InstanceLayout
+    {
+    public:
+        // Same layout as Game::InstanceData
+        struct RenderInstance
+        {
+            std::array<float, 3> Position;
+            float Scale;
+            std::array<float, 4> RotationQuat;
+            float ExtinctionScale;
+        };
+
+        // Same layout as Game::InstanceSimulationData
+        struct SimulationInstance
+        {
+            std::array<float, 3> Velocity;
+            float Mass;
+            std::array<float, 3> TargetPosition;
+        };
+
+        static_assert(sizeof(RenderInstance) == 36, "Must match the HLSL InstanceData stride");
+        static_assert(sizeof(SimulationInstance) == 28, "Must match the HLSL InstanceSimulationData stride");
+
+        // The single 64 byte record used before the split
+        struct InterleavedInstance
+        {
+            std::array<float, 3> Position;
+            float ExtinctionScale;
+            std::array<float, 3> Velocity;
+            float Mass;
+            std::array<float, 3> TargetPosition;
+            float Scale;
+            std::array<float, 4> RotationQuat;
+        };
+
+        enum class Layout
+        {
+            Interleaved,
+            Split
+        };
+
+        enum class Pass
+        {
+            // WriteSortingKeys_CS: position
+            WriteSortingKeys,
+            // Sphere_MS, VolShadowSphere_MS, VolShadowSplat_CS: position, scale, extinction
+            SphereProxies,
+            // Tetrahedron_MS: position, scale, extinction, rotation
+            Tetrahedra,
+            // SimulateParticles_CS: everything except rotation and extinction
+            Simulate
+        };
+
+        struct PassTraffic
+        {
+            // Bytes the pass actually uses per particle
+            double UsefulBytes;
+            // Bytes pulled in per particle when memory moves in whole sectors
+            double FetchedBytes;
+        };
+
+        static void Split(const std::vector<ParticleSimulation::Particle>& particles,
+            std::vector<RenderInstance>& render,
+            std::vector<SimulationInstance>& simulation);
+
+        static PassTraffic MeasureTraffic(Pass pass,
+            Layout layout,
+            uint32_t particleCount,
+            uint32_t sectorSize = 32);
+
+    private:
+        struct Field
+        {
+            uint32_t Stream;
+            uint32_t Offset;
+            uint32_t Size;
+        };
+
+        static std::vector<Field> GetFields(Pass pass, Layout layout);
+    };
+
+    inline void InstanceLayout::Split(const std::vector<ParticleSimulation::Particle>& particles,
+        std::vector<RenderInstance>& render,
+        std::vector<SimulationInstance>& simulation)
+    {
+        render.resize(particles.size());
+        simulation.resize(particles.size());
+
+        for (std::size_t i = 0; i < particles.size(); i++)
+        {
+            const auto& p = particles[i];
+            render[i] = { p.Position, p.Scale, p.RotationQuat, p.ExtinctionScale };
+            simulation[i] = { p.Velocity, p.Mass, p.TargetPosition };
+        }
+    }
+
+    inline InstanceLayout::PassTraffic InstanceLayout::MeasureTraffic(Pass pass,
+        Layout layout,
+        uint32_t particleCount,
+        uint32_t sectorSize)
+    {
+        const auto fields = GetFields(pass, layout);
+
+        const std::array<uint64_t, 2> strides = layout == Layout::Interleaved
+            ? std::array<uint64_t, 2>{ sizeof(InterleavedInstance), 0 }
+            : std::array<uint64_t, 2>{ sizeof(RenderInstance), sizeof(SimulationInstance) };
+
+        // Each stream is assumed to start on a sector boundary
+        std::array<std::unordered_set<uint64_t>, 2> sectors;
+        uint64_t usefulBytes = 0;
+
+        for (uint32_t i = 0; i < particleCount; i++)
+        {
+            for (const auto& field : fields)
+            {
+                const uint64_t begin = i * strides[field.Stream] + field.Offset;
+                const uint64_t end = begin + field.Size;
+
+                for (uint64_t sector = begin / sectorSize; sector <= (end - 1) / sectorSize; sector++)
+                {
+                    sectors[field.Stream].insert(sector);
+                }
+
+                usefulBytes += field.Size;
+            }
+        }
+
+        PassTraffic traffic = { 0.0, 0.0 };
+        if (particleCount == 0)
+        {
+            return traffic;
+        }
+
+        traffic.UsefulBytes = static_cast<double>(usefulBytes) / particleCount;
+        traffic.FetchedBytes = static_cast<double>((sectors[0].size() + sectors[1].size()) * sectorSize)
+            / particleCount;
+
+        return traffic;
+    }
+
+    inline std::vector<InstanceLayout::Field> InstanceLayout::GetFields(Pass pass, Layout layout)
+    {
+        auto interleaved = [](std::size_t offset, std::size_t size)
+            {
+                return Field{ 0, static_cast<uint32_t>(offset), static_cast<uint32_t>(size) };
+            };
+        auto render = [](std::size_t offset, std::size_t size)
+            {
+                return Field{ 0, static_cast<uint32_t>(offset), static_cast<uint32_t>(size) };
+            };
+        auto simulation = [](std::size_t offset, std::size_t size)
+            {
+                return Field{ 1, static_cast<uint32_t>(offset), static_cast<uint32_t>(size) };
+            };
+
+        const bool split = layout == Layout::Split;
+
+        const Field position = split
+            ? render(offsetof(RenderInstance, Position), 12)
+            : interleaved(offsetof(InterleavedInstance, Position), 12);
+        const Field scale = split
+            ? render(offsetof(RenderInstance, Scale), 4)
+            : interleaved(offsetof(InterleavedInstance, Scale), 4);
+        const Field extinction = split
+            ? render(offsetof(RenderInstance, ExtinctionScale), 4)
+            : interleaved(offsetof(InterleavedInstance, ExtinctionScale), 4);
+        const Field rotation = split
+            ? render(offsetof(RenderInstance, RotationQuat), 16)
+            : interleaved(offsetof(InterleavedInstance, RotationQuat), 16);
+        const Field velocity = split
+            ? simulation(offsetof(SimulationInstance, Velocity), 12)
+            : interleaved(offsetof(InterleavedInstance, Velocity), 12);
+        const Field mass = split
+            ? simulation(offsetof(SimulationInstance, Mass), 4)
+            : interleaved(offsetof(InterleavedInstance, Mass), 4);
+        const Field target = split
+            ? simulation(offsetof(SimulationInstance, TargetPosition), 12)
+            : interleaved(offsetof(InterleavedInstance, TargetPosition), 12);
+
+        switch (pass)
+        {
+        case Pass::WriteSortingKeys:
+            return { position };
+        case Pass::SphereProxies:
+            return { position, scale, extinction };
+        case Pass::Tetrahedra:
+            return { position, scale, extinction, rotation };
+        default:
+            return { position, scale, velocity, mass, target };
+        }
+    }
+}
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ISV
+{
+    // Read only memory mapping of a whole file. The mapping stays valid
+    // until the object is destroyed or moved from.
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        explicit MappedFile(const std::string& path);
+        ~MappedFile();
+
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const uint8_t* GetData() const;
+        std::size_t GetSize() const;
+
+        // Hints that [offset, offset + size) will be read soon
+        void Prefetch(std::size_t offset, std::size_t size) const;
+
+    private:
+        void Close();
+
+        const uint8_t* m_data = nullptr;
+        std::size_t m_size = 0;
+
+#ifdef _WIN32
+        HANDLE m_file = INVALID_HANDLE_VALUE;
+        HANDLE m_mapping = nullptr;
+#endif
+    };
+
+    inline MappedFile::MappedFile(const std::string& path)
+    {
+#ifdef _WIN32
+        m_file = CreateFileA(path.c_str(),
+            GENERIC_READ,
+            FILE_SHARE_READ,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+            nullptr);
+
+        if (m_file == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error("Could not open " + path);
+        }
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(m_file, &size))
+        {
+            Close();
+            throw std::runtime_error("Could not get the size of " + path);
+        }
+
+        m_size = static_cast<std::size_t>(size.QuadPart);
+        if (m_size == 0)
+        {
+            return;
+        }
+
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping == nullptr)
+        {
+            Close();
+            throw std::runtime_error("Could not map " + path);
+        }
+
+        m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        if (m_data == nullptr)
+        {
+            Close();
+            throw std::runtime_error("Could not map " + path);
+        }
+#else
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Could not open " + path);
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0)
+        {
+            close(fd);
+            throw std::runtime_error("Could not get the size of " + path);
+        }
+
+        m_size = static_cast<std::size_t>(info.st_size);
+        if (m_size > 0)
+        {
+            void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED)
+            {
+                close(fd);
+                m_size = 0;
+                throw std::runtime_error("Could not map " + path);
+            }
+
+            m_data = static_cast<const uint8_t*>(data);
+        }
+
+        // The mapping keeps its own reference to the file
+        close(fd);
+#endif
+    }
+
+    inline MappedFile::~MappedFile()
+    {
+        Close();
+    }
+
+    inline MappedFile::MappedFile(MappedFile&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    inline MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Close();
+
+            m_data = other.m_data;
+            m_size = other.m_size;
+            other.m_data = nullptr;
+            other.m_size = 0;
+
+#ifdef _WIN32
+            m_file = other.m_file;
+            m_mapping = other.m_mapping;
+            other.m_file = INVALID_HANDLE_VALUE;
+            other.m_mapping = nullptr;
+#endif
+        }
+
+        return *this;
+    }
+
+    inline const uint8_t* MappedFile::GetData() const
+    {
+        return m_data;
+    }
+
+    inline std::size_t MappedFile::GetSize() const
+    {
+        return m_size;
+    }
+
+    inline void MappedFile::Prefetch(std::size_t offset, std::size_t size) const
+    {
+        if (m_data == nullptr || offset >= m_size)
+            return;
+
+        if (size > m_size - offset)
+        {
+            size = m_size - offset;
+        }
+
+#ifdef _WIN32
+        WIN32_MEMORY_RANGE_ENTRY range;
+        range.VirtualAddress = const_cast<uint8_t*>(m_data + offset);
+        range.NumberOfBytes = size;
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+        // madvise wants a page aligned start
+        const std::size_t pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        const std::size_t alignedOffset = offset - offset % pageSize;
+        madvise(const_cast<uint8_t*>(m_data + alignedOffset),
+            size + (offset - alignedOffset),
+            MADV_WILLNEED);
+#endif
+    }
+
+    inline void MappedFile::Close()
+    {
+#ifdef _WIN32
+        if (m_data != nullptr)
+        {
+            UnmapViewOfFile(m_data);
+        }
+        if (m_mapping != nullptr)
+        {
+            CloseHandle(m_mapping);
+        }
+        if (m_file != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(m_file);
+        }
+
+        m_mapping = nullptr;
+        m_file = INVALID_HANDLE_VALUE;
+#else
+        if (m_data != nullptr)
+        {
+            munmap(const_cast<uint8_t*>(m_data), m_size);
+        }
+#endif
+
+        m_data = nullptr;
+        m_size = 0;
+    }
+}
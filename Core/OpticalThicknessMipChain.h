@@ -0,0 +1,236 @@
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ISV
+{
+    // CPU mirror of the optical thickness volume's mip chain, built with the
+    // same box filter as VolShadowMip_CS.hlsl and sampled like SampleLevel
+    // with a trilinear clamp sampler.
+    class OpticalThicknessMipChain
+    {
+    public:
+        struct Level
+        {
+            uint32_t Width;
+            uint32_t Height;
+            uint32_t Depth;
+            std::vector<float> Texels;
+
+            float Load(uint32_t x, uint32_t y, uint32_t z) const;
+            float Sample(float u, float v, float w) const;
+            std::size_t GetSizeInBytes() const;
+        };
+
+        // The volume is laid out like a D3D12 3D subresource: x fastest, then y, then z.
+        OpticalThicknessMipChain(const float* volume,
+            uint32_t width,
+            uint32_t height,
+            uint32_t depth);
+
+        static uint32_t GetMipCount(uint32_t width, uint32_t height, uint32_t depth);
+
+        // Mirrors VolumetricShadowLod in VolumetricLighting.hlsli
+        static float SelectLod(float footprint, float texelSize, float lodScale, uint32_t mipCount);
+
+        float SampleLevel(float u, float v, float w, float lod) const;
+
+        const Level& GetLevel(uint32_t mip) const;
+        uint32_t GetMipCount() const;
+        std::size_t GetSizeInBytes() const;
+
+    private:
+        static Level Downsample(const Level& source);
+
+        std::vector<Level> m_levels;
+    };
+
+    inline float OpticalThicknessMipChain::Level::Load(uint32_t x, uint32_t y, uint32_t z) const
+    {
+        return Texels[(static_cast<std::size_t>(z) * Height + y) * Width + x];
+    }
+
+    inline float OpticalThicknessMipChain::Level::Sample(float u, float v, float w) const
+    {
+        const std::array<float, 3> uvw = { u, v, w };
+        const std::array<uint32_t, 3> extents = { Width, Height, Depth };
+
+        std::array<uint32_t, 3> i0;
+        std::array<uint32_t, 3> i1;
+        std::array<float, 3> t;
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            const float f = std::clamp(uvw[axis], 0.f, 1.f) * extents[axis] - 0.5f;
+            const float floorF = std::floor(f);
+            const int maxIndex = static_cast<int>(extents[axis]) - 1;
+
+            t[axis] = f - floorF;
+            i0[axis] = static_cast<uint32_t>(std::clamp(static_cast<int>(floorF), 0, maxIndex));
+            i1[axis] = static_cast<uint32_t>(std::clamp(static_cast<int>(floorF) + 1, 0, maxIndex));
+        }
+
+        auto lerp = [](float a, float b, float s) { return a + s * (b - a); };
+
+        const float c00 = lerp(Load(i0[0], i0[1], i0[2]), Load(i1[0], i0[1], i0[2]), t[0]);
+        const float c10 = lerp(Load(i0[0], i1[1], i0[2]), Load(i1[0], i1[1], i0[2]), t[0]);
+        const float c01 = lerp(Load(i0[0], i0[1], i1[2]), Load(i1[0], i0[1], i1[2]), t[0]);
+        const float c11 = lerp(Load(i0[0], i1[1], i1[2]), Load(i1[0], i1[1], i1[2]), t[0]);
+
+        return lerp(lerp(c00, c10, t[1]), lerp(c01, c11, t[1]), t[2]);
+    }
+
+    inline std::size_t OpticalThicknessMipChain::Level::GetSizeInBytes() const
+    {
+        return Texels.size() * sizeof(float);
+    }
+
+    inline OpticalThicknessMipChain::OpticalThicknessMipChain(const float* volume,
+        uint32_t width,
+        uint32_t height,
+        uint32_t depth)
+    {
+        const uint32_t mipCount = GetMipCount(width, height, depth);
+        m_levels.reserve(mipCount);
+
+        Level base;
+        base.Width = width;
+        base.Height = height;
+        base.Depth = depth;
+        base.Texels.assign(volume, volume + static_cast<std::size_t>(width) * height * depth);
+        m_levels.push_back(std::move(base));
+
+        for (uint32_t mip = 1; mip < mipCount; mip++)
+        {
+            m_levels.push_back(Downsample(m_levels.back()));
+        }
+    }
+
+    inline uint32_t OpticalThicknessMipChain::GetMipCount(uint32_t width, uint32_t height, uint32_t depth)
+    {
+        uint32_t largest = std::max({ width, height, depth, 1u });
+        uint32_t count = 1;
+
+        while (largest > 1)
+        {
+            largest >>= 1;
+            count++;
+        }
+
+        return count;
+    }
+
+    inline float OpticalThicknessMipChain::SelectLod(float footprint,
+        float texelSize,
+        float lodScale,
+        uint32_t mipCount)
+    {
+        if (lodScale <= 0.f || texelSize <= 0.f || mipCount == 0)
+        {
+            return 0.f;
+        }
+
+        const float texels = footprint * lodScale / texelSize;
+        return std::clamp(std::log2(std::max(1.f, texels)), 0.f, mipCount - 1.f);
+    }
+
+    inline float OpticalThicknessMipChain::SampleLevel(float u, float v, float w, float lod) const
+    {
+        lod = std::clamp(lod, 0.f, static_cast<float>(m_levels.size() - 1));
+
+        const uint32_t lower = static_cast<uint32_t>(std::floor(lod));
+        const uint32_t upper = std::min(lower + 1, static_cast<uint32_t>(m_levels.size() - 1));
+        const float t = lod - lower;
+
+        const float a = m_levels[lower].Sample(u, v, w);
+        if (upper == lower || t == 0.f)
+        {
+            return a;
+        }
+
+        const float b = m_levels[upper].Sample(u, v, w);
+        return a + t * (b - a);
+    }
+
+    inline const OpticalThicknessMipChain::Level& OpticalThicknessMipChain::GetLevel(uint32_t mip) const
+    {
+        return m_levels[mip];
+    }
+
+    inline uint32_t OpticalThicknessMipChain::GetMipCount() const
+    {
+        return static_cast<uint32_t>(m_levels.size());
+    }
+
+    inline std::size_t OpticalThicknessMipChain::GetSizeInBytes() const
+    {
+        std::size_t total = 0;
+        for (const auto& level : m_levels)
+        {
+            total += level.GetSizeInBytes();
+        }
+
+        return total;
+    }
+
+    inline OpticalThicknessMipChain::Level OpticalThicknessMipChain::Downsample(const Level& source)
+    {
+        Level out;
+        out.Width = std::max(1u, source.Width >> 1);
+        out.Height = std::max(1u, source.Height >> 1);
+        out.Depth = std::max(1u, source.Depth >> 1);
+        out.Texels.resize(static_cast<std::size_t>(out.Width) * out.Height * out.Depth);
+
+        const std::array<uint32_t, 3> srcSize = { source.Width, source.Height, source.Depth };
+        const std::array<uint32_t, 3> dstSize = { out.Width, out.Height, out.Depth };
+
+        for (uint32_t z = 0; z < out.Depth; z++)
+        {
+            for (uint32_t y = 0; y < out.Height; y++)
+            {
+                for (uint32_t x = 0; x < out.Width; x++)
+                {
+                    const std::array<uint32_t, 3> dst = { x, y, z };
+                    std::array<uint32_t, 3> first;
+                    std::array<uint32_t, 3> last;
+
+                    for (int axis = 0; axis < 3; axis++)
+                    {
+                        first[axis] = dst[axis] * 2;
+                        last[axis] = std::min(first[axis] + 1, srcSize[axis] - 1);
+
+                        // Odd sized axes fold their last texel into the last destination texel
+                        if (dst[axis] == dstSize[axis] - 1)
+                        {
+                            last[axis] = srcSize[axis] - 1;
+                        }
+                    }
+
+                    float sum = 0.f;
+                    uint32_t count = 0;
+
+                    for (uint32_t sz = first[2]; sz <= last[2]; sz++)
+                    {
+                        for (uint32_t sy = first[1]; sy <= last[1]; sy++)
+                        {
+                            for (uint32_t sx = first[0]; sx <= last[0]; sx++)
+                            {
+                                sum += source.Load(sx, sy, sz);
+                                count++;
+                            }
+                        }
+                    }
+
+                    out.Texels[(static_cast<std::size_t>(z) * out.Height + y) * out.Width + x] = sum / count;
+                }
+            }
+        }
+
+        return out;
+    }
+}
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ISV
+{
+    // The threads ParallelFor runs its ranges on. Workers are started the
+    // first time a call needs that many and then sleep until the next call,
+    // so once the pool is big enough a call neither creates threads nor
+    // allocates.
+    //
+    // One call uses the pool at a time; a call from another thread waits
+    // for it. A call made from inside a range runs all of its ranges in
+    // order on the thread that made it.
+    class WorkerPool
+    {
+    public:
+        WorkerPool() = default;
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        // The pool shared by every ParallelFor call
+        static WorkerPool& Get();
+
+        // Calls fn(begin, end, threadIndex) for threadCount contiguous ranges
+        // of [0, count), range 0 on the calling thread, and returns once all
+        // of them have. An exception thrown by a range is rethrown here after
+        // the other ranges finish.
+        template<typename Fn>
+        void Run(uint32_t count, uint32_t threadCount, Fn& fn);
+
+        uint32_t GetWorkerCount() const;
+
+    private:
+        using RangeFn = void (*)(void* context, uint32_t begin, uint32_t end, uint32_t threadIndex);
+
+        struct Job
+        {
+            RangeFn Range = nullptr;
+            void* Context = nullptr;
+            uint32_t Count = 0;
+            uint32_t Chunk = 0;
+            uint32_t ThreadCount = 0;
+        };
+
+        void Dispatch(const Job& job);
+        void WorkerLoop(uint32_t threadIndex, uint64_t generation);
+        static void RunRange(const Job& job, uint32_t threadIndex);
+
+        static thread_local bool s_insideRange;
+
+        std::mutex m_dispatchMutex;
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_done;
+        std::vector<std::thread> m_workers;
+        Job m_job;
+        uint64_t m_generation = 0;
+        uint32_t m_pending = 0;
+        std::exception_ptr m_error;
+        bool m_stop = false;
+    };
+
+    inline thread_local bool WorkerPool::s_insideRange = false;
+
+    // Splits [0, count) into threadCount contiguous ranges and calls
+    // fn(begin, end, threadIndex) for each one. Range 0 runs on the calling
+    // thread and the rest on the shared WorkerPool. Ranges are assigned in
+    // order, so anything that concatenates per-range results by thread index
+    // stays deterministic.
+    template<typename Fn>
+    void ParallelFor(uint32_t count, uint32_t threadCount, Fn&& fn)
+    {
+        threadCount = std::max(1u, std::min(threadCount, count));
+
+        if (threadCount == 1)
+        {
+            fn(0u, count, 0u);
+            return;
+        }
+
+        WorkerPool::Get().Run(count, threadCount, fn);
+    }
+
+    inline uint32_t GetDefaultThreadCount()
+    {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    inline WorkerPool::~WorkerPool()
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+
+        for (auto& worker : m_workers)
+        {
+            worker.join();
+        }
+    }
+
+    inline WorkerPool& WorkerPool::Get()
+    {
+        static WorkerPool pool;
+        return pool;
+    }
+
+    template<typename Fn>
+    void WorkerPool::Run(uint32_t count, uint32_t threadCount, Fn& fn)
+    {
+        Job job;
+        job.Range = [](void* context, uint32_t begin, uint32_t end, uint32_t threadIndex)
+            {
+                (*static_cast<Fn*>(context))(begin, end, threadIndex);
+            };
+        job.Context = const_cast<void*>(static_cast<const void*>(&fn));
+        job.Count = count;
+        job.ThreadCount = std::max(1u, threadCount);
+        job.Chunk = (count + job.ThreadCount - 1) / job.ThreadCount;
+
+        Dispatch(job);
+    }
+
+    inline uint32_t WorkerPool::GetWorkerCount() const
+    {
+        std::lock_guard lock(m_mutex);
+        return static_cast<uint32_t>(m_workers.size());
+    }
+
+    inline void WorkerPool::Dispatch(const Job& job)
+    {
+        if (s_insideRange || job.ThreadCount == 1)
+        {
+            for (uint32_t t = 0; t < job.ThreadCount; t++)
+            {
+                RunRange(job, t);
+            }
+            return;
+        }
+
+        std::lock_guard dispatchLock(m_dispatchMutex);
+
+        {
+            std::lock_guard lock(m_mutex);
+
+            // New workers start at the current generation, so they pick up
+            // this job rather than waiting for the next one
+            while (m_workers.size() + 1 < job.ThreadCount)
+            {
+                const auto threadIndex = static_cast<uint32_t>(m_workers.size() + 1);
+                m_workers.emplace_back(&WorkerPool::WorkerLoop, this, threadIndex, m_generation);
+            }
+
+            m_job = job;
+            m_pending = job.ThreadCount - 1;
+            m_error = nullptr;
+            m_generation++;
+        }
+        m_wake.notify_all();
+
+        std::exception_ptr error;
+        s_insideRange = true;
+        try
+        {
+            RunRange(job, 0);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        s_insideRange = false;
+
+        // The workers still hold fn, so wait for them even if range 0 threw
+        {
+            std::unique_lock lock(m_mutex);
+            m_done.wait(lock, [this]() { return m_pending == 0; });
+            if (!error)
+            {
+                error = m_error;
+            }
+        }
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+    inline void WorkerPool::WorkerLoop(uint32_t threadIndex, uint64_t generation)
+    {
+        s_insideRange = true;
+
+        std::unique_lock lock(m_mutex);
+
+        while (true)
+        {
+            // Workers past the job's thread count sleep through it
+            m_wake.wait(lock, [&]()
+                {
+                    return m_stop || (m_generation != generation && threadIndex < m_job.ThreadCount);
+                });
+
+            if (m_stop)
+                return;
+
+            generation = m_generation;
+            const Job job = m_job;
+            lock.unlock();
+
+            std::exception_ptr error;
+            try
+            {
+                RunRange(job, threadIndex);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            lock.lock();
+            if (error && !m_error)
+            {
+                m_error = error;
+            }
+
+            if (--m_pending == 0)
+            {
+                m_done.notify_one();
+            }
+        }
+    }
+
+    inline void WorkerPool::RunRange(const Job& job, uint32_t threadIndex)
+    {
+        const uint32_t begin = std::min(job.Count, threadIndex * job.Chunk);
+        const uint32_t end = std::min(job.Count, begin + job.Chunk);
+        job.Range(job.Context, begin, end, threadIndex);
+    }
+}
@@ -0,0 +1,378 @@
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "Gradient/FreeSlotStack.h"
+
+#include "ParallelFor.h"
+#include "ParticleSimulation.h"
+
+namespace ISV
+{
+    // Spawns particles into a fixed size pool and retires them when their
+    // lifetime runs out.
+    //
+    // Retired slots go on a lock-free free slot stack and are reused by the
+    // next spawns, so the pool never grows and a particle's slot never moves
+    // while it's alive. Dead slots are left in place with a zero scale and
+    // extinction so the whole pool can be split into the instance streams
+    // with InstanceLayout and uploaded without compacting it first.
+    //
+    // Each spawn draws its attributes from a generator seeded by its spawn
+    // serial number. The same settings produce the same particles whatever
+    // the thread count, although the slots they land in can differ.
+    class ParticleEmitter
+    {
+    public:
+        using Particle = ParticleSimulation::Particle;
+        using Vector3 = ParticleSimulation::Vector3;
+
+        enum class VelocityDistribution : uint32_t
+        {
+            // Uniform over a cone of ConeAngle radians around Direction
+            Cone = 0,
+            // Uniform over all directions
+            Sphere = 1
+        };
+
+        struct Settings
+        {
+            float SpawnRate = 1000.f; // particles per second
+            float MinLifetime = 2.f;
+            float MaxLifetime = 4.f;
+
+            // Spawn positions are uniform inside this sphere
+            Vector3 Position = { 0.f, 0.f, 0.f };
+            float PositionRadius = 1.f;
+
+            VelocityDistribution Distribution = VelocityDistribution::Cone;
+            Vector3 Direction = { 0.f, 1.f, 0.f };
+            float ConeAngle = 0.5f;
+            float MinSpeed = 1.f;
+            float MaxSpeed = 5.f;
+
+            float MinMass = 0.5f;
+            float MaxMass = 2.5f;
+            float MinExtinctionScale = 0.f;
+            float MaxExtinctionScale = 5.f;
+
+            uint64_t Seed = 1;
+        };
+
+        struct Stats
+        {
+            uint32_t Spawned = 0;
+            uint32_t Retired = 0;
+            // Spawns that found the pool full
+            uint32_t Dropped = 0;
+        };
+
+        ParticleEmitter(uint32_t capacity, const Settings& settings);
+
+        // Ages every particle, retires the expired ones, then spawns
+        // however many particles the spawn rate asks for.
+        Stats Update(float deltaTime, uint32_t threadCount = 1);
+
+        // Spawns count particles immediately
+        Stats Spawn(uint32_t count, uint32_t threadCount = 1);
+
+        void SetSettings(const Settings& settings);
+        const Settings& GetSettings() const;
+
+        // Capacity sized and dense; dead slots have a scale of zero
+        const std::vector<Particle>& GetParticles() const;
+        bool IsAlive(uint32_t slot) const;
+        float GetAge(uint32_t slot) const;
+
+        uint32_t GetAliveCount() const;
+        uint32_t GetCapacity() const;
+
+    private:
+        class Random
+        {
+        public:
+            Random(uint64_t seed, uint64_t serial);
+
+            uint64_t Next();
+            float NextFloat();
+            float Range(float lo, float hi);
+
+        private:
+            uint64_t m_state;
+        };
+
+        Particle MakeParticle(uint64_t serial, float& lifetime) const;
+        Vector3 SampleVelocity(Random& random) const;
+
+        void Retire(uint32_t slot);
+
+        static Vector3 Normalize(const Vector3& v);
+        static Vector3 Cross(const Vector3& a, const Vector3& b);
+
+        Settings m_settings;
+
+        std::vector<Particle> m_particles;
+        std::vector<float> m_age;
+        std::vector<float> m_lifetime;
+        std::vector<uint8_t> m_alive;
+
+        Gradient::FreeSlotStack m_freeSlots;
+        std::atomic<uint32_t> m_aliveCount;
+
+        uint64_t m_spawnSerial = 0;
+        double m_spawnAccumulator = 0.0;
+    };
+
+    inline ParticleEmitter::ParticleEmitter(uint32_t capacity, const Settings& settings)
+        : m_settings(settings),
+        m_particles(capacity),
+        m_age(capacity, 0.f),
+        m_lifetime(capacity, 0.f),
+        m_alive(capacity, 0),
+        m_freeSlots(capacity),
+        m_aliveCount(0)
+    {
+        for (uint32_t slot = 0; slot < capacity; slot++)
+        {
+            Retire(slot);
+        }
+
+        m_freeSlots.Fill();
+    }
+
+    inline ParticleEmitter::Stats ParticleEmitter::Update(float deltaTime, uint32_t threadCount)
+    {
+        const uint32_t capacity = GetCapacity();
+        std::atomic<uint32_t> retired(0);
+
+        ParallelFor(capacity, threadCount, [&](uint32_t begin, uint32_t end, uint32_t)
+            {
+                uint32_t localRetired = 0;
+
+                for (uint32_t slot = begin; slot < end; slot++)
+                {
+                    if (!m_alive[slot])
+                        continue;
+
+                    m_age[slot] += deltaTime;
+                    if (m_age[slot] >= m_lifetime[slot])
+                    {
+                        Retire(slot);
+                        m_freeSlots.Push(slot);
+                        localRetired++;
+                    }
+                }
+
+                retired.fetch_add(localRetired, std::memory_order_relaxed);
+            });
+
+        m_aliveCount.fetch_sub(retired.load(), std::memory_order_relaxed);
+
+        m_spawnAccumulator += static_cast<double>(m_settings.SpawnRate) * std::max(0.f, deltaTime);
+        const double spawnCount = std::floor(m_spawnAccumulator);
+        m_spawnAccumulator -= spawnCount;
+
+        Stats stats = Spawn(static_cast<uint32_t>(spawnCount), threadCount);
+        stats.Retired = retired.load();
+
+        return stats;
+    }
+
+    inline ParticleEmitter::Stats ParticleEmitter::Spawn(uint32_t count, uint32_t threadCount)
+    {
+        const uint64_t firstSerial = m_spawnSerial;
+        m_spawnSerial += count;
+
+        std::atomic<uint32_t> spawned(0);
+
+        ParallelFor(count, threadCount, [&](uint32_t begin, uint32_t end, uint32_t)
+            {
+                uint32_t localSpawned = 0;
+
+                for (uint32_t i = begin; i < end; i++)
+                {
+                    const uint32_t slot = m_freeSlots.Pop();
+                    if (slot == Gradient::FreeSlotStack::InvalidSlot)
+                        break;
+
+                    float lifetime;
+                    m_particles[slot] = MakeParticle(firstSerial + i, lifetime);
+                    m_age[slot] = 0.f;
+                    m_lifetime[slot] = lifetime;
+                    m_alive[slot] = 1;
+                    localSpawned++;
+                }
+
+                spawned.fetch_add(localSpawned, std::memory_order_relaxed);
+            });
+
+        Stats stats;
+        stats.Spawned = spawned.load();
+        stats.Dropped = count - stats.Spawned;
+
+        m_aliveCount.fetch_add(stats.Spawned, std::memory_order_relaxed);
+
+        return stats;
+    }
+
+    inline void ParticleEmitter::SetSettings(const Settings& settings)
+    {
+        m_settings = settings;
+    }
+
+    inline const ParticleEmitter::Settings& ParticleEmitter::GetSettings() const
+    {
+        return m_settings;
+    }
+
+    inline const std::vector<ParticleEmitter::Particle>& ParticleEmitter::GetParticles() const
+    {
+        return m_particles;
+    }
+
+    inline bool ParticleEmitter::IsAlive(uint32_t slot) const
+    {
+        return m_alive[slot] != 0;
+    }
+
+    inline float ParticleEmitter::GetAge(uint32_t slot) const
+    {
+        return m_age[slot];
+    }
+
+    inline uint32_t ParticleEmitter::GetAliveCount() const
+    {
+        return m_aliveCount.load(std::memory_order_relaxed);
+    }
+
+    inline uint32_t ParticleEmitter::GetCapacity() const
+    {
+        return static_cast<uint32_t>(m_particles.size());
+    }
+
+    inline ParticleEmitter::Random::Random(uint64_t seed, uint64_t serial)
+        : m_state(seed * 0x9e3779b97f4a7c15ull ^ (serial + 0x632be59bd9b4e019ull))
+    {
+    }
+
+    inline uint64_t ParticleEmitter::Random::Next()
+    {
+        // SplitMix64
+        uint64_t z = (m_state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    inline float ParticleEmitter::Random::NextFloat()
+    {
+        return static_cast<float>(Next() >> 40) * (1.f / 16777216.f);
+    }
+
+    inline float ParticleEmitter::Random::Range(float lo, float hi)
+    {
+        return lo + (hi - lo) * NextFloat();
+    }
+
+    inline ParticleEmitter::Particle ParticleEmitter::MakeParticle(uint64_t serial, float& lifetime) const
+    {
+        constexpr float twoPi = 6.28318530718f;
+
+        Random random(m_settings.Seed, serial);
+
+        // Uniform inside the spawn sphere
+        const float z = random.Range(-1.f, 1.f);
+        const float phi = random.NextFloat() * twoPi;
+        const float r = m_settings.PositionRadius * std::cbrt(random.NextFloat());
+        const float ring = std::sqrt(std::max(0.f, 1.f - z * z));
+
+        Particle p;
+        p.Position = {
+            m_settings.Position[0] + r * ring * std::cos(phi),
+            m_settings.Position[1] + r * ring * std::sin(phi),
+            m_settings.Position[2] + r * z
+        };
+        p.Velocity = SampleVelocity(random);
+        p.Mass = random.Range(m_settings.MinMass, m_settings.MaxMass);
+        p.ExtinctionScale = random.Range(m_settings.MinExtinctionScale, m_settings.MaxExtinctionScale);
+        p.TargetPosition = p.Position;
+        p.Scale = 1.f;
+        p.RotationQuat = { 0.f, 0.f, 0.f, 1.f };
+
+        lifetime = random.Range(m_settings.MinLifetime, m_settings.MaxLifetime);
+
+        return p;
+    }
+
+    inline ParticleEmitter::Vector3 ParticleEmitter::SampleVelocity(Random& random) const
+    {
+        constexpr float twoPi = 6.28318530718f;
+
+        const float speed = random.Range(m_settings.MinSpeed, m_settings.MaxSpeed);
+        const float phi = random.NextFloat() * twoPi;
+
+        if (m_settings.Distribution == VelocityDistribution::Sphere)
+        {
+            const float z = random.Range(-1.f, 1.f);
+            const float ring = std::sqrt(std::max(0.f, 1.f - z * z));
+            return { speed * ring * std::cos(phi), speed * ring * std::sin(phi), speed * z };
+        }
+
+        // Uniform in solid angle: cos(theta) is uniform over [cos(angle), 1]
+        const float cosTheta = random.Range(std::cos(m_settings.ConeAngle), 1.f);
+        const float sinTheta = std::sqrt(std::max(0.f, 1.f - cosTheta * cosTheta));
+
+        const Vector3 axis = Normalize(m_settings.Direction);
+        const Vector3 helper = std::abs(axis[1]) < 0.99f
+            ? Vector3{ 0.f, 1.f, 0.f }
+            : Vector3{ 1.f, 0.f, 0.f };
+        const Vector3 tangent = Normalize(Cross(helper, axis));
+        const Vector3 bitangent = Cross(axis, tangent);
+
+        const float t = sinTheta * std::cos(phi);
+        const float b = sinTheta * std::sin(phi);
+
+        return {
+            speed * (axis[0] * cosTheta + tangent[0] * t + bitangent[0] * b),
+            speed * (axis[1] * cosTheta + tangent[1] * t + bitangent[1] * b),
+            speed * (axis[2] * cosTheta + tangent[2] * t + bitangent[2] * b)
+        };
+    }
+
+    inline void ParticleEmitter::Retire(uint32_t slot)
+    {
+        Particle& p = m_particles[slot];
+        p.Velocity = { 0.f, 0.f, 0.f };
+        p.Scale = 0.f;
+        p.ExtinctionScale = 0.f;
+        p.Mass = 1.f;
+
+        m_alive[slot] = 0;
+        m_age[slot] = 0.f;
+    }
+
+    inline ParticleEmitter::Vector3 ParticleEmitter::Normalize(const Vector3& v)
+    {
+        const float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        if (length <= 0.f)
+        {
+            return v;
+        }
+
+        return { v[0] / length, v[1] / length, v[2] / length };
+    }
+
+    inline ParticleEmitter::Vector3 ParticleEmitter::Cross(const Vector3& a, const Vector3& b)
+    {
+        return {
+            a[1] * b[2] - a[2] * b[1],
+            a[2] * b[0] - a[0] * b[2],
+            a[0] * b[1] - a[1] * b[0]
+        };
+    }
+}
@@ -0,0 +1,688 @@
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include "ParticleSpatialHash.h"
+
+namespace ISV
+{
+    // Deterministic CPU mirror of SimulateParticles_CS.hlsl, advanced with a
+    // fixed timestep and an accumulator.
+    //
+    // Simulation time is derived from the step counter rather than summed
+    // from frame times, and every step only depends on the particle state
+    // and its StepInput. Restoring a checkpoint and replaying the inputs
+    // recorded after it reproduces the same state bit for bit, as long as
+    // the same build runs both (different floating point settings will
+    // still diverge).
+    class ParticleSimulation
+    {
+    public:
+        using Vector3 = std::array<float, 3>;
+        using Vector4 = std::array<float, 4>;
+
+        // Row major, row vector convention like SimpleMath, so a point
+        // transforms as p * M the same way mul(p, g_TargetWorld) does.
+        using Matrix = std::array<float, 16>;
+
+        // Everything the simulation knows about a particle. InstanceLayout
+        // splits these into the instance streams the GPU reads.
+        struct Particle
+        {
+            Vector3 Position;
+            float ExtinctionScale;
+            Vector3 Velocity;
+            float Mass;
+            Vector3 TargetPosition;
+            float Scale;
+            Vector4 RotationQuat;
+        };
+
+        struct StepInput
+        {
+            Matrix TargetWorld = Identity();
+            bool DidShoot = false;
+            Vector3 ShootRayStart = { 0.f, 0.f, 0.f };
+            Vector3 ShootRayEnd = { 1.f, 1.f, 1.f };
+        };
+
+        struct Settings
+        {
+            double FixedStep = 1.0 / 60.0;
+            uint32_t Substeps = 1;
+
+            // Frames that need more steps than this drop the remainder
+            // instead of falling further and further behind.
+            uint32_t MaxStepsPerAdvance = 8;
+
+            // Particle to particle forces, found through a spatial hash with
+            // cells of InteractionRadius. Off while the radius is zero.
+            float InteractionRadius = 0.f;
+            float SeparationStrength = 0.f;
+            float CohesionStrength = 0.f;
+
+            // Particles that stay under both thresholds for SleepSteps
+            // substeps in a row fall asleep and are skipped until a bullet
+            // ray passes within WakeRadius. Off while SleepSteps is zero.
+            float SleepVelocityThreshold = 0.05f;
+            float SleepAccelerationThreshold = 0.5f;
+            float WakeRadius = 3.f;
+            uint32_t SleepSteps = 0;
+        };
+
+        // Same layout as Game::ParticleActivity
+        struct ParticleActivity
+        {
+            Vector3 PreviousVelocity;
+            uint32_t CalmSteps;
+        };
+
+        struct Checkpoint
+        {
+            uint64_t StepIndex = 0;
+            double Accumulator = 0.0;
+            std::vector<Particle> Particles;
+            std::vector<ParticleActivity> Activity;
+        };
+
+        ParticleSimulation(std::vector<Particle> particles, const Settings& settings);
+
+        // Runs as many fixed steps as the accumulated time allows and
+        // returns how many ran. Inputs are held for every step of the call.
+        uint32_t Advance(double elapsedSeconds, const StepInput& input);
+
+        // One fixed step, split into Settings::Substeps integrations.
+        // The bullet impulse is only applied by the first substep.
+        void Step(const StepInput& input);
+
+        Checkpoint Save() const;
+        void Restore(const Checkpoint& checkpoint);
+
+        static std::vector<uint8_t> Serialize(const Checkpoint& checkpoint);
+        static Checkpoint Deserialize(const std::vector<uint8_t>& bytes);
+
+        // While recording, every step's input is appended to the log so the
+        // run can be replayed from an earlier checkpoint.
+        void BeginRecording();
+        std::vector<StepInput> EndRecording();
+        void Replay(const std::vector<StepInput>& inputs);
+
+        // FNV-1a over the particle state, for cheap bit-exact comparisons.
+        uint64_t Hash() const;
+
+        // Wakes every particle, e.g. after the target has moved
+        void WakeAll();
+
+        // Particles integrated by the last substep
+        const std::vector<uint32_t>& GetActiveIndices() const;
+
+        const std::vector<Particle>& GetParticles() const;
+        const Settings& GetSettings() const;
+        uint64_t GetStepIndex() const;
+        double GetSimulatedTime() const;
+
+        // How far the accumulator is into the next step, in [0, 1).
+        // Useful for interpolating between the last two simulated states.
+        double GetInterpolationAlpha() const;
+
+        static Matrix Identity();
+        static Matrix Translation(float x, float y, float z);
+
+    private:
+        static constexpr uint64_t CheckpointMagic = 0x31504b4350564953ull; // "SIVPCKP1"
+
+        void Integrate(float totalTime, float deltaTime, const StepInput& input, bool applyImpulse);
+        void ComputeInteractions();
+
+        // Mirrors ClassifyParticles_CS.hlsl
+        void ClassifyParticles(float deltaTime, const StepInput& input, bool applyImpulse);
+
+        static Vector3 GetLocalTargetPosition(const Vector3& target, uint32_t index, float totalTime);
+        static Vector3 TransformPoint(const Vector3& p, const Matrix& m);
+        static Vector3 LineToPoint(const Vector3& lineStart, const Vector3& lineDirection, const Vector3& p);
+
+        static float Dot(const Vector3& a, const Vector3& b);
+        static float Length(const Vector3& v);
+        static Vector3 Normalize(const Vector3& v);
+
+        std::vector<Particle> m_particles;
+        Settings m_settings;
+        uint64_t m_stepIndex = 0;
+        double m_accumulator = 0.0;
+
+        std::vector<ParticleActivity> m_activity;
+        std::vector<uint32_t> m_activeIndices;
+
+        std::optional<ParticleSpatialHash> m_spatialHash;
+        std::vector<Vector3> m_interactionAcceleration;
+
+        bool m_recording = false;
+        std::vector<StepInput> m_recordedInputs;
+    };
+
+    inline ParticleSimulation::ParticleSimulation(std::vector<Particle> particles, const Settings& settings)
+        : m_particles(std::move(particles)), m_settings(settings)
+    {
+        m_settings.Substeps = std::max(1u, m_settings.Substeps);
+        m_settings.MaxStepsPerAdvance = std::max(1u, m_settings.MaxStepsPerAdvance);
+
+        m_activity.resize(m_particles.size(), { { 0.f, 0.f, 0.f }, 0 });
+        m_activeIndices.reserve(m_particles.size());
+
+        if (m_settings.InteractionRadius > 0.f)
+        {
+            m_spatialHash.emplace(m_settings.InteractionRadius,
+                static_cast<uint32_t>(m_particles.size() * 2));
+        }
+    }
+
+    inline uint32_t ParticleSimulation::Advance(double elapsedSeconds, const StepInput& input)
+    {
+        m_accumulator += std::max(0.0, elapsedSeconds);
+
+        uint32_t steps = 0;
+        while (m_accumulator >= m_settings.FixedStep && steps < m_settings.MaxStepsPerAdvance)
+        {
+            Step(input);
+            m_accumulator -= m_settings.FixedStep;
+            steps++;
+        }
+
+        if (steps == m_settings.MaxStepsPerAdvance)
+        {
+            m_accumulator = std::min(m_accumulator, m_settings.FixedStep);
+        }
+
+        return steps;
+    }
+
+    inline void ParticleSimulation::Step(const StepInput& input)
+    {
+        if (m_recording)
+        {
+            m_recordedInputs.push_back(input);
+        }
+
+        const uint32_t substeps = m_settings.Substeps;
+        const double substepLength = m_settings.FixedStep / substeps;
+
+        for (uint32_t s = 0; s < substeps; s++)
+        {
+            const uint64_t substepIndex = m_stepIndex * substeps + s;
+            const float totalTime = static_cast<float>(substepIndex * substepLength);
+
+            ClassifyParticles(static_cast<float>(substepLength), input, s == 0);
+            Integrate(totalTime, static_cast<float>(substepLength), input, s == 0);
+        }
+
+        m_stepIndex++;
+    }
+
+    inline ParticleSimulation::Checkpoint ParticleSimulation::Save() const
+    {
+        Checkpoint checkpoint;
+        checkpoint.StepIndex = m_stepIndex;
+        checkpoint.Accumulator = m_accumulator;
+        checkpoint.Particles = m_particles;
+        checkpoint.Activity = m_activity;
+        return checkpoint;
+    }
+
+    inline void ParticleSimulation::Restore(const Checkpoint& checkpoint)
+    {
+        m_stepIndex = checkpoint.StepIndex;
+        m_accumulator = checkpoint.Accumulator;
+        m_particles = checkpoint.Particles;
+        m_activity = checkpoint.Activity;
+        m_activity.resize(m_particles.size(), { { 0.f, 0.f, 0.f }, 0 });
+    }
+
+    inline std::vector<uint8_t> ParticleSimulation::Serialize(const Checkpoint& checkpoint)
+    {
+        const uint64_t count = checkpoint.Particles.size();
+        const uint64_t activityCount = checkpoint.Activity.size();
+        const std::size_t headerSize = sizeof(CheckpointMagic) + sizeof(checkpoint.StepIndex)
+            + sizeof(checkpoint.Accumulator) + sizeof(count) + sizeof(activityCount);
+
+        std::vector<uint8_t> bytes(headerSize + count * sizeof(Particle)
+            + activityCount * sizeof(ParticleActivity));
+        uint8_t* out = bytes.data();
+
+        auto write = [&out](const void* data, std::size_t size)
+            {
+                std::memcpy(out, data, size);
+                out += size;
+            };
+
+        write(&CheckpointMagic, sizeof(CheckpointMagic));
+        write(&checkpoint.StepIndex, sizeof(checkpoint.StepIndex));
+        write(&checkpoint.Accumulator, sizeof(checkpoint.Accumulator));
+        write(&count, sizeof(count));
+        write(checkpoint.Particles.data(), count * sizeof(Particle));
+        write(&activityCount, sizeof(activityCount));
+        write(checkpoint.Activity.data(), activityCount * sizeof(ParticleActivity));
+
+        return bytes;
+    }
+
+    inline ParticleSimulation::Checkpoint ParticleSimulation::Deserialize(const std::vector<uint8_t>& bytes)
+    {
+        Checkpoint checkpoint;
+        uint64_t magic = 0;
+        uint64_t count = 0;
+
+        const uint8_t* in = bytes.data();
+        std::size_t remaining = bytes.size();
+
+        auto read = [&](void* data, std::size_t size)
+            {
+                if (size > remaining)
+                {
+                    throw std::runtime_error("Truncated particle checkpoint");
+                }
+
+                std::memcpy(data, in, size);
+                in += size;
+                remaining -= size;
+            };
+
+        read(&magic, sizeof(magic));
+        if (magic != CheckpointMagic)
+        {
+            throw std::runtime_error("Not a particle checkpoint");
+        }
+
+        read(&checkpoint.StepIndex, sizeof(checkpoint.StepIndex));
+        read(&checkpoint.Accumulator, sizeof(checkpoint.Accumulator));
+        read(&count, sizeof(count));
+
+        if (count > remaining / sizeof(Particle))
+        {
+            throw std::runtime_error("Truncated particle checkpoint");
+        }
+
+        checkpoint.Particles.resize(static_cast<std::size_t>(count));
+        read(checkpoint.Particles.data(), checkpoint.Particles.size() * sizeof(Particle));
+
+        uint64_t activityCount = 0;
+        read(&activityCount, sizeof(activityCount));
+
+        if (activityCount > remaining / sizeof(ParticleActivity))
+        {
+            throw std::runtime_error("Truncated particle checkpoint");
+        }
+
+        checkpoint.Activity.resize(static_cast<std::size_t>(activityCount));
+        read(checkpoint.Activity.data(), checkpoint.Activity.size() * sizeof(ParticleActivity));
+
+        return checkpoint;
+    }
+
+    inline void ParticleSimulation::BeginRecording()
+    {
+        m_recording = true;
+        m_recordedInputs.clear();
+    }
+
+    inline std::vector<ParticleSimulation::StepInput> ParticleSimulation::EndRecording()
+    {
+        m_recording = false;
+        return std::move(m_recordedInputs);
+    }
+
+    inline void ParticleSimulation::Replay(const std::vector<StepInput>& inputs)
+    {
+        for (const auto& input : inputs)
+        {
+            Step(input);
+        }
+    }
+
+    inline uint64_t ParticleSimulation::Hash() const
+    {
+        uint64_t hash = 0xcbf29ce484222325ull;
+
+        const auto* bytes = reinterpret_cast<const uint8_t*>(m_particles.data());
+        const std::size_t size = m_particles.size() * sizeof(Particle);
+
+        for (std::size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3ull;
+        }
+
+        return hash;
+    }
+
+    inline void ParticleSimulation::WakeAll()
+    {
+        for (auto& activity : m_activity)
+        {
+            activity.CalmSteps = 0;
+        }
+    }
+
+    inline const std::vector<uint32_t>& ParticleSimulation::GetActiveIndices() const
+    {
+        return m_activeIndices;
+    }
+
+    inline const std::vector<ParticleSimulation::Particle>& ParticleSimulation::GetParticles() const
+    {
+        return m_particles;
+    }
+
+    inline const ParticleSimulation::Settings& ParticleSimulation::GetSettings() const
+    {
+        return m_settings;
+    }
+
+    inline uint64_t ParticleSimulation::GetStepIndex() const
+    {
+        return m_stepIndex;
+    }
+
+    inline double ParticleSimulation::GetSimulatedTime() const
+    {
+        return m_stepIndex * m_settings.FixedStep;
+    }
+
+    inline double ParticleSimulation::GetInterpolationAlpha() const
+    {
+        return std::clamp(m_accumulator / m_settings.FixedStep, 0.0, 1.0);
+    }
+
+    inline ParticleSimulation::Matrix ParticleSimulation::Identity()
+    {
+        return {
+            1.f, 0.f, 0.f, 0.f,
+            0.f, 1.f, 0.f, 0.f,
+            0.f, 0.f, 1.f, 0.f,
+            0.f, 0.f, 0.f, 1.f
+        };
+    }
+
+    inline ParticleSimulation::Matrix ParticleSimulation::Translation(float x, float y, float z)
+    {
+        Matrix m = Identity();
+        m[12] = x;
+        m[13] = y;
+        m[14] = z;
+        return m;
+    }
+
+    inline void ParticleSimulation::Integrate(float totalTime,
+        float deltaTime,
+        const StepInput& input,
+        bool applyImpulse)
+    {
+        const Vector3 shootDirection = Normalize({
+            input.ShootRayEnd[0] - input.ShootRayStart[0],
+            input.ShootRayEnd[1] - input.ShootRayStart[1],
+            input.ShootRayEnd[2] - input.ShootRayStart[2]
+            });
+
+        if (m_spatialHash)
+        {
+            ComputeInteractions();
+        }
+
+        for (const uint32_t i : m_activeIndices)
+        {
+            Particle& p = m_particles[i];
+
+            const Vector3 target = TransformPoint(
+                GetLocalTargetPosition(p.TargetPosition, i, totalTime),
+                input.TargetWorld);
+
+            const Vector3 attraction = {
+                target[0] - p.Position[0],
+                target[1] - p.Position[1],
+                target[2] - p.Position[2]
+            };
+
+            // Like gravity, this is independent of mass
+            Vector3 attractionAcceleration = { 0.f, 0.f, 0.f };
+            if (Length(attraction) >= 0.0001f)
+            {
+                const Vector3 n = Normalize(attraction);
+                attractionAcceleration = { 150.f * n[0], 150.f * n[1], 150.f * n[2] };
+            }
+
+            if (m_spatialHash)
+            {
+                for (int axis = 0; axis < 3; axis++)
+                    attractionAcceleration[axis] += m_interactionAcceleration[i][axis];
+            }
+
+            Vector3 bulletScatterVelocity = { 0.f, 0.f, 0.f };
+            if (applyImpulse && input.DidShoot)
+            {
+                const Vector3 l2p = LineToPoint(input.ShootRayStart, shootDirection, p.Position);
+
+                const float lineDistance = Length(l2p);
+                if (lineDistance > 0.f)
+                {
+                    const Vector3 n = Normalize(l2p);
+                    const float strength = 10.f / (lineDistance * lineDistance);
+                    bulletScatterVelocity = { strength * n[0], strength * n[1], strength * n[2] };
+                }
+            }
+
+            // This is not independent of mass
+            const float dampingScale = -4.f / p.Mass * deltaTime;
+            const Vector3 dampingVelocityChange = {
+                dampingScale * p.Velocity[0],
+                dampingScale * p.Velocity[1],
+                dampingScale * p.Velocity[2]
+            };
+
+            if (Length(dampingVelocityChange) < Length(p.Velocity))
+            {
+                for (int axis = 0; axis < 3; axis++)
+                    p.Velocity[axis] += dampingVelocityChange[axis];
+            }
+            else
+            {
+                p.Velocity = { 0.f, 0.f, 0.f };
+            }
+
+            for (int axis = 0; axis < 3; axis++)
+            {
+                p.Velocity[axis] += attractionAcceleration[axis] * deltaTime + bulletScatterVelocity[axis];
+                p.Position[axis] += p.Velocity[axis] * deltaTime;
+            }
+
+            const float scale = 0.2f + std::sin(2.f * totalTime + i * 2.3f);
+            p.Scale = scale * scale;
+        }
+    }
+
+    inline void ParticleSimulation::ClassifyParticles(float deltaTime,
+        const StepInput& input,
+        bool applyImpulse)
+    {
+        const uint32_t count = static_cast<uint32_t>(m_particles.size());
+        m_activeIndices.clear();
+
+        if (m_settings.SleepSteps == 0)
+        {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                m_activeIndices.push_back(i);
+            }
+
+            return;
+        }
+
+        const Vector3 shootDirection = Normalize({
+            input.ShootRayEnd[0] - input.ShootRayStart[0],
+            input.ShootRayEnd[1] - input.ShootRayStart[1],
+            input.ShootRayEnd[2] - input.ShootRayStart[2]
+            });
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            Particle& p = m_particles[i];
+            ParticleActivity& activity = m_activity[i];
+
+            const Vector3 velocityChange = {
+                p.Velocity[0] - activity.PreviousVelocity[0],
+                p.Velocity[1] - activity.PreviousVelocity[1],
+                p.Velocity[2] - activity.PreviousVelocity[2]
+            };
+
+            const float speed = Length(p.Velocity);
+            const float acceleration = Length(velocityChange) / std::max(deltaTime, 1e-5f);
+
+            const bool isCalm = speed < m_settings.SleepVelocityThreshold
+                && acceleration < m_settings.SleepAccelerationThreshold;
+            activity.CalmSteps = isCalm ? std::min(activity.CalmSteps + 1, m_settings.SleepSteps) : 0;
+
+            if (applyImpulse && input.DidShoot
+                && Length(LineToPoint(input.ShootRayStart, shootDirection, p.Position)) < m_settings.WakeRadius)
+            {
+                activity.CalmSteps = 0;
+            }
+
+            if (activity.CalmSteps < m_settings.SleepSteps)
+            {
+                m_activeIndices.push_back(i);
+            }
+            else
+            {
+                // Settle completely so the particle doesn't drift while asleep
+                p.Velocity = { 0.f, 0.f, 0.f };
+            }
+
+            activity.PreviousVelocity = p.Velocity;
+        }
+    }
+
+    inline void ParticleSimulation::ComputeInteractions()
+    {
+        // Forces are evaluated from the positions at the start of the
+        // substep so the result doesn't depend on update order
+        const uint32_t count = static_cast<uint32_t>(m_particles.size());
+        const float radius = m_settings.InteractionRadius;
+
+        m_spatialHash->Build(m_particles.data(), count, sizeof(Particle));
+        m_interactionAcceleration.assign(count, { 0.f, 0.f, 0.f });
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const Vector3& position = m_particles[i].Position;
+
+            Vector3 separation = { 0.f, 0.f, 0.f };
+            Vector3 centroid = { 0.f, 0.f, 0.f };
+            uint32_t neighbourCount = 0;
+
+            m_spatialHash->ForEachNeighbour(position, radius, [&](uint32_t j, float distanceSquared)
+                {
+                    if (j == i)
+                        return;
+
+                    const Vector3& other = m_particles[j].Position;
+                    const float distance = std::sqrt(distanceSquared);
+
+                    // Linear falloff to zero at the interaction radius
+                    if (distance > 0.f)
+                    {
+                        const float weight = (1.f - distance / radius) / distance;
+                        for (int axis = 0; axis < 3; axis++)
+                            separation[axis] += (position[axis] - other[axis]) * weight;
+                    }
+
+                    for (int axis = 0; axis < 3; axis++)
+                        centroid[axis] += other[axis];
+
+                    neighbourCount++;
+                });
+
+            if (neighbourCount == 0)
+                continue;
+
+            for (int axis = 0; axis < 3; axis++)
+            {
+                const float toCentroid = centroid[axis] / neighbourCount - position[axis];
+                m_interactionAcceleration[i][axis] = m_settings.SeparationStrength * separation[axis]
+                    + m_settings.CohesionStrength * toCentroid;
+            }
+        }
+    }
+
+    inline ParticleSimulation::Vector3 ParticleSimulation::GetLocalTargetPosition(const Vector3& target,
+        uint32_t index,
+        float totalTime)
+    {
+        const float seed = 353435.22425f * index;
+        const float angularVelocity = 3.f + 100.f * (seed - std::floor(seed));
+        const float angle = angularVelocity * totalTime;
+
+        // Rotation about +Y, applied as mul(v, QuatTo3x3(q))
+        const float s = std::sin(angle * 0.5f);
+        const float c = std::cos(angle * 0.5f);
+        const float m00 = 1.f - 2.f * s * s;
+        const float m02 = 2.f * s * c;
+
+        const float radius = 1.f + 3.f * std::sin(3.f * totalTime + index);
+
+        return {
+            (target[0] * m00 + target[2] * m02) * radius,
+            target[1] * radius,
+            (target[2] * m00 - target[0] * m02) * radius
+        };
+    }
+
+    inline ParticleSimulation::Vector3 ParticleSimulation::TransformPoint(const Vector3& p, const Matrix& m)
+    {
+        return {
+            p[0] * m[0] + p[1] * m[4] + p[2] * m[8] + m[12],
+            p[0] * m[1] + p[1] * m[5] + p[2] * m[9] + m[13],
+            p[0] * m[2] + p[1] * m[6] + p[2] * m[10] + m[14]
+        };
+    }
+
+    inline ParticleSimulation::Vector3 ParticleSimulation::LineToPoint(const Vector3& lineStart,
+        const Vector3& lineDirection,
+        const Vector3& p)
+    {
+        const Vector3 toStart = { lineStart[0] - p[0], lineStart[1] - p[1], lineStart[2] - p[2] };
+        const float projection = Dot(toStart, lineDirection);
+
+        return {
+            -(toStart[0] - projection * lineDirection[0]),
+            -(toStart[1] - projection * lineDirection[1]),
+            -(toStart[2] - projection * lineDirection[2])
+        };
+    }
+
+    inline float ParticleSimulation::Dot(const Vector3& a, const Vector3& b)
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    inline float ParticleSimulation::Length(const Vector3& v)
+    {
+        return std::sqrt(Dot(v, v));
+    }
+
+    inline ParticleSimulation::Vector3 ParticleSimulation::Normalize(const Vector3& v)
+    {
+        const float length = Length(v);
+        if (length <= 0.f)
+        {
+            return v;
+        }
+
+        return { v[0] / length, v[1] / length, v[2] / length };
+    }
+}
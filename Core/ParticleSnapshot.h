@@ -0,0 +1,760 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "InstanceLayout.h"
+#include "MappedFile.h"
+
+namespace ISV
+{
+    // Binary capture of the particle instance buffer and the frame constants
+    // over a sequence of frames, for replaying on machines without the
+    // simulation.
+    //
+    // File layout, all little endian:
+    //
+    //   page 0       FileHeader
+    //   frames       one record per frame, see below
+    //   index        FrameRecord per frame, FileHeader::IndexOffset points here
+    //
+    // Keyframes start on a page boundary and store the constants followed by
+    // each instance stream (positions, scales, rotations, extinction scales)
+    // as a tightly packed array, with every section padded to a page. A
+    // mapped keyframe can be used in place as a set of SoA arrays.
+    //
+    // Other frames are deltas against the frame before them: the constants
+    // in full, then per stream a bit mask of the 32 bit words that changed
+    // followed by the new values of those words. Sleeping particles and the
+    // attributes the simulation never writes cost one bit per word. A delta
+    // that would be bigger than a keyframe is written as a keyframe instead.
+    class ParticleSnapshot
+    {
+    public:
+        using RenderInstance = InstanceLayout::RenderInstance;
+        using Vector3 = std::array<float, 3>;
+        using Vector4 = std::array<float, 4>;
+
+        static constexpr uint64_t Magic = 0x50414e5356534921ull; // "!ISVSNAP"
+        static constexpr uint32_t Version = 1;
+        static constexpr uint32_t PageSize = 4096;
+        static constexpr uint32_t StreamCount = 4;
+
+        enum class FrameType : uint32_t
+        {
+            Keyframe = 0,
+            Delta = 1
+        };
+
+        struct FileHeader
+        {
+            uint64_t Magic;
+            uint32_t Version;
+            uint32_t PageSize;
+            uint32_t ParticleCount;
+            uint32_t ConstantsSize;
+            uint32_t KeyframeInterval;
+            uint32_t FrameCount;
+            uint64_t IndexOffset;
+        };
+
+        struct FrameRecord
+        {
+            uint64_t Offset;
+            uint64_t Size;
+            FrameType Type;
+            // The keyframe this frame's deltas start from
+            uint32_t Keyframe;
+        };
+
+        static_assert(sizeof(FileHeader) == 40, "Snapshot header layout changed");
+        static_assert(sizeof(FrameRecord) == 24, "Snapshot index layout changed");
+
+        // A decoded frame, one array per stream
+        struct Frame
+        {
+            std::vector<Vector3> Positions;
+            std::vector<float> Scales;
+            std::vector<Vector4> Rotations;
+            std::vector<float> ExtinctionScales;
+            std::vector<uint8_t> Constants;
+
+            void Resize(uint32_t particleCount, uint32_t constantsSize);
+
+            void SetInstances(const RenderInstance* instances, uint32_t count);
+            void GetInstances(std::vector<RenderInstance>& instances) const;
+
+            uint8_t* GetStream(uint32_t stream);
+            const uint8_t* GetStream(uint32_t stream) const;
+        };
+
+        // A keyframe read in place from the mapping
+        struct FrameView
+        {
+            uint32_t ParticleCount = 0;
+            const Vector3* Positions = nullptr;
+            const float* Scales = nullptr;
+            const Vector4* Rotations = nullptr;
+            const float* ExtinctionScales = nullptr;
+            const uint8_t* Constants = nullptr;
+        };
+
+        class Writer
+        {
+        public:
+            // Every keyframeInterval frames is a keyframe, which bounds how
+            // many deltas a random access has to apply
+            Writer(const std::string& path,
+                uint32_t particleCount,
+                uint32_t constantsSize,
+                uint32_t keyframeInterval = 30);
+            ~Writer();
+
+            Writer(const Writer&) = delete;
+            Writer& operator=(const Writer&) = delete;
+
+            void WriteFrame(const Frame& frame);
+            void WriteFrame(const RenderInstance* instances, const void* constants);
+
+            // Writes the index and the final header. Called by the destructor
+            // if needed, but only an explicit call reports errors.
+            void Close();
+
+            uint32_t GetFrameCount() const;
+            uint64_t GetBytesWritten() const;
+
+        private:
+            void Write(const void* data, std::size_t size);
+            void PadTo(uint64_t alignment);
+
+            std::ofstream m_file;
+            FileHeader m_header;
+            std::vector<FrameRecord> m_index;
+            uint32_t m_lastKeyframe = 0;
+
+            Frame m_previous;
+            Frame m_scratch;
+            std::vector<uint8_t> m_delta;
+
+            uint64_t m_offset = 0;
+            bool m_open = false;
+        };
+
+        class Reader
+        {
+        public:
+            explicit Reader(const std::string& path);
+
+            uint32_t GetFrameCount() const;
+            uint32_t GetParticleCount() const;
+            uint32_t GetConstantsSize() const;
+            uint32_t GetKeyframeInterval() const;
+
+            const FrameRecord& GetRecord(uint32_t frame) const;
+            bool IsKeyframe(uint32_t frame) const;
+
+            // No copies or decoding. Throws if frame isn't a keyframe.
+            FrameView GetKeyframeView(uint32_t frame) const;
+
+            // Decodes a frame. Reading the frame after the last one applies
+            // a single delta; anything else starts from the frame's keyframe.
+            // The result stays valid until the next call.
+            const Frame& ReadFrame(uint32_t frame);
+
+            const MappedFile& GetFile() const;
+
+        private:
+            void ApplyDelta(const FrameRecord& record);
+
+            MappedFile m_file;
+            FileHeader m_header;
+            const FrameRecord* m_index = nullptr;
+
+            Frame m_current;
+            uint32_t m_currentFrame = UINT32_MAX;
+        };
+
+        static uint32_t GetElementSize(uint32_t stream);
+        static uint64_t GetStreamSize(uint32_t stream, uint32_t particleCount);
+        static uint64_t GetKeyframeSize(uint32_t particleCount, uint32_t constantsSize);
+
+        // Offset of a keyframe section from the start of the frame. Section 0
+        // is the constants, section 1 + s is stream s.
+        static uint64_t GetKeyframeSectionOffset(uint32_t section, uint32_t particleCount, uint32_t constantsSize);
+
+        static uint64_t AlignUp(uint64_t value, uint64_t alignment);
+
+        // Writes the changed words of current against previous to out
+        static void EncodeDelta(const uint8_t* previous,
+            const uint8_t* current,
+            std::size_t size,
+            std::vector<uint8_t>& out);
+
+        // Applies a delta from EncodeDelta in place and returns the bytes read
+        static std::size_t DecodeDelta(const uint8_t* delta,
+            std::size_t available,
+            uint8_t* data,
+            std::size_t size);
+    };
+
+    inline void ParticleSnapshot::Frame::Resize(uint32_t particleCount, uint32_t constantsSize)
+    {
+        Positions.resize(particleCount);
+        Scales.resize(particleCount);
+        Rotations.resize(particleCount);
+        ExtinctionScales.resize(particleCount);
+        Constants.resize(constantsSize);
+    }
+
+    inline void ParticleSnapshot::Frame::SetInstances(const RenderInstance* instances, uint32_t count)
+    {
+        Positions.resize(count);
+        Scales.resize(count);
+        Rotations.resize(count);
+        ExtinctionScales.resize(count);
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            Positions[i] = instances[i].Position;
+            Scales[i] = instances[i].Scale;
+            Rotations[i] = instances[i].RotationQuat;
+            ExtinctionScales[i] = instances[i].ExtinctionScale;
+        }
+    }
+
+    inline void ParticleSnapshot::Frame::GetInstances(std::vector<RenderInstance>& instances) const
+    {
+        instances.resize(Positions.size());
+
+        for (std::size_t i = 0; i < instances.size(); i++)
+        {
+            instances[i] = { Positions[i], Scales[i], Rotations[i], ExtinctionScales[i] };
+        }
+    }
+
+    inline uint8_t* ParticleSnapshot::Frame::GetStream(uint32_t stream)
+    {
+        return const_cast<uint8_t*>(static_cast<const Frame*>(this)->GetStream(stream));
+    }
+
+    inline const uint8_t* ParticleSnapshot::Frame::GetStream(uint32_t stream) const
+    {
+        switch (stream)
+        {
+        case 0:
+            return reinterpret_cast<const uint8_t*>(Positions.data());
+        case 1:
+            return reinterpret_cast<const uint8_t*>(Scales.data());
+        case 2:
+            return reinterpret_cast<const uint8_t*>(Rotations.data());
+        default:
+            return reinterpret_cast<const uint8_t*>(ExtinctionScales.data());
+        }
+    }
+
+    inline ParticleSnapshot::Writer::Writer(const std::string& path,
+        uint32_t particleCount,
+        uint32_t constantsSize,
+        uint32_t keyframeInterval)
+        : m_file(path, std::ios::binary | std::ios::trunc)
+    {
+        if (!m_file)
+        {
+            throw std::runtime_error("Could not create " + path);
+        }
+
+        m_header = {};
+        m_header.Magic = ParticleSnapshot::Magic;
+        m_header.Version = ParticleSnapshot::Version;
+        m_header.PageSize = ParticleSnapshot::PageSize;
+        m_header.ParticleCount = particleCount;
+        m_header.ConstantsSize = constantsSize;
+        m_header.KeyframeInterval = std::max(1u, keyframeInterval);
+
+        // Rewritten with the frame count and index offset on Close
+        Write(&m_header, sizeof(m_header));
+        PadTo(PageSize);
+
+        m_previous.Resize(particleCount, constantsSize);
+        m_open = true;
+    }
+
+    inline ParticleSnapshot::Writer::~Writer()
+    {
+        try
+        {
+            Close();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    inline void ParticleSnapshot::Writer::WriteFrame(const Frame& frame)
+    {
+        if (!m_open)
+        {
+            throw std::runtime_error("Snapshot writer is closed");
+        }
+
+        const uint32_t particleCount = m_header.ParticleCount;
+        if (frame.Positions.size() != particleCount
+            || frame.Scales.size() != particleCount
+            || frame.Rotations.size() != particleCount
+            || frame.ExtinctionScales.size() != particleCount
+            || frame.Constants.size() != m_header.ConstantsSize)
+        {
+            throw std::runtime_error("Snapshot frame doesn't match the header");
+        }
+
+        const uint32_t frameIndex = static_cast<uint32_t>(m_index.size());
+        const uint64_t keyframeSize = GetKeyframeSize(particleCount, m_header.ConstantsSize);
+
+        bool keyframe = frameIndex % m_header.KeyframeInterval == 0;
+
+        if (!keyframe)
+        {
+            m_delta.clear();
+            m_delta.insert(m_delta.end(), frame.Constants.begin(), frame.Constants.end());
+            m_delta.resize(AlignUp(m_delta.size(), 8), 0);
+
+            for (uint32_t s = 0; s < StreamCount; s++)
+            {
+                EncodeDelta(m_previous.GetStream(s),
+                    frame.GetStream(s),
+                    GetStreamSize(s, particleCount),
+                    m_delta);
+            }
+
+            keyframe = m_delta.size() >= keyframeSize;
+        }
+
+        FrameRecord record = {};
+
+        if (keyframe)
+        {
+            PadTo(PageSize);
+
+            record.Offset = m_offset;
+            record.Size = keyframeSize;
+            record.Type = FrameType::Keyframe;
+            record.Keyframe = frameIndex;
+
+            for (uint32_t section = 0; section <= StreamCount; section++)
+            {
+                const uint8_t* data = section == 0 ? frame.Constants.data() : frame.GetStream(section - 1);
+                const uint64_t size = section == 0
+                    ? m_header.ConstantsSize
+                    : GetStreamSize(section - 1, particleCount);
+
+                Write(data, static_cast<std::size_t>(size));
+                PadTo(PageSize);
+            }
+
+            m_lastKeyframe = frameIndex;
+        }
+        else
+        {
+            PadTo(8);
+
+            record.Offset = m_offset;
+            record.Size = m_delta.size();
+            record.Type = FrameType::Delta;
+            record.Keyframe = m_lastKeyframe;
+
+            Write(m_delta.data(), m_delta.size());
+        }
+
+        m_index.push_back(record);
+
+        m_previous.Constants = frame.Constants;
+        for (uint32_t s = 0; s < StreamCount; s++)
+        {
+            std::memcpy(m_previous.GetStream(s),
+                frame.GetStream(s),
+                static_cast<std::size_t>(GetStreamSize(s, particleCount)));
+        }
+    }
+
+    inline void ParticleSnapshot::Writer::WriteFrame(const RenderInstance* instances, const void* constants)
+    {
+        m_scratch.SetInstances(instances, m_header.ParticleCount);
+        m_scratch.Constants.resize(m_header.ConstantsSize);
+        std::memcpy(m_scratch.Constants.data(), constants, m_header.ConstantsSize);
+
+        WriteFrame(m_scratch);
+    }
+
+    inline void ParticleSnapshot::Writer::Close()
+    {
+        if (!m_open)
+            return;
+
+        m_open = false;
+
+        PadTo(8);
+        m_header.IndexOffset = m_offset;
+        m_header.FrameCount = static_cast<uint32_t>(m_index.size());
+        Write(m_index.data(), m_index.size() * sizeof(FrameRecord));
+
+        m_file.seekp(0);
+        m_file.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+        m_file.close();
+
+        if (!m_file)
+        {
+            throw std::runtime_error("Failed to finish writing the snapshot");
+        }
+    }
+
+    inline uint32_t ParticleSnapshot::Writer::GetFrameCount() const
+    {
+        return static_cast<uint32_t>(m_index.size());
+    }
+
+    inline uint64_t ParticleSnapshot::Writer::GetBytesWritten() const
+    {
+        return m_offset;
+    }
+
+    inline void ParticleSnapshot::Writer::Write(const void* data, std::size_t size)
+    {
+        m_file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        if (!m_file)
+        {
+            throw std::runtime_error("Failed to write the snapshot");
+        }
+
+        m_offset += size;
+    }
+
+    inline void ParticleSnapshot::Writer::PadTo(uint64_t alignment)
+    {
+        static const std::array<char, PageSize> zeros = {};
+
+        const uint64_t padding = AlignUp(m_offset, alignment) - m_offset;
+        Write(zeros.data(), static_cast<std::size_t>(padding));
+    }
+
+    inline ParticleSnapshot::Reader::Reader(const std::string& path)
+        : m_file(path)
+    {
+        if (m_file.GetSize() < sizeof(FileHeader))
+        {
+            throw std::runtime_error("Not a particle snapshot");
+        }
+
+        std::memcpy(&m_header, m_file.GetData(), sizeof(m_header));
+
+        if (m_header.Magic != ParticleSnapshot::Magic)
+        {
+            throw std::runtime_error("Not a particle snapshot");
+        }
+        if (m_header.Version != ParticleSnapshot::Version || m_header.PageSize != ParticleSnapshot::PageSize)
+        {
+            throw std::runtime_error("Unsupported particle snapshot version");
+        }
+
+        const uint64_t indexSize = static_cast<uint64_t>(m_header.FrameCount) * sizeof(FrameRecord);
+        if (m_header.IndexOffset % 8 != 0
+            || m_header.IndexOffset > m_file.GetSize()
+            || indexSize > m_file.GetSize() - m_header.IndexOffset)
+        {
+            throw std::runtime_error("Truncated particle snapshot");
+        }
+
+        m_index = reinterpret_cast<const FrameRecord*>(m_file.GetData() + m_header.IndexOffset);
+
+        const uint64_t keyframeSize = GetKeyframeSize(m_header.ParticleCount, m_header.ConstantsSize);
+
+        for (uint32_t i = 0; i < m_header.FrameCount; i++)
+        {
+            const FrameRecord& record = m_index[i];
+
+            // A keyframe starts its own chain. A delta continues the chain of
+            // the frame before it, so ReadFrame only ever applies deltas
+            // between a keyframe and the frame asked for.
+            const bool valid = record.Offset <= m_header.IndexOffset
+                && record.Size <= m_header.IndexOffset - record.Offset
+                && ((record.Type == FrameType::Keyframe
+                        && record.Keyframe == i
+                        && record.Size == keyframeSize
+                        && record.Offset % PageSize == 0)
+                    || (record.Type == FrameType::Delta
+                        && i > 0
+                        && record.Keyframe == m_index[i - 1].Keyframe));
+
+            if (!valid)
+            {
+                throw std::runtime_error("Corrupt particle snapshot index");
+            }
+        }
+
+        m_current.Resize(m_header.ParticleCount, m_header.ConstantsSize);
+    }
+
+    inline uint32_t ParticleSnapshot::Reader::GetFrameCount() const
+    {
+        return m_header.FrameCount;
+    }
+
+    inline uint32_t ParticleSnapshot::Reader::GetParticleCount() const
+    {
+        return m_header.ParticleCount;
+    }
+
+    inline uint32_t ParticleSnapshot::Reader::GetConstantsSize() const
+    {
+        return m_header.ConstantsSize;
+    }
+
+    inline uint32_t ParticleSnapshot::Reader::GetKeyframeInterval() const
+    {
+        return m_header.KeyframeInterval;
+    }
+
+    inline const ParticleSnapshot::FrameRecord& ParticleSnapshot::Reader::GetRecord(uint32_t frame) const
+    {
+        if (frame >= m_header.FrameCount)
+        {
+            throw std::out_of_range("Snapshot frame out of range");
+        }
+
+        return m_index[frame];
+    }
+
+    inline bool ParticleSnapshot::Reader::IsKeyframe(uint32_t frame) const
+    {
+        return GetRecord(frame).Type == FrameType::Keyframe;
+    }
+
+    inline ParticleSnapshot::FrameView ParticleSnapshot::Reader::GetKeyframeView(uint32_t frame) const
+    {
+        const FrameRecord& record = GetRecord(frame);
+        if (record.Type != FrameType::Keyframe)
+        {
+            throw std::runtime_error("Snapshot frame isn't a keyframe");
+        }
+
+        const uint32_t particleCount = m_header.ParticleCount;
+        const uint32_t constantsSize = m_header.ConstantsSize;
+        const uint8_t* base = m_file.GetData() + record.Offset;
+
+        auto section = [&](uint32_t s)
+            {
+                return base + GetKeyframeSectionOffset(s, particleCount, constantsSize);
+            };
+
+        FrameView view;
+        view.ParticleCount = particleCount;
+        view.Constants = section(0);
+        view.Positions = reinterpret_cast<const Vector3*>(section(1));
+        view.Scales = reinterpret_cast<const float*>(section(2));
+        view.Rotations = reinterpret_cast<const Vector4*>(section(3));
+        view.ExtinctionScales = reinterpret_cast<const float*>(section(4));
+
+        return view;
+    }
+
+    inline const ParticleSnapshot::Frame& ParticleSnapshot::Reader::ReadFrame(uint32_t frame)
+    {
+        const FrameRecord& record = GetRecord(frame);
+
+        if (frame == m_currentFrame)
+        {
+            return m_current;
+        }
+
+        uint32_t next = record.Keyframe;
+        if (m_currentFrame != UINT32_MAX && m_currentFrame < frame && m_currentFrame >= record.Keyframe)
+        {
+            next = m_currentFrame + 1;
+        }
+        else
+        {
+            const FrameView view = GetKeyframeView(record.Keyframe);
+            const uint32_t particleCount = m_header.ParticleCount;
+
+            std::memcpy(m_current.Constants.data(), view.Constants, m_header.ConstantsSize);
+            std::memcpy(m_current.Positions.data(), view.Positions, particleCount * sizeof(Vector3));
+            std::memcpy(m_current.Scales.data(), view.Scales, particleCount * sizeof(float));
+            std::memcpy(m_current.Rotations.data(), view.Rotations, particleCount * sizeof(Vector4));
+            std::memcpy(m_current.ExtinctionScales.data(), view.ExtinctionScales, particleCount * sizeof(float));
+
+            m_currentFrame = record.Keyframe;
+            next = record.Keyframe + 1;
+        }
+
+        for (; next <= frame; next++)
+        {
+            // Invalidate first so a corrupt delta doesn't leave a half
+            // applied frame looking current
+            m_currentFrame = UINT32_MAX;
+            ApplyDelta(m_index[next]);
+            m_currentFrame = next;
+        }
+
+        return m_current;
+    }
+
+    inline const MappedFile& ParticleSnapshot::Reader::GetFile() const
+    {
+        return m_file;
+    }
+
+    inline void ParticleSnapshot::Reader::ApplyDelta(const FrameRecord& record)
+    {
+        const uint8_t* data = m_file.GetData() + record.Offset;
+        std::size_t remaining = static_cast<std::size_t>(record.Size);
+
+        const std::size_t constantsSize = static_cast<std::size_t>(AlignUp(m_header.ConstantsSize, 8));
+        if (constantsSize > remaining)
+        {
+            throw std::runtime_error("Truncated particle snapshot frame");
+        }
+
+        std::memcpy(m_current.Constants.data(), data, m_header.ConstantsSize);
+        data += constantsSize;
+        remaining -= constantsSize;
+
+        for (uint32_t s = 0; s < StreamCount; s++)
+        {
+            const std::size_t read = DecodeDelta(data,
+                remaining,
+                m_current.GetStream(s),
+                static_cast<std::size_t>(GetStreamSize(s, m_header.ParticleCount)));
+
+            data += read;
+            remaining -= read;
+        }
+    }
+
+    inline uint32_t ParticleSnapshot::GetElementSize(uint32_t stream)
+    {
+        constexpr std::array<uint32_t, StreamCount> sizes = {
+            sizeof(Vector3), sizeof(float), sizeof(Vector4), sizeof(float)
+        };
+
+        return sizes[stream];
+    }
+
+    inline uint64_t ParticleSnapshot::GetStreamSize(uint32_t stream, uint32_t particleCount)
+    {
+        return static_cast<uint64_t>(GetElementSize(stream)) * particleCount;
+    }
+
+    inline uint64_t ParticleSnapshot::GetKeyframeSize(uint32_t particleCount, uint32_t constantsSize)
+    {
+        return GetKeyframeSectionOffset(StreamCount + 1, particleCount, constantsSize);
+    }
+
+    inline uint64_t ParticleSnapshot::GetKeyframeSectionOffset(uint32_t section,
+        uint32_t particleCount,
+        uint32_t constantsSize)
+    {
+        uint64_t offset = 0;
+
+        for (uint32_t s = 0; s < section; s++)
+        {
+            const uint64_t size = s == 0 ? constantsSize : GetStreamSize(s - 1, particleCount);
+            offset += AlignUp(size, PageSize);
+        }
+
+        return offset;
+    }
+
+    inline uint64_t ParticleSnapshot::AlignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    inline void ParticleSnapshot::EncodeDelta(const uint8_t* previous,
+        const uint8_t* current,
+        std::size_t size,
+        std::vector<uint8_t>& out)
+    {
+        // Streams are made of floats, so they're always whole words
+        const std::size_t wordCount = size / sizeof(uint32_t);
+        const std::size_t blockCount = (wordCount + 63) / 64;
+
+        const std::size_t maskOffset = out.size();
+        out.resize(maskOffset + blockCount * sizeof(uint64_t), 0);
+
+        for (std::size_t block = 0; block < blockCount; block++)
+        {
+            uint64_t mask = 0;
+            const std::size_t first = block * 64;
+            const std::size_t last = std::min(wordCount, first + 64);
+
+            for (std::size_t w = first; w < last; w++)
+            {
+                if (std::memcmp(previous + w * 4, current + w * 4, 4) != 0)
+                {
+                    mask |= 1ull << (w - first);
+
+                    const std::size_t at = out.size();
+                    out.resize(at + 4);
+                    std::memcpy(out.data() + at, current + w * 4, 4);
+                }
+            }
+
+            std::memcpy(out.data() + maskOffset + block * sizeof(uint64_t), &mask, sizeof(mask));
+        }
+
+        out.resize(AlignUp(out.size(), 8), 0);
+    }
+
+    inline std::size_t ParticleSnapshot::DecodeDelta(const uint8_t* delta,
+        std::size_t available,
+        uint8_t* data,
+        std::size_t size)
+    {
+        const std::size_t wordCount = size / sizeof(uint32_t);
+        const std::size_t blockCount = (wordCount + 63) / 64;
+        const std::size_t maskBytes = blockCount * sizeof(uint64_t);
+
+        if (maskBytes > available)
+        {
+            throw std::runtime_error("Truncated particle snapshot frame");
+        }
+
+        const uint8_t* words = delta + maskBytes;
+        std::size_t changed = 0;
+
+        for (std::size_t block = 0; block < blockCount; block++)
+        {
+            uint64_t mask;
+            std::memcpy(&mask, delta + block * sizeof(uint64_t), sizeof(mask));
+
+            if (block * 64 + 64 > wordCount && wordCount % 64 != 0)
+            {
+                mask &= (1ull << (wordCount % 64)) - 1;
+            }
+
+            const std::size_t count = std::bitset<64>(mask).count();
+            if ((changed + count) * 4 > available - maskBytes)
+            {
+                throw std::runtime_error("Truncated particle snapshot frame");
+            }
+
+            while (mask != 0)
+            {
+                const std::size_t bit = static_cast<std::size_t>(std::bitset<64>((mask & (~mask + 1)) - 1).count());
+                std::memcpy(data + (block * 64 + bit) * 4, words + changed * 4, 4);
+                changed++;
+                mask &= mask - 1;
+            }
+        }
+
+        const std::size_t read = static_cast<std::size_t>(AlignUp(maskBytes + changed * 4, 8));
+        return std::min(read, available);
+    }
+}
@@ -0,0 +1,290 @@
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ParallelFor.h"
+
+namespace ISV
+{
+    // Uniform grid spatial hash for neighbour queries between particles.
+    //
+    // Particles are bucketed by hashing their integer cell coordinates into
+    // a power of two sized table, then counting sorted so that each bucket's
+    // particles are contiguous. The sort is stable and the per-thread ranges
+    // are merged in thread order, so the sorted order is the same for any
+    // thread count.
+    //
+    // Different cells can share a bucket. Each sorted entry keeps its cell
+    // coordinates so queries only report particles from the cells they visit.
+    class ParticleSpatialHash
+    {
+    public:
+        using Vector3 = std::array<float, 3>;
+        using Cell = std::array<int32_t, 3>;
+
+        // tableSize is rounded up to a power of two. Around twice the
+        // particle count keeps collisions rare.
+        ParticleSpatialHash(float cellSize, uint32_t tableSize);
+
+        // Positions are read from count elements spaced stride bytes apart,
+        // so the first member of a particle struct can be passed directly.
+        void Build(const void* positions,
+            uint32_t count,
+            std::size_t stride = sizeof(Vector3),
+            uint32_t threadCount = 1);
+
+        // Calls fn(index, distanceSquared) for every particle within radius
+        // of position, including the particle at position itself.
+        template<typename Fn>
+        void ForEachNeighbour(const Vector3& position, float radius, Fn&& fn) const;
+
+        // Appends the indices of the neighbours within radius to out and
+        // returns how many were added.
+        uint32_t FindNeighbours(const Vector3& position, float radius, std::vector<uint32_t>& out) const;
+
+        Cell GetCell(const Vector3& position) const;
+        uint32_t GetBucket(const Cell& cell) const;
+
+        float GetCellSize() const;
+        uint32_t GetTableSize() const;
+        uint32_t GetParticleCount() const;
+        std::size_t GetSizeInBytes() const;
+
+    private:
+        float m_cellSize;
+        float m_inverseCellSize;
+        uint32_t m_tableMask;
+
+        uint32_t m_count = 0;
+
+        // m_bucketStart[b] to m_bucketStart[b + 1] is the range of bucket b
+        std::vector<uint32_t> m_bucketStart;
+
+        // Per particle, in original order
+        std::vector<uint32_t> m_particleBucket;
+
+        // Per sorted entry
+        std::vector<uint32_t> m_sortedIndices;
+        std::vector<Vector3> m_sortedPositions;
+        std::vector<Cell> m_sortedCells;
+
+        // Per thread bucket counts, turned into write offsets in place
+        std::vector<std::vector<uint32_t>> m_threadCounts;
+    };
+
+    inline ParticleSpatialHash::ParticleSpatialHash(float cellSize, uint32_t tableSize)
+        : m_cellSize(cellSize), m_inverseCellSize(1.f / cellSize)
+    {
+        uint32_t size = 1;
+        while (size < tableSize && size < (1u << 31))
+        {
+            size <<= 1;
+        }
+
+        m_tableMask = size - 1;
+        m_bucketStart.resize(static_cast<std::size_t>(size) + 1, 0);
+    }
+
+    inline void ParticleSpatialHash::Build(const void* positions,
+        uint32_t count,
+        std::size_t stride,
+        uint32_t threadCount)
+    {
+        const auto* bytes = static_cast<const uint8_t*>(positions);
+        const uint32_t tableSize = m_tableMask + 1;
+
+        threadCount = std::max(1u, std::min(threadCount, count));
+
+        m_count = count;
+        m_particleBucket.resize(count);
+        m_sortedIndices.resize(count);
+        m_sortedPositions.resize(count);
+        m_sortedCells.resize(count);
+
+        m_threadCounts.resize(threadCount);
+
+        auto positionAt = [bytes, stride](uint32_t i)
+            {
+                return *reinterpret_cast<const Vector3*>(bytes + i * stride);
+            };
+
+        // Hash every particle and count bucket sizes per thread
+        ParallelFor(count, threadCount, [&](uint32_t begin, uint32_t end, uint32_t t)
+            {
+                auto& counts = m_threadCounts[t];
+                counts.assign(tableSize, 0);
+
+                for (uint32_t i = begin; i < end; i++)
+                {
+                    const uint32_t bucket = GetBucket(GetCell(positionAt(i)));
+                    m_particleBucket[i] = bucket;
+                    counts[bucket]++;
+                }
+            });
+
+        // Exclusive scan over (bucket, thread), split into ranges of buckets
+        std::vector<uint32_t> rangeTotals(threadCount, 0);
+
+        ParallelFor(tableSize, threadCount, [&](uint32_t begin, uint32_t end, uint32_t t)
+            {
+                uint32_t total = 0;
+                for (uint32_t b = begin; b < end; b++)
+                {
+                    for (const auto& counts : m_threadCounts)
+                    {
+                        total += counts[b];
+                    }
+                }
+
+                rangeTotals[t] = total;
+            });
+
+        uint32_t running = 0;
+        for (auto& total : rangeTotals)
+        {
+            const uint32_t rangeCount = total;
+            total = running;
+            running += rangeCount;
+        }
+
+        ParallelFor(tableSize, threadCount, [&](uint32_t begin, uint32_t end, uint32_t t)
+            {
+                uint32_t offset = rangeTotals[t];
+                for (uint32_t b = begin; b < end; b++)
+                {
+                    m_bucketStart[b] = offset;
+                    for (auto& counts : m_threadCounts)
+                    {
+                        const uint32_t bucketCount = counts[b];
+                        counts[b] = offset;
+                        offset += bucketCount;
+                    }
+                }
+            });
+
+        m_bucketStart[tableSize] = count;
+
+        // Scatter, keeping the original order within each bucket
+        ParallelFor(count, threadCount, [&](uint32_t begin, uint32_t end, uint32_t t)
+            {
+                auto& offsets = m_threadCounts[t];
+
+                for (uint32_t i = begin; i < end; i++)
+                {
+                    const uint32_t slot = offsets[m_particleBucket[i]]++;
+                    const Vector3 position = positionAt(i);
+
+                    m_sortedIndices[slot] = i;
+                    m_sortedPositions[slot] = position;
+                    m_sortedCells[slot] = GetCell(position);
+                }
+            });
+    }
+
+    template<typename Fn>
+    inline void ParticleSpatialHash::ForEachNeighbour(const Vector3& position, float radius, Fn&& fn) const
+    {
+        const float radiusSquared = radius * radius;
+
+        const Cell minCell = GetCell({ position[0] - radius, position[1] - radius, position[2] - radius });
+        const Cell maxCell = GetCell({ position[0] + radius, position[1] + radius, position[2] + radius });
+
+        for (int32_t z = minCell[2]; z <= maxCell[2]; z++)
+        {
+            for (int32_t y = minCell[1]; y <= maxCell[1]; y++)
+            {
+                for (int32_t x = minCell[0]; x <= maxCell[0]; x++)
+                {
+                    const Cell cell = { x, y, z };
+                    const uint32_t bucket = GetBucket(cell);
+
+                    const uint32_t end = m_bucketStart[bucket + 1];
+                    for (uint32_t slot = m_bucketStart[bucket]; slot < end; slot++)
+                    {
+                        if (m_sortedCells[slot] != cell)
+                            continue;
+
+                        const Vector3& p = m_sortedPositions[slot];
+                        const float dx = p[0] - position[0];
+                        const float dy = p[1] - position[1];
+                        const float dz = p[2] - position[2];
+                        const float distanceSquared = dx * dx + dy * dy + dz * dz;
+
+                        if (distanceSquared <= radiusSquared)
+                        {
+                            fn(m_sortedIndices[slot], distanceSquared);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    inline uint32_t ParticleSpatialHash::FindNeighbours(const Vector3& position,
+        float radius,
+        std::vector<uint32_t>& out) const
+    {
+        const std::size_t before = out.size();
+
+        ForEachNeighbour(position, radius, [&out](uint32_t index, float)
+            {
+                out.push_back(index);
+            });
+
+        return static_cast<uint32_t>(out.size() - before);
+    }
+
+    inline ParticleSpatialHash::Cell ParticleSpatialHash::GetCell(const Vector3& position) const
+    {
+        return {
+            static_cast<int32_t>(std::floor(position[0] * m_inverseCellSize)),
+            static_cast<int32_t>(std::floor(position[1] * m_inverseCellSize)),
+            static_cast<int32_t>(std::floor(position[2] * m_inverseCellSize))
+        };
+    }
+
+    inline uint32_t ParticleSpatialHash::GetBucket(const Cell& cell) const
+    {
+        const uint32_t h = (static_cast<uint32_t>(cell[0]) * 73856093u)
+            ^ (static_cast<uint32_t>(cell[1]) * 19349663u)
+            ^ (static_cast<uint32_t>(cell[2]) * 83492791u);
+
+        return h & m_tableMask;
+    }
+
+    inline float ParticleSpatialHash::GetCellSize() const
+    {
+        return m_cellSize;
+    }
+
+    inline uint32_t ParticleSpatialHash::GetTableSize() const
+    {
+        return m_tableMask + 1;
+    }
+
+    inline uint32_t ParticleSpatialHash::GetParticleCount() const
+    {
+        return m_count;
+    }
+
+    inline std::size_t ParticleSpatialHash::GetSizeInBytes() const
+    {
+        std::size_t size = m_bucketStart.size() * sizeof(uint32_t)
+            + m_particleBucket.size() * sizeof(uint32_t)
+            + m_sortedIndices.size() * sizeof(uint32_t)
+            + m_sortedPositions.size() * sizeof(Vector3)
+            + m_sortedCells.size() * sizeof(Cell);
+
+        for (const auto& counts : m_threadCounts)
+        {
+            size += counts.size() * sizeof(uint32_t);
+        }
+
+        return size;
+    }
+}
@@ -0,0 +1,352 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "FrameTimeHistogram.h"
+#include "ScenePreset.h"
+
+namespace ISV
+{
+    // Runs a list of presets one after the other, timing every frame once
+    // each preset has warmed up, and summarises the timings per preset.
+    //
+    // The renderer applies GetPreset() whenever EndFrame() reports that a
+    // new preset started, points the camera at GetCameraTime() each frame,
+    // and calls EndFrame() with the frame's duration, plus how long each
+    // pass took if it knows.
+    class PresetBenchmark
+    {
+    public:
+        enum class Pass : uint32_t
+        {
+            Simulation = 0,
+            VolumetricShadows,
+            ShadowMap,
+            Sort,
+            Render,
+            Count
+        };
+
+        static constexpr uint32_t PassCount = static_cast<uint32_t>(Pass::Count);
+
+        // Column names in the results
+        static constexpr std::array<const char*, PassCount> PassNames = {
+            "simulation",
+            "vol_shadows",
+            "shadow_map",
+            "sort",
+            "render"
+        };
+
+        static const char* GetPassName(Pass pass);
+
+        using PassTimes = std::array<double, PassCount>;
+
+        struct Result
+        {
+            std::string Preset;
+            uint32_t ParticleCount = 0;
+            uint32_t StepCount = 0;
+            uint32_t RenderingMethod = 0;
+            uint32_t Frames = 0;
+            double MeanMs = 0.0;
+            double MedianMs = 0.0;
+            double P95Ms = 0.0;
+            double P99Ms = 0.0;
+            double MinMs = 0.0;
+            double MaxMs = 0.0;
+            // Mean per pass, only filled in when every measured frame
+            // reported pass times
+            bool HasPassTimes = false;
+            PassTimes PassMeanMs = {};
+        };
+
+        explicit PresetBenchmark(std::vector<ScenePreset> presets);
+
+        bool IsFinished() const;
+        const ScenePreset& GetPreset() const;
+        uint32_t GetPresetIndex() const;
+        uint32_t GetPresetCount() const;
+
+        bool IsWarmingUp() const;
+
+        // Camera path time for the current frame. Held at zero while
+        // warming up.
+        float GetCameraTime() const;
+
+        // Returns true when the next frame starts a new preset
+        bool EndFrame(double frameSeconds);
+        bool EndFrame(double frameSeconds, const PassTimes& passMs);
+
+        const std::vector<Result>& GetResults() const;
+        void WriteCsv(const std::string& path) const;
+        void WriteJson(const std::string& path) const;
+        // JSON if path ends in .json, CSV otherwise
+        void WriteResults(const std::string& path) const;
+
+        static Result Summarize(const std::string& preset, std::vector<double> frameMs);
+
+    private:
+        bool RecordFrame(double frameSeconds, const PassTimes* passMs);
+        void FinishPreset();
+
+        std::vector<ScenePreset> m_presets;
+        std::vector<Result> m_results;
+        std::vector<double> m_frameMs;
+        PassTimes m_passTotalMs = {};
+        uint32_t m_passFrames = 0;
+
+        uint32_t m_presetIndex = 0;
+        uint32_t m_frame = 0;
+    };
+
+    inline PresetBenchmark::PresetBenchmark(std::vector<ScenePreset> presets)
+        : m_presets(std::move(presets))
+    {
+    }
+
+    inline bool PresetBenchmark::IsFinished() const
+    {
+        return m_presetIndex >= m_presets.size();
+    }
+
+    inline const ScenePreset& PresetBenchmark::GetPreset() const
+    {
+        return m_presets.at(m_presetIndex);
+    }
+
+    inline uint32_t PresetBenchmark::GetPresetIndex() const
+    {
+        return m_presetIndex;
+    }
+
+    inline uint32_t PresetBenchmark::GetPresetCount() const
+    {
+        return static_cast<uint32_t>(m_presets.size());
+    }
+
+    inline bool PresetBenchmark::IsWarmingUp() const
+    {
+        return !IsFinished() && m_frame < GetPreset().WarmupFrames;
+    }
+
+    inline float PresetBenchmark::GetCameraTime() const
+    {
+        if (IsFinished() || IsWarmingUp())
+        {
+            return 0.f;
+        }
+
+        const auto& preset = GetPreset();
+        return static_cast<float>(m_frame - preset.WarmupFrames) / preset.CameraFrameRate;
+    }
+
+    inline const char* PresetBenchmark::GetPassName(Pass pass)
+    {
+        return PassNames.at(static_cast<uint32_t>(pass));
+    }
+
+    inline bool PresetBenchmark::EndFrame(double frameSeconds)
+    {
+        return RecordFrame(frameSeconds, nullptr);
+    }
+
+    inline bool PresetBenchmark::EndFrame(double frameSeconds, const PassTimes& passMs)
+    {
+        return RecordFrame(frameSeconds, &passMs);
+    }
+
+    inline bool PresetBenchmark::RecordFrame(double frameSeconds, const PassTimes* passMs)
+    {
+        if (IsFinished())
+        {
+            return false;
+        }
+
+        if (!IsWarmingUp())
+        {
+            m_frameMs.push_back(frameSeconds * 1000.0);
+
+            if (passMs != nullptr)
+            {
+                for (uint32_t pass = 0; pass < PassCount; pass++)
+                {
+                    m_passTotalMs[pass] += (*passMs)[pass];
+                }
+                m_passFrames++;
+            }
+        }
+
+        m_frame++;
+
+        const auto& preset = GetPreset();
+        if (m_frame < preset.WarmupFrames + preset.MeasuredFrames)
+        {
+            return false;
+        }
+
+        FinishPreset();
+        return !IsFinished();
+    }
+
+    inline const std::vector<PresetBenchmark::Result>& PresetBenchmark::GetResults() const
+    {
+        return m_results;
+    }
+
+    inline void PresetBenchmark::WriteCsv(const std::string& path) const
+    {
+        std::ofstream file(path);
+        file << "preset,particle_count,step_count,rendering_method,"
+            << "frames,mean_ms,median_ms,p95_ms,p99_ms,min_ms,max_ms";
+        for (const char* pass : PassNames)
+        {
+            file << ',' << pass << "_ms";
+        }
+        file << '\n';
+
+        for (const auto& result : m_results)
+        {
+            // Preset names are free text
+            std::string name = result.Preset;
+            std::replace(name.begin(), name.end(), ',', ';');
+
+            file << name << ','
+                << result.ParticleCount << ','
+                << result.StepCount << ','
+                << ScenePreset::RenderingMethodNames.at(result.RenderingMethod) << ','
+                << result.Frames << ','
+                << result.MeanMs << ','
+                << result.MedianMs << ','
+                << result.P95Ms << ','
+                << result.P99Ms << ','
+                << result.MinMs << ','
+                << result.MaxMs;
+
+            // Left empty rather than zero when the renderer had no pass times
+            for (double passMs : result.PassMeanMs)
+            {
+                file << ',';
+                if (result.HasPassTimes)
+                {
+                    file << passMs;
+                }
+            }
+            file << '\n';
+        }
+
+        if (!file)
+        {
+            throw std::runtime_error("Could not write benchmark results to " + path);
+        }
+    }
+
+    inline void PresetBenchmark::WriteJson(const std::string& path) const
+    {
+        nlohmann::json results = nlohmann::json::array();
+
+        for (const auto& result : m_results)
+        {
+            nlohmann::json passes = nullptr;
+            if (result.HasPassTimes)
+            {
+                passes = nlohmann::json::object();
+                for (uint32_t pass = 0; pass < PassCount; pass++)
+                {
+                    passes[PassNames[pass]] = result.PassMeanMs[pass];
+                }
+            }
+
+            results.push_back({
+                { "preset", result.Preset },
+                { "particleCount", result.ParticleCount },
+                { "stepCount", result.StepCount },
+                { "renderingMethod", ScenePreset::RenderingMethodNames.at(result.RenderingMethod) },
+                { "frames", result.Frames },
+                { "meanMs", result.MeanMs },
+                { "medianMs", result.MedianMs },
+                { "p95Ms", result.P95Ms },
+                { "p99Ms", result.P99Ms },
+                { "minMs", result.MinMs },
+                { "maxMs", result.MaxMs },
+                { "passMeanMs", passes }
+            });
+        }
+
+        std::ofstream file(path);
+        file << results.dump(4) << "\n";
+
+        if (!file)
+        {
+            throw std::runtime_error("Could not write benchmark results to " + path);
+        }
+    }
+
+    inline void PresetBenchmark::WriteResults(const std::string& path) const
+    {
+        const std::string extension = ".json";
+        if (path.size() >= extension.size()
+            && path.compare(path.size() - extension.size(), extension.size(), extension) == 0)
+        {
+            WriteJson(path);
+        }
+        else
+        {
+            WriteCsv(path);
+        }
+    }
+
+    inline PresetBenchmark::Result PresetBenchmark::Summarize(const std::string& preset,
+        std::vector<double> frameMs)
+    {
+        const auto summary = FrameTimeHistogram::Summarize(std::move(frameMs));
+
+        Result result;
+        result.Preset = preset;
+        result.Frames = summary.Frames;
+        result.MeanMs = summary.MeanMs;
+        result.MedianMs = summary.P50Ms;
+        result.P95Ms = summary.P95Ms;
+        result.P99Ms = summary.P99Ms;
+        result.MinMs = summary.MinMs;
+        result.MaxMs = summary.MaxMs;
+
+        return result;
+    }
+
+    inline void PresetBenchmark::FinishPreset()
+    {
+        const auto& preset = GetPreset();
+
+        Result result = Summarize(preset.Name, std::move(m_frameMs));
+        result.ParticleCount = preset.ParticleCount;
+        result.StepCount = preset.StepCount;
+        result.RenderingMethod = preset.RenderingMethod;
+
+        if (m_passFrames > 0 && m_passFrames == result.Frames)
+        {
+            result.HasPassTimes = true;
+            for (uint32_t pass = 0; pass < PassCount; pass++)
+            {
+                result.PassMeanMs[pass] = m_passTotalMs[pass] / m_passFrames;
+            }
+        }
+
+        m_results.push_back(std::move(result));
+        m_frameMs.clear();
+        m_passTotalMs = {};
+        m_passFrames = 0;
+
+        m_presetIndex++;
+        m_frame = 0;
+    }
+}
@@ -0,0 +1,358 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define ISV_PROFILER_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define ISV_PROFILER_RDTSC 1
+#endif
+
+#include <nlohmann/json.hpp>
+
+namespace ISV
+{
+    // Scoped CPU zones recorded into per-thread ring buffers.
+    //
+    //  void Game::Render()
+    //  {
+    //      ISV_PROFILE_ZONE("Render");
+    //      ...
+    //  }
+    //
+    // A zone writes one complete event with its start and end times and
+    // its nesting depth when it closes. Zones read the CPU timestamp counter
+    // where there is one, which costs about half as much as
+    // steady_clock::now(); ticks are converted to nanoseconds on the steady
+    // clock when the events are collected. Recording only touches the
+    // calling thread's buffer, so it takes no locks; the profiler lock is
+    // only taken when a thread records for the first time and when the
+    // events are collected. Each buffer keeps the most recent
+    // EventsPerThread zones.
+    //
+    // Zone names must outlive the profiler, string literals are the
+    // intended use. Collect() should be called while no other thread is
+    // recording, e.g. from the main thread between frames.
+    class Profiler
+    {
+    public:
+        struct Event
+        {
+            const char* Name;
+            uint64_t StartNs;
+            uint64_t EndNs;
+            uint32_t ThreadIndex;
+            uint32_t Depth;
+        };
+
+        static constexpr uint32_t EventsPerThread = 1 << 16;
+
+        struct RawEvent
+        {
+            const char* Name;
+            uint64_t StartTicks;
+            uint64_t EndTicks;
+            uint32_t Depth;
+        };
+
+        struct ThreadBuffer
+        {
+            std::vector<RawEvent> Events;
+            std::atomic<uint64_t> Written = 0;
+            uint32_t ThreadIndex = 0;
+            uint32_t Depth = 0;
+        };
+
+        static Profiler& Get();
+
+        void SetEnabled(bool enabled);
+        bool IsEnabled() const;
+
+        // Nanoseconds on a monotonic clock
+        static uint64_t Now();
+        // The clock zones record, in unspecified units
+        static uint64_t Ticks();
+
+        // Drops every recorded event
+        void Clear();
+
+        // Every retained event, ordered by start time
+        std::vector<Event> Collect() const;
+
+        // Chrome trace event format, for chrome://tracing or Perfetto
+        static nlohmann::json ToChromeTrace(const std::vector<Event>& events);
+        void WriteChromeTrace(const std::string& path) const;
+
+        // The calling thread's buffer. Buffers of threads that have exited
+        // are kept, with their events, and handed to the next new thread.
+        ThreadBuffer& GetThreadBuffer();
+
+    private:
+        Profiler();
+
+        ThreadBuffer& AcquireThreadBuffer();
+        void ReleaseThreadBuffer(ThreadBuffer* buffer);
+
+        struct ThreadHandle
+        {
+            ThreadBuffer* Buffer = nullptr;
+            ~ThreadHandle();
+        };
+
+        std::atomic<bool> m_enabled = false;
+
+        // A pair of readings of both clocks to convert ticks against
+        uint64_t m_originTicks;
+        uint64_t m_originNs;
+
+        mutable std::mutex m_mutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+        std::vector<ThreadBuffer*> m_freeBuffers;
+
+        // The buffer pointer is kept apart from the handle so the zone's
+        // fast path reads a plain thread_local, without the initialisation
+        // check a thread_local with a destructor needs
+        static thread_local ThreadBuffer* s_buffer;
+        static thread_local ThreadHandle s_thread;
+    };
+
+    class ProfileZone
+    {
+    public:
+        explicit ProfileZone(const char* name);
+        ~ProfileZone();
+
+        ProfileZone(const ProfileZone&) = delete;
+        ProfileZone& operator=(const ProfileZone&) = delete;
+
+    private:
+        Profiler::ThreadBuffer* m_buffer = nullptr;
+        const char* m_name;
+        uint64_t m_start = 0;
+    };
+
+    inline thread_local Profiler::ThreadBuffer* Profiler::s_buffer = nullptr;
+    inline thread_local Profiler::ThreadHandle Profiler::s_thread;
+
+    inline Profiler::Profiler()
+        : m_originTicks(Ticks()),
+        m_originNs(Now())
+    {
+    }
+
+    inline Profiler& Profiler::Get()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    inline void Profiler::SetEnabled(bool enabled)
+    {
+        m_enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    inline bool Profiler::IsEnabled() const
+    {
+        return m_enabled.load(std::memory_order_relaxed);
+    }
+
+    inline uint64_t Profiler::Now()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    inline uint64_t Profiler::Ticks()
+    {
+#ifdef ISV_PROFILER_RDTSC
+        return __rdtsc();
+#else
+        return Now();
+#endif
+    }
+
+    inline void Profiler::Clear()
+    {
+        std::lock_guard lock(m_mutex);
+
+        for (auto& buffer : m_buffers)
+        {
+            buffer->Written.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    inline std::vector<Profiler::Event> Profiler::Collect() const
+    {
+        std::vector<Event> events;
+
+        // Measured over the whole run so far, so it gets more accurate the
+        // longer the profiler has been alive
+        const uint64_t elapsedTicks = Ticks() - m_originTicks;
+        const uint64_t elapsedNs = Now() - m_originNs;
+        const double nsPerTick = elapsedTicks > 0 && elapsedNs > 0
+            ? static_cast<double>(elapsedNs) / elapsedTicks
+            : 1.0;
+
+        auto toNs = [&](uint64_t ticks)
+            {
+                return m_originNs + static_cast<uint64_t>(
+                    static_cast<double>(static_cast<int64_t>(ticks - m_originTicks)) * nsPerTick);
+            };
+
+        {
+            std::lock_guard lock(m_mutex);
+
+            for (const auto& buffer : m_buffers)
+            {
+                const uint64_t written = buffer->Written.load(std::memory_order_acquire);
+                const uint64_t count = std::min<uint64_t>(written, EventsPerThread);
+
+                for (uint64_t i = written - count; i < written; i++)
+                {
+                    const auto& raw = buffer->Events[i % EventsPerThread];
+                    events.push_back({
+                        raw.Name,
+                        toNs(raw.StartTicks),
+                        toNs(raw.EndTicks),
+                        buffer->ThreadIndex,
+                        raw.Depth
+                    });
+                }
+            }
+        }
+
+        std::sort(events.begin(), events.end(), [](const Event& a, const Event& b)
+            {
+                return a.StartNs != b.StartNs ? a.StartNs < b.StartNs : a.Depth < b.Depth;
+            });
+
+        return events;
+    }
+
+    inline nlohmann::json Profiler::ToChromeTrace(const std::vector<Event>& events)
+    {
+        nlohmann::json traceEvents = nlohmann::json::array();
+
+        const uint64_t origin = events.empty() ? 0 : events.front().StartNs;
+
+        for (const auto& event : events)
+        {
+            // Complete events, timestamps in microseconds
+            traceEvents.push_back({
+                { "name", event.Name },
+                { "ph", "X" },
+                { "pid", 1 },
+                { "tid", event.ThreadIndex },
+                { "ts", (event.StartNs - origin) / 1000.0 },
+                { "dur", (event.EndNs - event.StartNs) / 1000.0 },
+                { "args", { { "depth", event.Depth } } }
+            });
+        }
+
+        return {
+            { "traceEvents", traceEvents },
+            { "displayTimeUnit", "ns" }
+        };
+    }
+
+    inline void Profiler::WriteChromeTrace(const std::string& path) const
+    {
+        std::ofstream file(path);
+        file << ToChromeTrace(Collect()).dump() << "\n";
+
+        if (!file)
+        {
+            throw std::runtime_error("Could not write trace " + path);
+        }
+    }
+
+    inline Profiler::ThreadBuffer& Profiler::GetThreadBuffer()
+    {
+        return s_buffer != nullptr ? *s_buffer : AcquireThreadBuffer();
+    }
+
+    inline Profiler::ThreadBuffer& Profiler::AcquireThreadBuffer()
+    {
+        std::lock_guard lock(m_mutex);
+
+        if (!m_freeBuffers.empty())
+        {
+            s_thread.Buffer = m_freeBuffers.back();
+            m_freeBuffers.pop_back();
+        }
+        else
+        {
+            auto buffer = std::make_unique<ThreadBuffer>();
+            buffer->Events.resize(EventsPerThread);
+            buffer->ThreadIndex = static_cast<uint32_t>(m_buffers.size());
+
+            s_thread.Buffer = buffer.get();
+            m_buffers.push_back(std::move(buffer));
+        }
+
+        s_thread.Buffer->Depth = 0;
+        s_buffer = s_thread.Buffer;
+        return *s_buffer;
+    }
+
+    inline void Profiler::ReleaseThreadBuffer(ThreadBuffer* buffer)
+    {
+        std::lock_guard lock(m_mutex);
+        m_freeBuffers.push_back(buffer);
+    }
+
+    inline Profiler::ThreadHandle::~ThreadHandle()
+    {
+        if (Buffer != nullptr)
+        {
+            Profiler::Get().ReleaseThreadBuffer(Buffer);
+            s_buffer = nullptr;
+        }
+    }
+
+    inline ProfileZone::ProfileZone(const char* name)
+        : m_name(name)
+    {
+        auto& profiler = Profiler::Get();
+        if (!profiler.IsEnabled())
+            return;
+
+        m_buffer = &profiler.GetThreadBuffer();
+        m_buffer->Depth++;
+        m_start = Profiler::Ticks();
+    }
+
+    inline ProfileZone::~ProfileZone()
+    {
+        if (m_buffer == nullptr)
+            return;
+
+        const uint64_t end = Profiler::Ticks();
+        const uint32_t depth = --m_buffer->Depth;
+
+        // Only this thread writes to the buffer
+        const uint64_t written = m_buffer->Written.load(std::memory_order_relaxed);
+        m_buffer->Events[written % Profiler::EventsPerThread] = {
+            m_name,
+            m_start,
+            end,
+            depth
+        };
+        m_buffer->Written.store(written + 1, std::memory_order_release);
+    }
+}
+
+#define ISV_PROFILE_CONCAT_INNER(a, b) a##b
+#define ISV_PROFILE_CONCAT(a, b) ISV_PROFILE_CONCAT_INNER(a, b)
+#define ISV_PROFILE_ZONE(name) ::ISV::ProfileZone ISV_PROFILE_CONCAT(isvProfileZone, __LINE__)(name)
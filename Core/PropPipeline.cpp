@@ -17,6 +17,7 @@ namespace ISV
         m_rootSignature.AddCBV(0, 0); // constants
         m_rootSignature.AddSRV(0, 0); // shadow map
         m_rootSignature.AddSRV(1, 0); // volumetric shadow map
+        m_rootSignature.AddSRV(2, 0); // Fourier opacity map
 
         m_rootSignature.AddStaticSampler(CD3DX12_STATIC_SAMPLER_DESC(0,
             D3D12_FILTER_MIN_MAG_MIP_LINEAR,
@@ -86,10 +87,13 @@ namespace ISV
         constants.ShadowTransform = ShadowTransform.Transpose();
         constants.VolumetricShadowTransform = VolumetricShadowTransform.Transpose();
         constants.RenderingMethod = RenderingMethod;
+        constants.VolumetricShadowRepresentation = VolumetricShadowRepresentation;
+        constants.VolumetricShadowFormat = VolumetricShadowFormat;
 
         m_rootSignature.SetCBV(cl, 0, 0, constants); 
         m_rootSignature.SetSRV(cl, 0, 0, ShadowMap);
         m_rootSignature.SetSRV(cl, 1, 0, VolumetricShadowMap);
+        m_rootSignature.SetSRV(cl, 2, 0, FourierOpacityMap);
 
 
         cl->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
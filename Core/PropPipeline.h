@@ -29,6 +29,8 @@ namespace ISV
             DirectX::XMMATRIX VolumetricShadowTransform;
             DirectX::XMFLOAT3 CameraPosition;
             uint32_t RenderingMethod;
+            uint32_t VolumetricShadowRepresentation;
+            uint32_t VolumetricShadowFormat;
         };
 
         using VertexType = DirectX::VertexPositionNormalTexture;
@@ -43,6 +45,7 @@ namespace ISV
 
         Gradient::GraphicsMemoryManager::DescriptorView ShadowMap;
         Gradient::GraphicsMemoryManager::DescriptorView VolumetricShadowMap;
+        Gradient::GraphicsMemoryManager::DescriptorView FourierOpacityMap;
         DirectX::SimpleMath::Matrix World;
         DirectX::SimpleMath::Matrix View;
         DirectX::SimpleMath::Matrix Proj;
@@ -51,6 +54,8 @@ namespace ISV
         DirectX::SimpleMath::Vector3 CameraPosition;
         DirectionalLight Light;
         uint32_t RenderingMethod;
+        uint32_t VolumetricShadowRepresentation = 0;
+        uint32_t VolumetricShadowFormat = 0;
 
     private:
         void InitializeRootSignature(ID3D12Device* device);
@@ -0,0 +1,474 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace ISV
+{
+    // Everything needed to reproduce a scene: the particle, lighting and
+    // simulation parameters the GUI exposes, a camera path and how long to
+    // run it for when benchmarking.
+    //
+    // Presets are JSON. Every key is optional and falls back to the default
+    // below, but unknown keys are errors so that a typo can't silently
+    // benchmark the wrong scene.
+    struct ScenePreset
+    {
+        using Vector3 = std::array<float, 3>;
+
+        // Same order as Game::RenderingMethod
+        static constexpr std::array<const char*, 6> RenderingMethodNames = {
+            "Vanilla",
+            "TaylorSeries",
+            "Simpson",
+            "WastedPixelsTet",
+            "SphericalProxy",
+            "WastedPixelsSphere"
+        };
+
+        // Same order as VolShadowMap::Representation
+        static constexpr std::array<const char*, 2> VolShadowRepresentationNames = {
+            "SliceVolume",
+            "FourierOpacity"
+        };
+
+        // Same order as VolShadowStorageFormat
+        static constexpr std::array<const char*, 4> VolShadowFormatNames = {
+            "Float32",
+            "Float16",
+            "LogUnorm16",
+            "LogUnorm8"
+        };
+
+        struct CameraKeyframe
+        {
+            float Time = 0.f;
+            Vector3 Position = { 0.f, 6.f, 45.f };
+            Vector3 Target = { 0.f, 6.f, 0.f };
+        };
+
+        struct CameraPose
+        {
+            Vector3 Position;
+            // Normalised
+            Vector3 Direction;
+        };
+
+        std::string Name = "Default";
+
+        // Particles
+        uint32_t ParticleCount = 4000;
+        float Scale = 4.4f;
+        Vector3 Albedo = { 0.5f, 0.5f, 0.5f };
+        float Extinction = 20.f;
+        float ExtinctionFalloff = 3.f;
+        float Anisotropy = 0.2f;
+        float ScatteringAsymmetry = 0.4f;
+        float MultiScatteringFactor = 0.5f;
+        float Reflectivity = 0.f;
+        uint32_t RenderingMethod = 4;
+        uint32_t StepCount = 2;
+        bool SoftShadows = false;
+        bool CompressedInstances = false;
+
+        // Light
+        Vector3 LightDirection = { 0.f, -1.f, 1.f };
+        float LightBrightness = 2.f;
+        Vector3 LightColor = { 1.f, 0.8705882353f, 0.6078431373f };
+
+        // Volumetric shadows
+        uint32_t VolShadowRepresentation = 0;
+        uint32_t VolShadowFormat = 0;
+        bool SplatVolShadows = false;
+        float VolShadowLodScale = 0.f;
+        bool DebugVolShadows = false;
+
+        // Simulation
+        bool SimulationEnabled = true;
+        bool FixedTimestep = true;
+        uint32_t SimulationRate = 60;
+        uint32_t Substeps = 1;
+        bool ParticleSleeping = false;
+        float SleepVelocityThreshold = 0.05f;
+        float SleepAccelerationThreshold = 0.5f;
+        uint32_t SleepSteps = 30;
+        float WakeRadius = 3.f;
+        Vector3 TargetPosition = { 0.f, 6.f, 0.f };
+
+        // Props
+        bool AnimateProps = true;
+        Vector3 BoxPosition = { -3.f, 0.f, 0.f };
+        Vector3 SpherePosition = { 3.f, 0.f, 0.f };
+
+        // Keyframes in increasing time order. The camera holds the first
+        // and last poses outside the path's time range.
+        std::vector<CameraKeyframe> CameraPath = { CameraKeyframe() };
+
+        // Benchmarking
+        uint32_t WarmupFrames = 60;
+        uint32_t MeasuredFrames = 300;
+        // The camera path advances by 1 / CameraFrameRate seconds per
+        // frame, so every run renders the same views however fast it goes
+        float CameraFrameRate = 60.f;
+
+        CameraPose EvaluateCamera(float time) const;
+
+        static ScenePreset FromJson(const nlohmann::json& json);
+        nlohmann::json ToJson() const;
+
+        static ScenePreset Load(const std::string& path);
+        void Save(const std::string& path) const;
+
+    private:
+        template<typename T>
+        static void Read(const nlohmann::json& section, const char* key, T& value);
+
+        template<std::size_t N>
+        static void ReadEnum(const nlohmann::json& section,
+            const char* key,
+            const std::array<const char*, N>& names,
+            uint32_t& value);
+
+        static void CheckKeys(const nlohmann::json& section,
+            const char* sectionName,
+            std::initializer_list<const char*> keys);
+
+        static const nlohmann::json& GetSection(const nlohmann::json& json, const char* name);
+    };
+
+    inline ScenePreset::CameraPose ScenePreset::EvaluateCamera(float time) const
+    {
+        CameraKeyframe a;
+        CameraKeyframe b;
+        float t = 0.f;
+
+        if (!CameraPath.empty())
+        {
+            a = b = CameraPath.front();
+
+            if (time >= CameraPath.back().Time)
+            {
+                a = b = CameraPath.back();
+            }
+            else
+            {
+                for (std::size_t i = 0; i + 1 < CameraPath.size(); i++)
+                {
+                    if (time < CameraPath[i + 1].Time)
+                    {
+                        a = CameraPath[i];
+                        b = CameraPath[i + 1];
+
+                        const float span = b.Time - a.Time;
+                        t = span > 0.f ? std::clamp((time - a.Time) / span, 0.f, 1.f) : 1.f;
+                        break;
+                    }
+                }
+            }
+        }
+
+        CameraPose pose;
+        Vector3 target;
+
+        for (int i = 0; i < 3; i++)
+        {
+            pose.Position[i] = a.Position[i] + (b.Position[i] - a.Position[i]) * t;
+            target[i] = a.Target[i] + (b.Target[i] - a.Target[i]) * t;
+            pose.Direction[i] = target[i] - pose.Position[i];
+        }
+
+        const float length = std::sqrt(pose.Direction[0] * pose.Direction[0]
+            + pose.Direction[1] * pose.Direction[1]
+            + pose.Direction[2] * pose.Direction[2]);
+
+        if (length > 0.f)
+        {
+            for (auto& component : pose.Direction)
+            {
+                component /= length;
+            }
+        }
+        else
+        {
+            pose.Direction = { 0.f, 0.f, -1.f };
+        }
+
+        return pose;
+    }
+
+    inline ScenePreset ScenePreset::FromJson(const nlohmann::json& json)
+    {
+        ScenePreset preset;
+
+        CheckKeys(json, "preset", {
+            "name", "particles", "light", "volumetricShadows",
+            "simulation", "props", "camera", "benchmark" });
+
+        Read(json, "name", preset.Name);
+
+        const auto& particles = GetSection(json, "particles");
+        CheckKeys(particles, "particles", {
+            "count", "scale", "albedo", "extinction", "extinctionFalloff",
+            "anisotropy", "scatteringAsymmetry", "multiScatteringFactor",
+            "reflectivity", "renderingMethod", "stepCount", "softShadows",
+            "compressedInstances" });
+        Read(particles, "count", preset.ParticleCount);
+        Read(particles, "scale", preset.Scale);
+        Read(particles, "albedo", preset.Albedo);
+        Read(particles, "extinction", preset.Extinction);
+        Read(particles, "extinctionFalloff", preset.ExtinctionFalloff);
+        Read(particles, "anisotropy", preset.Anisotropy);
+        Read(particles, "scatteringAsymmetry", preset.ScatteringAsymmetry);
+        Read(particles, "multiScatteringFactor", preset.MultiScatteringFactor);
+        Read(particles, "reflectivity", preset.Reflectivity);
+        ReadEnum(particles, "renderingMethod", RenderingMethodNames, preset.RenderingMethod);
+        Read(particles, "stepCount", preset.StepCount);
+        Read(particles, "softShadows", preset.SoftShadows);
+        Read(particles, "compressedInstances", preset.CompressedInstances);
+
+        const auto& light = GetSection(json, "light");
+        CheckKeys(light, "light", { "direction", "brightness", "color" });
+        Read(light, "direction", preset.LightDirection);
+        Read(light, "brightness", preset.LightBrightness);
+        Read(light, "color", preset.LightColor);
+
+        const auto& volShadows = GetSection(json, "volumetricShadows");
+        CheckKeys(volShadows, "volumetricShadows", {
+            "representation", "format", "splat", "lodScale", "debug" });
+        ReadEnum(volShadows, "representation", VolShadowRepresentationNames, preset.VolShadowRepresentation);
+        ReadEnum(volShadows, "format", VolShadowFormatNames, preset.VolShadowFormat);
+        Read(volShadows, "splat", preset.SplatVolShadows);
+        Read(volShadows, "lodScale", preset.VolShadowLodScale);
+        Read(volShadows, "debug", preset.DebugVolShadows);
+
+        const auto& simulation = GetSection(json, "simulation");
+        CheckKeys(simulation, "simulation", {
+            "enabled", "fixedTimestep", "rate", "substeps", "sleeping",
+            "sleepVelocity", "sleepAcceleration", "sleepSteps", "wakeRadius",
+            "targetPosition" });
+        Read(simulation, "enabled", preset.SimulationEnabled);
+        Read(simulation, "fixedTimestep", preset.FixedTimestep);
+        Read(simulation, "rate", preset.SimulationRate);
+        Read(simulation, "substeps", preset.Substeps);
+        Read(simulation, "sleeping", preset.ParticleSleeping);
+        Read(simulation, "sleepVelocity", preset.SleepVelocityThreshold);
+        Read(simulation, "sleepAcceleration", preset.SleepAccelerationThreshold);
+        Read(simulation, "sleepSteps", preset.SleepSteps);
+        Read(simulation, "wakeRadius", preset.WakeRadius);
+        Read(simulation, "targetPosition", preset.TargetPosition);
+
+        const auto& props = GetSection(json, "props");
+        CheckKeys(props, "props", { "animate", "boxPosition", "spherePosition" });
+        Read(props, "animate", preset.AnimateProps);
+        Read(props, "boxPosition", preset.BoxPosition);
+        Read(props, "spherePosition", preset.SpherePosition);
+
+        const auto& camera = GetSection(json, "camera");
+        CheckKeys(camera, "camera", { "path" });
+        if (camera.contains("path"))
+        {
+            preset.CameraPath.clear();
+
+            for (const auto& keyframeJson : camera.at("path"))
+            {
+                CheckKeys(keyframeJson, "camera path keyframe", { "time", "position", "target" });
+
+                CameraKeyframe keyframe;
+                Read(keyframeJson, "time", keyframe.Time);
+                Read(keyframeJson, "position", keyframe.Position);
+                Read(keyframeJson, "target", keyframe.Target);
+
+                if (!preset.CameraPath.empty() && keyframe.Time < preset.CameraPath.back().Time)
+                {
+                    throw std::runtime_error("Camera path keyframes must be in time order");
+                }
+
+                preset.CameraPath.push_back(keyframe);
+            }
+
+            if (preset.CameraPath.empty())
+            {
+                throw std::runtime_error("Camera path needs at least one keyframe");
+            }
+        }
+
+        const auto& benchmark = GetSection(json, "benchmark");
+        CheckKeys(benchmark, "benchmark", { "warmupFrames", "measuredFrames", "cameraFrameRate" });
+        Read(benchmark, "warmupFrames", preset.WarmupFrames);
+        Read(benchmark, "measuredFrames", preset.MeasuredFrames);
+        Read(benchmark, "cameraFrameRate", preset.CameraFrameRate);
+
+        if (preset.CameraFrameRate <= 0.f)
+        {
+            throw std::runtime_error("Camera frame rate must be positive");
+        }
+
+        return preset;
+    }
+
+    inline nlohmann::json ScenePreset::ToJson() const
+    {
+        nlohmann::json path = nlohmann::json::array();
+        for (const auto& keyframe : CameraPath)
+        {
+            path.push_back({
+                { "time", keyframe.Time },
+                { "position", keyframe.Position },
+                { "target", keyframe.Target }
+                });
+        }
+
+        return {
+            { "name", Name },
+            { "particles", {
+                { "count", ParticleCount },
+                { "scale", Scale },
+                { "albedo", Albedo },
+                { "extinction", Extinction },
+                { "extinctionFalloff", ExtinctionFalloff },
+                { "anisotropy", Anisotropy },
+                { "scatteringAsymmetry", ScatteringAsymmetry },
+                { "multiScatteringFactor", MultiScatteringFactor },
+                { "reflectivity", Reflectivity },
+                { "renderingMethod", RenderingMethodNames.at(RenderingMethod) },
+                { "stepCount", StepCount },
+                { "softShadows", SoftShadows },
+                { "compressedInstances", CompressedInstances }
+            } },
+            { "light", {
+                { "direction", LightDirection },
+                { "brightness", LightBrightness },
+                { "color", LightColor }
+            } },
+            { "volumetricShadows", {
+                { "representation", VolShadowRepresentationNames.at(VolShadowRepresentation) },
+                { "format", VolShadowFormatNames.at(VolShadowFormat) },
+                { "splat", SplatVolShadows },
+                { "lodScale", VolShadowLodScale },
+                { "debug", DebugVolShadows }
+            } },
+            { "simulation", {
+                { "enabled", SimulationEnabled },
+                { "fixedTimestep", FixedTimestep },
+                { "rate", SimulationRate },
+                { "substeps", Substeps },
+                { "sleeping", ParticleSleeping },
+                { "sleepVelocity", SleepVelocityThreshold },
+                { "sleepAcceleration", SleepAccelerationThreshold },
+                { "sleepSteps", SleepSteps },
+                { "wakeRadius", WakeRadius },
+                { "targetPosition", TargetPosition }
+            } },
+            { "props", {
+                { "animate", AnimateProps },
+                { "boxPosition", BoxPosition },
+                { "spherePosition", SpherePosition }
+            } },
+            { "camera", {
+                { "path", path }
+            } },
+            { "benchmark", {
+                { "warmupFrames", WarmupFrames },
+                { "measuredFrames", MeasuredFrames },
+                { "cameraFrameRate", CameraFrameRate }
+            } }
+        };
+    }
+
+    inline ScenePreset ScenePreset::Load(const std::string& path)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            throw std::runtime_error("Could not open preset " + path);
+        }
+
+        try
+        {
+            return FromJson(nlohmann::json::parse(file));
+        }
+        catch (const std::exception& e)
+        {
+            throw std::runtime_error("Invalid preset " + path + ": " + e.what());
+        }
+    }
+
+    inline void ScenePreset::Save(const std::string& path) const
+    {
+        std::ofstream file(path);
+        file << ToJson().dump(4) << "\n";
+
+        if (!file)
+        {
+            throw std::runtime_error("Could not write preset " + path);
+        }
+    }
+
+    template<typename T>
+    inline void ScenePreset::Read(const nlohmann::json& section, const char* key, T& value)
+    {
+        if (section.contains(key))
+        {
+            section.at(key).get_to(value);
+        }
+    }
+
+    template<std::size_t N>
+    inline void ScenePreset::ReadEnum(const nlohmann::json& section,
+        const char* key,
+        const std::array<const char*, N>& names,
+        uint32_t& value)
+    {
+        if (!section.contains(key))
+            return;
+
+        const auto name = section.at(key).get<std::string>();
+        for (uint32_t i = 0; i < N; i++)
+        {
+            if (name == names[i])
+            {
+                value = i;
+                return;
+            }
+        }
+
+        throw std::runtime_error("Unknown value \"" + name + "\" for " + key);
+    }
+
+    inline void ScenePreset::CheckKeys(const nlohmann::json& section,
+        const char* sectionName,
+        std::initializer_list<const char*> keys)
+    {
+        if (!section.is_object())
+        {
+            throw std::runtime_error(std::string("Expected an object for ") + sectionName);
+        }
+
+        for (const auto& item : section.items())
+        {
+            const bool known = std::any_of(keys.begin(), keys.end(),
+                [&item](const char* key) { return item.key() == key; });
+
+            if (!known)
+            {
+                throw std::runtime_error("Unknown key \"" + item.key() + "\" in " + sectionName);
+            }
+        }
+    }
+
+    inline const nlohmann::json& ScenePreset::GetSection(const nlohmann::json& json, const char* name)
+    {
+        static const nlohmann::json empty = nlohmann::json::object();
+
+        return json.contains(name) ? json.at(name) : empty;
+    }
+}
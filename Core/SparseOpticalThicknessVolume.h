@@ -0,0 +1,323 @@
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ISV
+{
+    // Bricked sparse storage for the cumulative optical thickness volume.
+    //
+    // The volume is split into BrickSize^3 bricks. An occupancy bitmap marks
+    // the bricks that can hold non-zero optical thickness, and only those
+    // bricks are given space in the brick pool. Everything else reads as zero.
+    //
+    // Coordinates match the VolShadowMap texture: u and v across the light's
+    // view, w along the light direction, all normalised to [0, 1].
+    class SparseOpticalThicknessVolume
+    {
+    public:
+        static constexpr uint32_t BrickSize = 8;
+        static constexpr uint32_t BrickTexelCount = BrickSize * BrickSize * BrickSize;
+        static constexpr uint32_t EmptyBrick = UINT32_MAX;
+
+        struct Bounds
+        {
+            std::array<float, 3> Min;
+            std::array<float, 3> Max;
+        };
+
+        SparseOpticalThicknessVolume(uint32_t width, uint32_t height, uint32_t depth);
+
+        void Clear();
+
+        // The volume stores cumulative optical thickness, so a particle
+        // affects every texel in its footprint from its near edge to the
+        // back of the volume, not just the texels inside its bounds.
+        void MarkBounds(const Bounds& bounds);
+
+        // Gives every marked brick a slot in the pool. Existing brick
+        // contents are discarded.
+        void AllocateBricks();
+
+        void Build(const std::vector<Bounds>& particleBounds);
+
+        // Copies the occupied bricks out of a dense volume laid out like a
+        // D3D12 3D subresource: x fastest, then y, then z.
+        void Fill(const float* dense);
+
+        // Fills occupied texels by calling fn(x, y, z) for each one.
+        template<typename Fn>
+        void FillWith(Fn&& fn);
+
+        float Load(uint32_t x, uint32_t y, uint32_t z) const;
+
+        // Trilinear filtering with clamped addressing, like the linear clamp
+        // sampler SampleOpticalThickness reads the dense texture with.
+        float Sample(float u, float v, float w) const;
+
+        bool IsBrickOccupied(uint32_t bx, uint32_t by, uint32_t bz) const;
+        uint32_t GetOccupiedBrickCount() const;
+        uint32_t GetBrickCount() const;
+
+        uint32_t GetWidth() const;
+        uint32_t GetHeight() const;
+        uint32_t GetDepth() const;
+
+        std::size_t GetSizeInBytes() const;
+        static std::size_t GetDenseSizeInBytes(uint32_t width, uint32_t height, uint32_t depth);
+
+    private:
+        uint32_t m_width;
+        uint32_t m_height;
+        uint32_t m_depth;
+
+        std::array<uint32_t, 3> m_brickCounts;
+
+        std::vector<uint64_t> m_occupancy;
+        std::vector<uint32_t> m_brickTable;
+        std::vector<float> m_brickPool;
+        uint32_t m_occupiedBrickCount = 0;
+
+        uint32_t GetBrickIndex(uint32_t bx, uint32_t by, uint32_t bz) const;
+        void SetOccupied(uint32_t brickIndex);
+        bool IsOccupied(uint32_t brickIndex) const;
+    };
+
+    inline SparseOpticalThicknessVolume::SparseOpticalThicknessVolume(uint32_t width,
+        uint32_t height,
+        uint32_t depth)
+        : m_width(width), m_height(height), m_depth(depth)
+    {
+        m_brickCounts = {
+            (width + BrickSize - 1) / BrickSize,
+            (height + BrickSize - 1) / BrickSize,
+            (depth + BrickSize - 1) / BrickSize
+        };
+
+        const uint32_t brickCount = GetBrickCount();
+        m_occupancy.resize((brickCount + 63) / 64);
+        m_brickTable.resize(brickCount, EmptyBrick);
+    }
+
+    inline void SparseOpticalThicknessVolume::Clear()
+    {
+        std::fill(m_occupancy.begin(), m_occupancy.end(), 0);
+        std::fill(m_brickTable.begin(), m_brickTable.end(), EmptyBrick);
+        m_brickPool.clear();
+        m_occupiedBrickCount = 0;
+    }
+
+    inline void SparseOpticalThicknessVolume::MarkBounds(const Bounds& bounds)
+    {
+        const std::array<uint32_t, 3> extents = { m_width, m_height, m_depth };
+        std::array<uint32_t, 3> minBrick;
+        std::array<uint32_t, 3> maxBrick;
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            const float lo = std::clamp(std::min(bounds.Min[axis], bounds.Max[axis]), 0.f, 1.f);
+            const float hi = std::clamp(std::max(bounds.Min[axis], bounds.Max[axis]), 0.f, 1.f);
+
+            // Widen by one texel so the linear sampler's footprint is covered
+            const int minTexel = static_cast<int>(std::floor(lo * extents[axis] - 0.5f)) - 1;
+            const int maxTexel = static_cast<int>(std::ceil(hi * extents[axis] - 0.5f)) + 1;
+
+            const int maxIndex = static_cast<int>(extents[axis]) - 1;
+            minBrick[axis] = static_cast<uint32_t>(std::clamp(minTexel, 0, maxIndex)) / BrickSize;
+            maxBrick[axis] = static_cast<uint32_t>(std::clamp(maxTexel, 0, maxIndex)) / BrickSize;
+        }
+
+        maxBrick[2] = m_brickCounts[2] - 1;
+
+        for (uint32_t bz = minBrick[2]; bz <= maxBrick[2]; bz++)
+        {
+            for (uint32_t by = minBrick[1]; by <= maxBrick[1]; by++)
+            {
+                for (uint32_t bx = minBrick[0]; bx <= maxBrick[0]; bx++)
+                {
+                    SetOccupied(GetBrickIndex(bx, by, bz));
+                }
+            }
+        }
+    }
+
+    inline void SparseOpticalThicknessVolume::AllocateBricks()
+    {
+        m_occupiedBrickCount = 0;
+
+        for (uint32_t i = 0; i < m_brickTable.size(); i++)
+        {
+            m_brickTable[i] = IsOccupied(i) ? m_occupiedBrickCount++ : EmptyBrick;
+        }
+
+        m_brickPool.assign(static_cast<std::size_t>(m_occupiedBrickCount) * BrickTexelCount, 0.f);
+    }
+
+    inline void SparseOpticalThicknessVolume::Build(const std::vector<Bounds>& particleBounds)
+    {
+        Clear();
+
+        for (const auto& bounds : particleBounds)
+        {
+            MarkBounds(bounds);
+        }
+
+        AllocateBricks();
+    }
+
+    inline void SparseOpticalThicknessVolume::Fill(const float* dense)
+    {
+        const std::size_t rowPitch = m_width;
+        const std::size_t slicePitch = rowPitch * m_height;
+
+        FillWith([&](uint32_t x, uint32_t y, uint32_t z)
+            {
+                return dense[z * slicePitch + y * rowPitch + x];
+            });
+    }
+
+    template<typename Fn>
+    inline void SparseOpticalThicknessVolume::FillWith(Fn&& fn)
+    {
+        for (uint32_t bz = 0; bz < m_brickCounts[2]; bz++)
+        {
+            for (uint32_t by = 0; by < m_brickCounts[1]; by++)
+            {
+                for (uint32_t bx = 0; bx < m_brickCounts[0]; bx++)
+                {
+                    const uint32_t slot = m_brickTable[GetBrickIndex(bx, by, bz)];
+                    if (slot == EmptyBrick)
+                        continue;
+
+                    float* brick = m_brickPool.data() + static_cast<std::size_t>(slot) * BrickTexelCount;
+
+                    const uint32_t x0 = bx * BrickSize;
+                    const uint32_t y0 = by * BrickSize;
+                    const uint32_t z0 = bz * BrickSize;
+                    const uint32_t x1 = std::min(x0 + BrickSize, m_width);
+                    const uint32_t y1 = std::min(y0 + BrickSize, m_height);
+                    const uint32_t z1 = std::min(z0 + BrickSize, m_depth);
+
+                    for (uint32_t z = z0; z < z1; z++)
+                    {
+                        for (uint32_t y = y0; y < y1; y++)
+                        {
+                            for (uint32_t x = x0; x < x1; x++)
+                            {
+                                brick[((z - z0) * BrickSize + (y - y0)) * BrickSize + (x - x0)]
+                                    = fn(x, y, z);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    inline float SparseOpticalThicknessVolume::Load(uint32_t x, uint32_t y, uint32_t z) const
+    {
+        const uint32_t slot = m_brickTable[GetBrickIndex(x / BrickSize, y / BrickSize, z / BrickSize)];
+        if (slot == EmptyBrick)
+            return 0.f;
+
+        const uint32_t lx = x % BrickSize;
+        const uint32_t ly = y % BrickSize;
+        const uint32_t lz = z % BrickSize;
+
+        return m_brickPool[static_cast<std::size_t>(slot) * BrickTexelCount
+            + (lz * BrickSize + ly) * BrickSize + lx];
+    }
+
+    inline float SparseOpticalThicknessVolume::Sample(float u, float v, float w) const
+    {
+        const std::array<float, 3> uvw = { u, v, w };
+        const std::array<uint32_t, 3> extents = { m_width, m_height, m_depth };
+
+        std::array<uint32_t, 3> i0;
+        std::array<uint32_t, 3> i1;
+        std::array<float, 3> t;
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            const float f = std::clamp(uvw[axis], 0.f, 1.f) * extents[axis] - 0.5f;
+            const float floorF = std::floor(f);
+            const int maxIndex = static_cast<int>(extents[axis]) - 1;
+
+            t[axis] = f - floorF;
+            i0[axis] = static_cast<uint32_t>(std::clamp(static_cast<int>(floorF), 0, maxIndex));
+            i1[axis] = static_cast<uint32_t>(std::clamp(static_cast<int>(floorF) + 1, 0, maxIndex));
+        }
+
+        auto lerp = [](float a, float b, float s) { return a + s * (b - a); };
+
+        const float c00 = lerp(Load(i0[0], i0[1], i0[2]), Load(i1[0], i0[1], i0[2]), t[0]);
+        const float c10 = lerp(Load(i0[0], i1[1], i0[2]), Load(i1[0], i1[1], i0[2]), t[0]);
+        const float c01 = lerp(Load(i0[0], i0[1], i1[2]), Load(i1[0], i0[1], i1[2]), t[0]);
+        const float c11 = lerp(Load(i0[0], i1[1], i1[2]), Load(i1[0], i1[1], i1[2]), t[0]);
+
+        return lerp(lerp(c00, c10, t[1]), lerp(c01, c11, t[1]), t[2]);
+    }
+
+    inline bool SparseOpticalThicknessVolume::IsBrickOccupied(uint32_t bx, uint32_t by, uint32_t bz) const
+    {
+        return IsOccupied(GetBrickIndex(bx, by, bz));
+    }
+
+    inline uint32_t SparseOpticalThicknessVolume::GetOccupiedBrickCount() const
+    {
+        return m_occupiedBrickCount;
+    }
+
+    inline uint32_t SparseOpticalThicknessVolume::GetBrickCount() const
+    {
+        return m_brickCounts[0] * m_brickCounts[1] * m_brickCounts[2];
+    }
+
+    inline uint32_t SparseOpticalThicknessVolume::GetWidth() const
+    {
+        return m_width;
+    }
+
+    inline uint32_t SparseOpticalThicknessVolume::GetHeight() const
+    {
+        return m_height;
+    }
+
+    inline uint32_t SparseOpticalThicknessVolume::GetDepth() const
+    {
+        return m_depth;
+    }
+
+    inline std::size_t SparseOpticalThicknessVolume::GetSizeInBytes() const
+    {
+        return m_occupancy.size() * sizeof(uint64_t)
+            + m_brickTable.size() * sizeof(uint32_t)
+            + m_brickPool.size() * sizeof(float);
+    }
+
+    inline std::size_t SparseOpticalThicknessVolume::GetDenseSizeInBytes(uint32_t width,
+        uint32_t height,
+        uint32_t depth)
+    {
+        return static_cast<std::size_t>(width) * height * depth * sizeof(float);
+    }
+
+    inline uint32_t SparseOpticalThicknessVolume::GetBrickIndex(uint32_t bx, uint32_t by, uint32_t bz) const
+    {
+        return (bz * m_brickCounts[1] + by) * m_brickCounts[0] + bx;
+    }
+
+    inline void SparseOpticalThicknessVolume::SetOccupied(uint32_t brickIndex)
+    {
+        m_occupancy[brickIndex / 64] |= uint64_t(1) << (brickIndex % 64);
+    }
+
+    inline bool SparseOpticalThicknessVolume::IsOccupied(uint32_t brickIndex) const
+    {
+        return (m_occupancy[brickIndex / 64] >> (brickIndex % 64)) & 1;
+    }
+}
@@ -0,0 +1,259 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace ISV
+{
+    // Storage formats for the optical thickness volume.
+    // Must match the VOL_SHADOW_FORMAT_* constants in VolShadowEncoding.hlsli.
+    enum class VolShadowStorageFormat : uint32_t
+    {
+        Float32 = 0,
+        Float16 = 1,
+        LogUnorm16 = 2,
+        LogUnorm8 = 3
+    };
+
+    // CPU mirror of Shaders/VolShadowEncoding.hlsli, used to measure how much
+    // a baked volume loses when it's stored in one of the smaller formats.
+    class VolShadowEncoding
+    {
+    public:
+        static constexpr float LogMaxOpticalThickness = 32.f;
+
+        struct Report
+        {
+            float MaxOpticalThicknessError = 0.f;
+            float MaxTransmittanceError = 0.f;
+            float MeanTransmittanceError = 0.f;
+            std::size_t DenseBytes = 0;
+            std::size_t QuantizedBytes = 0;
+        };
+
+        static bool IsLogEncoded(VolShadowStorageFormat format);
+        static std::size_t GetBytesPerTexel(VolShadowStorageFormat format);
+
+        static float Encode(float opticalThickness, VolShadowStorageFormat format);
+        static float Decode(float stored, VolShadowStorageFormat format);
+
+        // Round trips a value through the format's storage, including the
+        // precision lost to the half float or UNORM representation.
+        static float Quantize(float opticalThickness, VolShadowStorageFormat format);
+
+        static std::vector<float> QuantizeVolume(const float* volume,
+            std::size_t texelCount,
+            VolShadowStorageFormat format);
+
+        static Report Measure(const float* volume,
+            std::size_t texelCount,
+            VolShadowStorageFormat format);
+
+        static uint16_t FloatToHalf(float value);
+        static float HalfToFloat(uint16_t value);
+    };
+
+    inline bool VolShadowEncoding::IsLogEncoded(VolShadowStorageFormat format)
+    {
+        return format == VolShadowStorageFormat::LogUnorm16
+            || format == VolShadowStorageFormat::LogUnorm8;
+    }
+
+    inline std::size_t VolShadowEncoding::GetBytesPerTexel(VolShadowStorageFormat format)
+    {
+        switch (format)
+        {
+        case VolShadowStorageFormat::Float16:
+        case VolShadowStorageFormat::LogUnorm16:
+            return 2;
+        case VolShadowStorageFormat::LogUnorm8:
+            return 1;
+        default:
+            return 4;
+        }
+    }
+
+    inline float VolShadowEncoding::Encode(float opticalThickness, VolShadowStorageFormat format)
+    {
+        if (IsLogEncoded(format))
+        {
+            return std::clamp(std::log2(1.f + std::max(0.f, opticalThickness))
+                / std::log2(1.f + LogMaxOpticalThickness), 0.f, 1.f);
+        }
+
+        return opticalThickness;
+    }
+
+    inline float VolShadowEncoding::Decode(float stored, VolShadowStorageFormat format)
+    {
+        if (IsLogEncoded(format))
+        {
+            return std::exp2(stored * std::log2(1.f + LogMaxOpticalThickness)) - 1.f;
+        }
+
+        return stored;
+    }
+
+    inline float VolShadowEncoding::Quantize(float opticalThickness, VolShadowStorageFormat format)
+    {
+        const float encoded = Encode(opticalThickness, format);
+
+        switch (format)
+        {
+        case VolShadowStorageFormat::Float16:
+            return Decode(HalfToFloat(FloatToHalf(encoded)), format);
+        case VolShadowStorageFormat::LogUnorm16:
+            return Decode(std::round(encoded * 65535.f) / 65535.f, format);
+        case VolShadowStorageFormat::LogUnorm8:
+            return Decode(std::round(encoded * 255.f) / 255.f, format);
+        default:
+            return encoded;
+        }
+    }
+
+    inline std::vector<float> VolShadowEncoding::QuantizeVolume(const float* volume,
+        std::size_t texelCount,
+        VolShadowStorageFormat format)
+    {
+        std::vector<float> out(texelCount);
+
+        for (std::size_t i = 0; i < texelCount; i++)
+        {
+            out[i] = Quantize(volume[i], format);
+        }
+
+        return out;
+    }
+
+    inline VolShadowEncoding::Report VolShadowEncoding::Measure(const float* volume,
+        std::size_t texelCount,
+        VolShadowStorageFormat format)
+    {
+        Report report;
+        report.DenseBytes = texelCount * GetBytesPerTexel(VolShadowStorageFormat::Float32);
+        report.QuantizedBytes = texelCount * GetBytesPerTexel(format);
+
+        double transmittanceErrorSum = 0.0;
+
+        for (std::size_t i = 0; i < texelCount; i++)
+        {
+            const float reference = volume[i];
+            const float quantized = Quantize(reference, format);
+
+            const float otError = std::abs(quantized - reference);
+            const float tError = std::abs(std::exp(-quantized) - std::exp(-reference));
+
+            report.MaxOpticalThicknessError = std::max(report.MaxOpticalThicknessError, otError);
+            report.MaxTransmittanceError = std::max(report.MaxTransmittanceError, tError);
+            transmittanceErrorSum += tError;
+        }
+
+        if (texelCount > 0)
+        {
+            report.MeanTransmittanceError = static_cast<float>(transmittanceErrorSum / texelCount);
+        }
+
+        return report;
+    }
+
+    inline uint16_t VolShadowEncoding::FloatToHalf(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+
+        const uint32_t sign = (bits >> 16) & 0x8000;
+        const uint32_t exponent = (bits >> 23) & 0xff;
+        uint32_t mantissa = bits & 0x7fffff;
+
+        // NaN and infinity
+        if (exponent == 0xff)
+        {
+            return static_cast<uint16_t>(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+        }
+
+        const int halfExponent = static_cast<int>(exponent) - 127 + 15;
+
+        if (halfExponent >= 0x1f)
+        {
+            return static_cast<uint16_t>(sign | 0x7c00);
+        }
+
+        if (halfExponent <= 0)
+        {
+            // Denormal or zero
+            if (halfExponent < -10)
+            {
+                return static_cast<uint16_t>(sign);
+            }
+
+            mantissa |= 0x800000;
+            const uint32_t shift = static_cast<uint32_t>(14 - halfExponent);
+            uint32_t halfMantissa = mantissa >> shift;
+            const uint32_t remainder = mantissa & ((1u << shift) - 1);
+            const uint32_t halfway = 1u << (shift - 1);
+
+            if (remainder > halfway || (remainder == halfway && (halfMantissa & 1)))
+            {
+                halfMantissa++;
+            }
+
+            return static_cast<uint16_t>(sign | halfMantissa);
+        }
+
+        uint32_t half = sign | (static_cast<uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+        const uint32_t remainder = mantissa & 0x1fff;
+
+        // Round to nearest even, which may carry into the exponent
+        if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+        {
+            half++;
+        }
+
+        return static_cast<uint16_t>(half);
+    }
+
+    inline float VolShadowEncoding::HalfToFloat(uint16_t value)
+    {
+        const uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+        const uint32_t exponent = (value >> 10) & 0x1f;
+        uint32_t mantissa = value & 0x3ff;
+
+        uint32_t bits;
+
+        if (exponent == 0)
+        {
+            if (mantissa == 0)
+            {
+                bits = sign;
+            }
+            else
+            {
+                // Renormalise the denormal
+                int e = -1;
+                do
+                {
+                    e++;
+                    mantissa <<= 1;
+                } while ((mantissa & 0x400) == 0);
+
+                bits = sign | (static_cast<uint32_t>(127 - 15 - e) << 23) | ((mantissa & 0x3ff) << 13);
+            }
+        }
+        else if (exponent == 0x1f)
+        {
+            bits = sign | 0x7f800000 | (mantissa << 13);
+        }
+        else
+        {
+            bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+        }
+
+        float out;
+        std::memcpy(&out, &bits, sizeof(out));
+        return out;
+    }
+}
@@ -1,17 +1,44 @@
 #include "pch.h"
 
 #include "Core/VolShadowMap.h"
+#include "Gradient/ReadData.h"
+#include "Gradient/Math.h"
 
 using namespace DirectX::SimpleMath;
 
+namespace
+{
+    Microsoft::WRL::ComPtr<ID3D12PipelineState> CreateComputePipelineState(
+        ID3D12Device* device,
+        const wchar_t* shaderPath,
+        ID3D12RootSignature* rootSignature)
+    {
+        Microsoft::WRL::ComPtr<ID3D12PipelineState> out;
+
+        auto csData = DX::ReadData(shaderPath);
+        D3D12_COMPUTE_PIPELINE_STATE_DESC psoDesc = {};
+        psoDesc.pRootSignature = rootSignature;
+        psoDesc.CS = { csData.data(), csData.size() };
+        DX::ThrowIfFailed(
+            device->CreateComputePipelineState(&psoDesc,
+                IID_PPV_ARGS(out.ReleaseAndGetAddressOf())));
+
+        return out;
+    }
+}
+
 namespace ISV
 {
     VolShadowMap::VolShadowMap(ID3D12Device* device,
         float sceneRadius,
-        DirectX::SimpleMath::Vector3 sceneCentre)
+        DirectX::SimpleMath::Vector3 sceneCentre,
+        StorageFormat storageFormat)
     {
         auto gmm = Gradient::GraphicsMemoryManager::Get();
 
+        m_storageFormat = storageFormat;
+        m_mipCount = 1 + static_cast<uint32_t>(std::floor(std::log2(std::max(Width, Depth))));
+
         m_sceneRadius = sceneRadius;
         m_sceneCentre = sceneCentre;
 
@@ -34,16 +61,10 @@ namespace ISV
             1.f
         };
 
+        // Optical thickness is always accumulated in full precision,
+        // only the volume it's copied into uses the storage format
         auto format = DXGI_FORMAT_R32_FLOAT;
-
-        auto textureDesc = CD3DX12_RESOURCE_DESC::Tex3D(
-            format,
-            Width,
-            Width,
-            Depth,
-            1,
-            D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET
-        );
+        auto volumeFormat = GetDXGIFormat(storageFormat);
 
         D3D12_CLEAR_VALUE clearValue = {};
         clearValue.Format = format;
@@ -52,10 +73,39 @@ namespace ISV
         clearValue.Color[2] = 0;
         clearValue.Color[3] = 0;
 
-        m_texture3D.Create(device,
-            &textureDesc,
-            D3D12_RESOURCE_STATE_RENDER_TARGET,
-            &clearValue);
+        if (storageFormat == StorageFormat::Float32)
+        {
+            auto textureDesc = CD3DX12_RESOURCE_DESC::Tex3D(
+                volumeFormat,
+                Width,
+                Width,
+                Depth,
+                m_mipCount,
+                D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET
+                | D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS
+            );
+
+            m_texture3D.Create(device,
+                &textureDesc,
+                D3D12_RESOURCE_STATE_RENDER_TARGET,
+                &clearValue);
+        }
+        else
+        {
+            auto textureDesc = CD3DX12_RESOURCE_DESC::Tex3D(
+                volumeFormat,
+                Width,
+                Width,
+                Depth,
+                m_mipCount,
+                D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS
+            );
+
+            m_texture3D.Create(device,
+                &textureDesc,
+                D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+                nullptr);
+        }
 
         m_texture3D.Get()->SetName(L"Volumetric Shadow Map");
 
@@ -80,15 +130,115 @@ namespace ISV
         m_rtv = gmm->CreateRTV(device, rtvDesc, m_texture2D.Get());
 
         auto srvDesc = D3D12_SHADER_RESOURCE_VIEW_DESC();
-        srvDesc.Format = format;
+        srvDesc.Format = volumeFormat;
         srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE3D;
-        srvDesc.Texture3D.MipLevels = 1;
+        srvDesc.Texture3D.MipLevels = m_mipCount;
         srvDesc.Texture3D.MostDetailedMip = 0;
         srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 
         m_srv = gmm->CreateSRV(device,
             m_texture3D.Get(),
             &srvDesc);
+
+        m_volumeUAV = gmm->CreateUAV(device, m_texture3D.Get());
+
+        if (storageFormat != StorageFormat::Float32)
+        {
+            auto scratchSrvDesc = D3D12_SHADER_RESOURCE_VIEW_DESC();
+            scratchSrvDesc.Format = format;
+            scratchSrvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+            scratchSrvDesc.Texture2D.MipLevels = 1;
+            scratchSrvDesc.Texture2D.MostDetailedMip = 0;
+            scratchSrvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+
+            m_scratchSRV = gmm->CreateSRV(device,
+                m_texture2D.Get(),
+                &scratchSrvDesc);
+
+            m_encodeRS.AddCBV(0, 0);
+            m_encodeRS.AddSRV(0, 0);
+            m_encodeRS.AddUAV(0, 0);
+            m_encodeRS.Build(device, true);
+
+            m_encodePSO = CreateComputePipelineState(device,
+                L"VolShadowEncode_CS.cso",
+                m_encodeRS.Get());
+        }
+
+        m_mipUAVs.resize(m_mipCount);
+        for (uint32_t mip = 0; mip < m_mipCount; mip++)
+        {
+            m_mipUAVs[mip] = gmm->CreateUAV(device, m_texture3D.Get(), mip);
+        }
+
+        m_mipRS.AddCBV(0, 0);
+        m_mipRS.AddUAV(0, 0);
+        m_mipRS.AddUAV(1, 0);
+        m_mipRS.Build(device, true);
+
+        m_mipPSO = CreateComputePipelineState(device,
+            L"VolShadowMip_CS.cso",
+            m_mipRS.Get());
+
+        auto fourierDesc = CD3DX12_RESOURCE_DESC::Tex2D(
+            FourierFormat,
+            Width,
+            Width,
+            FourierSliceCount,
+            1
+        );
+
+        fourierDesc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+
+        D3D12_CLEAR_VALUE fourierClearValue = {};
+        fourierClearValue.Format = FourierFormat;
+
+        m_fourierTexture.Create(device,
+            &fourierDesc,
+            D3D12_RESOURCE_STATE_RENDER_TARGET,
+            &fourierClearValue);
+
+        m_fourierTexture.Get()->SetName(L"Fourier Opacity Map");
+
+        for (uint32_t i = 0; i < FourierSliceCount; i++)
+        {
+            auto fourierRtvDesc = D3D12_RENDER_TARGET_VIEW_DESC();
+            fourierRtvDesc.Format = FourierFormat;
+            fourierRtvDesc.ViewDimension = D3D12_RTV_DIMENSION_TEXTURE2DARRAY;
+            fourierRtvDesc.Texture2DArray.MipSlice = 0;
+            fourierRtvDesc.Texture2DArray.FirstArraySlice = i;
+            fourierRtvDesc.Texture2DArray.ArraySize = 1;
+            fourierRtvDesc.Texture2DArray.PlaneSlice = 0;
+            m_fourierRTVs[i] = gmm->CreateRTV(device, fourierRtvDesc, m_fourierTexture.Get());
+        }
+
+        auto fourierSrvDesc = D3D12_SHADER_RESOURCE_VIEW_DESC();
+        fourierSrvDesc.Format = FourierFormat;
+        fourierSrvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+        fourierSrvDesc.Texture2DArray.MipLevels = 1;
+        fourierSrvDesc.Texture2DArray.MostDetailedMip = 0;
+        fourierSrvDesc.Texture2DArray.FirstArraySlice = 0;
+        fourierSrvDesc.Texture2DArray.ArraySize = FourierSliceCount;
+        fourierSrvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+
+        m_fourierSRV = gmm->CreateSRV(device,
+            m_fourierTexture.Get(),
+            &fourierSrvDesc);
+    }
+
+    DXGI_FORMAT VolShadowMap::GetDXGIFormat(StorageFormat format)
+    {
+        switch (format)
+        {
+        case StorageFormat::Float16:
+            return DXGI_FORMAT_R16_FLOAT;
+        case StorageFormat::LogUnorm16:
+            return DXGI_FORMAT_R16_UNORM;
+        case StorageFormat::LogUnorm8:
+            return DXGI_FORMAT_R8_UNORM;
+        default:
+            return DXGI_FORMAT_R32_FLOAT;
+        }
     }
 
     void VolShadowMap::SetLightDirection(const DirectX::SimpleMath::Vector3& direction)
@@ -112,6 +262,11 @@ namespace ISV
         float boxFarPlane = depthSlice * sliceThickness;
         float boxNearPlane = (depthSlice - 1) * sliceThickness;
 
+        return GetBoundingBox(boxNearPlane, boxFarPlane);
+    }
+
+    DirectX::BoundingOrientedBox VolShadowMap::GetBoundingBox(float boxNearPlane, float boxFarPlane)
+    {
         std::array<Vector3, 6> bounds;
         bounds[0] = { -m_sceneRadius, 0, 0 }; // left
         bounds[1] = { m_sceneRadius, 0, 0 }; // right
@@ -138,7 +293,6 @@ namespace ISV
     {
         cl->RSSetViewports(1, &m_shadowMapViewport);
 
-        m_texture3D.Transition(cl, D3D12_RESOURCE_STATE_COPY_DEST);
         m_texture2D.Transition(cl, D3D12_RESOURCE_STATE_RENDER_TARGET);
 
         auto rtvHandle = m_rtv->GetCPUHandle();
@@ -147,18 +301,6 @@ namespace ISV
             0, nullptr
         );
 
-        D3D12_TEXTURE_COPY_LOCATION dstLocation = {};
-        dstLocation.pResource = m_texture3D.Get();
-        dstLocation.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-        dstLocation.SubresourceIndex = D3D12CalcSubresource(0, 0, 0, 1, 1);
-
-        D3D12_TEXTURE_COPY_LOCATION srcLocation = {};
-        srcLocation.pResource = m_texture2D.Get();
-        srcLocation.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-        srcLocation.SubresourceIndex = 0;
-
-        m_texture3D.Transition(cl, D3D12_RESOURCE_STATE_COPY_DEST);
-
         for (uint32_t depthSlice = 0; depthSlice < Depth; depthSlice++)
         {
             m_texture2D.Transition(cl, D3D12_RESOURCE_STATE_RENDER_TARGET);
@@ -176,22 +318,144 @@ namespace ISV
                     GetBoundingBox(depthSlice), boxNearPlane);
             }
 
-            m_texture2D.Transition(cl, D3D12_RESOURCE_STATE_COPY_SOURCE);
+            if (m_storageFormat == StorageFormat::Float32)
+            {
+                CopySliceToVolume(cl, depthSlice);
+            }
+            else
+            {
+                EncodeSliceToVolume(cl, depthSlice);
+            }
+        }
 
-            D3D12_BOX srcBox = { 0, 0, Width, Width, 0, 1 }; 
-            srcBox.left = 0;
-            srcBox.top = 0;
-            srcBox.right = Width;
-            srcBox.bottom = Width;
-            srcBox.front = 0;
-            srcBox.back = 1;
+        GenerateMips(cl);
+    }
+
+    void VolShadowMap::CopySliceToVolume(ID3D12GraphicsCommandList* cl, uint32_t depthSlice)
+    {
+        D3D12_TEXTURE_COPY_LOCATION dstLocation = {};
+        dstLocation.pResource = m_texture3D.Get();
+        dstLocation.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+        dstLocation.SubresourceIndex = D3D12CalcSubresource(0, 0, 0, 1, 1);
+
+        D3D12_TEXTURE_COPY_LOCATION srcLocation = {};
+        srcLocation.pResource = m_texture2D.Get();
+        srcLocation.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+        srcLocation.SubresourceIndex = 0;
 
-            cl->CopyTextureRegion(
-                &dstLocation,
-                0, 0, depthSlice,
-                &srcLocation, &srcBox
+        m_texture3D.Transition(cl, D3D12_RESOURCE_STATE_COPY_DEST);
+        m_texture2D.Transition(cl, D3D12_RESOURCE_STATE_COPY_SOURCE);
+
+        D3D12_BOX srcBox = { 0, 0, Width, Width, 0, 1 }; 
+        srcBox.left = 0;
+        srcBox.top = 0;
+        srcBox.right = Width;
+        srcBox.bottom = Width;
+        srcBox.front = 0;
+        srcBox.back = 1;
+
+        cl->CopyTextureRegion(
+            &dstLocation,
+            0, 0, depthSlice,
+            &srcLocation, &srcBox
+        );
+    }
+
+    // Formats other than R32_FLOAT can't be copied into from the scratch
+    // target, and log encoded values can't be accumulated with blending,
+    // so each finished slice is encoded into the volume with a compute pass.
+    // This replaces the bound pipeline state, so the draw function has to 
+    // set its own before every slice.
+    void VolShadowMap::EncodeSliceToVolume(ID3D12GraphicsCommandList* cl, uint32_t depthSlice)
+    {
+        m_texture3D.Transition(cl, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        m_texture2D.Transition(cl, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+        EncodeConstants constants;
+        constants.Slice = depthSlice;
+        constants.Format = static_cast<uint32_t>(m_storageFormat);
+        constants.Width = Width;
+        constants.Height = Width;
+
+        m_encodeRS.SetOnCommandList(cl);
+        cl->SetPipelineState(m_encodePSO.Get());
+
+        m_encodeRS.SetCBV(cl, 0, 0, constants);
+        m_encodeRS.SetSRV(cl, 0, 0, m_scratchSRV);
+        m_encodeRS.SetUAV(cl, 0, 0, m_volumeUAV);
+
+        cl->Dispatch(Gradient::Math::DivRoundUp(Width, 8),
+            Gradient::Math::DivRoundUp(Width, 8),
+            1);
+    }
+
+    void VolShadowMap::RenderFourier(ID3D12GraphicsCommandList* cl, DrawFn fn)
+    {
+        cl->RSSetViewports(1, &m_shadowMapViewport);
+
+        m_fourierTexture.Transition(cl, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+        std::array<D3D12_CPU_DESCRIPTOR_HANDLE, FourierSliceCount> rtvHandles;
+        for (uint32_t i = 0; i < FourierSliceCount; i++)
+        {
+            rtvHandles[i] = m_fourierRTVs[i]->GetCPUHandle();
+            cl->ClearRenderTargetView(rtvHandles[i],
+                DirectX::ColorsLinear::Black,
+                0, nullptr
             );
         }
+
+        cl->OMSetRenderTargets(FourierSliceCount, rtvHandles.data(), FALSE, nullptr);
+
+        fn(m_shadowMapView, m_shadowMapProj,
+            GetBoundingBox(0.f, 2 * m_sceneRadius), 0.f);
+    }
+
+    void VolShadowMap::RenderSplat(ID3D12GraphicsCommandList* cl, SplatFn fn)
+    {
+        m_texture3D.Transition(cl, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+        auto viewProj = m_shadowMapView * m_shadowMapProj;
+
+        SplatConstants constants;
+        constants.LightViewProj = viewProj.Transpose();
+        constants.LightInverseViewProj = viewProj.Invert().Transpose();
+        constants.VolumeWidth = Width;
+        constants.VolumeDepth = Depth;
+        constants.LightDepthRange = 2 * m_sceneRadius;
+        constants.NdcPerWorldUnit = 1.f / m_sceneRadius;
+
+        fn(constants, m_volumeUAV);
+
+        GenerateMips(cl);
+    }
+
+    void VolShadowMap::GenerateMips(ID3D12GraphicsCommandList* cl)
+    {
+        m_texture3D.Transition(cl, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+        m_mipRS.SetOnCommandList(cl);
+        cl->SetPipelineState(m_mipPSO.Get());
+
+        MipConstants constants;
+        constants.Format = static_cast<uint32_t>(m_storageFormat);
+        m_mipRS.SetCBV(cl, 0, 0, constants);
+
+        for (uint32_t mip = 1; mip < m_mipCount; mip++)
+        {
+            auto uavBarrier = CD3DX12_RESOURCE_BARRIER::UAV(m_texture3D.Get());
+            cl->ResourceBarrier(1, &uavBarrier);
+
+            m_mipRS.SetUAV(cl, 0, 0, m_mipUAVs[mip - 1]);
+            m_mipRS.SetUAV(cl, 1, 0, m_mipUAVs[mip]);
+
+            uint32_t mipWidth = std::max(1u, Width >> mip);
+            uint32_t mipDepth = std::max(1u, Depth >> mip);
+
+            cl->Dispatch(Gradient::Math::DivRoundUp(mipWidth, 4u),
+                Gradient::Math::DivRoundUp(mipWidth, 4u),
+                Gradient::Math::DivRoundUp(mipDepth, 4u));
+        }
     }
 
     Gradient::GraphicsMemoryManager::DescriptorView
@@ -201,6 +465,28 @@ namespace ISV
         return m_srv;
     }
 
+    Gradient::GraphicsMemoryManager::DescriptorView
+        VolShadowMap::TransitionAndGetFourierSRV(ID3D12GraphicsCommandList* cl)
+    {
+        m_fourierTexture.Transition(cl, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+        return m_fourierSRV;
+    }
+
+    VolShadowMap::StorageFormat VolShadowMap::GetStorageFormat() const
+    {
+        return m_storageFormat;
+    }
+
+    uint32_t VolShadowMap::GetMipCount() const
+    {
+        return m_mipCount;
+    }
+
+    float VolShadowMap::GetTexelSize() const
+    {
+        return 2 * m_sceneRadius / Width;
+    }
+
     DirectX::SimpleMath::Matrix VolShadowMap::GetShadowTransform() const
     {
         const static auto t = DirectX::SimpleMath::Matrix(
@@ -3,6 +3,8 @@
 #include "pch.h"
 #include "Gradient/BarrierResource.h"
 #include "Gradient/GraphicsMemoryManager.h"
+#include "Gradient/RootSignature.h"
+#include "Core/VolShadowEncoding.h"
 #include <directxtk12/SimpleMath.h>
 #include <array>
 
@@ -14,28 +16,112 @@ namespace ISV
         const uint32_t Width = 256;
         const uint32_t Depth = 10;
 
+        // How optical thickness is stored along the light rays.
+        // Must match the VOL_SHADOW_* constants in FourierOpacity.hlsli.
+        enum class Representation : uint32_t
+        {
+            SliceVolume = 0,
+            FourierOpacity = 1
+        };
+
+        // Fourier coefficients are packed into two RGBA slices,
+        // see Core/FourierOpacityMap.h
+        static constexpr uint32_t FourierSliceCount = 2;
+        static constexpr DXGI_FORMAT FourierFormat = DXGI_FORMAT_R32G32B32A32_FLOAT;
+
+        using StorageFormat = VolShadowStorageFormat;
+
+        static DXGI_FORMAT GetDXGIFormat(StorageFormat format);
+
         using DrawFn = std::function<void(DirectX::SimpleMath::Matrix,
             DirectX::SimpleMath::Matrix, DirectX::BoundingOrientedBox, float)>;
 
+        // Matches the SplatConstants cbuffer in VolShadowSplat_CS.hlsl
+        struct __declspec(align(16)) SplatConstants
+        {
+            DirectX::XMMATRIX LightViewProj;
+            DirectX::XMMATRIX LightInverseViewProj;
+            uint32_t VolumeWidth;
+            uint32_t VolumeDepth;
+            float LightDepthRange;
+            float NdcPerWorldUnit;
+            uint32_t FlipLayout = 0;
+        };
+
+        using SplatFn = std::function<void(const SplatConstants&,
+            Gradient::GraphicsMemoryManager::DescriptorView)>;
+
         VolShadowMap(ID3D12Device* device,
             float sceneRadius,
-            DirectX::SimpleMath::Vector3 sceneCentre = DirectX::SimpleMath::Vector3::Zero);
+            DirectX::SimpleMath::Vector3 sceneCentre = DirectX::SimpleMath::Vector3::Zero,
+            StorageFormat storageFormat = StorageFormat::Float32);
 
         void SetLightDirection(const DirectX::SimpleMath::Vector3& direction);
         void Render(ID3D12GraphicsCommandList* cl, DrawFn fn);
 
+        // Draws every particle once into the Fourier coefficient targets,
+        // instead of once per depth slice.
+        void RenderFourier(ID3D12GraphicsCommandList* cl, DrawFn fn);
+
+        // Fills every slice in one compute pass, fn binds the particles
+        // and dispatches VolShadowSplat_CS into the given volume UAV.
+        void RenderSplat(ID3D12GraphicsCommandList* cl, SplatFn fn);
+
         Gradient::GraphicsMemoryManager::DescriptorView 
             TransitionAndGetSRV(ID3D12GraphicsCommandList* cl);
+        Gradient::GraphicsMemoryManager::DescriptorView
+            TransitionAndGetFourierSRV(ID3D12GraphicsCommandList* cl);
         DirectX::SimpleMath::Matrix GetShadowTransform() const;
+        StorageFormat GetStorageFormat() const;
+        uint32_t GetMipCount() const;
+
+        // World space size of a mip 0 texel across the light's view
+        float GetTexelSize() const;
 
     private:
+        struct __declspec(align(16)) EncodeConstants
+        {
+            uint32_t Slice;
+            uint32_t Format;
+            uint32_t Width;
+            uint32_t Height;
+        };
+
+        struct __declspec(align(16)) MipConstants
+        {
+            uint32_t Format;
+        };
+
+        void CopySliceToVolume(ID3D12GraphicsCommandList* cl, uint32_t depthSlice);
+        void EncodeSliceToVolume(ID3D12GraphicsCommandList* cl, uint32_t depthSlice);
+        void GenerateMips(ID3D12GraphicsCommandList* cl);
+
+        StorageFormat m_storageFormat;
+        uint32_t m_mipCount;
+
         D3D12_VIEWPORT m_shadowMapViewport;
         Gradient::GraphicsMemoryManager::DescriptorView m_srv;
         Gradient::BarrierResource m_texture3D;
         Gradient::BarrierResource m_texture2D;
         Gradient::GraphicsMemoryManager::DescriptorView m_rtv;
 
+        Gradient::GraphicsMemoryManager::DescriptorView m_volumeUAV;
+
+        std::vector<Gradient::GraphicsMemoryManager::DescriptorView> m_mipUAVs;
+        Gradient::RootSignature m_mipRS;
+        Microsoft::WRL::ComPtr<ID3D12PipelineState> m_mipPSO;
+
+        // Only used when the volume isn't stored as R32_FLOAT
+        Gradient::GraphicsMemoryManager::DescriptorView m_scratchSRV;
+        Gradient::RootSignature m_encodeRS;
+        Microsoft::WRL::ComPtr<ID3D12PipelineState> m_encodePSO;
+
+        Gradient::BarrierResource m_fourierTexture;
+        std::array<Gradient::GraphicsMemoryManager::DescriptorView, FourierSliceCount> m_fourierRTVs;
+        Gradient::GraphicsMemoryManager::DescriptorView m_fourierSRV;
+
         DirectX::BoundingOrientedBox GetBoundingBox(uint32_t depthSlice);
+        DirectX::BoundingOrientedBox GetBoundingBox(float nearPlane, float farPlane);
 
 
         DirectX::SimpleMath::Vector3 m_sceneCentre;
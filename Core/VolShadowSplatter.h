@@ -0,0 +1,306 @@
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ISV
+{
+    // CPU reference for VolShadowSplat_CS.hlsl.
+    //
+    // Each particle is a sphere with a Gaussian faded extinction. Along a
+    // straight ray its optical thickness has a closed form, so the volume can
+    // be filled by evaluating it per texel and slice instead of rasterising
+    // proxies once per slice. Unlike the compute shader this iterates over
+    // particles and splats each one into the texels under its footprint.
+    class VolShadowSplatter
+    {
+    public:
+        using Vector3 = std::array<float, 3>;
+
+        struct Particle
+        {
+            Vector3 Position;
+            float Radius;
+            float Extinction;
+        };
+
+        // Orthographic light looking at SceneCentre along Direction, covering
+        // a square of half-size SceneRadius and a depth of 2 * SceneRadius,
+        // the same as VolShadowMap.
+        struct Light
+        {
+            Vector3 SceneCentre;
+            Vector3 Direction;
+            float SceneRadius;
+        };
+
+        struct Settings
+        {
+            uint32_t Width = 256;
+            uint32_t Depth = 10;
+            float FalloffRadius = 1.f;
+            bool Faded = true;
+            bool FlipLayout = false;
+        };
+
+        // Mirrors FadedOpticalThickness in RenderingEquation.hlsli, with an
+        // exact erf in place of the lookup texture.
+        static float FadedOpticalThickness(float zmin,
+            float z,
+            float d,
+            float cosAlpha,
+            float sigma,
+            float u);
+
+        static bool RaySphereIntersect(const Vector3& rayOrigin,
+            const Vector3& rayDir,
+            const Vector3& centre,
+            float radius,
+            float& tNear,
+            float& tFar);
+
+        // Returns cumulative optical thickness laid out like the 3D texture:
+        // x fastest, then y, then slice.
+        static std::vector<float> Splat(const std::vector<Particle>& particles,
+            const Light& light,
+            const Settings& settings);
+
+    private:
+        struct Basis
+        {
+            Vector3 Eye;
+            Vector3 Right;
+            Vector3 Up;
+            Vector3 Forward;
+        };
+
+        static Basis MakeLightBasis(const Light& light);
+
+        static float Dot(const Vector3& a, const Vector3& b);
+        static Vector3 Cross(const Vector3& a, const Vector3& b);
+        static Vector3 Normalize(const Vector3& v);
+    };
+
+    inline float VolShadowSplatter::FadedOpticalThickness(float zmin,
+        float z,
+        float d,
+        float cosAlpha,
+        float sigma,
+        float u)
+    {
+        constexpr float pi = 3.14159265359f;
+
+        const float d2 = d * d;
+        const float u2 = u * u;
+
+        const float prefix = sigma * 0.2f * std::sqrt(2 * pi) * u;
+        const float fiveRoot2 = 5 * std::sqrt(2.f);
+
+        const float firstExp = fiveRoot2 * d * cosAlpha / u;
+        const float secondExp = fiveRoot2 * (d * cosAlpha - z + zmin) / u;
+        const float thirdExp = (50 * d2 * cosAlpha * cosAlpha - 50 * d2) / u2;
+
+        const float ot = prefix * (std::erf(firstExp) - std::erf(secondExp)) * std::exp(thirdExp);
+        if (ot < 0.0005f)
+        {
+            return 0.f;
+        }
+
+        return ot;
+    }
+
+    inline bool VolShadowSplatter::RaySphereIntersect(const Vector3& rayOrigin,
+        const Vector3& rayDir,
+        const Vector3& centre,
+        float radius,
+        float& tNear,
+        float& tFar)
+    {
+        const Vector3 L = { rayOrigin[0] - centre[0], rayOrigin[1] - centre[1], rayOrigin[2] - centre[2] };
+        const float a = Dot(rayDir, rayDir);
+        const float b = 2.f * Dot(rayDir, L);
+        const float c = Dot(L, L) - radius * radius;
+
+        const float discriminant = b * b - 4.f * a * c;
+
+        if (discriminant < 0.f)
+        {
+            tNear = -1.f;
+            tFar = -1.f;
+            return false;
+        }
+
+        const float sqrtDisc = std::sqrt(discriminant);
+        tNear = (-b - sqrtDisc) / (2.f * a);
+        tFar = (-b + sqrtDisc) / (2.f * a);
+
+        return true;
+    }
+
+    inline std::vector<float> VolShadowSplatter::Splat(const std::vector<Particle>& particles,
+        const Light& light,
+        const Settings& settings)
+    {
+        const uint32_t width = settings.Width;
+        const uint32_t depth = settings.Depth;
+        const std::size_t slicePitch = static_cast<std::size_t>(width) * width;
+
+        std::vector<float> volume(slicePitch * depth, 0.f);
+
+        if (width == 0 || depth < 2)
+        {
+            return volume;
+        }
+
+        const Basis basis = MakeLightBasis(light);
+        const float R = light.SceneRadius;
+        const float sliceThickness = 2 * R / (depth - 1.f);
+
+        for (const auto& particle : particles)
+        {
+            if (particle.Radius <= 0.f)
+                continue;
+
+            const Vector3 toParticle = {
+                particle.Position[0] - basis.Eye[0],
+                particle.Position[1] - basis.Eye[1],
+                particle.Position[2] - basis.Eye[2]
+            };
+
+            // Footprint in NDC, then in texels
+            const float ndcX = Dot(toParticle, basis.Right) / R;
+            const float ndcY = Dot(toParticle, basis.Up) / R;
+            const float ndcRadius = particle.Radius / R;
+
+            float minU = 0.5f * (ndcX - ndcRadius) + 0.5f;
+            float maxU = 0.5f * (ndcX + ndcRadius) + 0.5f;
+            float minV = 0.5f - 0.5f * (ndcY + ndcRadius);
+            float maxV = 0.5f - 0.5f * (ndcY - ndcRadius);
+
+            if (settings.FlipLayout)
+            {
+                const float flippedMinU = 1 - maxU;
+                const float flippedMinV = 1 - maxV;
+                maxU = 1 - minU;
+                maxV = 1 - minV;
+                minU = flippedMinU;
+                minV = flippedMinV;
+            }
+
+            const int maxIndex = static_cast<int>(width) - 1;
+            const int x0 = std::clamp(static_cast<int>(std::floor(minU * width - 0.5f)), 0, maxIndex);
+            const int x1 = std::clamp(static_cast<int>(std::ceil(maxU * width - 0.5f)), 0, maxIndex);
+            const int y0 = std::clamp(static_cast<int>(std::floor(minV * width - 0.5f)), 0, maxIndex);
+            const int y1 = std::clamp(static_cast<int>(std::ceil(maxV * width - 0.5f)), 0, maxIndex);
+
+            const float falloffRadius = settings.FalloffRadius * particle.Radius;
+
+            for (int y = y0; y <= y1; y++)
+            {
+                for (int x = x0; x <= x1; x++)
+                {
+                    float u = (x + 0.5f) / width;
+                    float v = (y + 0.5f) / width;
+
+                    if (settings.FlipLayout)
+                    {
+                        u = 1 - u;
+                        v = 1 - v;
+                    }
+
+                    const float rayNdcX = u * 2 - 1;
+                    const float rayNdcY = 1 - v * 2;
+
+                    const Vector3 rayOrigin = {
+                        basis.Eye[0] + R * (rayNdcX * basis.Right[0] + rayNdcY * basis.Up[0]),
+                        basis.Eye[1] + R * (rayNdcX * basis.Right[1] + rayNdcY * basis.Up[1]),
+                        basis.Eye[2] + R * (rayNdcX * basis.Right[2] + rayNdcY * basis.Up[2])
+                    };
+
+                    float tNear, tFar;
+                    if (!RaySphereIntersect(rayOrigin, basis.Forward, particle.Position,
+                        particle.Radius, tNear, tFar) || tFar < 0)
+                    {
+                        continue;
+                    }
+
+                    tNear = std::max(tNear, 0.f);
+
+                    const Vector3 toCentre = {
+                        particle.Position[0] - (rayOrigin[0] + basis.Forward[0] * tNear),
+                        particle.Position[1] - (rayOrigin[1] + basis.Forward[1] * tNear),
+                        particle.Position[2] - (rayOrigin[2] + basis.Forward[2] * tNear)
+                    };
+                    const float d = std::sqrt(Dot(toCentre, toCentre));
+                    const float cosAlpha = d > 0.00001f
+                        ? std::clamp(Dot(basis.Forward, toCentre) / d, -1.f, 1.f)
+                        : 1.f;
+
+                    for (uint32_t slice = 1; slice < depth; slice++)
+                    {
+                        const float zmax = std::min(tFar, slice * sliceThickness) - tNear;
+                        if (zmax <= 0.f)
+                            continue;
+
+                        const float ot = settings.Faded
+                            ? FadedOpticalThickness(0, zmax, d, cosAlpha, particle.Extinction, falloffRadius)
+                            : zmax * particle.Extinction;
+
+                        volume[slice * slicePitch + static_cast<std::size_t>(y) * width + x] += ot;
+                    }
+                }
+            }
+        }
+
+        return volume;
+    }
+
+    inline VolShadowSplatter::Basis VolShadowSplatter::MakeLightBasis(const Light& light)
+    {
+        // Same construction as Matrix::CreateLookAt with UnitY as up
+        const Vector3 direction = Normalize(light.Direction);
+
+        Basis basis;
+        basis.Eye = {
+            light.SceneCentre[0] - light.SceneRadius * direction[0],
+            light.SceneCentre[1] - light.SceneRadius * direction[1],
+            light.SceneCentre[2] - light.SceneRadius * direction[2]
+        };
+        basis.Forward = direction;
+
+        const Vector3 zAxis = { -direction[0], -direction[1], -direction[2] };
+        basis.Right = Normalize(Cross({ 0.f, 1.f, 0.f }, zAxis));
+        basis.Up = Cross(zAxis, basis.Right);
+
+        return basis;
+    }
+
+    inline float VolShadowSplatter::Dot(const Vector3& a, const Vector3& b)
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    inline VolShadowSplatter::Vector3 VolShadowSplatter::Cross(const Vector3& a, const Vector3& b)
+    {
+        return {
+            a[1] * b[2] - a[2] * b[1],
+            a[2] * b[0] - a[0] * b[2],
+            a[0] * b[1] - a[1] * b[0]
+        };
+    }
+
+    inline VolShadowSplatter::Vector3 VolShadowSplatter::Normalize(const Vector3& v)
+    {
+        const float length = std::sqrt(Dot(v, v));
+        if (length <= 0.f)
+        {
+            return v;
+        }
+
+        return { v[0] / length, v[1] / length, v[2] / length };
+    }
+}
@@ -6,6 +6,7 @@
 #include "Game.h"
 
 #include <directxtk12/CommonStates.h>
+#include <directxtk12/ResourceUploadBatch.h>
 
 #include <imgui.h>
 #include "imgui_impl_win32.h"
@@ -14,6 +15,7 @@
 #include "Gradient/GraphicsMemoryManager.h"
 #include "Gradient/ReadData.h"
 #include "Gradient/Math.h"
+#include "Core/Profiler.h"
 
 extern void ExitGame() noexcept;
 
@@ -30,6 +32,19 @@ inline void ThrowIfFfxFailed(FfxErrorCode error)
     }
 }
 
+namespace
+{
+    XMFLOAT3 ToFloat3(const ISV::ScenePreset::Vector3& v)
+    {
+        return { v[0], v[1], v[2] };
+    }
+
+    ISV::ScenePreset::Vector3 ToArray(const XMFLOAT3& v)
+    {
+        return { v.x, v.y, v.z };
+    }
+}
+
 float ComputeErf(float x)
 {
     if (std::abs(x) >= 4.0f)
@@ -97,6 +112,8 @@ Game::Game() noexcept(false)
     //   Add DX::DeviceResources::c_EnableHDR for HDR10 display.
     //   Add DX::DeviceResources::c_ReverseDepth to optimize depth buffer clears for 0 instead of 1.
     m_deviceResources->RegisterDeviceNotify(this);
+
+    ApplyPreset(ISV::ScenePreset());
 }
 
 Game::~Game()
@@ -126,8 +143,6 @@ void Game::Initialize(HWND window, int width, int height)
     m_deviceResources->CreateWindowSizeDependentResources();
     CreateWindowSizeDependentResources();
 
-    m_camera.SetPosition({ 0, 6, 45 });
-
     // TODO: Change the timer settings if you want something other than the default variable timestep mode.
     // e.g. for 60 FPS fixed timestep update logic, call:
     /*
@@ -140,17 +155,26 @@ void Game::Initialize(HWND window, int width, int height)
 // Executes the basic game loop.
 void Game::Tick()
 {
+    ISV_PROFILE_ZONE("Frame");
+
     m_timer.Tick([&]()
         {
             Update(m_timer);
         });
 
     Render();
+
+    if (m_benchmark)
+    {
+        UpdateBenchmark();
+    }
 }
 
 // Updates the world.
 void Game::Update(DX::StepTimer const& timer)
 {
+    ISV_PROFILE_ZONE("Update");
+
     PIXBeginEvent(PIX_COLOR_DEFAULT, L"Update");
 
     auto mouseState = DirectX::Mouse::Get().GetState();
@@ -158,6 +182,14 @@ void Game::Update(DX::StepTimer const& timer)
 
     m_camera.Update(timer, mouseState);
 
+    if (m_benchmark)
+    {
+        // The benchmark owns the camera
+        const auto pose = m_benchmark->GetPreset().EvaluateCamera(m_benchmark->GetCameraTime());
+        m_camera.SetPosition(Vector3(ToFloat3(pose.Position)));
+        m_camera.SetDirection(Vector3(ToFloat3(pose.Direction)));
+    }
+
     if (mouseState.positionMode == DirectX::Mouse::MODE_ABSOLUTE
         && m_mouseButtonTracker.leftButton == DirectX::Mouse::ButtonStateTracker::HELD)
     {
@@ -184,6 +216,16 @@ void Game::Update(DX::StepTimer const& timer)
         m_didShoot = false;
     }
 
+    if (m_guiVolShadowFormat != m_volShadowMap->GetStorageFormat())
+    {
+        // The volume's format is fixed at creation, so it has to be rebuilt
+        m_deviceResources->WaitForGpu();
+        m_volShadowMap = std::make_unique<ISV::VolShadowMap>(
+            m_deviceResources->GetD3DDevice(),
+            30.f,
+            Vector3::Zero,
+            m_guiVolShadowFormat);
+    }
 
     auto time = static_cast<float>(timer.GetTotalSeconds());
 
@@ -213,12 +255,304 @@ void Game::Update(DX::StepTimer const& timer)
 
 #pragma region Frame Render
 
+void Game::EncodeInstances(ID3D12GraphicsCommandList6* cl,
+    const Constants& constants)
+{
+    ISV_PROFILE_ZONE("EncodeInstances");
+
+    auto bm = Gradient::BufferManager::Get();
+
+    bm->GetInstanceBuffer(m_tetInstances)->Resource.Transition(cl, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+    bm->GetInstanceBuffer(m_compressedInstances)->Resource.Transition(cl, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    bm->GetInstanceBuffer(m_instanceClusters)->Resource.Transition(cl, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+    m_encodeInstancesRS.SetOnCommandList(cl);
+    cl->SetPipelineState(m_encodeInstancesPSO.Get());
+
+    m_encodeInstancesRS.SetCBV(cl, 0, 0, constants);
+    m_encodeInstancesRS.SetStructuredBufferSRV(cl, 0, 0, m_tetInstances);
+    m_encodeInstancesRS.SetUAV(cl, 0, 0, m_compressedInstancesUAV);
+    m_encodeInstancesRS.SetUAV(cl, 1, 0, m_instanceClustersUAV);
+
+    // One group per cluster
+    cl->Dispatch(
+        Gradient::Math::DivRoundUp(
+            static_cast<uint32_t>(m_guiParticleCount),
+            InstanceClusterSize),
+        1, 1);
+
+    bm->GetInstanceBuffer(m_compressedInstances)->Resource.Transition(cl, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+    bm->GetInstanceBuffer(m_instanceClusters)->Resource.Transition(cl, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+}
+
+void Game::BeginSnapshotCapture()
+{
+    auto device = m_deviceResources->GetD3DDevice();
+
+    static_assert(sizeof(InstanceData) == sizeof(ISV::ParticleSnapshot::RenderInstance),
+        "Snapshots store InstanceData as is");
+
+    if (!m_snapshotReadback)
+    {
+        auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK);
+        auto desc = CD3DX12_RESOURCE_DESC::Buffer(MaxParticles * sizeof(InstanceData));
+
+        DX::ThrowIfFailed(
+            device->CreateCommittedResource(
+                &heapProperties,
+                D3D12_HEAP_FLAG_NONE,
+                &desc,
+                D3D12_RESOURCE_STATE_COPY_DEST,
+                nullptr,
+                IID_PPV_ARGS(m_snapshotReadback.ReleaseAndGetAddressOf())));
+        m_snapshotReadback->SetName(L"Snapshot Readback");
+    }
+
+    // The particle count is fixed for the whole capture
+    m_snapshotParticleCount = static_cast<uint32_t>(m_guiParticleCount);
+    m_snapshotFramesRemaining = static_cast<uint32_t>(m_guiSnapshotFrames);
+    m_snapshotWriter = std::make_unique<ISV::ParticleSnapshot::Writer>("capture.isvsnap",
+        m_snapshotParticleCount,
+        static_cast<uint32_t>(sizeof(Constants)));
+}
+
+void Game::CopyInstancesForSnapshot(ID3D12GraphicsCommandList6* cl,
+    const Constants& constants)
+{
+    auto bm = Gradient::BufferManager::Get();
+    auto instances = bm->GetInstanceBuffer(m_tetInstances);
+
+    instances->Resource.Transition(cl, D3D12_RESOURCE_STATE_COPY_SOURCE);
+
+    cl->CopyBufferRegion(m_snapshotReadback.Get(),
+        0,
+        instances->Resource.Get(),
+        0,
+        m_snapshotParticleCount * sizeof(InstanceData));
+
+    m_snapshotConstants = constants;
+    m_snapshotCopyPending = true;
+}
+
+void Game::WriteSnapshotFrame()
+{
+    // Capturing is a debugging aid, so stalling for the copy is fine
+    m_deviceResources->WaitForGpu();
+    m_snapshotCopyPending = false;
+
+    const auto readRange = CD3DX12_RANGE(0, m_snapshotParticleCount * sizeof(InstanceData));
+    void* mapped = nullptr;
+    DX::ThrowIfFailed(m_snapshotReadback->Map(0, &readRange, &mapped));
+
+    m_snapshotWriter->WriteFrame(
+        static_cast<const ISV::ParticleSnapshot::RenderInstance*>(mapped),
+        &m_snapshotConstants);
+
+    const auto writeRange = CD3DX12_RANGE(0, 0);
+    m_snapshotReadback->Unmap(0, &writeRange);
+
+    m_snapshotFramesRemaining--;
+    if (m_snapshotFramesRemaining == 0)
+    {
+        m_snapshotWriter->Close();
+        m_snapshotWriter.reset();
+    }
+}
+
+void Game::ApplyPreset(const ISV::ScenePreset& preset)
+{
+    m_guiParticleCount = std::min(static_cast<int>(preset.ParticleCount), MaxParticles);
+    m_guiScale = preset.Scale;
+    m_guiAlbedo = ToFloat3(preset.Albedo);
+    m_guiExtinction = preset.Extinction;
+    m_guiExtinctionFalloffFactor = preset.ExtinctionFalloff;
+    m_guiAnisotropy = preset.Anisotropy;
+    m_guiScatteringAsymmetry = preset.ScatteringAsymmetry;
+    m_guiMultiScatteringFactor = preset.MultiScatteringFactor;
+    m_guiReflectivity = preset.Reflectivity;
+    m_guiRenderingMethod = static_cast<RenderingMethod>(preset.RenderingMethod);
+    m_guiStepCount = static_cast<int>(preset.StepCount);
+    m_guiSoftShadows = preset.SoftShadows;
+    m_guiCompressedInstances = preset.CompressedInstances;
+
+    m_guiLightDirection = ToFloat3(preset.LightDirection);
+    m_guiLightBrightness = preset.LightBrightness;
+    m_guiLightColor = ToFloat3(preset.LightColor);
+
+    m_guiVolShadowRepresentation
+        = static_cast<ISV::VolShadowMap::Representation>(preset.VolShadowRepresentation);
+    m_guiVolShadowFormat = static_cast<ISV::VolShadowMap::StorageFormat>(preset.VolShadowFormat);
+    m_guiSplatVolShadows = preset.SplatVolShadows;
+    m_guiVolShadowLodScale = preset.VolShadowLodScale;
+    m_guiDebugVolShadows = preset.DebugVolShadows;
+
+    m_guiSimulationEnabled = preset.SimulationEnabled;
+    m_guiFixedTimestep = preset.FixedTimestep;
+    m_guiSimulationRate = static_cast<int>(preset.SimulationRate);
+    m_guiSubsteps = static_cast<int>(preset.Substeps);
+    m_guiParticleSleeping = preset.ParticleSleeping;
+    m_guiSleepVelocityThreshold = preset.SleepVelocityThreshold;
+    m_guiSleepAccelerationThreshold = preset.SleepAccelerationThreshold;
+    m_guiSleepSteps = static_cast<int>(preset.SleepSteps);
+    m_guiWakeRadius = preset.WakeRadius;
+    m_guiTargetWorld = ToFloat3(preset.TargetPosition);
+
+    m_guiAnimateProps = preset.AnimateProps;
+    m_guiBoxPosition = ToFloat3(preset.BoxPosition);
+    m_guiSpherePosition = ToFloat3(preset.SpherePosition);
+
+    const auto pose = preset.EvaluateCamera(0.f);
+    m_camera.SetPosition(Vector3(ToFloat3(pose.Position)));
+    m_camera.SetDirection(Vector3(ToFloat3(pose.Direction)));
+
+    // Don't let the new preset catch up on simulation steps owed by the old one
+    m_simulationAccumulator = 0.0;
+}
+
+ISV::ScenePreset Game::GetCurrentPreset() const
+{
+    ISV::ScenePreset preset;
+
+    preset.ParticleCount = static_cast<uint32_t>(m_guiParticleCount);
+    preset.Scale = m_guiScale;
+    preset.Albedo = ToArray(m_guiAlbedo);
+    preset.Extinction = m_guiExtinction;
+    preset.ExtinctionFalloff = m_guiExtinctionFalloffFactor;
+    preset.Anisotropy = m_guiAnisotropy;
+    preset.ScatteringAsymmetry = m_guiScatteringAsymmetry;
+    preset.MultiScatteringFactor = m_guiMultiScatteringFactor;
+    preset.Reflectivity = m_guiReflectivity;
+    preset.RenderingMethod = static_cast<uint32_t>(m_guiRenderingMethod);
+    preset.StepCount = static_cast<uint32_t>(m_guiStepCount);
+    preset.SoftShadows = m_guiSoftShadows;
+    preset.CompressedInstances = m_guiCompressedInstances;
+
+    preset.LightDirection = ToArray(m_guiLightDirection);
+    preset.LightBrightness = m_guiLightBrightness;
+    preset.LightColor = ToArray(m_guiLightColor);
+
+    preset.VolShadowRepresentation = static_cast<uint32_t>(m_guiVolShadowRepresentation);
+    preset.VolShadowFormat = static_cast<uint32_t>(m_guiVolShadowFormat);
+    preset.SplatVolShadows = m_guiSplatVolShadows;
+    preset.VolShadowLodScale = m_guiVolShadowLodScale;
+    preset.DebugVolShadows = m_guiDebugVolShadows;
+
+    preset.SimulationEnabled = m_guiSimulationEnabled;
+    preset.FixedTimestep = m_guiFixedTimestep;
+    preset.SimulationRate = static_cast<uint32_t>(m_guiSimulationRate);
+    preset.Substeps = static_cast<uint32_t>(m_guiSubsteps);
+    preset.ParticleSleeping = m_guiParticleSleeping;
+    preset.SleepVelocityThreshold = m_guiSleepVelocityThreshold;
+    preset.SleepAccelerationThreshold = m_guiSleepAccelerationThreshold;
+    preset.SleepSteps = static_cast<uint32_t>(m_guiSleepSteps);
+    preset.WakeRadius = m_guiWakeRadius;
+    preset.TargetPosition = ToArray(m_guiTargetWorld);
+
+    preset.AnimateProps = m_guiAnimateProps;
+    preset.BoxPosition = ToArray(m_guiBoxPosition);
+    preset.SpherePosition = ToArray(m_guiSpherePosition);
+
+    // A still camera where the current one is
+    const auto& camera = m_camera.GetCamera();
+    ISV::ScenePreset::CameraKeyframe keyframe;
+    keyframe.Position = ToArray(camera.GetPosition());
+    keyframe.Target = ToArray(camera.GetPosition() + camera.GetDirection());
+    preset.CameraPath = { keyframe };
+
+    return preset;
+}
+
+void Game::StartBenchmark(std::vector<ISV::ScenePreset> presets, const std::string& resultsPath)
+{
+    if (presets.empty())
+    {
+        throw std::runtime_error("The benchmark needs at least one preset");
+    }
+
+    m_benchmark = std::make_unique<ISV::PresetBenchmark>(std::move(presets));
+    m_benchmarkResultsPath = resultsPath;
+    ApplyPreset(m_benchmark->GetPreset());
+}
+
+void Game::UpdateBenchmark()
+{
+    ISV_PROFILE_ZONE("UpdateBenchmark");
+
+    // Frame to frame CPU time, which includes waiting on the GPU. GPU pass
+    // times come from the newest frame the GPU has finished, a couple of
+    // frames behind; the warmup frames cover the gap after a preset change.
+    const auto& gpuTimes = m_gpuTimer->GetResults();
+    bool nextPreset = false;
+
+    if (gpuTimes.GetLastReadFrame() > 0)
+    {
+        ISV::PresetBenchmark::PassTimes passMs = {};
+        for (uint32_t pass = 0; pass < ISV::PresetBenchmark::PassCount; pass++)
+        {
+            // Passes that didn't run in that frame count as zero
+            const auto* zone = gpuTimes.FindZone(ISV::PresetBenchmark::PassNames[pass]);
+            if (zone != nullptr && zone->LastFrame == gpuTimes.GetLastReadFrame())
+            {
+                passMs[pass] = zone->LastMs;
+            }
+        }
+
+        nextPreset = m_benchmark->EndFrame(m_timer.GetLastFrameSeconds(), passMs);
+    }
+    else
+    {
+        nextPreset = m_benchmark->EndFrame(m_timer.GetLastFrameSeconds());
+    }
+
+    if (nextPreset)
+    {
+        ApplyPreset(m_benchmark->GetPreset());
+    }
+
+    if (m_benchmark->IsFinished())
+    {
+        m_benchmark->WriteResults(m_benchmarkResultsPath);
+        m_benchmark.reset();
+
+        if (ISV::Profiler::Get().IsEnabled())
+        {
+            WriteCpuTrace();
+        }
+
+        ExitGame();
+    }
+}
+
+void Game::StartCpuTrace(const std::string& path)
+{
+    m_cpuTracePath = path;
+    ISV::Profiler::Get().Clear();
+    ISV::Profiler::Get().SetEnabled(true);
+}
+
+void Game::WriteCpuTrace()
+{
+    try
+    {
+        ISV::Profiler::Get().WriteChromeTrace(m_cpuTracePath);
+        m_cpuTraceStatus = "Wrote " + m_cpuTracePath;
+    }
+    catch (const std::exception& e)
+    {
+        m_cpuTraceStatus = e.what();
+    }
+}
+
 void Game::WriteSortingKeys(ID3D12GraphicsCommandList6* cl,
     const Constants& constants)
 {
+    ISV_PROFILE_ZONE("WriteSortingKeys");
+
     auto bm = Gradient::BufferManager::Get();
 
     bm->GetInstanceBuffer(m_tetInstances)->Resource.Transition(cl, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+    bm->GetInstanceBuffer(m_compressedInstances)->Resource.Transition(cl, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+    bm->GetInstanceBuffer(m_instanceClusters)->Resource.Transition(cl, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
     bm->GetInstanceBuffer(m_tetKeys)->Resource.Transition(cl, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
     bm->GetInstanceBuffer(m_tetIndices)->Resource.Transition(cl, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
 
@@ -227,6 +561,8 @@ void Game::WriteSortingKeys(ID3D12GraphicsCommandList6* cl,
 
     m_keyWritingRS.SetCBV(cl, 0, 0, constants);
     m_keyWritingRS.SetStructuredBufferSRV(cl, 0, 0, m_tetInstances);
+    m_keyWritingRS.SetStructuredBufferSRV(cl, 6, 0, m_compressedInstances);
+    m_keyWritingRS.SetStructuredBufferSRV(cl, 7, 0, m_instanceClusters);
     m_keyWritingRS.SetUAV(cl, 0, 0, m_tetKeysUAV);
     m_keyWritingRS.SetUAV(cl, 1, 0, m_tetIndicesUAV);
 
@@ -241,6 +577,8 @@ void Game::DispatchParallelSort(ID3D12GraphicsCommandList6* cl,
     Gradient::BufferManager::InstanceBufferEntry* keys,
     Gradient::BufferManager::InstanceBufferEntry* payload)
 {
+    ISV_PROFILE_ZONE("DispatchParallelSort");
+
     auto bm = Gradient::BufferManager::Get();
 
     keys->Resource.Transition(cl, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
@@ -277,6 +615,8 @@ void Game::DispatchParallelSort(ID3D12GraphicsCommandList6* cl,
 void Game::RenderPropShadows(ID3D12GraphicsCommandList6* cl,
     Vector3 normalizedLightDirection)
 {
+    ISV_PROFILE_ZONE("RenderPropShadows");
+
     m_shadowMap->SetLightDirection(normalizedLightDirection);
 
     m_propPipeline->World = m_boxWorld;
@@ -305,6 +645,8 @@ void Game::RenderPropShadows(ID3D12GraphicsCommandList6* cl,
 void Game::RenderProps(ID3D12GraphicsCommandList6* cl,
     Vector3 normalizedLightDirection)
 {
+    ISV_PROFILE_ZONE("RenderProps");
+
     m_shadowMap->TransitionToShaderResource(cl);
 
     m_propPipeline->World = m_boxWorld;
@@ -318,7 +660,10 @@ void Game::RenderProps(ID3D12GraphicsCommandList6* cl,
     m_propPipeline->ShadowTransform = m_shadowMap->GetShadowTransform();
     m_propPipeline->VolumetricShadowTransform = m_volShadowMap->GetShadowTransform();
     m_propPipeline->VolumetricShadowMap = m_volShadowMap->TransitionAndGetSRV(cl);
+    m_propPipeline->FourierOpacityMap = m_volShadowMap->TransitionAndGetFourierSRV(cl);
     m_propPipeline->RenderingMethod = static_cast<uint32_t>(m_guiRenderingMethod);
+    m_propPipeline->VolumetricShadowRepresentation = static_cast<uint32_t>(m_guiVolShadowRepresentation);
+    m_propPipeline->VolumetricShadowFormat = static_cast<uint32_t>(m_volShadowMap->GetStorageFormat());
 
     m_propPipeline->Apply(cl, true);
     auto bm = Gradient::BufferManager::Get();
@@ -339,12 +684,18 @@ void Game::RenderProps(ID3D12GraphicsCommandList6* cl,
 void Game::RenderParticles(ID3D12GraphicsCommandList6* cl,
     const Constants& constants)
 {
+    ISV_PROFILE_ZONE("RenderParticles");
+
     auto bm = Gradient::BufferManager::Get();
 
     bm->GetInstanceBuffer(m_tetInstances)->Resource.Transition(
         cl, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
     bm->GetInstanceBuffer(m_tetIndices)->Resource.Transition(
         cl, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+    bm->GetInstanceBuffer(m_compressedInstances)->Resource.Transition(
+        cl, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+    bm->GetInstanceBuffer(m_instanceClusters)->Resource.Transition(
+        cl, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
     m_erfTexture.Transition(cl, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
 
     m_particleRS.SetOnCommandList(cl);
@@ -362,9 +713,12 @@ void Game::RenderParticles(ID3D12GraphicsCommandList6* cl,
     m_particleRS.SetCBV(cl, 0, 0, constants);
     m_particleRS.SetStructuredBufferSRV(cl, 0, 0, m_tetInstances);
     m_particleRS.SetStructuredBufferSRV(cl, 1, 0, m_tetIndices);
+    m_particleRS.SetStructuredBufferSRV(cl, 6, 0, m_compressedInstances);
+    m_particleRS.SetStructuredBufferSRV(cl, 7, 0, m_instanceClusters);
     m_particleRS.SetSRV(cl, 2, 0, m_volShadowMap->TransitionAndGetSRV(cl));
     m_particleRS.SetSRV(cl, 3, 0, m_shadowMap->GetShadowMapSRV());
     m_particleRS.SetSRV(cl, 4, 0, m_erfTextureSRV);
+    m_particleRS.SetSRV(cl, 5, 0, m_volShadowMap->TransitionAndGetFourierSRV(cl));
 
     cl->DispatchMesh(
         Gradient::Math::DivRoundUp(
@@ -376,36 +730,91 @@ void Game::RenderParticles(ID3D12GraphicsCommandList6* cl,
 void Game::RenderVolumetricShadows(ID3D12GraphicsCommandList6* cl,
     const Constants& constants)
 {
+    ISV_PROFILE_ZONE("RenderVolumetricShadows");
+
     auto bm = Gradient::BufferManager::Get();
 
+    const bool useSphereProxies = m_guiRenderingMethod == RenderingMethod::SphericalProxy
+        || m_guiRenderingMethod == RenderingMethod::WastedPixelsSphere;
+    const bool useFourier = m_guiVolShadowRepresentation 
+        == ISV::VolShadowMap::Representation::FourierOpacity;
+
+    m_volShadowMap->SetLightDirection(constants.LightDirection);
+
+    if (m_guiSplatVolShadows && !useFourier)
+    {
+        bm->GetInstanceBuffer(m_tetInstances)->Resource.Transition(
+            cl, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+        bm->GetInstanceBuffer(m_compressedInstances)->Resource.Transition(
+            cl, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+        bm->GetInstanceBuffer(m_instanceClusters)->Resource.Transition(
+            cl, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+        m_erfTexture.Transition(cl, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+
+        m_volShadowMap->RenderSplat(cl,
+            [constants, &cl, useSphereProxies, this](
+                const ISV::VolShadowMap::SplatConstants& splatConstants,
+                Gradient::GraphicsMemoryManager::DescriptorView volumeUAV)
+            {
+                auto newSplatConstants = splatConstants;
+                newSplatConstants.FlipLayout = useSphereProxies ? 0 : 1;
+
+                m_splatRS.SetOnCommandList(cl);
+                cl->SetPipelineState(m_splatPSO.Get());
+
+                m_splatRS.SetCBV(cl, 0, 0, constants);
+                m_splatRS.SetCBV(cl, 1, 0, newSplatConstants);
+                m_splatRS.SetStructuredBufferSRV(cl, 0, 0, m_tetInstances);
+                m_splatRS.SetStructuredBufferSRV(cl, 6, 0, m_compressedInstances);
+                m_splatRS.SetStructuredBufferSRV(cl, 7, 0, m_instanceClusters);
+                m_splatRS.SetSRV(cl, 4, 0, m_erfTextureSRV);
+                m_splatRS.SetUAV(cl, 0, 0, volumeUAV);
+
+                cl->Dispatch(
+                    Gradient::Math::DivRoundUp(newSplatConstants.VolumeWidth, 8),
+                    Gradient::Math::DivRoundUp(newSplatConstants.VolumeWidth, 8),
+                    1);
+            });
+
+        return;
+    }
+
     m_particleRS.SetOnCommandList(cl);
 
-    if (m_guiRenderingMethod == RenderingMethod::SphericalProxy || m_guiRenderingMethod == RenderingMethod::WastedPixelsSphere)
+    Gradient::PipelineState* volShadowPSO = nullptr;
+    if (useSphereProxies)
     {
-        m_volShadowSpherePSO->Set(cl, true);
+        volShadowPSO = useFourier ? m_volShadowSphereFourierPSO.get() : m_volShadowSpherePSO.get();
     }
     else
     {
-        m_volShadowPSO->Set(cl, true);
+        volShadowPSO = useFourier ? m_volShadowFourierPSO.get() : m_volShadowPSO.get();
     }
 
     bm->GetInstanceBuffer(m_tetInstances)->Resource.Transition(
         cl, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
     bm->GetInstanceBuffer(m_tetIndices)->Resource.Transition(
         cl, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+    bm->GetInstanceBuffer(m_compressedInstances)->Resource.Transition(
+        cl, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+    bm->GetInstanceBuffer(m_instanceClusters)->Resource.Transition(
+        cl, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
     m_erfTexture.Transition(cl, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
 
     m_particleRS.SetStructuredBufferSRV(cl, 0, 0, m_tetInstances);
     m_particleRS.SetStructuredBufferSRV(cl, 1, 0, m_tetIndices);
+    m_particleRS.SetStructuredBufferSRV(cl, 6, 0, m_compressedInstances);
+    m_particleRS.SetStructuredBufferSRV(cl, 7, 0, m_instanceClusters);
     m_particleRS.SetSRV(cl, 4, 0, m_erfTextureSRV);
 
-    m_volShadowMap->SetLightDirection(constants.LightDirection);
-    m_volShadowMap->Render(cl,
-        [constants, &cl, &bm, this](Matrix view,
+    auto drawFn = [constants, &cl, &bm, volShadowPSO, this](Matrix view,
             Matrix proj,
             DirectX::BoundingOrientedBox bb,
             float nearPlane)
         {
+            // Slices may be encoded with a compute pass in between draws
+            volShadowPSO->Set(cl, true);
+
             auto newConstants = constants;
 
             Matrix v;
@@ -441,11 +850,22 @@ void Game::RenderVolumetricShadows(ID3D12GraphicsCommandList6* cl,
                     m_guiParticleCount,
                     32),
                 1, 1);
-        });
+        };
+
+    if (useFourier)
+    {
+        m_volShadowMap->RenderFourier(cl, drawFn);
+    }
+    else
+    {
+        m_volShadowMap->Render(cl, drawFn);
+    }
 }
 
 void Game::RenderGUI(ID3D12GraphicsCommandList6* cl)
 {
+    ISV_PROFILE_ZONE("RenderGUI");
+
     ImGui_ImplDX12_NewFrame();
     ImGui_ImplWin32_NewFrame();
     ImGui::NewFrame();
@@ -457,6 +877,114 @@ void Game::RenderGUI(ID3D12GraphicsCommandList6* cl)
     ImGui::Text("FPS: %.2f", fps);
     ImGui::Text("msPF: %.2f", 1000.f / fps);
 
+    const auto& frameTimes = m_timer.GetFrameTimes();
+    const auto& gpuTimes = m_gpuTimer->GetResults();
+
+    const auto now = std::chrono::steady_clock::now();
+    if (now - m_guiSummaryTime >= GuiSummaryInterval)
+    {
+        m_guiSummaryTime = now;
+        m_guiFrameSummary = frameTimes.GetSummary();
+
+        m_guiZoneSummaries.clear();
+        for (const auto& zone : gpuTimes.GetZoneStats())
+        {
+            m_guiZoneSummaries.push_back({ zone.Name, zone.LastMs, zone.History.GetSummary() });
+        }
+    }
+
+    const auto& frameSummary = m_guiFrameSummary;
+    ImGui::Text("p50: %.2f ms  p95: %.2f ms  p99: %.2f ms",
+        frameSummary.P50Ms, frameSummary.P95Ms, frameSummary.P99Ms);
+    ImGui::Text("min: %.2f ms  max: %.2f ms  (last %u frames)",
+        frameSummary.MinMs, frameSummary.MaxMs, frameSummary.Frames);
+
+    const auto history = frameTimes.GetHistory();
+    const float plotMaxMs = static_cast<float>(std::max(33.3, frameSummary.P99Ms * 1.5));
+    ImGui::PlotLines("##FrameTimes", history.data(), static_cast<int>(history.size()),
+        0, "Frame time (ms)", 0.f, plotMaxMs, ImVec2(0, 60));
+
+    const auto histogram = frameTimes.GetHistogram(50, plotMaxMs);
+    ImGui::PlotHistogram("##FrameTimeHistogram", histogram.data(), static_cast<int>(histogram.size()),
+        0, "Frame time histogram", 0.f, FLT_MAX, ImVec2(0, 60));
+
+    if (ImGui::Button("Reset Frame Times"))
+    {
+        m_timer.ResetFrameTimes();
+        m_guiSummaryTime = {};
+    }
+
+    if (ImGui::TreeNodeEx("GPU passes", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        ImGui::Text("%-18s %8s %8s %8s", "", "last", "mean", "p95");
+        for (const auto& zone : m_guiZoneSummaries)
+        {
+            ImGui::Text("%-18s %8.3f %8.3f %8.3f",
+                zone.Name.c_str(), zone.LastMs, zone.Summary.MeanMs, zone.Summary.P95Ms);
+        }
+
+        if (gpuTimes.GetDroppedFrames() > 0 || gpuTimes.GetDroppedZones() > 0)
+        {
+            ImGui::Text("Dropped %llu frames, %llu zones",
+                static_cast<unsigned long long>(gpuTimes.GetDroppedFrames()),
+                static_cast<unsigned long long>(gpuTimes.GetDroppedZones()));
+        }
+
+        ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("Prop meshes"))
+    {
+        auto bm = Gradient::BufferManager::Get();
+
+        // Measured at creation, before and after ProceduralMesh's
+        // optimisation passes
+        const std::pair<const char*, Gradient::BufferManager::MeshHandle> props[] = {
+            { "Box", m_box },
+            { "Floor", m_floor },
+            { "Sphere", m_sphere },
+        };
+
+        ImGui::Text("%-8s %6s %11s %11s %11s %11s", "", "tris", "ACMR", "ATVR", "overdraw", "overfetch");
+        for (const auto& [name, handle] : props)
+        {
+            const auto& report = bm->GetMesh(handle)->GetOptimizationReport();
+            ImGui::Text("%-8s %6u %5.2f>%5.2f %5.2f>%5.2f %5.2f>%5.2f %5.2f>%5.2f",
+                name, report.After.TriangleCount,
+                report.Before.Acmr, report.After.Acmr,
+                report.Before.Atvr, report.After.Atvr,
+                report.Before.Overdraw, report.After.Overdraw,
+                report.Before.Overfetch, report.After.Overfetch);
+        }
+
+        ImGui::TreePop();
+    }
+
+    // Keeps the last ISV::Profiler::EventsPerThread zones of each thread
+    bool profileCpu = ISV::Profiler::Get().IsEnabled();
+    if (ImGui::Checkbox("Profile CPU", &profileCpu))
+    {
+        ISV::Profiler::Get().SetEnabled(profileCpu);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Write CPU Trace"))
+    {
+        WriteCpuTrace();
+    }
+    if (!m_cpuTraceStatus.empty())
+    {
+        ImGui::Text("%s", m_cpuTraceStatus.c_str());
+    }
+
+    if (m_benchmark)
+    {
+        ImGui::Text("Benchmarking %s (%u of %u)%s",
+            m_benchmark->GetPreset().Name.c_str(),
+            m_benchmark->GetPresetIndex() + 1,
+            m_benchmark->GetPresetCount(),
+            m_benchmark->IsWarmingUp() ? ", warming up" : "");
+    }
+
     ImGui::End();
 
     ImGui::Begin("Options");
@@ -469,6 +997,7 @@ void Game::RenderGUI(ID3D12GraphicsCommandList6* cl)
             m_guiParticleCount = MaxParticles;
         }
         ImGui::SliderFloat("Scale", &m_guiScale, 0.01, 30);
+        ImGui::Checkbox("Compressed Instances", &m_guiCompressedInstances);
         ImGui::ColorEdit3("Albedo", &m_guiAlbedo.x);
         ImGui::SliderFloat("Extinction", &m_guiExtinction, 0, 100);
         ImGui::SliderFloat("Extinction Falloff", &m_guiExtinctionFalloffFactor, 0, 10);
@@ -497,6 +1026,22 @@ void Game::RenderGUI(ID3D12GraphicsCommandList6* cl)
         ImGui::SliderFloat("Brightness", &m_guiLightBrightness, 0, 10);
         ImGui::ColorEdit3("Color", &m_guiLightColor.x);
         ImGui::Checkbox("Debug Volumetric Shadows", &m_guiDebugVolShadows);
+        const char* volShadowItems[] = {
+            "Slice Volume",
+            "Fourier Opacity Map"
+        };
+        ImGui::Combo("Volumetric Shadow Storage", reinterpret_cast<int*>(&m_guiVolShadowRepresentation),
+            volShadowItems, IM_ARRAYSIZE(volShadowItems));
+        const char* volShadowFormatItems[] = {
+            "R32 Float",
+            "R16 Float",
+            "R16 UNORM (log)",
+            "R8 UNORM (log)"
+        };
+        ImGui::Combo("Volumetric Shadow Format", reinterpret_cast<int*>(&m_guiVolShadowFormat),
+            volShadowFormatItems, IM_ARRAYSIZE(volShadowFormatItems));
+        ImGui::Checkbox("Splat Volumetric Shadows in Compute", &m_guiSplatVolShadows);
+        ImGui::SliderFloat("Shadow Lookup Cone Scale", &m_guiVolShadowLodScale, 0.f, 4.f);
 
         ImGui::TreePop();
     }
@@ -504,10 +1049,76 @@ void Game::RenderGUI(ID3D12GraphicsCommandList6* cl)
     if (ImGui::TreeNodeEx("Simulation", ImGuiTreeNodeFlags_DefaultOpen))
     {
         ImGui::Checkbox("Enabled", &m_guiSimulationEnabled);
+        ImGui::Checkbox("Particle Sleeping", &m_guiParticleSleeping);
+        if (m_guiParticleSleeping)
+        {
+            ImGui::SliderFloat("Sleep Velocity", &m_guiSleepVelocityThreshold, 0.f, 5.f);
+            ImGui::SliderFloat("Sleep Acceleration", &m_guiSleepAccelerationThreshold, 0.f, 50.f);
+            ImGui::SliderInt("Sleep Steps", &m_guiSleepSteps, 1, 240);
+            ImGui::SliderFloat("Bullet Wake Radius", &m_guiWakeRadius, 0.f, 20.f);
+        }
+        ImGui::Checkbox("Fixed Timestep", &m_guiFixedTimestep);
+        if (m_guiFixedTimestep)
+        {
+            ImGui::SliderInt("Simulation Rate (Hz)", &m_guiSimulationRate, 30, 240);
+            ImGui::SliderInt("Substeps", &m_guiSubsteps, 1, 8);
+        }
         ImGui::DragFloat3("Target Position", &m_guiTargetWorld.x, 0.05f, -100.f, 100.f);
         ImGui::TreePop();
     }
 
+    if (ImGui::TreeNodeEx("Capture"))
+    {
+        if (m_snapshotWriter)
+        {
+            ImGui::Text("Capturing, %u frames left", m_snapshotFramesRemaining);
+        }
+        else
+        {
+            ImGui::SliderInt("Frames", &m_guiSnapshotFrames, 1, 1000);
+            if (ImGui::Button("Capture Snapshot"))
+            {
+                BeginSnapshotCapture();
+            }
+        }
+        ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNodeEx("Presets"))
+    {
+        ImGui::InputText("Path", m_guiPresetPath, sizeof(m_guiPresetPath));
+        if (ImGui::Button("Load"))
+        {
+            try
+            {
+                ApplyPreset(ISV::ScenePreset::Load(m_guiPresetPath));
+                m_presetStatus = "Loaded";
+            }
+            catch (const std::exception& e)
+            {
+                m_presetStatus = e.what();
+            }
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Save"))
+        {
+            try
+            {
+                GetCurrentPreset().Save(m_guiPresetPath);
+                m_presetStatus = "Saved";
+            }
+            catch (const std::exception& e)
+            {
+                m_presetStatus = e.what();
+            }
+        }
+        if (!m_presetStatus.empty())
+        {
+            ImGui::TextWrapped("%s", m_presetStatus.c_str());
+        }
+        ImGui::TreePop();
+    }
+
     if (ImGui::TreeNodeEx("Props", ImGuiTreeNodeFlags_DefaultOpen))
     {
         ImGui::DragFloat3("Box Position", &m_guiBoxPosition.x, 0.05f, -100.f, 100.f);
@@ -525,27 +1136,177 @@ void Game::RenderGUI(ID3D12GraphicsCommandList6* cl)
 
 void Game::SimulateParticles(ID3D12GraphicsCommandList6* cl, const Constants& constants)
 {
+    ISV_PROFILE_ZONE("SimulateParticles");
+
     auto bm = Gradient::BufferManager::Get();
 
     bm->GetInstanceBuffer(m_tetInstances)->Resource.Transition(
         cl, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    bm->GetInstanceBuffer(m_tetSimulationData)->Resource.Transition(
+        cl, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+    if (m_guiParticleSleeping)
+    {
+        SimulateActiveParticles(cl, constants);
+        return;
+    }
 
     m_simulationRS.SetOnCommandList(cl);
     cl->SetPipelineState(m_simulationPSO.Get());
 
     m_simulationRS.SetCBV(cl, 0, 0, constants);
     m_simulationRS.SetUAV(cl, 0, 0, m_tetInstancesUAV);
+    m_simulationRS.SetUAV(cl, 1, 0, m_tetSimulationDataUAV);
+
+    cl->Dispatch(
+        Gradient::Math::DivRoundUp(
+            m_guiParticleCount,
+            32u),
+        1, 1);
+}
+
+void Game::SimulateActiveParticles(ID3D12GraphicsCommandList6* cl, const Constants& constants)
+{
+    ISV_PROFILE_ZONE("SimulateActiveParticles");
+
+    auto bm = Gradient::BufferManager::Get();
+    auto instances = bm->GetInstanceBuffer(m_tetInstances);
+    auto activeIndices = bm->GetInstanceBuffer(m_activeIndices);
+    auto activeCount = bm->GetInstanceBuffer(m_activeCount);
+    auto activeCountReset = bm->GetInstanceBuffer(m_activeCountReset);
+
+    // Moving the target invalidates every particle's resting place
+    const bool targetMoved = m_guiTargetWorld.x != m_sleepingTargetWorld.x
+        || m_guiTargetWorld.y != m_sleepingTargetWorld.y
+        || m_guiTargetWorld.z != m_sleepingTargetWorld.z;
+    m_sleepingTargetWorld = m_guiTargetWorld;
+
+    ActivityConstants activityConstants;
+    activityConstants.VelocityThreshold = m_guiSleepVelocityThreshold;
+    activityConstants.AccelerationThreshold = m_guiSleepAccelerationThreshold;
+    activityConstants.WakeRadius = m_guiWakeRadius;
+    activityConstants.SleepSteps = static_cast<uint32_t>(m_guiSleepSteps);
+    activityConstants.WakeAll = targetMoved ? 1 : 0;
+
+    activeCount->Resource.Transition(cl, D3D12_RESOURCE_STATE_COPY_DEST);
+    activeCountReset->Resource.Transition(cl, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    cl->CopyBufferRegion(activeCount->Resource.Get(), 0,
+        activeCountReset->Resource.Get(), 0, sizeof(uint32_t));
+
+    instances->Resource.Transition(cl, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    bm->GetInstanceBuffer(m_particleActivity)->Resource.Transition(cl, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    activeIndices->Resource.Transition(cl, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    activeCount->Resource.Transition(cl, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+    // Compact the indices of the particles that are awake
+    m_classifyRS.SetOnCommandList(cl);
+    cl->SetPipelineState(m_classifyPSO.Get());
+
+    m_classifyRS.SetCBV(cl, 0, 0, constants);
+    m_classifyRS.SetCBV(cl, 1, 0, activityConstants);
+    m_classifyRS.SetUAV(cl, 0, 0, m_tetInstancesUAV);
+    m_classifyRS.SetUAV(cl, 1, 0, m_tetSimulationDataUAV);
+    m_classifyRS.SetUAV(cl, 2, 0, m_particleActivityUAV);
+    m_classifyRS.SetUAV(cl, 3, 0, m_activeIndicesUAV);
+    m_classifyRS.SetUAV(cl, 4, 0, m_activeCountUAV);
 
     cl->Dispatch(
         Gradient::Math::DivRoundUp(
             m_guiParticleCount,
             32u),
         1, 1);
+
+    auto countBarrier = CD3DX12_RESOURCE_BARRIER::UAV(activeCount->Resource.Get());
+    cl->ResourceBarrier(1, &countBarrier);
+
+    m_simulationArgsRS.SetOnCommandList(cl);
+    cl->SetPipelineState(m_simulationArgsPSO.Get());
+    m_simulationArgsRS.SetUAV(cl, 0, 0, m_activeCountUAV);
+    cl->Dispatch(1, 1, 1);
+
+    activeIndices->Resource.Transition(cl, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    activeCount->Resource.Transition(cl,
+        D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+
+    // The classification pass puts sleeping particles to rest
+    D3D12_RESOURCE_BARRIER instanceBarriers[] = {
+        CD3DX12_RESOURCE_BARRIER::UAV(instances->Resource.Get()),
+        CD3DX12_RESOURCE_BARRIER::UAV(bm->GetInstanceBuffer(m_tetSimulationData)->Resource.Get())
+    };
+    cl->ResourceBarrier(static_cast<UINT>(std::size(instanceBarriers)), instanceBarriers);
+
+    // Only the awake particles are integrated
+    m_activeSimulationRS.SetOnCommandList(cl);
+    cl->SetPipelineState(m_activeSimulationPSO.Get());
+
+    m_activeSimulationRS.SetCBV(cl, 0, 0, constants);
+    m_activeSimulationRS.SetUAV(cl, 0, 0, m_tetInstancesUAV);
+    m_activeSimulationRS.SetUAV(cl, 1, 0, m_tetSimulationDataUAV);
+    m_activeSimulationRS.SetStructuredBufferSRV(cl, 0, 0, m_activeIndices);
+    m_activeSimulationRS.SetStructuredBufferSRV(cl, 1, 0, m_activeCount);
+
+    cl->ExecuteIndirect(m_dispatchSignature.Get(), 1,
+        activeCount->Resource.Get(), sizeof(uint32_t),
+        nullptr, 0);
+}
+
+uint32_t Game::SimulateParticlesFixedStep(ID3D12GraphicsCommandList6* cl, const Constants& constants)
+{
+    ISV_PROFILE_ZONE("SimulateParticlesFixedStep");
+
+    const double fixedStep = 1.0 / m_guiSimulationRate;
+    const uint32_t substeps = static_cast<uint32_t>(m_guiSubsteps);
+    const double substepLength = fixedStep / substeps;
+
+    m_simulationAccumulator += m_timer.GetElapsedSeconds();
+
+    auto stepConstants = constants;
+    stepConstants.DeltaTime = static_cast<float>(substepLength);
+
+    auto bm = Gradient::BufferManager::Get();
+    auto instances = bm->GetInstanceBuffer(m_tetInstances);
+    auto simulationData = bm->GetInstanceBuffer(m_tetSimulationData);
+
+    uint32_t steps = 0;
+    while (m_simulationAccumulator >= fixedStep && steps < MaxSimulationStepsPerFrame)
+    {
+        for (uint32_t s = 0; s < substeps; s++)
+        {
+            if (steps > 0 || s > 0)
+            {
+                D3D12_RESOURCE_BARRIER uavBarriers[] = {
+                    CD3DX12_RESOURCE_BARRIER::UAV(instances->Resource.Get()),
+                    CD3DX12_RESOURCE_BARRIER::UAV(simulationData->Resource.Get())
+                };
+                cl->ResourceBarrier(static_cast<UINT>(std::size(uavBarriers)), uavBarriers);
+            }
+
+            stepConstants.TotalTime = static_cast<float>(m_simulationTime + s * substepLength);
+            SimulateParticles(cl, stepConstants);
+
+            // The bullet impulse is a velocity change, so it's only applied once
+            stepConstants.DidShoot = 0;
+        }
+
+        m_simulationTime += fixedStep;
+        m_simulationAccumulator -= fixedStep;
+        steps++;
+    }
+
+    // Drop whatever is left after a long frame rather than trying to catch up
+    if (steps == MaxSimulationStepsPerFrame)
+    {
+        m_simulationAccumulator = std::min(m_simulationAccumulator, fixedStep);
+    }
+
+    return steps;
 }
 
 // Draws the scene.
 void Game::Render()
 {
+    ISV_PROFILE_ZONE("Render");
+
     auto gmm = Gradient::GraphicsMemoryManager::Get();
 
     // Don't try to render anything before the first Update.
@@ -561,6 +1322,14 @@ void Game::Render()
     auto cl = m_deviceResources->GetCommandList();
     auto bm = Gradient::BufferManager::Get();
 
+    using Pass = ISV::PresetBenchmark::Pass;
+
+    m_gpuTimer->BeginFrame(cl);
+    const auto frameZone = m_gpuTimer->BeginZone("frame");
+
+    // CPU updates to dynamic instance buffers since the last frame
+    bm->CommitDynamicBuffers(cl);
+
     ID3D12DescriptorHeap* heaps[] = { gmm->GetSrvUavDescriptorHeap(), m_states->Heap() };
     cl->SetDescriptorHeaps(static_cast<UINT>(std::size(heaps)), heaps);
 
@@ -626,6 +1395,12 @@ void Game::Render()
     constants.StepCount = m_guiStepCount;
     constants.MultiScatteringFactor = m_guiMultiScatteringFactor;
     constants.Reflectivity = m_guiReflectivity;
+    constants.VolumetricShadowRepresentation = static_cast<uint32_t>(m_guiVolShadowRepresentation);
+    constants.VolumetricShadowFormat = static_cast<uint32_t>(m_volShadowMap->GetStorageFormat());
+    constants.VolumetricShadowTexelSize = m_volShadowMap->GetTexelSize();
+    constants.VolumetricShadowLodScale = m_guiVolShadowLodScale;
+    constants.VolumetricShadowMipCount = m_volShadowMap->GetMipCount();
+    constants.CompressedInstances = m_guiCompressedInstances ? 1 : 0;
 
     auto size = m_deviceResources->GetOutputSize();
     constants.RenderTargetWidth = static_cast<float>(size.right);
@@ -646,31 +1421,66 @@ void Game::Render()
         constants.DidShoot = 0;
     }
 
-    m_didShoot = 0;
-
+    bool shotConsumed = true;
 
     if (m_guiSimulationEnabled)
     {
         PIXBeginEvent(cl, PIX_COLOR_DEFAULT, L"Simulate particles");
+        const auto simulationZone = m_gpuTimer->BeginZone(ISV::PresetBenchmark::GetPassName(Pass::Simulation));
+
+        if (m_guiFixedTimestep)
+        {
+            // A shot fired on a frame that runs no steps waits for the next one
+            shotConsumed = SimulateParticlesFixedStep(cl, constants) > 0;
+        }
+        else
+        {
+            SimulateParticles(cl, constants);
+        }
+
+        m_gpuTimer->EndZone(simulationZone);
+        PIXEndEvent(cl);
+    }
+
+    if (shotConsumed)
+    {
+        m_didShoot = 0;
+    }
 
-        SimulateParticles(cl, constants);
+    if (m_guiCompressedInstances)
+    {
+        PIXBeginEvent(cl, PIX_COLOR_DEFAULT, L"Encode instances");
+        const auto encodeZone = m_gpuTimer->BeginZone("encode_instances");
+
+        EncodeInstances(cl, constants);
 
+        m_gpuTimer->EndZone(encodeZone);
         PIXEndEvent(cl);
     }
 
+    if (m_snapshotWriter)
+    {
+        CopyInstancesForSnapshot(cl, constants);
+    }
+
     PIXBeginEvent(cl, PIX_COLOR_DEFAULT, L"Volumetric shadow rendering");
+    const auto volShadowZone = m_gpuTimer->BeginZone(ISV::PresetBenchmark::GetPassName(Pass::VolumetricShadows));
 
     RenderVolumetricShadows(cl, constants);
 
+    m_gpuTimer->EndZone(volShadowZone);
     PIXEndEvent(cl);
 
     PIXBeginEvent(cl, PIX_COLOR_DEFAULT, L"Shadow map");
+    const auto shadowMapZone = m_gpuTimer->BeginZone(ISV::PresetBenchmark::GetPassName(Pass::ShadowMap));
 
     RenderPropShadows(cl, lightDirection);
 
+    m_gpuTimer->EndZone(shadowMapZone);
     PIXEndEvent(cl);
 
     PIXBeginEvent(cl, PIX_COLOR_DEFAULT, L"Sort particles");
+    const auto sortZone = m_gpuTimer->BeginZone(ISV::PresetBenchmark::GetPassName(Pass::Sort));
 
     WriteSortingKeys(cl, constants);
     DispatchParallelSort(cl,
@@ -679,23 +1489,29 @@ void Game::Render()
     );
 
     cl->SetDescriptorHeaps(static_cast<UINT>(std::size(heaps)), heaps);
+    m_gpuTimer->EndZone(sortZone);
     PIXEndEvent(cl);
 
     PIXBeginEvent(cl, PIX_COLOR_DEFAULT, L"Render");
+    const auto renderZone = m_gpuTimer->BeginZone(ISV::PresetBenchmark::GetPassName(Pass::Render));
 
     ClearAndSetHDRTarget();
     RenderProps(cl, lightDirection);
     RenderParticles(cl, constants);
 
+    m_gpuTimer->EndZone(renderZone);
     PIXEndEvent(cl);
 
     PIXBeginEvent(cl, PIX_COLOR_DEFAULT, L"GUI");
+    const auto guiZone = m_gpuTimer->BeginZone("gui");
 
     RenderGUI(cl);
 
+    m_gpuTimer->EndZone(guiZone);
     PIXEndEvent(cl);
 
     PIXBeginEvent(cl, PIX_COLOR_DEFAULT, L"MSAA resolve and tonemap");
+    const auto tonemapZone = m_gpuTimer->BeginZone("tonemap");
 
     m_renderTarget->CopyToSingleSampled(cl);
     ClearAndSetBackBufferTarget();
@@ -717,14 +1533,33 @@ void Game::Render()
         break;
     }
 
+    m_gpuTimer->EndZone(tonemapZone);
+    m_gpuTimer->EndZone(frameZone);
+    m_gpuTimer->EndFrame();
 
     PIXEndEvent(cl);
 
+    // Buffers created since the last frame are copied before this frame
+    // runs, on the same queue
+    Gradient::UploadManager::Get()->Flush();
+
     // Show the new frame.
     //PIXBeginEvent(m_deviceResources->GetCommandQueue(), PIX_COLOR_DEFAULT, L"Present");
-    m_deviceResources->Present();
+    {
+        // Includes waiting on the GPU for the next frame's resources
+        ISV_PROFILE_ZONE("Present");
+        m_deviceResources->Present();
+    }
+
+    m_gpuTimer->Signal(m_deviceResources->GetCommandQueue());
+    bm->SignalDynamicBuffers(m_deviceResources->GetCommandQueue());
 
     gmm->Commit(m_deviceResources->GetCommandQueue());
+
+    if (m_snapshotCopyPending)
+    {
+        WriteSnapshotFrame();
+    }
     //PIXEndEvent(m_deviceResources->GetCommandQueue());
 }
 
@@ -855,13 +1690,18 @@ void Game::CreateDeviceDependentResources()
     }
 
     Gradient::GraphicsMemoryManager::Initialize(device);
+    Gradient::UploadManager::Initialize(device);
     Gradient::BufferManager::Initialize();
 
     auto bm = Gradient::BufferManager::Get();
 
-    m_floor = bm->CreateBox(device, cq, { 1, 1, 1 });
-    m_box = bm->CreateBox(device, cq, { 3, 3, 3 });
-    m_sphere = bm->CreateSphere(device, cq, 2.f);
+    // The Prop meshes window shows what optimisation did to these
+    Gradient::Rendering::MeshOptimizationOptions propOptions;
+    propOptions.CollectStatistics = true;
+
+    m_floor = bm->CreateBox(device, cq, { 1, 1, 1 }, true, false, propOptions);
+    m_box = bm->CreateBox(device, cq, { 3, 3, 3 }, true, false, propOptions);
+    m_sphere = bm->CreateSphere(device, cq, 2.f, 16, true, false, propOptions);
 
     m_states = std::make_unique<DirectX::CommonStates>(device);
 
@@ -870,6 +1710,8 @@ void Game::CreateDeviceDependentResources()
         Vector3{ 1, 1, 1 },
         50.f);
 
+    m_gpuTimer = std::make_unique<ISV::GpuTimer>(device, cq, m_deviceResources->GetBackBufferCount());
+
     RenderTargetState backBufferRTState(m_deviceResources->GetBackBufferFormat(),
         m_deviceResources->GetDepthBufferFormat());
 
@@ -923,6 +1765,9 @@ void Game::CreateDeviceDependentResources()
     m_particleRS.AddSRV(2, 0);       // volumetric shadow map
     m_particleRS.AddSRV(3, 0);       // regular shadow map
     m_particleRS.AddSRV(4, 0);       // ERF lookup texture
+    m_particleRS.AddSRV(5, 0);       // Fourier opacity map
+    m_particleRS.AddRootSRV(6, 0);   // compressed instances
+    m_particleRS.AddRootSRV(7, 0);   // instance clusters
 
     m_particleRS.AddStaticSampler(CD3DX12_STATIC_SAMPLER_DESC(0,
         D3D12_FILTER_MIN_MAG_MIP_LINEAR,
@@ -1016,9 +1861,38 @@ void Game::CreateDeviceDependentResources()
     m_volShadowSpherePSO = std::make_unique<Gradient::PipelineState>(volShadowSpherePsoDesc);
     m_volShadowSpherePSO->Build(device);
 
+    // Fourier opacity map PSOs
+    // These write the coefficients of every interval into two targets at once
+    auto volShadowFourierPSData = DX::ReadData(L"VolShadowFourier_PS.cso");
+    auto volShadowSphereFourierPSData = DX::ReadData(L"VolShadowSphereFourier_PS.cso");
+
+    auto volShadowFourierPsoDesc = psoDesc;
+    volShadowFourierPsoDesc.NumRenderTargets = ISV::VolShadowMap::FourierSliceCount;
+    for (uint32_t i = 0; i < ISV::VolShadowMap::FourierSliceCount; i++)
+    {
+        volShadowFourierPsoDesc.RTVFormats[i] = ISV::VolShadowMap::FourierFormat;
+    }
+    volShadowFourierPsoDesc.PS = { volShadowFourierPSData.data(), volShadowFourierPSData.size() };
+
+    m_volShadowFourierPSO = std::make_unique<Gradient::PipelineState>(volShadowFourierPsoDesc);
+    m_volShadowFourierPSO->Build(device);
+
+    auto volShadowSphereFourierPsoDesc = volShadowSpherePsoDesc;
+    volShadowSphereFourierPsoDesc.NumRenderTargets = ISV::VolShadowMap::FourierSliceCount;
+    for (uint32_t i = 0; i < ISV::VolShadowMap::FourierSliceCount; i++)
+    {
+        volShadowSphereFourierPsoDesc.RTVFormats[i] = ISV::VolShadowMap::FourierFormat;
+    }
+    volShadowSphereFourierPsoDesc.PS = { volShadowSphereFourierPSData.data(), volShadowSphereFourierPSData.size() };
+
+    m_volShadowSphereFourierPSO = std::make_unique<Gradient::PipelineState>(volShadowSphereFourierPsoDesc);
+    m_volShadowSphereFourierPSO->Build(device);
+
     // Key writing PSO and root signature
     m_keyWritingRS.AddCBV(0, 0); // constants
     m_keyWritingRS.AddRootSRV(0, 0); // instances
+    m_keyWritingRS.AddRootSRV(6, 0); // compressed instances
+    m_keyWritingRS.AddRootSRV(7, 0); // instance clusters
     m_keyWritingRS.AddUAV(0, 0); // keys
     m_keyWritingRS.AddUAV(1, 0); // indices
     m_keyWritingRS.Build(device, true);
@@ -1028,12 +1902,88 @@ void Game::CreateDeviceDependentResources()
     // Simulation PSO and root signature
     m_simulationRS.AddCBV(0, 0); // constants
     m_simulationRS.AddUAV(0, 0); // instances
+    m_simulationRS.AddUAV(1, 0); // instance simulation data
     m_simulationRS.Build(device, true);
 
     m_simulationPSO = CreateComputePipelineState(device,
         L"SimulateParticles_CS.cso",
         m_simulationRS.Get());
 
+    // Particle sleeping
+    m_classifyRS.AddCBV(0, 0); // constants
+    m_classifyRS.AddCBV(1, 0); // activity constants
+    m_classifyRS.AddUAV(0, 0); // instances
+    m_classifyRS.AddUAV(1, 0); // instance simulation data
+    m_classifyRS.AddUAV(2, 0); // activity
+    m_classifyRS.AddUAV(3, 0); // active indices
+    m_classifyRS.AddUAV(4, 0); // active count and dispatch arguments
+    m_classifyRS.Build(device, true);
+
+    m_classifyPSO = CreateComputePipelineState(device,
+        L"ClassifyParticles_CS.cso",
+        m_classifyRS.Get());
+
+    m_simulationArgsRS.AddUAV(0, 0); // active count and dispatch arguments
+    m_simulationArgsRS.Build(device, true);
+
+    m_simulationArgsPSO = CreateComputePipelineState(device,
+        L"WriteSimulationArgs_CS.cso",
+        m_simulationArgsRS.Get());
+
+    m_activeSimulationRS.AddCBV(0, 0); // constants
+    m_activeSimulationRS.AddUAV(0, 0); // instances
+    m_activeSimulationRS.AddUAV(1, 0); // instance simulation data
+    m_activeSimulationRS.AddRootSRV(0, 0); // active indices
+    m_activeSimulationRS.AddRootSRV(1, 0); // active count
+    m_activeSimulationRS.Build(device, true);
+
+    m_activeSimulationPSO = CreateComputePipelineState(device,
+        L"SimulateActiveParticles_CS.cso",
+        m_activeSimulationRS.Get());
+
+    D3D12_INDIRECT_ARGUMENT_DESC dispatchArgument = {};
+    dispatchArgument.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH;
+
+    D3D12_COMMAND_SIGNATURE_DESC dispatchSignatureDesc = {};
+    dispatchSignatureDesc.ByteStride = sizeof(D3D12_DISPATCH_ARGUMENTS);
+    dispatchSignatureDesc.NumArgumentDescs = 1;
+    dispatchSignatureDesc.pArgumentDescs = &dispatchArgument;
+
+    DX::ThrowIfFailed(device->CreateCommandSignature(&dispatchSignatureDesc,
+        nullptr,
+        IID_PPV_ARGS(m_dispatchSignature.ReleaseAndGetAddressOf())));
+
+    // Compressed instance encoding
+    m_encodeInstancesRS.AddCBV(0, 0); // constants
+    m_encodeInstancesRS.AddRootSRV(0, 0); // instances
+    m_encodeInstancesRS.AddUAV(0, 0); // compressed instances
+    m_encodeInstancesRS.AddUAV(1, 0); // instance clusters
+    m_encodeInstancesRS.Build(device, true);
+
+    m_encodeInstancesPSO = CreateComputePipelineState(device,
+        L"EncodeInstances_CS.cso",
+        m_encodeInstancesRS.Get());
+
+    // Compute splatting of volumetric shadows
+    m_splatRS.AddCBV(0, 0);         // constants
+    m_splatRS.AddCBV(1, 0);         // splat constants
+    m_splatRS.AddRootSRV(0, 0);     // instances
+    m_splatRS.AddRootSRV(6, 0);     // compressed instances
+    m_splatRS.AddRootSRV(7, 0);     // instance clusters
+    m_splatRS.AddSRV(4, 0);         // ERF lookup texture
+    m_splatRS.AddUAV(0, 0);         // volumetric shadow map
+    m_splatRS.AddStaticSampler(CD3DX12_STATIC_SAMPLER_DESC(0,
+        D3D12_FILTER_MIN_MAG_MIP_LINEAR,
+        D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+        D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+        D3D12_TEXTURE_ADDRESS_MODE_CLAMP),
+        0, 0);
+    m_splatRS.Build(device, true);
+
+    m_splatPSO = CreateComputePipelineState(device,
+        L"VolShadowSplat_CS.cso",
+        m_splatRS.Get());
+
     m_propPipeline = std::make_unique<ISV::PropPipeline>(device);
 
     // Set up FidelityFX interface.
@@ -1088,6 +2038,7 @@ void Game::CreateTetrahedronInstances()
     // Create instances
 
     std::vector<InstanceData> instances;
+    std::vector<InstanceSimulationData> simulationData;
     for (int i = 0; i < MaxParticles; i++)
     {
         Vector3 position;
@@ -1105,12 +2056,16 @@ void Game::CreateTetrahedronInstances()
         instances.push_back(
             {
             position + 2.f * rotationAxis,
-            densityMultiplier,
+            1.f,
+            Quaternion::CreateFromAxisAngle(rotationAxis, angle),
+            densityMultiplier
+            });
+
+        simulationData.push_back(
+            {
             Vector3::Zero,
             densityMultiplier * 0.5f,
-            position,
-            1.f,
-            Quaternion::CreateFromAxisAngle(rotationAxis, angle)
+            position
             });
     }
 
@@ -1120,6 +2075,11 @@ void Game::CreateTetrahedronInstances()
     m_tetInstancesUAV = gmm->CreateBufferUAV(device,
         bm->GetInstanceBuffer(m_tetInstances)->Resource.Get(), sizeof(InstanceData));
 
+    m_tetSimulationData = bm->CreateBuffer(device, cq, simulationData);
+    bm->GetInstanceBuffer(m_tetSimulationData)->Resource.Get()->SetName(L"Tetrahedron Simulation Data");
+    m_tetSimulationDataUAV = gmm->CreateBufferUAV(device,
+        bm->GetInstanceBuffer(m_tetSimulationData)->Resource.Get(), sizeof(InstanceSimulationData));
+
 
     // Create keys
     std::vector<float> keys;
@@ -1140,6 +2100,45 @@ void Game::CreateTetrahedronInstances()
     m_tetIndices = bm->CreateBuffer(device, cq, payload);
     bm->GetInstanceBuffer(m_tetIndices)->Resource.Get()->SetName(L"Tetrahedron Indices");
     m_tetIndicesUAV = gmm->CreateBufferUAV(device, bm->GetInstanceBuffer(m_tetIndices)->Resource.Get(), sizeof(float));
+
+    // Sleeping state and the compacted list of awake particles
+    std::vector<ParticleActivity> activity(instances.size());
+
+    m_particleActivity = bm->CreateBuffer(device, cq, activity);
+    bm->GetInstanceBuffer(m_particleActivity)->Resource.Get()->SetName(L"Particle Activity");
+    m_particleActivityUAV = gmm->CreateBufferUAV(device,
+        bm->GetInstanceBuffer(m_particleActivity)->Resource.Get(), sizeof(ParticleActivity));
+
+    m_activeIndices = bm->CreateBuffer(device, cq, payload);
+    bm->GetInstanceBuffer(m_activeIndices)->Resource.Get()->SetName(L"Active Particle Indices");
+    m_activeIndicesUAV = gmm->CreateBufferUAV(device,
+        bm->GetInstanceBuffer(m_activeIndices)->Resource.Get(), sizeof(uint32_t));
+
+    // Active count followed by D3D12_DISPATCH_ARGUMENTS
+    std::vector<uint32_t> activeCount = { 0, 0, 1, 1 };
+
+    m_activeCount = bm->CreateBuffer(device, cq, activeCount);
+    bm->GetInstanceBuffer(m_activeCount)->Resource.Get()->SetName(L"Active Particle Count");
+    m_activeCountUAV = gmm->CreateBufferUAV(device,
+        bm->GetInstanceBuffer(m_activeCount)->Resource.Get(), sizeof(uint32_t));
+
+    m_activeCountReset = bm->CreateBuffer(device, cq, activeCount);
+    bm->GetInstanceBuffer(m_activeCountReset)->Resource.Get()->SetName(L"Active Particle Count Reset");
+
+    // Compressed instances, filled in by EncodeInstances_CS when enabled
+    std::vector<DirectX::XMUINT4> compressedInstances(instances.size());
+    std::vector<DirectX::XMFLOAT4> instanceClusters(
+        Gradient::Math::DivRoundUp(static_cast<uint32_t>(instances.size()), InstanceClusterSize));
+
+    m_compressedInstances = bm->CreateBuffer(device, cq, compressedInstances);
+    bm->GetInstanceBuffer(m_compressedInstances)->Resource.Get()->SetName(L"Compressed Instances");
+    m_compressedInstancesUAV = gmm->CreateBufferUAV(device,
+        bm->GetInstanceBuffer(m_compressedInstances)->Resource.Get(), sizeof(DirectX::XMUINT4));
+
+    m_instanceClusters = bm->CreateBuffer(device, cq, instanceClusters);
+    bm->GetInstanceBuffer(m_instanceClusters)->Resource.Get()->SetName(L"Instance Clusters");
+    m_instanceClustersUAV = gmm->CreateBufferUAV(device,
+        bm->GetInstanceBuffer(m_instanceClusters)->Resource.Get(), sizeof(DirectX::XMFLOAT4));
 }
 
 void Game::CreateErfLookupTexture()
@@ -1197,6 +2196,7 @@ void Game::CleanupResources()
     ThrowIfFfxFailed(ffxParallelSortContextDestroy(&m_parallelSortContext));
 
     Gradient::BufferManager::Shutdown();
+    Gradient::UploadManager::Shutdown();
     Gradient::GraphicsMemoryManager::Shutdown();
 }
 
@@ -7,6 +7,7 @@
 #include "DeviceResources.h"
 #include "StepTimer.h"
 
+#include <chrono>
 #include <memory>
 
 #include <directxtk12/Keyboard.h>
@@ -27,6 +28,9 @@
 #include "Core/VolShadowMap.h"
 #include "Core/ShadowMap.h"
 #include "Core/PropPipeline.h"
+#include "Core/ParticleSnapshot.h"
+#include "Core/PresetBenchmark.h"
+#include "Core/GpuTimer.h"
 
 
 // A basic game implementation that creates a D3D12 device and
@@ -36,7 +40,10 @@ class Game final : public DX::IDeviceNotify
 public:
     const float BrightnessScale = 10.f;
     const int MaxParticles = 65535;
+    // Must match INSTANCE_CLUSTER_SIZE in InstanceCompression.hlsli
+    const uint32_t InstanceClusterSize = 256;
     const int ERF_TEXTURE_WIDTH = 512;
+    const uint32_t MaxSimulationStepsPerFrame = 8;
 
     enum class RenderingMethod : int
     {
@@ -91,19 +98,48 @@ public:
 
         float RenderTargetWidth = 1920.f;
         float RenderTargetHeight = 1080.f;
-        float Padding1 = 0.f;
-        float Padding2 = 0.f;
+        uint32_t VolumetricShadowRepresentation = 0;
+        uint32_t VolumetricShadowFormat = 0;
+
+        float VolumetricShadowTexelSize = 1.f;
+        float VolumetricShadowLodScale = 0.f;
+        uint32_t VolumetricShadowMipCount = 1;
+        uint32_t CompressedInstances = 0;
     };
 
-    struct __declspec(align(16)) InstanceData
+    // Read by every particle pass. Not 16 byte aligned, the structured
+    // buffer stride is the packed 36 bytes.
+    struct InstanceData
     {
         DirectX::XMFLOAT3 Position;
+        float Scale = 1.f;
+        DirectX::XMFLOAT4 RotationQuat;
         float AbsorptionScale;
+    };
+
+    // Only read and written by the simulation
+    struct InstanceSimulationData
+    {
         DirectX::XMFLOAT3 Velocity;
         float Mass;
         DirectX::XMFLOAT3 TargetPosition;
-        float Scale = 1.f;
-        DirectX::XMFLOAT4 RotationQuat;
+    };
+
+    struct ParticleActivity
+    {
+        DirectX::XMFLOAT3 PreviousVelocity = { 0, 0, 0 };
+        uint32_t CalmSteps = 0;
+    };
+
+    struct __declspec(align(16)) ActivityConstants
+    {
+        float VelocityThreshold;
+        float AccelerationThreshold;
+        float WakeRadius;
+        uint32_t SleepSteps;
+
+        uint32_t WakeAll;
+        DirectX::XMFLOAT3 Padding;
     };
 
 
@@ -137,6 +173,17 @@ public:
 
     void CleanupResources();
 
+    // Presets
+    void ApplyPreset(const ISV::ScenePreset& preset);
+    ISV::ScenePreset GetCurrentPreset() const;
+    // Runs every preset in turn and writes per preset frame timings to
+    // resultsPath, then exits
+    void StartBenchmark(std::vector<ISV::ScenePreset> presets, const std::string& resultsPath);
+
+    // Turns on the CPU profiler. The trace is written to path when a
+    // benchmark finishes, or from the Performance window.
+    void StartCpuTrace(const std::string& path);
+
     // Properties
     void GetDefaultSize(int& width, int& height) const noexcept;
 
@@ -155,6 +202,14 @@ private:
     void CreateErfLookupTexture();
 
     void SimulateParticles(ID3D12GraphicsCommandList6* cl, const Constants& constants);
+    void SimulateActiveParticles(ID3D12GraphicsCommandList6* cl, const Constants& constants);
+    uint32_t SimulateParticlesFixedStep(ID3D12GraphicsCommandList6* cl, const Constants& constants);
+    void EncodeInstances(ID3D12GraphicsCommandList6* cl, const Constants& constants);
+    void BeginSnapshotCapture();
+    void CopyInstancesForSnapshot(ID3D12GraphicsCommandList6* cl, const Constants& constants);
+    void WriteSnapshotFrame();
+    void UpdateBenchmark();
+    void WriteCpuTrace();
     void WriteSortingKeys(ID3D12GraphicsCommandList6* cl, const Constants& constants);
     void DispatchParallelSort(ID3D12GraphicsCommandList6* cl,
         Gradient::BufferManager::InstanceBufferEntry* keys,
@@ -186,8 +241,8 @@ private:
     Gradient::BufferManager::MeshHandle m_box;
     Gradient::BufferManager::MeshHandle m_sphere;
 
-    DirectX::XMFLOAT3 m_guiBoxPosition = { -3, 0, 0 };
-    DirectX::XMFLOAT3 m_guiSpherePosition = { 3, 0, 0 };
+    DirectX::XMFLOAT3 m_guiBoxPosition;
+    DirectX::XMFLOAT3 m_guiSpherePosition;
     DirectX::SimpleMath::Matrix m_boxWorld;
     DirectX::SimpleMath::Matrix m_floorWorld;
     DirectX::SimpleMath::Matrix m_sphereWorld;
@@ -198,15 +253,49 @@ private:
     std::unique_ptr<DirectX::ToneMapPostProcess> m_tonemapper;
     std::unique_ptr<DirectX::ToneMapPostProcess> m_tonemapperHDR10;
     Gradient::BufferManager::InstanceBufferHandle m_tetInstances;
+    Gradient::BufferManager::InstanceBufferHandle m_tetSimulationData;
     Gradient::BufferManager::InstanceBufferHandle m_tetKeys;
     Gradient::BufferManager::InstanceBufferHandle m_tetIndices;
     Gradient::GraphicsMemoryManager::DescriptorView m_tetInstancesUAV;
+    Gradient::GraphicsMemoryManager::DescriptorView m_tetSimulationDataUAV;
     Gradient::GraphicsMemoryManager::DescriptorView m_tetKeysUAV;
     Gradient::GraphicsMemoryManager::DescriptorView m_tetIndicesUAV;
 
+    // Particle sleeping
+    Gradient::BufferManager::InstanceBufferHandle m_particleActivity;
+    Gradient::BufferManager::InstanceBufferHandle m_activeIndices;
+    Gradient::BufferManager::InstanceBufferHandle m_activeCount;
+    Gradient::BufferManager::InstanceBufferHandle m_activeCountReset;
+    Gradient::GraphicsMemoryManager::DescriptorView m_particleActivityUAV;
+    Gradient::GraphicsMemoryManager::DescriptorView m_activeIndicesUAV;
+    Gradient::GraphicsMemoryManager::DescriptorView m_activeCountUAV;
+
+    // Compressed copy of m_tetInstances, see InstanceCompression.hlsli
+    Gradient::BufferManager::InstanceBufferHandle m_compressedInstances;
+    Gradient::BufferManager::InstanceBufferHandle m_instanceClusters;
+    Gradient::GraphicsMemoryManager::DescriptorView m_compressedInstancesUAV;
+    Gradient::GraphicsMemoryManager::DescriptorView m_instanceClustersUAV;
+
     std::unique_ptr<ISV::ShadowMap> m_shadowMap;
     std::unique_ptr<ISV::VolShadowMap> m_volShadowMap;
 
+    // Per pass GPU times. Zones named after PresetBenchmark::PassNames
+    // feed the benchmark's pass columns.
+    std::unique_ptr<ISV::GpuTimer> m_gpuTimer;
+
+    // Percentiles shown in the Performance window. Summarising sorts each
+    // history, so it's redone a few times a second rather than every frame.
+    struct GuiZoneSummary
+    {
+        std::string Name;
+        double LastMs = 0.0;
+        ISV::FrameTimeHistogram::Summary Summary;
+    };
+    static constexpr std::chrono::milliseconds GuiSummaryInterval{ 250 };
+    std::chrono::steady_clock::time_point m_guiSummaryTime;
+    ISV::FrameTimeHistogram::Summary m_guiFrameSummary;
+    std::vector<GuiZoneSummary> m_guiZoneSummaries;
+
     Gradient::RootSignature m_particleRS;
     std::unique_ptr<Gradient::PipelineState> m_tetPSO;
 
@@ -217,39 +306,99 @@ private:
     std::unique_ptr<Gradient::PipelineState> m_spherePSO;
     std::unique_ptr<Gradient::PipelineState> m_volShadowSpherePSO;
 
+    // Fourier opacity map PSOs
+    std::unique_ptr<Gradient::PipelineState> m_volShadowFourierPSO;
+    std::unique_ptr<Gradient::PipelineState> m_volShadowSphereFourierPSO;
+
     Gradient::RootSignature m_keyWritingRS;
     Microsoft::WRL::ComPtr<ID3D12PipelineState> m_keyWritingPSO;
 
     Gradient::RootSignature m_simulationRS;
     Microsoft::WRL::ComPtr<ID3D12PipelineState> m_simulationPSO;
 
-
-    DirectX::XMFLOAT3 m_guiAlbedo = { 0.5f, 0.5f, 0.5f };
-    float m_guiExtinction = 20.f;
-
-    DirectX::XMFLOAT3 m_guiLightDirection = { 0, -1, 1 };
-    float m_guiLightBrightness = 2.f;
-
-    DirectX::XMFLOAT3 m_guiLightColor = { 1, 0.8705882353, 0.6078431373 };
-    float m_guiScatteringAsymmetry = 0.4f;
-
-    DirectX::XMFLOAT3 m_guiTargetWorld = { 0, 6, 0 };
-
-    int m_guiParticleCount = 4000;
-    float m_guiScale = 4.4f;
-    float m_guiExtinctionFalloffFactor = 3.f;
-
-    float m_guiAnisotropy = 0.2f;
-    bool m_guiDebugVolShadows = false;
-    bool m_guiSoftShadows = false;
-    bool m_guiSimulationEnabled = true;
+    Gradient::RootSignature m_classifyRS;
+    Microsoft::WRL::ComPtr<ID3D12PipelineState> m_classifyPSO;
+
+    Gradient::RootSignature m_simulationArgsRS;
+    Microsoft::WRL::ComPtr<ID3D12PipelineState> m_simulationArgsPSO;
+
+    Gradient::RootSignature m_activeSimulationRS;
+    Microsoft::WRL::ComPtr<ID3D12PipelineState> m_activeSimulationPSO;
+    Microsoft::WRL::ComPtr<ID3D12CommandSignature> m_dispatchSignature;
+
+    Gradient::RootSignature m_encodeInstancesRS;
+    Microsoft::WRL::ComPtr<ID3D12PipelineState> m_encodeInstancesPSO;
+
+    Gradient::RootSignature m_splatRS;
+    Microsoft::WRL::ComPtr<ID3D12PipelineState> m_splatPSO;
+
+
+    // Scene parameters. Their defaults live in ISV::ScenePreset and are
+    // set by ApplyPreset when the game is constructed.
+    DirectX::XMFLOAT3 m_guiAlbedo;
+    float m_guiExtinction;
+
+    DirectX::XMFLOAT3 m_guiLightDirection;
+    float m_guiLightBrightness;
+
+    DirectX::XMFLOAT3 m_guiLightColor;
+    float m_guiScatteringAsymmetry;
+
+    DirectX::XMFLOAT3 m_guiTargetWorld;
+
+    int m_guiParticleCount;
+    float m_guiScale;
+    bool m_guiCompressedInstances;
+    float m_guiExtinctionFalloffFactor;
+
+    float m_guiAnisotropy;
+    bool m_guiDebugVolShadows;
+    ISV::VolShadowMap::Representation m_guiVolShadowRepresentation;
+    ISV::VolShadowMap::StorageFormat m_guiVolShadowFormat;
+    bool m_guiSplatVolShadows;
+    float m_guiVolShadowLodScale;
+    bool m_guiSoftShadows;
+    bool m_guiSimulationEnabled;
+    bool m_guiFixedTimestep;
+    int m_guiSimulationRate;
+    int m_guiSubsteps;
+    bool m_guiParticleSleeping;
+    float m_guiSleepVelocityThreshold;
+    float m_guiSleepAccelerationThreshold;
+    float m_guiWakeRadius;
+    int m_guiSleepSteps;
+    DirectX::XMFLOAT3 m_sleepingTargetWorld = { 0, 6, 0 };
     
-    RenderingMethod m_guiRenderingMethod = RenderingMethod::SphericalProxy;
-    int m_guiStepCount = 2;
-    float m_guiMultiScatteringFactor = 0.5;
-    float m_guiReflectivity = 0;
-
-    bool m_guiAnimateProps = true;
+    RenderingMethod m_guiRenderingMethod;
+    int m_guiStepCount;
+    float m_guiMultiScatteringFactor;
+    float m_guiReflectivity;
+
+    bool m_guiAnimateProps;
+
+    // Fixed timestep simulation state
+    double m_simulationAccumulator = 0.0;
+    double m_simulationTime = 0.0;
+
+    // Snapshot capture. The instance buffer is copied to a readback
+    // buffer each captured frame and written out once the GPU is done.
+    std::unique_ptr<ISV::ParticleSnapshot::Writer> m_snapshotWriter;
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_snapshotReadback;
+    Constants m_snapshotConstants;
+    uint32_t m_snapshotParticleCount = 0;
+    uint32_t m_snapshotFramesRemaining = 0;
+    bool m_snapshotCopyPending = false;
+    int m_guiSnapshotFrames = 120;
+
+    // Presets and the preset benchmark
+    std::unique_ptr<ISV::PresetBenchmark> m_benchmark;
+    std::string m_benchmarkResultsPath = "benchmark_results.csv";
+    char m_guiPresetPath[260] = "Presets/Default.json";
+    std::string m_presetStatus;
+
+    // CPU profiler trace
+    std::string m_cpuTracePath = "cpu_trace.json";
+    std::string m_cpuTraceStatus;
 
     // Bullet shooting state
     bool m_didShoot = false;
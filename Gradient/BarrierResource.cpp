@@ -46,6 +46,11 @@ namespace Gradient
         SetState(initialResourceState);
     }
 
+    D3D12_RESOURCE_STATES BarrierResource::GetState() const
+    {
+        return m_resourceState;
+    }
+
     void BarrierResource::SetState(D3D12_RESOURCE_STATES newState)
     {
         m_resourceState = newState;
@@ -22,6 +22,7 @@ namespace Gradient
             const D3D12_CLEAR_VALUE* pOptimizedClearValue
         );
 
+        D3D12_RESOURCE_STATES GetState() const;
         void SetState(D3D12_RESOURCE_STATES newState);
         void Transition(ID3D12GraphicsCommandList* cl,
             D3D12_RESOURCE_STATES newState);
@@ -2,6 +2,8 @@
 
 #include "Gradient/BufferManager.h"
 
+#include <algorithm>
+
 namespace Gradient
 {
     std::unique_ptr<BufferManager> BufferManager::s_instance;
@@ -26,9 +28,72 @@ namespace Gradient
         return m_instanceBuffers.Get(handle);
     }
 
+    void BufferManager::RemoveInstanceBuffer(InstanceBufferHandle handle)
+    {
+        auto entry = m_instanceBuffers.Get(handle);
+        if (entry == nullptr)
+            return;
+
+        if (entry->Dynamic == nullptr)
+        {
+            m_instanceBuffers.Remove(handle);
+            return;
+        }
+
+        // Under the lock, so a commit never uses a buffer being removed
+        std::lock_guard lock(m_dynamicMutex);
+
+        auto found = std::find(m_dynamicBuffers.begin(), m_dynamicBuffers.end(), handle);
+        if (found != m_dynamicBuffers.end())
+        {
+            m_dynamicBuffers.erase(found);
+        }
+
+        m_instanceBuffers.Remove(handle);
+    }
+
+    void BufferManager::CommitDynamicBuffers(ID3D12GraphicsCommandList* cl)
+    {
+        std::lock_guard lock(m_dynamicMutex);
+
+        if (m_dynamicBuffers.empty())
+            return;
+
+        // The slot this frame writes was last used SlotCount frames ago
+        const uint64_t frame = ++m_dynamicFrame;
+        if (frame > DynamicInstanceBuffer::SlotCount)
+        {
+            const uint64_t reused = frame - DynamicInstanceBuffer::SlotCount;
+            if (m_dynamicFence->GetCompletedValue() < reused)
+            {
+                DX::ThrowIfFailed(m_dynamicFence->SetEventOnCompletion(reused, nullptr));
+            }
+        }
+
+        const auto slot = static_cast<uint32_t>(frame % DynamicInstanceBuffer::SlotCount);
+
+        for (auto handle : m_dynamicBuffers)
+        {
+            if (auto entry = m_instanceBuffers.Get(handle))
+            {
+                entry->Dynamic->Commit(cl, entry->Resource, slot);
+            }
+        }
+    }
+
+    void BufferManager::SignalDynamicBuffers(ID3D12CommandQueue* cq)
+    {
+        std::lock_guard lock(m_dynamicMutex);
+
+        if (m_dynamicFence != nullptr && m_dynamicFrame > 0)
+        {
+            DX::ThrowIfFailed(cq->Signal(m_dynamicFence.Get(), m_dynamicFrame));
+        }
+    }
+
     BufferManager::MeshHandle BufferManager::AddMesh(Rendering::ProceduralMesh&& mesh)
     {
-        return m_meshes.Allocate(mesh);
+        return m_meshes.Allocate(std::move(mesh));
     }
 
     void BufferManager::RemoveMesh(MeshHandle handle)
@@ -47,11 +112,12 @@ namespace Gradient
         ID3D12Device* device,
         ID3D12CommandQueue* cq,
         const Rendering::ProceduralMesh::VertexCollection& vertices,
-        const Rendering::ProceduralMesh::IndexCollection& indices
+        const Rendering::ProceduralMesh::IndexCollection& indices,
+        const Rendering::MeshOptimizationOptions& options
     )
     {
         return AddMesh(Rendering::ProceduralMesh::CreateFromVertices(
-            device, cq, vertices, indices
+            device, cq, vertices, indices, options
         ));
     }
 
@@ -60,10 +126,11 @@ namespace Gradient
         ID3D12CommandQueue* cq,
         const DirectX::XMFLOAT3& size,
         bool rhcoords,
-        bool invertn)
+        bool invertn,
+        const Rendering::MeshOptimizationOptions& options)
     {
         return AddMesh(Rendering::ProceduralMesh::CreateBox(
-            device, cq, size, rhcoords, invertn
+            device, cq, size, rhcoords, invertn, options
         ));
     }
 
@@ -73,10 +140,11 @@ namespace Gradient
         float diameter,
         size_t tessellation,
         bool rhcoords,
-        bool invertn)
+        bool invertn,
+        const Rendering::MeshOptimizationOptions& options)
     {
         return AddMesh(Rendering::ProceduralMesh::CreateSphere(
-            device, cq, diameter, tessellation, rhcoords, invertn
+            device, cq, diameter, tessellation, rhcoords, invertn, options
         ));
     }
 
@@ -85,10 +153,11 @@ namespace Gradient
         ID3D12CommandQueue* cq,
         float diameter,
         size_t tessellation,
-        bool rhcoords)
+        bool rhcoords,
+        const Rendering::MeshOptimizationOptions& options)
     {
         return AddMesh(Rendering::ProceduralMesh::CreateGeoSphere(
-            device, cq, diameter, tessellation, rhcoords
+            device, cq, diameter, tessellation, rhcoords, options
         ));
     }
 
@@ -98,10 +167,11 @@ namespace Gradient
         const float& width,
         const float& height,
         const float& divisions,
-        bool tiled)
+        bool tiled,
+        const Rendering::MeshOptimizationOptions& options)
     {
         return AddMesh(Rendering::ProceduralMesh::CreateGrid(
-            device, cq, width, height, divisions, tiled
+            device, cq, width, height, divisions, tiled, options
         ));
     }
 
@@ -109,10 +179,11 @@ namespace Gradient
         ID3D12Device* device,
         ID3D12CommandQueue* cq,
         const float& width,
-        const float& height)
+        const float& height,
+        const Rendering::MeshOptimizationOptions& options)
     {
         return AddMesh(Rendering::ProceduralMesh::CreateBillboard(
-            device, cq, width, height
+            device, cq, width, height, options
         ));
     }
 
@@ -121,10 +192,11 @@ namespace Gradient
         ID3D12CommandQueue* cq,
         const float& topRadius,
         const float& bottomRadius,
-        const float& height)
+        const float& height,
+        const Rendering::MeshOptimizationOptions& options)
     {
         return AddMesh(Rendering::ProceduralMesh::CreateFrustum(
-            device, cq, topRadius, bottomRadius, height
+            device, cq, topRadius, bottomRadius, height, options
         ));
     }
 
@@ -134,10 +206,11 @@ namespace Gradient
         const float& bottomRadius,
         const float& topRadius,
         const DirectX::SimpleMath::Vector3& topCentre,
-        const DirectX::SimpleMath::Quaternion& topRotation)
+        const DirectX::SimpleMath::Quaternion& topRotation,
+        const Rendering::MeshOptimizationOptions& options)
     {
         return AddMesh(Rendering::ProceduralMesh::CreateAngledFrustum(
-            device, cq, bottomRadius, topRadius, topCentre, topRotation
+            device, cq, bottomRadius, topRadius, topCentre, topRotation, options
         ));
     }
 
@@ -145,11 +218,10 @@ namespace Gradient
         ID3D12Device* device,
         ID3D12CommandQueue* cq,
         const Rendering::ProceduralMesh::MeshPart& part,
-        float simplificationRate,
-        float errorRate)
+        const Rendering::MeshOptimizationOptions& options)
     {
         return AddMesh(Rendering::ProceduralMesh::CreateFromPart(
-            device, cq, part, simplificationRate, errorRate
+            device, cq, part, options
         ));
     }
 
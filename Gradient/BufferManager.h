@@ -2,17 +2,19 @@
 
 #include "pch.h"
 
-#include <directxtk12/BufferHelpers.h>
-#include <directxtk12/ResourceUploadBatch.h>
-
 #include "Gradient/BarrierResource.h"
-#include "Gradient/FreeListAllocator.h"
+#include "Gradient/ConcurrentFreeListAllocator.h"
+#include "Gradient/DynamicInstanceBuffer.h"
 #include "Gradient/Rendering/ProceduralMesh.h"
+#include "Gradient/UploadManager.h"
 
+#include <mutex>
 #include <optional>
 
 namespace Gradient
 {
+    // Meshes and instance buffers can be created, fetched and removed from
+    // any thread, e.g. while loading assets on worker threads.
     class BufferManager
     {
     public:
@@ -20,12 +22,16 @@ namespace Gradient
         {
             BarrierResource Resource;
             uint32_t InstanceCount;
+            // When the initial data has been copied in
+            UploadTicket Upload;
+            // Only for buffers made with CreateDynamicBuffer
+            std::unique_ptr<DynamicInstanceBuffer> Dynamic;
         };
 
-        using InstanceBufferList = FreeListAllocator<InstanceBufferEntry>;
+        using InstanceBufferList = ConcurrentFreeListAllocator<InstanceBufferEntry>;
         using InstanceBufferHandle = InstanceBufferList::Handle;
 
-        using MeshList = FreeListAllocator<Rendering::ProceduralMesh>;
+        using MeshList = ConcurrentFreeListAllocator<Rendering::ProceduralMesh>;
         using MeshHandle = MeshList::Handle;
 
         static void Initialize();
@@ -37,6 +43,27 @@ namespace Gradient
             ID3D12CommandQueue* cq,
             const std::vector<T>& instanceData);
         InstanceBufferEntry* GetInstanceBuffer(InstanceBufferHandle handle);
+        // The GPU must be done with the buffer. Dynamic buffers stop being
+        // committed.
+        void RemoveInstanceBuffer(InstanceBufferHandle handle);
+
+        // An instance buffer the CPU can update every frame. The GPU must
+        // not write to it; see DynamicInstanceBuffer.
+        template <typename T>
+        InstanceBufferHandle CreateDynamicBuffer(ID3D12Device* device,
+            ID3D12CommandQueue* cq,
+            const std::vector<T>& instanceData);
+        // Reaches the GPU with the next CommitDynamicBuffers
+        template <typename T>
+        void UpdateInstances(InstanceBufferHandle handle,
+            uint32_t first,
+            const T* instances,
+            uint32_t count);
+        // Records the copies for every dynamic buffer updated since the
+        // last frame. Call once per frame, before the buffers are used.
+        void CommitDynamicBuffers(ID3D12GraphicsCommandList* cl);
+        // Call once the frame's command list has been executed
+        void SignalDynamicBuffers(ID3D12CommandQueue* cq);
 
         MeshHandle AddMesh(Rendering::ProceduralMesh&& mesh);
         void RemoveMesh(MeshHandle handle);
@@ -48,7 +75,8 @@ namespace Gradient
             ID3D12Device* device,
             ID3D12CommandQueue* cq,
             const Rendering::ProceduralMesh::VertexCollection& vertices,
-            const Rendering::ProceduralMesh::IndexCollection& indices
+            const Rendering::ProceduralMesh::IndexCollection& indices,
+            const Rendering::MeshOptimizationOptions& options = {}
         );
 
         MeshHandle CreateBox(
@@ -56,7 +84,8 @@ namespace Gradient
             ID3D12CommandQueue* cq,
             const DirectX::XMFLOAT3& size,
             bool rhcoords = true,
-            bool invertn = false);
+            bool invertn = false,
+            const Rendering::MeshOptimizationOptions& options = {});
 
         MeshHandle CreateSphere(
             ID3D12Device* device,
@@ -64,14 +93,16 @@ namespace Gradient
             float diameter = 1,
             size_t tessellation = 16,
             bool rhcoords = true,
-            bool invertn = false);
+            bool invertn = false,
+            const Rendering::MeshOptimizationOptions& options = {});
 
         MeshHandle CreateGeoSphere(
             ID3D12Device* device,
             ID3D12CommandQueue* cq,
             float diameter = 1,
             size_t tessellation = 3,
-            bool rhcoords = true);
+            bool rhcoords = true,
+            const Rendering::MeshOptimizationOptions& options = {});
 
         MeshHandle CreateGrid(
             ID3D12Device* device,
@@ -79,20 +110,23 @@ namespace Gradient
             const float& width = 10,
             const float& height = 10,
             const float& divisions = 10,
-            bool tiled = true);
+            bool tiled = true,
+            const Rendering::MeshOptimizationOptions& options = {});
 
         MeshHandle CreateBillboard(
             ID3D12Device* device,
             ID3D12CommandQueue* cq,
             const float& width = 1,
-            const float& height = 1);
+            const float& height = 1,
+            const Rendering::MeshOptimizationOptions& options = {});
 
         MeshHandle CreateFrustum(
             ID3D12Device* device,
             ID3D12CommandQueue* cq,
             const float& topRadius = 1,
             const float& bottomRadius = 1,
-            const float& height = 3);
+            const float& height = 3,
+            const Rendering::MeshOptimizationOptions& options = {});
 
         MeshHandle CreateAngledFrustum(
             ID3D12Device* device,
@@ -100,14 +134,14 @@ namespace Gradient
             const float& bottomRadius = 1,
             const float& topRadius = 1,
             const DirectX::SimpleMath::Vector3& topCentre = { 0, 3, 0 },
-            const DirectX::SimpleMath::Quaternion& topRotation = DirectX::SimpleMath::Quaternion::Identity);
+            const DirectX::SimpleMath::Quaternion& topRotation = DirectX::SimpleMath::Quaternion::Identity,
+            const Rendering::MeshOptimizationOptions& options = {});
 
         MeshHandle CreateFromPart(
             ID3D12Device* device,
             ID3D12CommandQueue* cq,
             const Rendering::ProceduralMesh::MeshPart& part,
-            float simplificationRate = 0.f,
-            float errorRate = 0.1f
+            const Rendering::MeshOptimizationOptions& options = {}
         );
 
 #pragma endregion
@@ -117,6 +151,13 @@ namespace Gradient
 
         InstanceBufferList m_instanceBuffers;
         MeshList m_meshes;
+
+        // Dynamic buffers share a frame count and fence, which says when a
+        // frame's staging slot can be written again
+        std::mutex m_dynamicMutex;
+        std::vector<InstanceBufferHandle> m_dynamicBuffers;
+        Microsoft::WRL::ComPtr<ID3D12Fence> m_dynamicFence;
+        uint64_t m_dynamicFrame = 0;
     };
 
     template <typename T>
@@ -127,28 +168,68 @@ namespace Gradient
     {
         auto handle = m_instanceBuffers.Allocate({
             BarrierResource(),
-            static_cast<uint32_t>(instanceData.size())
+            static_cast<uint32_t>(instanceData.size()),
+            {},
+            nullptr
             });
 
         auto entry = m_instanceBuffers.Get(handle);
 
-        DirectX::ResourceUploadBatch uploadBatch(device);
+        entry->Upload = UploadManager::Get()->CreateStaticBuffer(device,
+            cq,
+            instanceData.data(),
+            instanceData.size() * sizeof(T),
+            D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE,
+            entry->Resource.ReleaseAndGetAddressOf(),
+            D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        entry->Resource.SetState(D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
 
-        uploadBatch.Begin();
+        return handle;
+    }
 
-        DX::ThrowIfFailed(
-            DirectX::CreateStaticBuffer(device,
-                uploadBatch,
-                instanceData.data(),
-                instanceData.size(),
-                D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE,
-                entry->Resource.ReleaseAndGetAddressOf(),
-                D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS));
-        entry->Resource.SetState(D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE);
+    template <typename T>
+    BufferManager::InstanceBufferHandle BufferManager::CreateDynamicBuffer(
+        ID3D12Device* device,
+        ID3D12CommandQueue* cq,
+        const std::vector<T>& instanceData)
+    {
+        auto handle = CreateBuffer(device, cq, instanceData);
 
-        auto uploadFinished = uploadBatch.End(cq);
-        uploadFinished.wait();
+        m_instanceBuffers.Get(handle)->Dynamic = std::make_unique<DynamicInstanceBuffer>(device,
+            static_cast<uint32_t>(sizeof(T)),
+            static_cast<uint32_t>(instanceData.size()),
+            instanceData.data());
 
+        std::lock_guard lock(m_dynamicMutex);
+
+        if (m_dynamicFence == nullptr)
+        {
+            DX::ThrowIfFailed(
+                device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(m_dynamicFence.ReleaseAndGetAddressOf())));
+            m_dynamicFence->SetName(L"Dynamic Instance Fence");
+        }
+
+        m_dynamicBuffers.push_back(handle);
         return handle;
     }
-}
\ No newline at end of file
+
+    template <typename T>
+    void BufferManager::UpdateInstances(InstanceBufferHandle handle,
+        uint32_t first,
+        const T* instances,
+        uint32_t count)
+    {
+        auto entry = m_instanceBuffers.Get(handle);
+        if (entry == nullptr || entry->Dynamic == nullptr)
+        {
+            throw std::runtime_error("UpdateInstances needs a dynamic instance buffer");
+        }
+
+        if (entry->Dynamic->GetElementSize() != sizeof(T))
+        {
+            throw std::runtime_error("UpdateInstances element size doesn't match the buffer's");
+        }
+
+        entry->Dynamic->Update(first, instances, count);
+    }
+}
@@ -69,6 +69,12 @@ namespace Gradient
         m_position = pos;
     }
 
+    void Camera::SetDirection(Vector3 const& direction)
+    {
+        m_direction = direction;
+        m_direction.Normalize();
+    }
+
     void Camera::RotateYawPitch(float yaw, float pitch)
     {
         const auto maxPitchCosine = 0.99f;
@@ -49,6 +49,7 @@ namespace Gradient
         void SetFieldOfView(float const& fovRadians);
         void SetAspectRatio(float const& aspectRatio);
         void SetPosition(DirectX::SimpleMath::Vector3 const&);
+        void SetDirection(DirectX::SimpleMath::Vector3 const&);
         void RotateYawPitch(float yaw, float pitch);
         DirectX::SimpleMath::Vector3 GetPosition() const;
         DirectX::SimpleMath::Vector3 GetDirection() const;
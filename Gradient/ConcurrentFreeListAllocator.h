@@ -0,0 +1,338 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#include "Gradient/FreeSlotStack.h"
+
+namespace Gradient
+{
+    // A FreeListAllocator that any number of threads can allocate from,
+    // remove from and read at once, so assets can be loaded on worker
+    // threads.
+    //
+    // Elements live in fixed size blocks that are allocated on demand and
+    // never move, so pointers from Get stay valid until the element is
+    // removed. Freed slots go on a FreeSlotStack whose links live in the
+    // slots themselves, so it grows with the blocks.
+    //
+    // A slot's generation is odd while it holds an element and even while
+    // it is free. Get is wait-free: it checks the handle's generation
+    // against the slot's and returns the element. Remove only succeeds
+    // for the thread that moves the generation on, so removing a handle
+    // twice, even from two threads, frees it once. Reading an element
+    // while another thread removes it is up to the caller to prevent,
+    // as with any container.
+    //
+    // There is no dense array to iterate, as FreeListAllocator has, because
+    // elements can't move while other threads hold pointers to them.
+    // ForEach scans the slots instead, skipping blocks with nothing live in
+    // them, so it costs a pass over every slot of the occupied blocks.
+    // Elements allocated while it runs may or may not be visited.
+    template <typename T, uint32_t BlockSize = 256, uint32_t MaxBlocks = 4096>
+    class ConcurrentFreeListAllocator
+    {
+    public:
+        struct Handle
+        {
+            static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+            uint32_t Index = InvalidIndex;
+            uint32_t Generation = 0;
+
+            bool operator==(const Handle& other) const
+            {
+                return Index == other.Index && Generation == other.Generation;
+            }
+
+            bool operator!=(const Handle& other) const
+            {
+                return !(*this == other);
+            }
+        };
+
+        static constexpr uint32_t Capacity = BlockSize * MaxBlocks;
+
+        ConcurrentFreeListAllocator();
+        ~ConcurrentFreeListAllocator();
+
+        ConcurrentFreeListAllocator(const ConcurrentFreeListAllocator&) = delete;
+        ConcurrentFreeListAllocator& operator=(const ConcurrentFreeListAllocator&) = delete;
+
+        // Throws std::runtime_error once Capacity elements are live
+        Handle Allocate(const T& in);
+        Handle Allocate(T&& in);
+        // Does nothing for handles that are already invalid
+        void Remove(Handle handle);
+
+        bool IsValid(Handle handle) const;
+
+        // nullptr for invalid handles
+        T* Get(Handle handle);
+        const T* Get(Handle handle) const;
+
+        // Approximate while other threads are allocating or removing
+        std::size_t Size() const;
+
+        // Calls fn(element) for every live element, in slot order
+        template <typename Fn>
+        void ForEach(Fn&& fn);
+        template <typename Fn>
+        void ForEach(Fn&& fn) const;
+
+    private:
+        struct Slot
+        {
+            std::atomic<uint32_t> Generation{ 0 };
+            std::atomic<uint32_t> NextFree{ Handle::InvalidIndex };
+            alignas(T) unsigned char Storage[sizeof(T)];
+
+            T* GetElement()
+            {
+                return std::launder(reinterpret_cast<T*>(Storage));
+            }
+        };
+
+        struct Block
+        {
+            std::atomic<uint32_t> LiveCount{ 0 };
+            Slot Slots[BlockSize];
+        };
+
+        // Finds a free slot's link in its block
+        struct SlotLinks
+        {
+            ConcurrentFreeListAllocator* Owner;
+
+            std::atomic<uint32_t>& operator[](uint32_t index) const
+            {
+                return Owner->GetSlot(index)->NextFree;
+            }
+        };
+
+        template <typename U>
+        Handle Emplace(U&& in);
+
+        Block* GetBlock(uint32_t index) const;
+        Slot* GetSlot(uint32_t index) const;
+        Slot& GetOrCreateSlot(uint32_t index);
+
+        std::unique_ptr<std::atomic<Block*>[]> m_blocks;
+        BasicFreeSlotStack<SlotLinks> m_freeSlots;
+        std::atomic<uint32_t> m_slotCount{ 0 };
+        std::atomic<int64_t> m_size{ 0 };
+    };
+
+    template <typename T, uint32_t BlockSize, uint32_t MaxBlocks>
+    ConcurrentFreeListAllocator<T, BlockSize, MaxBlocks>::ConcurrentFreeListAllocator()
+        : m_blocks(std::make_unique<std::atomic<Block*>[]>(MaxBlocks)),
+        m_freeSlots(SlotLinks{ this })
+    {
+        for (uint32_t i = 0; i < MaxBlocks; i++)
+        {
+            m_blocks[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    template <typename T, uint32_t BlockSize, uint32_t MaxBlocks>
+    ConcurrentFreeListAllocator<T, BlockSize, MaxBlocks>::~ConcurrentFreeListAllocator()
+    {
+        for (uint32_t i = 0; i < MaxBlocks; i++)
+        {
+            Block* block = m_blocks[i].load(std::memory_order_acquire);
+            if (block == nullptr)
+                continue;
+
+            for (auto& slot : block->Slots)
+            {
+                if (slot.Generation.load(std::memory_order_relaxed) & 1)
+                {
+                    slot.GetElement()->~T();
+                }
+            }
+
+            delete block;
+        }
+    }
+
+    template <typename T, uint32_t BlockSize, uint32_t MaxBlocks>
+    typename ConcurrentFreeListAllocator<T, BlockSize, MaxBlocks>::Handle
+        ConcurrentFreeListAllocator<T, BlockSize, MaxBlocks>::Allocate(const T& in)
+    {
+        return Emplace(in);
+    }
+
+    template <typename T, uint32_t BlockSize, uint32_t MaxBlocks>
+    typename ConcurrentFreeListAllocator<T, BlockSize, MaxBlocks>::Handle
+        ConcurrentFreeListAllocator<T, BlockSize, MaxBlocks>::Allocate(T&& in)
+    {
+        return Emplace(std::move(in));
+    }
+
+    template <typename T, uint32_t BlockSize, uint32_t MaxBlocks>
+    template <typename U>
+    typename ConcurrentFreeListAllocator<T, BlockSize, MaxBlocks>::Handle
+        ConcurrentFreeListAllocator<T, BlockSize, MaxBlocks>::Emplace(U&& in)
+    {
+        uint32_t index = m_freeSlots.Pop();
+        if (index == Handle::InvalidIndex)
+        {
+            index = m_slotCount.fetch_add(1, std::memory_order_relaxed);
+            if (index >= Capacity)
+            {
+                m_slotCount.fetch_sub(1, std::memory_order_relaxed);
+                throw std::runtime_error("ConcurrentFreeListAllocator is full");
+            }
+        }
+
+        Slot& slot = GetOrCreateSlot(index);
+
+        try
+        {
+            new (slot.Storage) T(std::forward<U>(in));
+        }
+        catch (...)
+        {
+            m_freeSlots.Push(index);
+            throw;
+        }
+
+        // Publishes the element to Get
+        const uint32_t generation = slot.Generation.load(std::memory_order_relaxed) + 1;
+        slot.Generation.store(generation, std::memory_order_release);
+        GetBlock(index)->LiveCount.fetch_add(1, std::memory_order_release);
+        m_size.fetch_add(1, std::memory_order_relaxed);
+
+        return { index, generation };
+    }
+
+    template <typename T, uint32_t BlockSize, uint32_t MaxBlocks>
+    void ConcurrentFreeListAllocator<T, BlockSize, MaxBlocks>::Remove(Handle handle)
+    {
+        if ((handle.Generation & 1) == 0)
+            return;
+
+        Slot* slot = GetSlot(handle.Index);
+        if (slot == nullptr)
+            return;
+
+        // Only one thread can move the generation on
+        uint32_t expected = handle.Generation;
+        if (!slot->Generation.compare_exchange_strong(expected, handle.Generation + 1,
+            std::memory_order_acq_rel, std::memory_order_relaxed))
+        {
+            return;
+        }
+
+        slot->GetElement()->~T();
+        GetBlock(handle.Index)->LiveCount.fetch_sub(1, std::memory_order_relaxed);
+        m_size.fetch_sub(1, std::memory_order_relaxed);
+        m_freeSlots.Push(handle.Index);
+    }
+
+    template <typename T, uint32_t BlockSize, uint32_t MaxBlocks>
+    bool ConcurrentFreeListAllocator<T, BlockSize, MaxBlocks>::IsValid(Handle handle) const
+    {
+        const Slot* slot = GetSlot(handle.Index);
+        return slot != nullptr
+            && (handle.Generation & 1) != 0
+            && slot->Generation.load(std::memory_order_acquire) == handle.Generation;
+    }
+
+    template <typename T, uint32_t BlockSize, uint32_t MaxBlocks>
+    T* ConcurrentFreeListAllocator<T, BlockSize, MaxBlocks>::Get(Handle handle)
+    {
+        return IsValid(handle) ? GetSlot(handle.Index)->GetElement() : nullptr;
+    }
+
+    template <typename T, uint32_t BlockSize, uint32_t MaxBlocks>
+    const T* ConcurrentFreeListAllocator<T, BlockSize, MaxBlocks>::Get(Handle handle) const
+    {
+        return IsValid(handle) ? GetSlot(handle.Index)->GetElement() : nullptr;
+    }
+
+    template <typename T, uint32_t BlockSize, uint32_t MaxBlocks>
+    std::size_t ConcurrentFreeListAllocator<T, BlockSize, MaxBlocks>::Size() const
+    {
+        const int64_t size = m_size.load(std::memory_order_relaxed);
+        return size > 0 ? static_cast<std::size_t>(size) : 0;
+    }
+
+    template <typename T, uint32_t BlockSize, uint32_t MaxBlocks>
+    template <typename Fn>
+    void ConcurrentFreeListAllocator<T, BlockSize, MaxBlocks>::ForEach(Fn&& fn)
+    {
+        const uint32_t slotCount = std::min(m_slotCount.load(std::memory_order_acquire), Capacity);
+        const uint32_t blockCount = (slotCount + BlockSize - 1) / BlockSize;
+
+        for (uint32_t b = 0; b < blockCount; b++)
+        {
+            Block* block = m_blocks[b].load(std::memory_order_acquire);
+            if (block == nullptr || block->LiveCount.load(std::memory_order_acquire) == 0)
+                continue;
+
+            for (auto& slot : block->Slots)
+            {
+                if (slot.Generation.load(std::memory_order_acquire) & 1)
+                {
+                    fn(*slot.GetElement());
+                }
+            }
+        }
+    }
+
+    template <typename T, uint32_t BlockSize, uint32_t MaxBlocks>
+    template <typename Fn>
+    void ConcurrentFreeListAllocator<T, BlockSize, MaxBlocks>::ForEach(Fn&& fn) const
+    {
+        const_cast<ConcurrentFreeListAllocator*>(this)->ForEach([&fn](const T& element)
+            {
+                fn(element);
+            });
+    }
+
+    template <typename T, uint32_t BlockSize, uint32_t MaxBlocks>
+    typename ConcurrentFreeListAllocator<T, BlockSize, MaxBlocks>::Block*
+        ConcurrentFreeListAllocator<T, BlockSize, MaxBlocks>::GetBlock(uint32_t index) const
+    {
+        if (index >= Capacity)
+            return nullptr;
+
+        return m_blocks[index / BlockSize].load(std::memory_order_acquire);
+    }
+
+    template <typename T, uint32_t BlockSize, uint32_t MaxBlocks>
+    typename ConcurrentFreeListAllocator<T, BlockSize, MaxBlocks>::Slot*
+        ConcurrentFreeListAllocator<T, BlockSize, MaxBlocks>::GetSlot(uint32_t index) const
+    {
+        Block* block = GetBlock(index);
+        return block != nullptr ? &block->Slots[index % BlockSize] : nullptr;
+    }
+
+    template <typename T, uint32_t BlockSize, uint32_t MaxBlocks>
+    typename ConcurrentFreeListAllocator<T, BlockSize, MaxBlocks>::Slot&
+        ConcurrentFreeListAllocator<T, BlockSize, MaxBlocks>::GetOrCreateSlot(uint32_t index)
+    {
+        auto& blockPointer = m_blocks[index / BlockSize];
+        Block* block = blockPointer.load(std::memory_order_acquire);
+
+        if (block == nullptr)
+        {
+            // Threads that race to create the same block keep the first one
+            auto created = std::make_unique<Block>();
+            if (blockPointer.compare_exchange_strong(block, created.get(),
+                std::memory_order_acq_rel, std::memory_order_acquire))
+            {
+                block = created.release();
+            }
+        }
+
+        return block->Slots[index % BlockSize];
+    }
+}
@@ -0,0 +1,439 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Gradient
+{
+    // Hands out indices into a fixed size descriptor heap, lowest free
+    // index first, from a hierarchy of bitmaps. The bottom level has a bit
+    // per index, set while the index is free; every level above has a bit
+    // per word of the level below, set while that word has a free bit. A
+    // single allocation walks down from the top with find-first-set, so it
+    // costs one word per level, and freeing sets a bit per level. Ranges
+    // are marked and freed a word at a time.
+    //
+    // Contiguous ranges, for descriptor tables, are found by scanning the
+    // bottom level a word at a time, first fit. The scan uses the level
+    // above to jump over words with nothing free, and keeps a count of
+    // entirely free words per group of 64 words: a group that is entirely
+    // free extends a run by 4096 indices in one step, and runs long enough
+    // that they must cover a whole free word skip groups that have none.
+    class DescriptorIndexAllocator
+    {
+    public:
+        static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+        explicit DescriptorIndexAllocator(uint32_t capacity);
+
+        // InvalidIndex when every index is taken
+        uint32_t Allocate();
+        // The first of count free indices in a row, InvalidIndex if there
+        // is no such run
+        uint32_t AllocateRange(uint32_t count);
+
+        // Freeing an index that isn't allocated does nothing
+        void Free(uint32_t index);
+        void FreeRange(uint32_t first, uint32_t count);
+
+        bool IsAllocated(uint32_t index) const;
+        uint32_t GetCapacity() const;
+        uint32_t GetFreeCount() const;
+
+    private:
+        static constexpr uint32_t WordBits = 64;
+
+        bool IsFree(uint32_t index) const;
+        void MarkAllocated(uint32_t index);
+        void MarkFree(uint32_t index);
+        // A word at a time. Allocating expects every index in the range
+        // to be free.
+        void MarkRange(uint32_t first, uint32_t count, bool free);
+        // Keeps the whole free word counts and the levels above in step
+        // with a bottom level word. Callers keep the free count.
+        void SetBottomWord(uint32_t w, uint64_t value);
+
+        // The first bit set at or after position on a level, InvalidIndex
+        // if there is none
+        uint32_t FindNextSet(std::size_t level, uint32_t position) const;
+        // The first bottom level word at or after word with a free bit
+        uint32_t FindFreeWord(uint32_t word) const;
+
+        uint32_t m_capacity;
+        uint32_t m_freeCount;
+        // m_levels[0] is the bottom level
+        std::vector<std::vector<uint64_t>> m_levels;
+        // Entirely free bottom level words per group of WordBits words
+        std::vector<uint32_t> m_wholeFreeWords;
+    };
+
+    inline DescriptorIndexAllocator::DescriptorIndexAllocator(uint32_t capacity)
+        : m_capacity(capacity),
+        m_freeCount(capacity)
+    {
+        // Every index starts free; bits past the capacity stay clear so
+        // they are never found
+        uint32_t bits = capacity;
+        do
+        {
+            const uint32_t words = (bits + WordBits - 1) / WordBits;
+            std::vector<uint64_t> level(std::max(words, 1u), 0);
+
+            for (uint32_t i = 0; i < bits; i++)
+            {
+                level[i / WordBits] |= uint64_t(1) << (i % WordBits);
+            }
+
+            m_levels.push_back(std::move(level));
+            bits = words;
+        } while (bits > 1);
+
+        const auto& bottom = m_levels[0];
+        m_wholeFreeWords.resize((bottom.size() + WordBits - 1) / WordBits, 0);
+        for (std::size_t w = 0; w < bottom.size(); w++)
+        {
+            if (bottom[w] == ~uint64_t(0))
+            {
+                m_wholeFreeWords[w / WordBits]++;
+            }
+        }
+    }
+
+    inline uint32_t DescriptorIndexAllocator::Allocate()
+    {
+        if (m_freeCount == 0)
+        {
+            return InvalidIndex;
+        }
+
+        uint32_t word = 0;
+        for (auto level = m_levels.size(); level-- > 0;)
+        {
+            word = word * WordBits + std::countr_zero(m_levels[level][word]);
+        }
+
+        MarkAllocated(word);
+        return word;
+    }
+
+    inline uint32_t DescriptorIndexAllocator::AllocateRange(uint32_t count)
+    {
+        if (count == 0 || count > m_freeCount)
+        {
+            return InvalidIndex;
+        }
+
+        if (count == 1)
+        {
+            return Allocate();
+        }
+
+        const auto& bottom = m_levels[0];
+        const auto words = static_cast<uint32_t>(bottom.size());
+
+        // A run this long covers at least one whole word, so it starts in
+        // a whole free word or in the word before one
+        const bool needsWholeWord = count >= 2 * WordBits - 1;
+
+        uint32_t runStart = 0;
+        uint32_t runLength = 0;
+        uint32_t w = 0;
+
+        while (w < words)
+        {
+            if (runLength == 0)
+            {
+                // Jump over words with nothing free
+                if (bottom[w] == 0)
+                {
+                    w = FindFreeWord(w);
+                    if (w == InvalidIndex)
+                        break;
+                }
+
+                // Skip to the last word of a group with no whole free word
+                if (needsWholeWord
+                    && m_wholeFreeWords[w / WordBits] == 0
+                    && w % WordBits != WordBits - 1)
+                {
+                    w = w / WordBits * WordBits + WordBits - 1;
+                    continue;
+                }
+            }
+
+            if (w % WordBits == 0 && m_wholeFreeWords[w / WordBits] == WordBits)
+            {
+                // The whole group extends the run
+                if (runLength == 0)
+                {
+                    runStart = w * WordBits;
+                }
+                runLength += WordBits * WordBits;
+                w += WordBits;
+            }
+            else
+            {
+                const uint64_t free = bottom[w];
+
+                if (free == ~uint64_t(0))
+                {
+                    // The whole word extends the run
+                    if (runLength == 0)
+                    {
+                        runStart = w * WordBits;
+                    }
+                    runLength += WordBits;
+                }
+                else if (free == 0)
+                {
+                    runLength = 0;
+                }
+                else
+                {
+                    // Step over whole runs of free and taken bits
+                    uint32_t bit = 0;
+                    while (bit < WordBits)
+                    {
+                        const uint64_t rest = free >> bit;
+                        if (rest == 0)
+                        {
+                            runLength = 0;
+                            break;
+                        }
+
+                        if (rest & 1)
+                        {
+                            const auto ones = static_cast<uint32_t>(std::countr_one(rest));
+                            if (runLength == 0)
+                            {
+                                runStart = w * WordBits + bit;
+                            }
+                            runLength += ones;
+                            bit += ones;
+
+                            if (runLength >= count)
+                                break;
+                        }
+                        else
+                        {
+                            runLength = 0;
+                            bit += static_cast<uint32_t>(std::countr_zero(rest));
+                        }
+                    }
+                }
+
+                w++;
+            }
+
+            if (runLength >= count)
+            {
+                MarkRange(runStart, count, false);
+                return runStart;
+            }
+        }
+
+        return InvalidIndex;
+    }
+
+    inline void DescriptorIndexAllocator::Free(uint32_t index)
+    {
+        if (IsAllocated(index))
+        {
+            MarkFree(index);
+        }
+    }
+
+    inline void DescriptorIndexAllocator::FreeRange(uint32_t first, uint32_t count)
+    {
+        if (first >= m_capacity)
+            return;
+
+        // Indices that are already free stay as they are
+        MarkRange(first, std::min(count, m_capacity - first), true);
+    }
+
+    inline bool DescriptorIndexAllocator::IsAllocated(uint32_t index) const
+    {
+        return index < m_capacity && !IsFree(index);
+    }
+
+    inline uint32_t DescriptorIndexAllocator::GetCapacity() const
+    {
+        return m_capacity;
+    }
+
+    inline uint32_t DescriptorIndexAllocator::GetFreeCount() const
+    {
+        return m_freeCount;
+    }
+
+    inline bool DescriptorIndexAllocator::IsFree(uint32_t index) const
+    {
+        return (m_levels[0][index / WordBits] >> (index % WordBits)) & 1;
+    }
+
+    inline void DescriptorIndexAllocator::MarkAllocated(uint32_t index)
+    {
+        m_freeCount--;
+
+        if (m_levels[0][index / WordBits] == ~uint64_t(0))
+        {
+            m_wholeFreeWords[index / WordBits / WordBits]--;
+        }
+
+        // Clear the bit, and the parent's bit if that emptied the word
+        for (auto& level : m_levels)
+        {
+            auto& word = level[index / WordBits];
+            word &= ~(uint64_t(1) << (index % WordBits));
+
+            if (word != 0)
+                break;
+
+            index /= WordBits;
+        }
+    }
+
+    inline void DescriptorIndexAllocator::MarkFree(uint32_t index)
+    {
+        m_freeCount++;
+        const uint32_t bottomWord = index / WordBits;
+
+        // Set the bit, and the parent's bit if the word was empty
+        for (auto& level : m_levels)
+        {
+            auto& word = level[index / WordBits];
+            const bool wasEmpty = word == 0;
+            word |= uint64_t(1) << (index % WordBits);
+
+            if (!wasEmpty)
+                break;
+
+            index /= WordBits;
+        }
+
+        if (m_levels[0][bottomWord] == ~uint64_t(0))
+        {
+            m_wholeFreeWords[bottomWord / WordBits]++;
+        }
+    }
+
+    inline void DescriptorIndexAllocator::MarkRange(uint32_t first, uint32_t count, bool free)
+    {
+        // Allocation only marks free runs, so only freeing has to count
+        if (!free)
+        {
+            m_freeCount -= count;
+        }
+
+        const uint32_t end = first + count;
+        for (uint32_t i = first; i < end;)
+        {
+            const uint32_t w = i / WordBits;
+            const uint32_t bits = std::min(end - i, WordBits - i % WordBits);
+            const uint64_t mask = (bits == WordBits ? ~uint64_t(0) : (uint64_t(1) << bits) - 1) << (i % WordBits);
+            const uint64_t word = m_levels[0][w];
+
+            if (free)
+            {
+                m_freeCount += static_cast<uint32_t>(std::popcount(mask & ~word));
+                SetBottomWord(w, word | mask);
+            }
+            else
+            {
+                SetBottomWord(w, word & ~mask);
+            }
+
+            i += bits;
+        }
+    }
+
+    inline void DescriptorIndexAllocator::SetBottomWord(uint32_t w, uint64_t value)
+    {
+        uint64_t& word = m_levels[0][w];
+        const uint64_t previous = word;
+        word = value;
+
+        if (previous == ~uint64_t(0))
+        {
+            m_wholeFreeWords[w / WordBits]--;
+        }
+        if (value == ~uint64_t(0))
+        {
+            m_wholeFreeWords[w / WordBits]++;
+        }
+
+        // Set or clear the parent's bit if the word filled or emptied, and
+        // so on up while that fills or empties the parent
+        const bool hasFree = value != 0;
+        if (hasFree == (previous != 0))
+            return;
+
+        uint32_t index = w;
+        for (std::size_t level = 1; level < m_levels.size(); level++)
+        {
+            uint64_t& parent = m_levels[level][index / WordBits];
+            const bool parentHadFree = parent != 0;
+            const uint64_t bit = uint64_t(1) << (index % WordBits);
+            parent = hasFree ? parent | bit : parent & ~bit;
+
+            if ((parent != 0) == parentHadFree)
+                break;
+
+            index /= WordBits;
+        }
+    }
+
+    inline uint32_t DescriptorIndexAllocator::FindNextSet(std::size_t level, uint32_t position) const
+    {
+        const auto& bits = m_levels[level];
+        const uint32_t word = position / WordBits;
+        if (word >= bits.size())
+        {
+            return InvalidIndex;
+        }
+
+        const uint64_t rest = bits[word] & (~uint64_t(0) << (position % WordBits));
+        if (rest != 0)
+        {
+            return word * WordBits + static_cast<uint32_t>(std::countr_zero(rest));
+        }
+
+        // Nothing left in this word, so ask the level above for the next
+        // word that has anything
+        if (level + 1 == m_levels.size())
+        {
+            return InvalidIndex;
+        }
+
+        const uint32_t next = FindNextSet(level + 1, word + 1);
+        if (next == InvalidIndex)
+        {
+            return InvalidIndex;
+        }
+
+        return next * WordBits + static_cast<uint32_t>(std::countr_zero(bits[next]));
+    }
+
+    inline uint32_t DescriptorIndexAllocator::FindFreeWord(uint32_t word) const
+    {
+        if (m_levels.size() == 1)
+        {
+            return word == 0 && m_levels[0][0] != 0 ? 0 : InvalidIndex;
+        }
+
+        // Usually the next word with anything free shares a summary word
+        // with this one
+        const uint64_t rest = m_levels[1][word / WordBits] & (~uint64_t(0) << (word % WordBits));
+        if (rest != 0)
+        {
+            return word / WordBits * WordBits + static_cast<uint32_t>(std::countr_zero(rest));
+        }
+
+        return FindNextSet(1, (word / WordBits + 1) * WordBits);
+    }
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace Gradient
+{
+    // Records which elements of a buffer have changed since the last
+    // upload, one bit per element, and turns them into as few ranges as
+    // possible to copy.
+    //
+    // Marking is a few word writes whatever the pattern, so scattered
+    // updates to a handful of elements cost no more than a list of ranges
+    // would, while a million scattered updates don't need sorting.
+    // Collect walks only the words between the first and last dirty one,
+    // stepping over whole runs with countr_zero and countr_one.
+    //
+    // Runs separated by at most mergeGap clean elements come out as one
+    // range. That trades copying the clean elements in between for fewer
+    // copy commands, so it is only right when the source of the copy
+    // holds current data for the clean elements too.
+    class DirtyRangeTracker
+    {
+    public:
+        struct Range
+        {
+            uint32_t First;
+            uint32_t Count;
+        };
+
+        explicit DirtyRangeTracker(uint32_t capacity);
+
+        // Throws if the range runs past the capacity
+        void Mark(uint32_t first, uint32_t count);
+        void MarkAll();
+
+        bool IsDirty(uint32_t index) const;
+        bool Empty() const;
+        uint32_t GetCapacity() const;
+
+        // Replaces out's contents with the coalesced dirty ranges, in
+        // order, and clears every mark. Reuses out's storage, so a vector
+        // kept between frames stops allocating once it has grown.
+        void Collect(uint32_t mergeGap, std::vector<Range>& out);
+
+    private:
+        static constexpr uint32_t WordBits = 64;
+
+        uint32_t m_capacity;
+        std::vector<uint64_t> m_bits;
+
+        // Bounds of the words with dirty bits, m_firstWord > m_lastWord
+        // when there are none
+        uint32_t m_firstWord;
+        uint32_t m_lastWord = 0;
+    };
+
+    inline DirtyRangeTracker::DirtyRangeTracker(uint32_t capacity)
+        : m_capacity(capacity),
+        m_bits((capacity + WordBits - 1) / WordBits, 0),
+        m_firstWord(UINT32_MAX)
+    {
+    }
+
+    inline void DirtyRangeTracker::Mark(uint32_t first, uint32_t count)
+    {
+        if (count == 0)
+            return;
+
+        if (first >= m_capacity || count > m_capacity - first)
+        {
+            throw std::runtime_error("DirtyRangeTracker range is out of bounds");
+        }
+
+        const uint32_t last = first + count - 1;
+        const uint32_t firstWord = first / WordBits;
+        const uint32_t lastWord = last / WordBits;
+
+        const uint64_t firstMask = ~uint64_t(0) << (first % WordBits);
+        const uint64_t lastMask = ~uint64_t(0) >> (WordBits - 1 - last % WordBits);
+
+        if (firstWord == lastWord)
+        {
+            m_bits[firstWord] |= firstMask & lastMask;
+        }
+        else
+        {
+            m_bits[firstWord] |= firstMask;
+            std::fill(m_bits.begin() + firstWord + 1, m_bits.begin() + lastWord, ~uint64_t(0));
+            m_bits[lastWord] |= lastMask;
+        }
+
+        m_firstWord = std::min(m_firstWord, firstWord);
+        m_lastWord = std::max(m_lastWord, lastWord);
+    }
+
+    inline void DirtyRangeTracker::MarkAll()
+    {
+        Mark(0, m_capacity);
+    }
+
+    inline bool DirtyRangeTracker::IsDirty(uint32_t index) const
+    {
+        return index < m_capacity && ((m_bits[index / WordBits] >> (index % WordBits)) & 1);
+    }
+
+    inline bool DirtyRangeTracker::Empty() const
+    {
+        return m_firstWord > m_lastWord;
+    }
+
+    inline uint32_t DirtyRangeTracker::GetCapacity() const
+    {
+        return m_capacity;
+    }
+
+    inline void DirtyRangeTracker::Collect(uint32_t mergeGap, std::vector<Range>& out)
+    {
+        out.clear();
+
+        if (Empty())
+            return;
+
+        // The range being built, [start, end)
+        bool open = false;
+        uint32_t start = 0;
+        uint32_t end = 0;
+
+        auto addRun = [&](uint32_t runStart, uint32_t runEnd)
+            {
+                if (open && runStart - end <= mergeGap)
+                {
+                    end = runEnd;
+                    return;
+                }
+
+                if (open)
+                {
+                    out.push_back({ start, end - start });
+                }
+
+                open = true;
+                start = runStart;
+                end = runEnd;
+            };
+
+        for (uint32_t w = m_firstWord; w <= m_lastWord; w++)
+        {
+            const uint64_t word = m_bits[w];
+            if (word == 0)
+                continue;
+
+            m_bits[w] = 0;
+            const uint32_t base = w * WordBits;
+
+            if (word == ~uint64_t(0))
+            {
+                addRun(base, base + WordBits);
+                continue;
+            }
+
+            uint32_t bit = static_cast<uint32_t>(std::countr_zero(word));
+            while (bit < WordBits)
+            {
+                const uint64_t rest = word >> bit;
+                const auto ones = static_cast<uint32_t>(std::countr_one(rest));
+                addRun(base + bit, base + bit + ones);
+
+                bit += ones;
+                if (bit >= WordBits || (word >> bit) == 0)
+                    break;
+
+                bit += static_cast<uint32_t>(std::countr_zero(word >> bit));
+            }
+        }
+
+        if (open)
+        {
+            out.push_back({ start, end - start });
+        }
+
+        m_firstWord = UINT32_MAX;
+        m_lastWord = 0;
+    }
+}
@@ -0,0 +1,97 @@
+#include "pch.h"
+
+#include "Gradient/DynamicInstanceBuffer.h"
+
+#include <cstring>
+
+namespace Gradient
+{
+    DynamicInstanceBuffer::DynamicInstanceBuffer(ID3D12Device* device,
+        uint32_t elementSize,
+        uint32_t elementCount,
+        const void* initialData,
+        uint32_t mergeGap)
+        : m_elementSize(elementSize),
+        m_elementCount(elementCount),
+        m_mergeGap(mergeGap),
+        m_elements(static_cast<std::size_t>(elementSize) * elementCount),
+        m_dirty(elementCount)
+    {
+        if (elementSize == 0 || elementCount == 0)
+        {
+            throw std::runtime_error("Cannot create an empty dynamic instance buffer");
+        }
+
+        std::memcpy(m_elements.data(), initialData, m_elements.size());
+
+        auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+        auto desc = CD3DX12_RESOURCE_DESC::Buffer(static_cast<UINT64>(m_elements.size()) * SlotCount);
+
+        DX::ThrowIfFailed(
+            device->CreateCommittedResource(
+                &heapProperties,
+                D3D12_HEAP_FLAG_NONE,
+                &desc,
+                D3D12_RESOURCE_STATE_GENERIC_READ,
+                nullptr,
+                IID_PPV_ARGS(m_staging.ReleaseAndGetAddressOf())));
+        m_staging->SetName(L"Dynamic Instance Staging");
+
+        const auto readRange = CD3DX12_RANGE(0, 0);
+        void* mapped = nullptr;
+        DX::ThrowIfFailed(m_staging->Map(0, &readRange, &mapped));
+        m_stagingData = static_cast<uint8_t*>(mapped);
+    }
+
+    void DynamicInstanceBuffer::Update(uint32_t first, const void* elements, uint32_t count)
+    {
+        std::lock_guard lock(m_mutex);
+
+        // Throws before anything is written if the range is out of bounds
+        m_dirty.Mark(first, count);
+
+        std::memcpy(m_elements.data() + static_cast<std::size_t>(first) * m_elementSize,
+            elements,
+            static_cast<std::size_t>(count) * m_elementSize);
+    }
+
+    uint32_t DynamicInstanceBuffer::Commit(ID3D12GraphicsCommandList* cl, BarrierResource& destination, uint32_t slot)
+    {
+        std::lock_guard lock(m_mutex);
+
+        if (m_dirty.Empty())
+            return 0;
+
+        m_dirty.Collect(m_mergeGap, m_ranges);
+
+        const auto before = destination.GetState();
+        destination.Transition(cl, D3D12_RESOURCE_STATE_COPY_DEST);
+
+        const uint64_t slotOffset = static_cast<uint64_t>(slot % SlotCount) * m_elements.size();
+
+        for (const auto& range : m_ranges)
+        {
+            const uint64_t offset = static_cast<uint64_t>(range.First) * m_elementSize;
+            const uint64_t size = static_cast<uint64_t>(range.Count) * m_elementSize;
+
+            // Written in order, which suits write-combined upload memory
+            std::memcpy(m_stagingData + slotOffset + offset, m_elements.data() + offset, size);
+
+            cl->CopyBufferRegion(destination.Get(), offset, m_staging.Get(), slotOffset + offset, size);
+        }
+
+        destination.Transition(cl, before);
+
+        return static_cast<uint32_t>(m_ranges.size());
+    }
+
+    uint32_t DynamicInstanceBuffer::GetElementSize() const
+    {
+        return m_elementSize;
+    }
+
+    uint32_t DynamicInstanceBuffer::GetElementCount() const
+    {
+        return m_elementCount;
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "pch.h"
+
+#include <mutex>
+#include <vector>
+
+#include "Gradient/BarrierResource.h"
+#include "Gradient/DirtyRangeTracker.h"
+
+namespace Gradient
+{
+    // Streams CPU updates of an instance buffer to the GPU each frame.
+    //
+    // Updates go into a CPU copy of the buffer and mark the elements
+    // dirty. Commit coalesces the dirty elements into ranges, copies them
+    // from the CPU copy into this frame's slot of a persistently mapped
+    // upload buffer, and records copies from there into the default heap
+    // buffer. There is a slot per frame in flight, each as big as the
+    // whole buffer, so a frame never writes staging the GPU may still be
+    // reading; the caller picks the slot and makes sure its last frame
+    // has finished, as BufferManager does.
+    //
+    // The CPU copy is the source of truth, so the GPU must not write the
+    // buffer: ranges are merged across small clean gaps, which copies the
+    // clean elements in between as well. Update and Commit may be called
+    // from different threads.
+    class DynamicInstanceBuffer
+    {
+    public:
+        static constexpr uint32_t SlotCount = 3;
+        // Clean elements a copy may span to join two dirty runs
+        static constexpr uint32_t DefaultMergeGap = 8;
+
+        DynamicInstanceBuffer(ID3D12Device* device,
+            uint32_t elementSize,
+            uint32_t elementCount,
+            const void* initialData,
+            uint32_t mergeGap = DefaultMergeGap);
+
+        void Update(uint32_t first, const void* elements, uint32_t count);
+
+        // Records copies of everything updated since the last commit into
+        // destination, leaving it in the state it was in. Returns the
+        // number of copies.
+        uint32_t Commit(ID3D12GraphicsCommandList* cl, BarrierResource& destination, uint32_t slot);
+
+        uint32_t GetElementSize() const;
+        uint32_t GetElementCount() const;
+
+    private:
+        uint32_t m_elementSize;
+        uint32_t m_elementCount;
+        uint32_t m_mergeGap;
+
+        std::mutex m_mutex;
+        std::vector<uint8_t> m_elements;
+        DirtyRangeTracker m_dirty;
+        std::vector<DirtyRangeTracker::Range> m_ranges;
+
+        Microsoft::WRL::ComPtr<ID3D12Resource> m_staging;
+        uint8_t* m_stagingData = nullptr;
+    };
+}
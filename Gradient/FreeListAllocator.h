@@ -1,82 +1,231 @@
 #pragma once
 
-#include "pch.h"
-#include <optional>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
 
 namespace Gradient
 {
+    // Elements addressed by generational handles. A handle holds a slot
+    // index and the slot's generation when it was allocated; removing an
+    // element bumps the generation, so handles to removed elements stay
+    // invalid after the slot is reused instead of aliasing the new element.
+    //
+    // Live elements are packed in a dense array, with the slots pointing
+    // into it, so iterating visits only live elements in contiguous memory.
+    // Remove moves the last element into the hole. Pointers from Get and
+    // iterators are invalidated by Allocate and Remove; handles are not.
+    //
+    // The move and the extra indirection make a remove and allocate pair
+    // slower than keeping each element in its slot, and iteration several
+    // times faster, so the dense layout wins unless a large share of the
+    // elements is replaced per pass over them. The ratios vary a lot with
+    // the machine and element count; AllocatorBenchmark measures both and
+    // reports the break-even share.
     template <typename T>
     class FreeListAllocator
     {
     public:
-        using Handle = std::size_t;
+        struct Handle
+        {
+            static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+            uint32_t Index = InvalidIndex;
+            uint32_t Generation = 0;
+
+            bool operator==(const Handle& other) const
+            {
+                return Index == other.Index && Generation == other.Generation;
+            }
+
+            bool operator!=(const Handle& other) const
+            {
+                return !(*this == other);
+            }
+        };
+
+        using iterator = typename std::vector<T>::iterator;
+        using const_iterator = typename std::vector<T>::const_iterator;
 
         Handle Allocate(const T& in);
         Handle Allocate(T&& in);
+        // Does nothing for handles that are already invalid
         void Remove(Handle handle);
+        void Clear();
 
+        bool IsValid(Handle handle) const;
+
+        // nullptr for invalid handles
         T* Get(Handle handle);
+        const T* Get(Handle handle) const;
+
+        // Live elements, in no particular order
+        std::size_t Size() const;
+        bool Empty() const;
+        iterator begin();
+        iterator end();
+        const_iterator begin() const;
+        const_iterator end() const;
 
+        // The handle of the element at position i of the iteration order
+        Handle GetHandleAt(std::size_t i) const;
 
     private:
-        std::vector<std::optional<T>> m_elements;
-        std::vector<Handle> m_freeHandles;
+        struct Slot
+        {
+            uint32_t DenseIndex = Handle::InvalidIndex;
+            uint32_t Generation = 0;
+        };
+
+        Handle AllocateSlot();
 
+        std::vector<T> m_dense;
+        std::vector<uint32_t> m_denseToSlot;
+        std::vector<Slot> m_slots;
+        std::vector<uint32_t> m_freeSlots;
     };
 
     template <typename T>
-    FreeListAllocator<T>::Handle
+    typename FreeListAllocator<T>::Handle
         FreeListAllocator<T>::Allocate(T&& in)
     {
-        if (!m_freeHandles.empty())
-        {
-            Handle handle = m_freeHandles.back();
-            m_freeHandles.pop_back();
-            m_elements[handle] = in;
-
-            return handle;
-        }
-
-        m_elements.emplace_back(in);
-        return m_elements.size() - 1;
+        m_dense.push_back(std::move(in));
+        return AllocateSlot();
     }
 
     template <typename T>
-    FreeListAllocator<T>::Handle
+    typename FreeListAllocator<T>::Handle
         FreeListAllocator<T>::Allocate(const T& in)
     {
-        if (!m_freeHandles.empty())
-        {
-            Handle handle = m_freeHandles.back();
-            m_freeHandles.pop_back();
-            assert(!m_elements[handle]);
-            m_elements[handle] = in;
+        m_dense.push_back(in);
+        return AllocateSlot();
+    }
 
-            return handle;
+    template <typename T>
+    typename FreeListAllocator<T>::Handle
+        FreeListAllocator<T>::AllocateSlot()
+    {
+        uint32_t index;
+        if (!m_freeSlots.empty())
+        {
+            index = m_freeSlots.back();
+            m_freeSlots.pop_back();
+        }
+        else
+        {
+            index = static_cast<uint32_t>(m_slots.size());
+            m_slots.emplace_back();
         }
 
-        m_elements.emplace_back(in);
-        return m_elements.size() - 1;
+        auto& slot = m_slots[index];
+        assert(slot.DenseIndex == Handle::InvalidIndex);
+        slot.DenseIndex = static_cast<uint32_t>(m_dense.size() - 1);
+        m_denseToSlot.push_back(index);
+
+        return { index, slot.Generation };
     }
 
     template <typename T>
-    void FreeListAllocator<T>::Remove(FreeListAllocator<T>::Handle handle)
+    void FreeListAllocator<T>::Remove(Handle handle)
     {
-        if (handle < m_elements.size())
+        if (!IsValid(handle))
+            return;
+
+        auto& slot = m_slots[handle.Index];
+        const uint32_t denseIndex = slot.DenseIndex;
+        const uint32_t lastIndex = static_cast<uint32_t>(m_dense.size() - 1);
+
+        if (denseIndex != lastIndex)
         {
-            m_freeHandles.push_back(handle);
-            m_elements[handle].reset();
+            m_dense[denseIndex] = std::move(m_dense[lastIndex]);
+            m_denseToSlot[denseIndex] = m_denseToSlot[lastIndex];
+            m_slots[m_denseToSlot[denseIndex]].DenseIndex = denseIndex;
         }
+
+        m_dense.pop_back();
+        m_denseToSlot.pop_back();
+
+        slot.DenseIndex = Handle::InvalidIndex;
+        slot.Generation++;
+        m_freeSlots.push_back(handle.Index);
     }
 
     template <typename T>
-    T* FreeListAllocator<T>::Get(FreeListAllocator<T>::Handle handle)
+    void FreeListAllocator<T>::Clear()
     {
-        if (handle < m_elements.size())
+        for (uint32_t index : m_denseToSlot)
         {
-            return &m_elements[handle].value();
+            m_slots[index].DenseIndex = Handle::InvalidIndex;
+            m_slots[index].Generation++;
+            m_freeSlots.push_back(index);
         }
 
-        return nullptr;
+        m_dense.clear();
+        m_denseToSlot.clear();
+    }
+
+    template <typename T>
+    bool FreeListAllocator<T>::IsValid(Handle handle) const
+    {
+        return handle.Index < m_slots.size()
+            && m_slots[handle.Index].Generation == handle.Generation
+            && m_slots[handle.Index].DenseIndex != Handle::InvalidIndex;
+    }
+
+    template <typename T>
+    T* FreeListAllocator<T>::Get(Handle handle)
+    {
+        return IsValid(handle) ? &m_dense[m_slots[handle.Index].DenseIndex] : nullptr;
+    }
+
+    template <typename T>
+    const T* FreeListAllocator<T>::Get(Handle handle) const
+    {
+        return IsValid(handle) ? &m_dense[m_slots[handle.Index].DenseIndex] : nullptr;
+    }
+
+    template <typename T>
+    std::size_t FreeListAllocator<T>::Size() const
+    {
+        return m_dense.size();
+    }
+
+    template <typename T>
+    bool FreeListAllocator<T>::Empty() const
+    {
+        return m_dense.empty();
+    }
+
+    template <typename T>
+    typename FreeListAllocator<T>::iterator FreeListAllocator<T>::begin()
+    {
+        return m_dense.begin();
+    }
+
+    template <typename T>
+    typename FreeListAllocator<T>::iterator FreeListAllocator<T>::end()
+    {
+        return m_dense.end();
+    }
+
+    template <typename T>
+    typename FreeListAllocator<T>::const_iterator FreeListAllocator<T>::begin() const
+    {
+        return m_dense.begin();
+    }
+
+    template <typename T>
+    typename FreeListAllocator<T>::const_iterator FreeListAllocator<T>::end() const
+    {
+        return m_dense.end();
+    }
+
+    template <typename T>
+    typename FreeListAllocator<T>::Handle FreeListAllocator<T>::GetHandleAt(std::size_t i) const
+    {
+        const uint32_t index = m_denseToSlot[i];
+        return { index, m_slots[index].Generation };
     }
-}
\ No newline at end of file
+}
@@ -83,6 +83,11 @@ namespace Gradient
         m_camera.SetPosition(position);
     }
 
+    void FreeMoveCamera::SetDirection(const DirectX::SimpleMath::Vector3& direction)
+    {
+        m_camera.SetDirection(direction);
+    }
+
     const Camera& FreeMoveCamera::GetCamera() const
     {
         return m_camera;
@@ -14,6 +14,7 @@ namespace Gradient
 
         void Update(DX::StepTimer const& timer, const DirectX::Mouse::State& mouseState);
         void SetPosition(DirectX::SimpleMath::Vector3 const&);
+        void SetDirection(DirectX::SimpleMath::Vector3 const&);
         void SetAspectRatio(const float& aspectRatio);
         const Camera& GetCamera() const;
 
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace Gradient
+{
+    // Lock-free stack of slot indices (a Treiber stack).
+    //
+    // Each slot's link to the slot below it is kept by Links, which maps a
+    // slot to a std::atomic<uint32_t> the stack owns while the slot is on
+    // it, so pushing and popping never allocate. The head packs the top slot
+    // with a tag that is bumped on every successful update, which stops a pop
+    // from succeeding against a head that was popped and pushed back in the
+    // meantime (ABA).
+    //
+    // A slot must only be pushed by whoever popped it, or by the owner while
+    // filling the stack before it is shared.
+    template <typename Links>
+    class BasicFreeSlotStack
+    {
+    public:
+        static constexpr uint32_t InvalidSlot = UINT32_MAX;
+
+        explicit BasicFreeSlotStack(Links links);
+
+        void Push(uint32_t slot);
+
+        // Returns InvalidSlot when the stack is empty
+        uint32_t Pop();
+
+        // Approximate while other threads are pushing or popping
+        uint32_t GetSize() const;
+
+    protected:
+        // Replaces the contents with slots [0, count) so that slot 0 is
+        // popped first. Not safe while other threads use the stack.
+        void Fill(uint32_t count);
+
+    private:
+        static uint64_t Pack(uint32_t slot, uint32_t tag);
+        static uint32_t GetSlot(uint64_t head);
+        static uint32_t GetTag(uint64_t head);
+
+        Links m_links;
+        std::atomic<uint64_t> m_head;
+        std::atomic<int32_t> m_size;
+    };
+
+    // Links for slots [0, capacity), preallocated in one array
+    class FreeSlotArray
+    {
+    public:
+        explicit FreeSlotArray(uint32_t capacity)
+            : m_next(std::make_unique<std::atomic<uint32_t>[]>(capacity))
+        {
+        }
+
+        std::atomic<uint32_t>& operator[](uint32_t slot) const
+        {
+            return m_next[slot];
+        }
+
+    private:
+        std::unique_ptr<std::atomic<uint32_t>[]> m_next;
+    };
+
+    // Fixed capacity stack of slots [0, capacity)
+    class FreeSlotStack : public BasicFreeSlotStack<FreeSlotArray>
+    {
+    public:
+        explicit FreeSlotStack(uint32_t capacity);
+
+        // Pushes every slot so that slot 0 is popped first
+        void Fill();
+
+        uint32_t GetCapacity() const;
+
+    private:
+        uint32_t m_capacity;
+    };
+
+    template <typename Links>
+    BasicFreeSlotStack<Links>::BasicFreeSlotStack(Links links)
+        : m_links(std::move(links)),
+        m_head(Pack(InvalidSlot, 0)),
+        m_size(0)
+    {
+    }
+
+    template <typename Links>
+    void BasicFreeSlotStack<Links>::Fill(uint32_t count)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            m_links[i].store(i + 1 < count ? i + 1 : InvalidSlot, std::memory_order_relaxed);
+        }
+
+        const uint32_t tag = GetTag(m_head.load(std::memory_order_relaxed)) + 1;
+        m_head.store(Pack(count > 0 ? 0 : InvalidSlot, tag), std::memory_order_release);
+        m_size.store(static_cast<int32_t>(count), std::memory_order_relaxed);
+    }
+
+    template <typename Links>
+    void BasicFreeSlotStack<Links>::Push(uint32_t slot)
+    {
+        std::atomic<uint32_t>& link = m_links[slot];
+        uint64_t head = m_head.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            link.store(GetSlot(head), std::memory_order_relaxed);
+
+            if (m_head.compare_exchange_weak(head, Pack(slot, GetTag(head) + 1),
+                std::memory_order_release, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+
+        m_size.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    template <typename Links>
+    uint32_t BasicFreeSlotStack<Links>::Pop()
+    {
+        uint64_t head = m_head.load(std::memory_order_acquire);
+
+        while (true)
+        {
+            const uint32_t slot = GetSlot(head);
+            if (slot == InvalidSlot)
+            {
+                return InvalidSlot;
+            }
+
+            // May read a stale link if another thread wins the race, in which
+            // case the tag check below fails and we retry
+            const uint32_t next = m_links[slot].load(std::memory_order_relaxed);
+
+            if (m_head.compare_exchange_weak(head, Pack(next, GetTag(head) + 1),
+                std::memory_order_acquire, std::memory_order_acquire))
+            {
+                m_size.fetch_sub(1, std::memory_order_relaxed);
+                return slot;
+            }
+        }
+    }
+
+    template <typename Links>
+    uint32_t BasicFreeSlotStack<Links>::GetSize() const
+    {
+        // Can dip below zero while a pop lands before the matching push count
+        return static_cast<uint32_t>(std::max(0, m_size.load(std::memory_order_relaxed)));
+    }
+
+    template <typename Links>
+    uint64_t BasicFreeSlotStack<Links>::Pack(uint32_t slot, uint32_t tag)
+    {
+        return (static_cast<uint64_t>(tag) << 32) | slot;
+    }
+
+    template <typename Links>
+    uint32_t BasicFreeSlotStack<Links>::GetSlot(uint64_t head)
+    {
+        return static_cast<uint32_t>(head);
+    }
+
+    template <typename Links>
+    uint32_t BasicFreeSlotStack<Links>::GetTag(uint64_t head)
+    {
+        return static_cast<uint32_t>(head >> 32);
+    }
+
+    inline FreeSlotStack::FreeSlotStack(uint32_t capacity)
+        : BasicFreeSlotStack(FreeSlotArray(capacity)),
+        m_capacity(capacity)
+    {
+    }
+
+    inline void FreeSlotStack::Fill()
+    {
+        BasicFreeSlotStack::Fill(m_capacity);
+    }
+
+    inline uint32_t FreeSlotStack::GetCapacity() const
+    {
+        return m_capacity;
+    }
+}
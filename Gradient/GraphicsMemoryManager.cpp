@@ -2,6 +2,9 @@
 
 #include "Gradient/GraphicsMemoryManager.h"
 
+#include <string>
+#include <system_error>
+
 namespace Gradient
 {
     std::unique_ptr<GraphicsMemoryManager> GraphicsMemoryManager::s_instance;
@@ -20,54 +23,139 @@ namespace Gradient
             D3D12_DESCRIPTOR_HEAP_TYPE_DSV,
             D3D12_DESCRIPTOR_HEAP_FLAG_NONE,
             64);
+
+        m_srvIndices = std::make_unique<DescriptorIndexAllocator>(static_cast<uint32_t>(m_srvDescriptors->Count()));
+        m_rtvIndices = std::make_unique<DescriptorIndexAllocator>(static_cast<uint32_t>(m_rtvDescriptors->Count()));
+        m_dsvIndices = std::make_unique<DescriptorIndexAllocator>(static_cast<uint32_t>(m_dsvDescriptors->Count()));
+
+        m_constantRing = std::make_unique<LinearRingAllocator>(ConstantRingSize, MaxConstantFramesInFlight);
+
+        auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+        auto desc = CD3DX12_RESOURCE_DESC::Buffer(ConstantRingSize);
+
+        DX::ThrowIfFailed(
+            device->CreateCommittedResource(
+                &heapProperties,
+                D3D12_HEAP_FLAG_NONE,
+                &desc,
+                D3D12_RESOURCE_STATE_GENERIC_READ,
+                nullptr,
+                IID_PPV_ARGS(m_constantBuffer.ReleaseAndGetAddressOf())));
+        m_constantBuffer->SetName(L"Constant Ring");
+
+        // Upload heaps can stay mapped for their whole lifetime
+        const auto readRange = CD3DX12_RANGE(0, 0);
+        void* mapped = nullptr;
+        DX::ThrowIfFailed(m_constantBuffer->Map(0, &readRange, &mapped));
+        m_constantData = static_cast<uint8_t*>(mapped);
+        m_constantGpuAddress = m_constantBuffer->GetGPUVirtualAddress();
+
+        DX::ThrowIfFailed(
+            device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(m_constantFence.ReleaseAndGetAddressOf())));
+        m_constantFence->SetName(L"Constant Ring Fence");
+
+        m_constantFenceEvent.Attach(CreateEventEx(nullptr, nullptr, 0, EVENT_MODIFY_STATE | SYNCHRONIZE));
+        if (!m_constantFenceEvent.IsValid())
+        {
+            throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "CreateEventEx");
+        }
     }
 
     void GraphicsMemoryManager::Commit(ID3D12CommandQueue* cq)
     {
-        m_frameGraphicsResources.clear();
+        m_constantRing->ReleaseCompletedFrames(m_constantFence->GetCompletedValue());
+
+        if (m_constantRing->GetPendingFrameCount() == m_constantRing->GetMaxFramesInFlight())
+        {
+            WaitForConstantFence(m_constantRing->GetOldestPendingFence());
+        }
+
+        m_constantRing->EndFrame(++m_constantFenceValue);
+        DX::ThrowIfFailed(cq->Signal(m_constantFence.Get(), m_constantFenceValue));
+
         m_graphicsMemory->Commit(cq);
     }
 
-    GraphicsMemoryManager::DescriptorIndex GraphicsMemoryManager::AllocateSrvOrUav()
+    uint64_t GraphicsMemoryManager::AllocateConstantSpace(uint64_t size)
     {
-        if (!m_freeSrvIndices.empty())
+        while (true)
         {
-            auto index_it = m_freeSrvIndices.begin();
-            auto index = *index_it;
-            m_freeSrvIndices.erase(index_it);
-            TrackCpuDescriptorHandle(index);
-            return index;
+            const uint64_t offset = m_constantRing->Allocate(size, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+            if (offset != LinearRingAllocator::InvalidOffset)
+            {
+                return offset;
+            }
+
+            // The rest of the ring belongs to frames the GPU may still be
+            // reading, or to this frame
+            const uint64_t oldest = m_constantRing->GetOldestPendingFence();
+            if (oldest == 0)
+            {
+                throw std::runtime_error("Out of constant buffer space");
+            }
+
+            WaitForConstantFence(oldest);
         }
+    }
 
-        auto index = m_srvDescriptors->Allocate();
-        TrackCpuDescriptorHandle(index);
-        return index;
+    void GraphicsMemoryManager::WaitForConstantFence(uint64_t value)
+    {
+        if (m_constantFence->GetCompletedValue() < value)
+        {
+            DX::ThrowIfFailed(m_constantFence->SetEventOnCompletion(value, m_constantFenceEvent.Get()));
+            std::ignore = WaitForSingleObjectEx(m_constantFenceEvent.Get(), INFINITE, FALSE);
+        }
+
+        m_constantRing->ReleaseCompletedFrames(m_constantFence->GetCompletedValue());
     }
 
-    void GraphicsMemoryManager::TrackCpuDescriptorHandle(DescriptorIndex index)
+    GraphicsMemoryManager::DescriptorIndex GraphicsMemoryManager::AllocateFrom(
+        DescriptorIndexAllocator& allocator,
+        uint32_t count,
+        const char* heapName)
     {
-        auto cpuHandle = m_srvDescriptors->GetCpuHandle(index);
-        m_cpuHandleToSrvIndex.insert({ cpuHandle, index });
+        const auto index = allocator.AllocateRange(count);
+        if (index == DescriptorIndexAllocator::InvalidIndex)
+        {
+            throw std::runtime_error(std::string("Out of ") + heapName + " descriptors");
+        }
+
+        return index;
     }
 
-    void GraphicsMemoryManager::UntrackCpuDescriptorHandle(DescriptorIndex index)
+    GraphicsMemoryManager::DescriptorIndex GraphicsMemoryManager::AllocateSrvOrUav()
     {
-        auto cpuHandle = m_srvDescriptors->GetCpuHandle(index);
-        m_cpuHandleToSrvIndex.erase(cpuHandle);
+        return AllocateFrom(*m_srvIndices, 1, "SRV/UAV");
     }
 
     void GraphicsMemoryManager::FreeSrvOrUav(GraphicsMemoryManager::DescriptorIndex index)
     {
-        UntrackCpuDescriptorHandle(index);
-        m_freeSrvIndices.insert(index);
+        m_srvIndices->Free(static_cast<uint32_t>(index));
+    }
+
+    GraphicsMemoryManager::DescriptorIndex GraphicsMemoryManager::AllocateSrvOrUavRange(uint32_t count)
+    {
+        return AllocateFrom(*m_srvIndices, count, "SRV/UAV");
+    }
+
+    void GraphicsMemoryManager::FreeSrvOrUavRange(DescriptorIndex first, uint32_t count)
+    {
+        m_srvIndices->FreeRange(static_cast<uint32_t>(first), count);
     }
 
     void GraphicsMemoryManager::FreeSrvByCpuHandle(D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle)
     {
-        if (auto it = m_cpuHandleToSrvIndex.find(cpuHandle); it != m_cpuHandleToSrvIndex.end())
-        {
-            FreeSrvOrUav(it->second);
-        }
+        // Descriptors are evenly spaced from the start of the heap
+        const auto first = m_srvDescriptors->GetFirstCpuHandle();
+        if (cpuHandle.ptr < first.ptr)
+            return;
+
+        const auto offset = cpuHandle.ptr - first.ptr;
+        if (offset % m_srvDescriptors->Increment() != 0)
+            return;
+
+        // Ignores handles past the end of the heap and unallocated ones
+        FreeSrvOrUav(static_cast<DescriptorIndex>(offset / m_srvDescriptors->Increment()));
     }
 
     GraphicsMemoryManager::DescriptorView GraphicsMemoryManager::CreateSRV(
@@ -128,20 +216,12 @@ namespace Gradient
 
     GraphicsMemoryManager::DescriptorIndex GraphicsMemoryManager::AllocateRTV()
     {
-        if (!m_freeRTVIndices.empty())
-        {
-            auto index_it = m_freeRTVIndices.begin();
-            auto index = *index_it;
-            m_freeRTVIndices.erase(index_it);
-            return index;
-        }
-
-        return m_rtvDescriptors->Allocate();
+        return AllocateFrom(*m_rtvIndices, 1, "RTV");
     }
 
     void GraphicsMemoryManager::FreeRTV(DescriptorIndex index)
     {
-        m_freeRTVIndices.insert(index);
+        m_rtvIndices->Free(static_cast<uint32_t>(index));
     }
 
     GraphicsMemoryManager::DescriptorView GraphicsMemoryManager::CreateRTV(
@@ -182,20 +262,12 @@ namespace Gradient
 
     GraphicsMemoryManager::DescriptorIndex GraphicsMemoryManager::AllocateDSV()
     {
-        if (!m_freeDSVIndices.empty())
-        {
-            auto index_it = m_freeDSVIndices.begin();
-            auto index = *index_it;
-            m_freeDSVIndices.erase(index_it);
-            return index;
-        }
-
-        return m_dsvDescriptors->Allocate();
+        return AllocateFrom(*m_dsvIndices, 1, "DSV");
     }
 
     void GraphicsMemoryManager::FreeDSV(DescriptorIndex index)
     {
-        m_freeDSVIndices.insert(index);
+        m_dsvIndices->Free(static_cast<uint32_t>(index));
     }
 
     GraphicsMemoryManager::DescriptorView GraphicsMemoryManager::CreateDSV(
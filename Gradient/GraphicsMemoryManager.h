@@ -2,11 +2,12 @@
 
 #include "pch.h"
 
-#include <set>
-#include <unordered_map>
 #include <directxtk12/DescriptorHeap.h>
 #include <directxtk12/DirectXHelpers.h>
 
+#include "Gradient/DescriptorIndexAllocator.h"
+#include "Gradient/LinearRingAllocator.h"
+
 namespace Gradient
 {
     // Manages resources and descriptors. Not currently thread-safe.
@@ -44,9 +45,12 @@ namespace Gradient
 
         static GraphicsMemoryManager* Get();
 
+        // Copies data into this frame's part of the constant ring. The
+        // address stays valid until the GPU finishes the frame.
         template <typename T>
         inline D3D12_GPU_VIRTUAL_ADDRESS AllocateConstant(const T& data);
 
+        // Ends the frame's constants; call once per frame after submitting
         void Commit(ID3D12CommandQueue* cq);
 
 
@@ -54,6 +58,10 @@ namespace Gradient
 
         DescriptorIndex AllocateSrvOrUav();
         void FreeSrvOrUav(DescriptorIndex index);
+        // count descriptors in a row, for descriptor tables. Returns the
+        // first index.
+        DescriptorIndex AllocateSrvOrUavRange(uint32_t count);
+        void FreeSrvOrUavRange(DescriptorIndex first, uint32_t count);
         // Used by ImGui
         void FreeSrvByCpuHandle(D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle);
 
@@ -122,8 +130,16 @@ namespace Gradient
 
     private:
         GraphicsMemoryManager(ID3D12Device* device);
-        void TrackCpuDescriptorHandle(DescriptorIndex index);
-        void UntrackCpuDescriptorHandle(DescriptorIndex index);
+
+        static DescriptorIndex AllocateFrom(DescriptorIndexAllocator& allocator, uint32_t count, const char* heapName);
+
+        // Offset into the constant ring, waiting on older frames for space
+        uint64_t AllocateConstantSpace(uint64_t size);
+        void WaitForConstantFence(uint64_t value);
+
+        // 16K 256 byte constants, far more than a frame uses
+        static constexpr uint64_t ConstantRingSize = 4 * 1024 * 1024;
+        static constexpr uint32_t MaxConstantFramesInFlight = 4;
 
         static std::unique_ptr<GraphicsMemoryManager> s_instance;
 
@@ -132,40 +148,28 @@ namespace Gradient
         std::unique_ptr<DirectX::DescriptorPile> m_rtvDescriptors;
         std::unique_ptr<DirectX::DescriptorPile> m_dsvDescriptors;
 
-        std::set<DescriptorIndex> m_freeSrvIndices;
-        std::set<DescriptorIndex> m_freeRTVIndices;
-        std::set<DescriptorIndex> m_freeDSVIndices;
-
-        std::vector<DirectX::GraphicsResource> m_frameGraphicsResources;
-
-        struct DescriptorHandleHash
-        {
-            std::size_t operator()(const D3D12_CPU_DESCRIPTOR_HANDLE& h) const noexcept
-            {
-                return std::hash<SIZE_T>{}(h.ptr);
-            }
-        };
-
-        struct DescriptorHandleEqual
-        {
-            constexpr bool operator()(const D3D12_CPU_DESCRIPTOR_HANDLE& l,
-                const D3D12_CPU_DESCRIPTOR_HANDLE& r) const
-            {
-                return l.ptr == r.ptr;
-            }
-        };
-
-        std::unordered_map<D3D12_CPU_DESCRIPTOR_HANDLE,
-            DescriptorIndex,
-            DescriptorHandleHash,
-            DescriptorHandleEqual>
-            m_cpuHandleToSrvIndex;
+        // Which indices of each heap are in use. The piles only provide
+        // the heaps and handle arithmetic.
+        std::unique_ptr<DescriptorIndexAllocator> m_srvIndices;
+        std::unique_ptr<DescriptorIndexAllocator> m_rtvIndices;
+        std::unique_ptr<DescriptorIndexAllocator> m_dsvIndices;
+
+        // Persistently mapped upload buffer that every frame's constants
+        // are bump allocated from
+        std::unique_ptr<LinearRingAllocator> m_constantRing;
+        Microsoft::WRL::ComPtr<ID3D12Resource> m_constantBuffer;
+        uint8_t* m_constantData = nullptr;
+        D3D12_GPU_VIRTUAL_ADDRESS m_constantGpuAddress = 0;
+        Microsoft::WRL::ComPtr<ID3D12Fence> m_constantFence;
+        uint64_t m_constantFenceValue = 0;
+        Microsoft::WRL::Wrappers::Event m_constantFenceEvent;
     };
 
     template <typename T>
     inline D3D12_GPU_VIRTUAL_ADDRESS GraphicsMemoryManager::AllocateConstant(const T& data)
     {
-        m_frameGraphicsResources.push_back(m_graphicsMemory->AllocateConstant(data));
-        return m_frameGraphicsResources.back().GpuAddress();
+        const uint64_t offset = AllocateConstantSpace(sizeof(T));
+        std::memcpy(m_constantData + offset, &data, sizeof(T));
+        return m_constantGpuAddress + offset;
     }
 }
\ No newline at end of file
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace Gradient
+{
+    // Bump allocates byte ranges from a fixed size ring, for per-frame data
+    // such as constant buffers, independent of the graphics API. The caller
+    // owns the memory and writes to the offsets this returns.
+    //
+    // Allocations made between two EndFrame calls belong to one frame.
+    // EndFrame tags them with a fence value, and once the GPU has passed
+    // that value ReleaseCompletedFrames hands their bytes back. Nothing is
+    // freed individually, so an allocation is an align and an add.
+    //
+    //  const uint64_t offset = ring.Allocate(sizeof(constants), 256);
+    //  std::memcpy(mapped + offset, &constants, sizeof(constants));
+    //  ...
+    //  ring.EndFrame(++fenceValue);
+    //  queue->Signal(fence, fenceValue);
+    //  ...
+    //  ring.ReleaseCompletedFrames(fence->GetCompletedValue());
+    //
+    // An allocation never straddles the end of the ring: if it doesn't fit
+    // before the end, it starts again at offset 0 and the bytes skipped
+    // belong to the frame until it is released. The ring and frame list
+    // are sized at construction, so none of this touches the heap.
+    class LinearRingAllocator
+    {
+    public:
+        static constexpr uint64_t InvalidOffset = UINT64_MAX;
+
+        // capacity must be a multiple of every alignment asked for
+        LinearRingAllocator(uint64_t capacity, uint32_t maxFramesInFlight);
+
+        // InvalidOffset if the ring is too full. alignment must be a power
+        // of two.
+        uint64_t Allocate(uint64_t size, uint64_t alignment);
+
+        // Closes the current frame; its bytes are released once the GPU
+        // reaches fenceValue. Fence values must increase. Throws if
+        // maxFramesInFlight frames are already waiting.
+        void EndFrame(uint64_t fenceValue);
+        void ReleaseCompletedFrames(uint64_t completedFenceValue);
+
+        // The fence value of the oldest frame still holding bytes, 0 if
+        // there is none. Waiting for it is how to make room.
+        uint64_t GetOldestPendingFence() const;
+        uint32_t GetPendingFrameCount() const;
+        uint32_t GetMaxFramesInFlight() const;
+
+        uint64_t GetCapacity() const;
+        uint64_t GetUsedBytes() const;
+        // Bytes allocated since the last EndFrame, including padding
+        uint64_t GetFrameBytes() const;
+
+    private:
+        struct PendingFrame
+        {
+            uint64_t FenceValue;
+            uint64_t End;
+        };
+
+        uint64_t m_capacity;
+
+        // Positions count every byte ever allocated, so they only grow;
+        // the offset into the ring is position % capacity
+        uint64_t m_head = 0;
+        uint64_t m_tail = 0;
+        uint64_t m_frameStart = 0;
+
+        // Ring of frames waiting on the GPU, oldest at m_firstPending
+        std::vector<PendingFrame> m_pending;
+        uint32_t m_firstPending = 0;
+        uint32_t m_pendingCount = 0;
+    };
+
+    inline LinearRingAllocator::LinearRingAllocator(uint64_t capacity, uint32_t maxFramesInFlight)
+        : m_capacity(capacity),
+        m_pending(maxFramesInFlight)
+    {
+        if (capacity == 0 || maxFramesInFlight == 0)
+        {
+            throw std::runtime_error("LinearRingAllocator needs a capacity and at least one frame");
+        }
+    }
+
+    inline uint64_t LinearRingAllocator::Allocate(uint64_t size, uint64_t alignment)
+    {
+        if (alignment == 0 || (alignment & (alignment - 1)) != 0 || m_capacity % alignment != 0)
+        {
+            throw std::runtime_error("LinearRingAllocator alignment must be a power of two dividing the capacity");
+        }
+
+        if (size > m_capacity)
+            return InvalidOffset;
+
+        uint64_t start = (m_head + alignment - 1) & ~(alignment - 1);
+
+        // Wrap rather than straddle the end
+        if (start % m_capacity + size > m_capacity)
+        {
+            start = (start / m_capacity + 1) * m_capacity;
+        }
+
+        // With nothing live the skipped bytes don't need to be kept, so
+        // an allocation as large as the ring always fits
+        if (m_head == m_tail)
+        {
+            m_tail = start;
+        }
+
+        if (start + size - m_tail > m_capacity)
+            return InvalidOffset;
+
+        m_head = start + size;
+        return start % m_capacity;
+    }
+
+    inline void LinearRingAllocator::EndFrame(uint64_t fenceValue)
+    {
+        if (m_pendingCount == m_pending.size())
+        {
+            throw std::runtime_error("LinearRingAllocator has too many frames in flight");
+        }
+
+        const auto index = (m_firstPending + m_pendingCount) % static_cast<uint32_t>(m_pending.size());
+        m_pending[index] = { fenceValue, m_head };
+        m_pendingCount++;
+        m_frameStart = m_head;
+    }
+
+    inline void LinearRingAllocator::ReleaseCompletedFrames(uint64_t completedFenceValue)
+    {
+        while (m_pendingCount > 0 && m_pending[m_firstPending].FenceValue <= completedFenceValue)
+        {
+            m_tail = std::max(m_tail, m_pending[m_firstPending].End);
+            m_firstPending = (m_firstPending + 1) % static_cast<uint32_t>(m_pending.size());
+            m_pendingCount--;
+        }
+    }
+
+    inline uint64_t LinearRingAllocator::GetOldestPendingFence() const
+    {
+        return m_pendingCount > 0 ? m_pending[m_firstPending].FenceValue : 0;
+    }
+
+    inline uint32_t LinearRingAllocator::GetPendingFrameCount() const
+    {
+        return m_pendingCount;
+    }
+
+    inline uint32_t LinearRingAllocator::GetMaxFramesInFlight() const
+    {
+        return static_cast<uint32_t>(m_pending.size());
+    }
+
+    inline uint64_t LinearRingAllocator::GetCapacity() const
+    {
+        return m_capacity;
+    }
+
+    inline uint64_t LinearRingAllocator::GetUsedBytes() const
+    {
+        return m_head - m_tail;
+    }
+
+    inline uint64_t LinearRingAllocator::GetFrameBytes() const
+    {
+        return m_head - m_frameStart;
+    }
+}
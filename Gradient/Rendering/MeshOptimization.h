@@ -0,0 +1,206 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <meshoptimizer.h>
+
+namespace Gradient::Rendering
+{
+    // The meshoptimizer passes a mesh goes through before upload. They run
+    // in the order listed, after welding duplicate vertices.
+    struct MeshOptimizationOptions
+    {
+        // Fraction of the triangles meshopt_simplify tries to remove, and
+        // the largest error it may introduce, relative to the mesh's size
+        float SimplificationRate = 0.f;
+        float SimplificationError = 0.1f;
+
+        // Orders triangles to reuse the post-transform vertex cache
+        bool OptimizeVertexCache = true;
+        // Then reorders clusters of them to draw front to back from most
+        // views, letting ACMR grow by at most OverdrawThreshold times
+        bool OptimizeOverdraw = true;
+        float OverdrawThreshold = 1.05f;
+        // Orders vertices by first use, for fewer cache misses on fetch
+        bool OptimizeVertexFetch = true;
+
+        bool BuildMeshlets = false;
+
+        // Fills in MeshOptimizationReport. Measuring overdraw rasterises
+        // the mesh from several views, which is slow for big meshes, so
+        // only ask for it where the report is shown.
+        bool CollectStatistics = false;
+    };
+
+    // How well a mesh's order suits the GPU's vertex and pixel pipelines
+    struct MeshStatistics
+    {
+        // Post-transform cache size the ratios are measured with
+        static constexpr uint32_t CacheSize = 16;
+
+        uint32_t VertexCount = 0;
+        uint32_t TriangleCount = 0;
+
+        // Vertex shader invocations per triangle. 3 is no reuse at all;
+        // a regular grid approaches 0.5.
+        float Acmr = 0.f;
+        // Vertex shader invocations per vertex, 1 at best
+        float Atvr = 0.f;
+        // Pixels shaded per pixel covered, averaged over several views
+        float Overdraw = 0.f;
+        // Vertex bytes fetched per byte of vertex buffer, 1 at best
+        float Overfetch = 0.f;
+
+        // Positions are three floats at the start of each vertex
+        static MeshStatistics Analyze(const uint32_t* indices,
+            std::size_t indexCount,
+            const void* vertices,
+            std::size_t vertexCount,
+            std::size_t vertexStride);
+    };
+
+    // Left zeroed unless CollectStatistics is set
+    struct MeshOptimizationReport
+    {
+        MeshStatistics Before;
+        MeshStatistics After;
+    };
+
+    // Runs the passes in options on a triangle list in place. Vertex must
+    // start with its position as three floats, as the DirectXTK vertex
+    // types do.
+    template <typename Vertex>
+    MeshOptimizationReport OptimizeMesh(std::vector<Vertex>& vertices,
+        std::vector<uint32_t>& indices,
+        const MeshOptimizationOptions& options);
+
+    inline MeshStatistics MeshStatistics::Analyze(const uint32_t* indices,
+        std::size_t indexCount,
+        const void* vertices,
+        std::size_t vertexCount,
+        std::size_t vertexStride)
+    {
+        MeshStatistics stats;
+        stats.VertexCount = static_cast<uint32_t>(vertexCount);
+        stats.TriangleCount = static_cast<uint32_t>(indexCount / 3);
+
+        if (indexCount == 0)
+            return stats;
+
+        const auto cache = meshopt_analyzeVertexCache(indices, indexCount, vertexCount, CacheSize, 0, 0);
+        const auto overdraw = meshopt_analyzeOverdraw(indices,
+            indexCount,
+            static_cast<const float*>(vertices),
+            vertexCount,
+            vertexStride);
+        const auto fetch = meshopt_analyzeVertexFetch(indices, indexCount, vertexCount, vertexStride);
+
+        stats.Acmr = cache.acmr;
+        stats.Atvr = cache.atvr;
+        stats.Overdraw = overdraw.overdraw;
+        stats.Overfetch = fetch.overfetch;
+
+        return stats;
+    }
+
+    template <typename Vertex>
+    MeshOptimizationReport OptimizeMesh(std::vector<Vertex>& vertices,
+        std::vector<uint32_t>& indices,
+        const MeshOptimizationOptions& options)
+    {
+        static_assert(std::is_trivially_copyable_v<Vertex>, "Vertices are moved with memcpy");
+
+        MeshOptimizationReport report;
+
+        if (indices.empty())
+            return report;
+
+        if (options.CollectStatistics)
+        {
+            report.Before = MeshStatistics::Analyze(indices.data(),
+                indices.size(),
+                vertices.data(),
+                vertices.size(),
+                sizeof(Vertex));
+        }
+
+        // Weld vertices that are identical, so the cache can reuse them
+        std::vector<unsigned int> remap(vertices.size());
+        const std::size_t vertexCount = meshopt_generateVertexRemap(remap.data(),
+            indices.data(),
+            indices.size(),
+            vertices.data(),
+            vertices.size(),
+            sizeof(Vertex));
+
+        std::vector<Vertex> outVertices(vertexCount);
+        meshopt_remapIndexBuffer(indices.data(), indices.data(), indices.size(), remap.data());
+        meshopt_remapVertexBuffer(outVertices.data(), vertices.data(), vertices.size(), sizeof(Vertex), remap.data());
+        vertices = std::move(outVertices);
+
+        const float* positions = reinterpret_cast<const float*>(vertices.data());
+
+        if (options.SimplificationRate > 0.f)
+        {
+            std::vector<uint32_t> simplified(indices.size());
+
+            float error = 0.f;
+            const std::size_t indexCount = meshopt_simplify(simplified.data(),
+                indices.data(),
+                indices.size(),
+                positions,
+                vertices.size(),
+                sizeof(Vertex),
+                static_cast<std::size_t>((1.f - options.SimplificationRate) * indices.size()),
+                options.SimplificationError,
+                meshopt_SimplifyPrune,
+                &error);
+
+            simplified.resize(indexCount);
+            indices = std::move(simplified);
+        }
+
+        if (options.OptimizeVertexCache)
+        {
+            meshopt_optimizeVertexCache(indices.data(), indices.data(), indices.size(), vertices.size());
+        }
+
+        if (options.OptimizeOverdraw)
+        {
+            meshopt_optimizeOverdraw(indices.data(),
+                indices.data(),
+                indices.size(),
+                positions,
+                vertices.size(),
+                sizeof(Vertex),
+                options.OverdrawThreshold);
+        }
+
+        if (options.OptimizeVertexFetch)
+        {
+            // Also drops the vertices simplification left unused
+            const std::size_t fetchedCount = meshopt_optimizeVertexFetch(vertices.data(),
+                indices.data(),
+                indices.size(),
+                vertices.data(),
+                vertices.size(),
+                sizeof(Vertex));
+            vertices.resize(fetchedCount);
+        }
+
+        if (options.CollectStatistics)
+        {
+            report.After = MeshStatistics::Analyze(indices.data(),
+                indices.size(),
+                vertices.data(),
+                vertices.size(),
+                sizeof(Vertex));
+        }
+
+        return report;
+    }
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include <meshoptimizer.h>
+
+namespace Gradient::Rendering
+{
+    // Culling volumes of one meshlet, from meshopt_computeMeshletBounds
+    struct MeshletBounds
+    {
+        std::array<float, 3> Center;
+        float Radius;
+
+        // Every triangle faces away from a camera inside the cone that
+        // opens from ConeApex along -ConeAxis. ConeCutoff is 1 when the
+        // triangles' normals are too spread out for the cone to cull.
+        std::array<float, 3> ConeApex;
+        std::array<float, 3> ConeAxis;
+        float ConeCutoff;
+
+        bool IsBackfacing(const std::array<float, 3>& cameraPosition) const;
+
+        // Planes are (normal, distance) with normals pointing into the
+        // frustum and normalised, so points inside have dot(n, p) + d >= 0
+        bool IsOutsideFrustum(const std::array<std::array<float, 4>, 6>& planes) const;
+    };
+
+    struct Meshlet
+    {
+        uint32_t VertexOffset;
+        uint32_t TriangleOffset;
+        uint32_t VertexCount;
+        uint32_t TriangleCount;
+        MeshletBounds Bounds;
+    };
+
+    // A mesh split into meshlets in the layout mesh shaders read, with
+    // nothing tied to a graphics API, so it can be uploaded as structured
+    // buffers or culled on the CPU.
+    //
+    // A meshlet's vertices are VertexIndices[VertexOffset, VertexOffset +
+    // VertexCount), indices into the mesh's own vertex buffer. Its
+    // triangles are three bytes each from Triangles[TriangleOffset],
+    // indexing the meshlet's vertices. Each meshlet's triangles start on
+    // a four byte boundary, so they can be read as packed uint32s.
+    struct MeshletData
+    {
+        // Fits NVIDIA's recommended mesh shader output limits, and 124
+        // triangles of 3 bytes round to a whole number of uint32s
+        static constexpr uint32_t DefaultMaxVertices = 64;
+        static constexpr uint32_t DefaultMaxTriangles = 124;
+        // How much meshlet building favours tight cones over fewer
+        // meshlets; meshoptimizer suggests 0.25 when cones are used
+        static constexpr float DefaultConeWeight = 0.25f;
+
+        std::vector<Meshlet> Meshlets;
+        std::vector<uint32_t> VertexIndices;
+        std::vector<uint8_t> Triangles;
+
+        static MeshletData Build(const uint32_t* indices,
+            std::size_t indexCount,
+            const float* positions,
+            std::size_t vertexCount,
+            std::size_t positionStride,
+            uint32_t maxVertices = DefaultMaxVertices,
+            uint32_t maxTriangles = DefaultMaxTriangles,
+            float coneWeight = DefaultConeWeight);
+
+        bool Empty() const;
+        uint32_t GetTriangleCount() const;
+    };
+
+    inline bool MeshletBounds::IsBackfacing(const std::array<float, 3>& cameraPosition) const
+    {
+        const float dx = ConeApex[0] - cameraPosition[0];
+        const float dy = ConeApex[1] - cameraPosition[1];
+        const float dz = ConeApex[2] - cameraPosition[2];
+
+        const float length = std::sqrt(dx * dx + dy * dy + dz * dz);
+        if (length == 0.f)
+            return false;
+
+        const float d = (dx * ConeAxis[0] + dy * ConeAxis[1] + dz * ConeAxis[2]) / length;
+        return d >= ConeCutoff;
+    }
+
+    inline bool MeshletBounds::IsOutsideFrustum(const std::array<std::array<float, 4>, 6>& planes) const
+    {
+        for (const auto& plane : planes)
+        {
+            const float distance = plane[0] * Center[0] + plane[1] * Center[1] + plane[2] * Center[2] + plane[3];
+            if (distance < -Radius)
+                return true;
+        }
+
+        return false;
+    }
+
+    inline MeshletData MeshletData::Build(const uint32_t* indices,
+        std::size_t indexCount,
+        const float* positions,
+        std::size_t vertexCount,
+        std::size_t positionStride,
+        uint32_t maxVertices,
+        uint32_t maxTriangles,
+        float coneWeight)
+    {
+        if (maxVertices < 3 || maxVertices > 255 || maxTriangles < 1 || maxTriangles > 512 || maxTriangles % 4 != 0)
+        {
+            throw std::runtime_error("Meshlets need 3 to 255 vertices and a multiple of 4 up to 512 triangles");
+        }
+
+        if (indexCount % 3 != 0)
+        {
+            throw std::runtime_error("Meshlets can only be built from triangle lists");
+        }
+
+        MeshletData data;
+
+        if (indexCount == 0)
+            return data;
+
+        const std::size_t maxMeshlets = meshopt_buildMeshletsBound(indexCount, maxVertices, maxTriangles);
+
+        std::vector<meshopt_Meshlet> meshlets(maxMeshlets);
+        data.VertexIndices.resize(maxMeshlets * maxVertices);
+        data.Triangles.resize(maxMeshlets * maxTriangles * 3);
+
+        const std::size_t meshletCount = meshopt_buildMeshlets(meshlets.data(),
+            data.VertexIndices.data(),
+            data.Triangles.data(),
+            indices,
+            indexCount,
+            positions,
+            vertexCount,
+            positionStride,
+            maxVertices,
+            maxTriangles,
+            coneWeight);
+
+        // Only the last meshlet says how much of the arrays was used
+        const auto& last = meshlets[meshletCount - 1];
+        data.VertexIndices.resize(last.vertex_offset + last.vertex_count);
+        data.Triangles.resize(last.triangle_offset + ((last.triangle_count * 3 + 3) & ~3u));
+
+        data.Meshlets.reserve(meshletCount);
+        for (std::size_t i = 0; i < meshletCount; i++)
+        {
+            const auto& meshlet = meshlets[i];
+
+            const meshopt_Bounds bounds = meshopt_computeMeshletBounds(&data.VertexIndices[meshlet.vertex_offset],
+                &data.Triangles[meshlet.triangle_offset],
+                meshlet.triangle_count,
+                positions,
+                vertexCount,
+                positionStride);
+
+            data.Meshlets.push_back({
+                meshlet.vertex_offset,
+                meshlet.triangle_offset,
+                meshlet.vertex_count,
+                meshlet.triangle_count,
+                {
+                    { bounds.center[0], bounds.center[1], bounds.center[2] },
+                    bounds.radius,
+                    { bounds.cone_apex[0], bounds.cone_apex[1], bounds.cone_apex[2] },
+                    { bounds.cone_axis[0], bounds.cone_axis[1], bounds.cone_axis[2] },
+                    bounds.cone_cutoff
+                }
+            });
+        }
+
+        return data;
+    }
+
+    inline bool MeshletData::Empty() const
+    {
+        return Meshlets.empty();
+    }
+
+    inline uint32_t MeshletData::GetTriangleCount() const
+    {
+        uint32_t count = 0;
+        for (const auto& meshlet : Meshlets)
+        {
+            count += meshlet.TriangleCount;
+        }
+        return count;
+    }
+}
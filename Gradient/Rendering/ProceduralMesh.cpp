@@ -1,9 +1,7 @@
 #include "pch.h"
 #include "Gradient/Rendering/ProceduralMesh.h"
-#include <directxtk12/BufferHelpers.h>
-#include <directxtk12/ResourceUploadBatch.h>
+#include "Gradient/UploadManager.h"
 #include <map>
-#include <meshoptimizer.h>
 
 using namespace DirectX::SimpleMath;
 
@@ -1070,81 +1068,32 @@ namespace Gradient::Rendering
             0);
     }
 
-    std::tuple<ProceduralMesh::VertexCollection, ProceduralMesh::IndexCollection>
-        OptimizeMesh(const ProceduralMesh::VertexCollection& vertices,
-            const ProceduralMesh::IndexCollection& indices,
-            float simplificationRate = 0.0f,
-            float errorRate = 0.1f)
-    {
-        std::vector<unsigned int> remap(vertices.size());
-        auto vertexCount = meshopt_generateVertexRemap(&remap[0],
-            indices.data(),
-            indices.size(),
-            vertices.data(),
-            vertices.size(),
-            sizeof(ProceduralMesh::VertexType));
-
-        ProceduralMesh::VertexCollection outVertices(vertexCount);
-        ProceduralMesh::IndexCollection outIndices(indices.size());
-
-        meshopt_remapIndexBuffer(outIndices.data(),
-            indices.data(),
-            indices.size(),
-            remap.data());
-
-        meshopt_remapVertexBuffer(outVertices.data(),
-            vertices.data(),
-            vertices.size(),
-            sizeof(ProceduralMesh::VertexType),
-            remap.data());
-
-        if (simplificationRate > 0.f)
-        {
-            ProceduralMesh::IndexCollection simplifiedIndices(indices.size());
-
-            float error = 0.f;
-            size_t newIndexCount = meshopt_simplify(simplifiedIndices.data(), outIndices.data(), outIndices.size(),
-                &outVertices[0].position.x, outVertices.size(), sizeof(ProceduralMesh::VertexType),
-                (1.f - simplificationRate) * outIndices.size(), errorRate, meshopt_SimplifyPrune, &error);
-
-            simplifiedIndices.resize(newIndexCount);
-            outIndices = simplifiedIndices;
-            outIndices.resize(newIndexCount);
-        }
-
-        meshopt_optimizeVertexCache(outIndices.data(),
-            outIndices.data(),
-            outIndices.size(),
-            outVertices.size());
-        meshopt_optimizeOverdraw(outIndices.data(),
-            outIndices.data(),
-            outIndices.size(),
-            &outVertices[0].position.x,
-            outVertices.size(),
-            sizeof(ProceduralMesh::VertexType),
-            1.05f);
-
-        size_t newVertexCount =
-            meshopt_optimizeVertexFetch(outVertices.data(),
-                outIndices.data(),
-                outIndices.size(),
-                outVertices.data(),
-                outVertices.size(),
-                sizeof(ProceduralMesh::VertexType));
-
-        outVertices.resize(newVertexCount);
-
-        return std::make_tuple(outVertices, outIndices);
-    }
-
     void ProceduralMesh::Initialize(ID3D12Device* device,
         ID3D12CommandQueue* cq,
         const VertexCollection& vertices,
         const IndexCollection& indices,
-        float simplificationRate,
-        float errorRate)
+        const MeshOptimizationOptions& options)
     {
-        auto [optimizedVertices, optimizedIndices] = OptimizeMesh(vertices, indices, simplificationRate, errorRate);
+        VertexCollection optimizedVertices = vertices;
+        IndexCollection optimizedIndices = indices;
+        m_optimizationReport = OptimizeMesh(optimizedVertices, optimizedIndices, options);
+
+        // Simplification can prune every triangle of a small part
+        if (optimizedVertices.empty() || optimizedIndices.empty())
+        {
+            throw std::runtime_error("Cannot create a mesh with no triangles");
+        }
+
+        // Built from the cache optimised indices, so each meshlet covers
+        // a compact patch of the surface and its cone stays narrow
+        if (options.BuildMeshlets)
+        {
+            m_meshlets = MeshletData::Build(optimizedIndices.data(),
+                optimizedIndices.size(),
+                reinterpret_cast<const float*>(optimizedVertices.data()),
+                optimizedVertices.size(),
+                sizeof(VertexType));
+        }
 
         NarrowIndexCollection narrowIndices;
 
@@ -1160,38 +1109,33 @@ namespace Gradient::Rendering
         }
 
 
-        DirectX::ResourceUploadBatch uploadBatch(device);
-
-        uploadBatch.Begin();
+        auto um = UploadManager::Get();
 
-        DX::ThrowIfFailed(
-            DirectX::CreateStaticBuffer(device, uploadBatch,
-                optimizedVertices,
-                D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER,
-                m_vertexBuffer.ReleaseAndGetAddressOf()));
+        // The uploads are batched with others and run before the next
+        // frame, so nothing here waits on the GPU
+        m_vertexUpload = um->CreateStaticBuffer(device, cq,
+            optimizedVertices.data(),
+            optimizedVertices.size() * sizeof(VertexType),
+            D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER,
+            m_vertexBuffer.ReleaseAndGetAddressOf());
 
         if (use16bit)
         {
-            DX::ThrowIfFailed(
-                DirectX::CreateStaticBuffer(device,
-                    uploadBatch,
-                    narrowIndices,
-                    D3D12_RESOURCE_STATE_INDEX_BUFFER,
-                    m_indexBuffer.ReleaseAndGetAddressOf()));
+            m_indexUpload = um->CreateStaticBuffer(device, cq,
+                narrowIndices.data(),
+                narrowIndices.size() * sizeof(uint16_t),
+                D3D12_RESOURCE_STATE_INDEX_BUFFER,
+                m_indexBuffer.ReleaseAndGetAddressOf());
         }
         else
         {
-            DX::ThrowIfFailed(
-                DirectX::CreateStaticBuffer(device,
-                    uploadBatch,
-                    optimizedIndices,
-                    D3D12_RESOURCE_STATE_INDEX_BUFFER,
-                    m_indexBuffer.ReleaseAndGetAddressOf()));
+            m_indexUpload = um->CreateStaticBuffer(device, cq,
+                optimizedIndices.data(),
+                optimizedIndices.size() * sizeof(uint32_t),
+                D3D12_RESOURCE_STATE_INDEX_BUFFER,
+                m_indexBuffer.ReleaseAndGetAddressOf());
         }
 
-        auto uploadFinished = uploadBatch.End(cq);
-
-        // Create the bounding box while waiting for the upload.
         {
             std::vector<DirectX::XMFLOAT3> points;
 
@@ -1207,8 +1151,6 @@ namespace Gradient::Rendering
             );
         }
 
-        uploadFinished.wait();
-
         m_vbv.BufferLocation = m_vertexBuffer->GetGPUVirtualAddress();
         m_vbv.StrideInBytes = sizeof(VertexType);
         m_vbv.SizeInBytes = m_vbv.StrideInBytes * optimizedVertices.size();
@@ -1234,18 +1176,35 @@ namespace Gradient::Rendering
         return m_boundingBox;
     }
 
+    UploadTicket ProceduralMesh::GetUploadTicket() const
+    {
+        // Batches complete in order, so the later ticket covers both
+        return m_indexUpload.Batch > m_vertexUpload.Batch ? m_indexUpload : m_vertexUpload;
+    }
+
+    const MeshletData& ProceduralMesh::GetMeshlets() const
+    {
+        return m_meshlets;
+    }
+
+    const MeshOptimizationReport& ProceduralMesh::GetOptimizationReport() const
+    {
+        return m_optimizationReport;
+    }
+
     ProceduralMesh ProceduralMesh::CreateBox(
         ID3D12Device* device,
         ID3D12CommandQueue* cq,
         const DirectX::XMFLOAT3& size,
         bool rhcoords,
-        bool invertn)
+        bool invertn,
+        const MeshOptimizationOptions& options)
     {
         VertexCollection vertices;
         IndexCollection indices;
         ComputeBox(vertices, indices, size, rhcoords, invertn);
 
-        return CreateFromVertices(device, cq, vertices, indices);
+        return CreateFromVertices(device, cq, vertices, indices, options);
     }
 
     ProceduralMesh ProceduralMesh::CreateSphere(
@@ -1254,13 +1213,14 @@ namespace Gradient::Rendering
         float diameter,
         size_t tessellation,
         bool rhcoords,
-        bool invertn)
+        bool invertn,
+        const MeshOptimizationOptions& options)
     {
         VertexCollection vertices;
         IndexCollection indices;
         ComputeSphere(vertices, indices, diameter, tessellation, rhcoords, invertn);
 
-        return CreateFromVertices(device, cq, vertices, indices);
+        return CreateFromVertices(device, cq, vertices, indices, options);
     }
 
     ProceduralMesh ProceduralMesh::CreateGeoSphere(
@@ -1268,13 +1228,14 @@ namespace Gradient::Rendering
         ID3D12CommandQueue* cq,
         float diameter,
         size_t tessellation,
-        bool rhcoords)
+        bool rhcoords,
+        const MeshOptimizationOptions& options)
     {
         VertexCollection vertices;
         IndexCollection indices;
         ComputeGeoSphere(vertices, indices, diameter, tessellation, rhcoords);
 
-        return CreateFromVertices(device, cq, vertices, indices);
+        return CreateFromVertices(device, cq, vertices, indices, options);
     }
 
     ProceduralMesh ProceduralMesh::CreateGrid(ID3D12Device* device,
@@ -1282,25 +1243,27 @@ namespace Gradient::Rendering
         const float& width,
         const float& height,
         const float& divisions,
-        bool tiled)
+        bool tiled,
+        const MeshOptimizationOptions& options)
     {
         VertexCollection vertices;
         IndexCollection indices;
         ComputeGrid(vertices, indices, width, height, divisions, tiled);
 
-        return CreateFromVertices(device, cq, vertices, indices);
+        return CreateFromVertices(device, cq, vertices, indices, options);
     }
 
     ProceduralMesh ProceduralMesh::CreateBillboard(ID3D12Device* device,
         ID3D12CommandQueue* cq,
         const float& width,
-        const float& height)
+        const float& height,
+        const MeshOptimizationOptions& options)
     {
         VertexCollection vertices;
         IndexCollection indices;
         ComputeBillboard(vertices, indices, width, height);
 
-        return CreateFromVertices(device, cq, vertices, indices);
+        return CreateFromVertices(device, cq, vertices, indices, options);
     }
 
     ProceduralMesh ProceduralMesh::CreateFrustum(
@@ -1308,7 +1271,8 @@ namespace Gradient::Rendering
         ID3D12CommandQueue* cq,
         const float& topRadius,
         const float& bottomRadius,
-        const float& height)
+        const float& height,
+        const MeshOptimizationOptions& options)
     {
         VertexCollection vertices;
         IndexCollection indices;
@@ -1319,7 +1283,7 @@ namespace Gradient::Rendering
             18,
             height);
 
-        return CreateFromVertices(device, cq, vertices, indices);
+        return CreateFromVertices(device, cq, vertices, indices, options);
     }
 
     ProceduralMesh::MeshPart ProceduralMesh::CreateAngledFrustumPart(
@@ -1347,7 +1311,8 @@ namespace Gradient::Rendering
         const float& bottomRadius,
         const float& topRadius,
         const DirectX::SimpleMath::Vector3& topCentre,
-        const DirectX::SimpleMath::Quaternion& topRotation)
+        const DirectX::SimpleMath::Quaternion& topRotation,
+        const MeshOptimizationOptions& options)
     {
         VertexCollection vertices;
         IndexCollection indices;
@@ -1358,7 +1323,7 @@ namespace Gradient::Rendering
             topRotation,
             18);
 
-        return CreateFromVertices(device, cq, vertices, indices);
+        return CreateFromVertices(device, cq, vertices, indices, options);
     }
 
     ProceduralMesh ProceduralMesh::CreateFromVertices(
@@ -1366,8 +1331,7 @@ namespace Gradient::Rendering
         ID3D12CommandQueue* cq,
         const VertexCollection& vertices,
         const IndexCollection& indices,
-        float simplificationRate,
-        float errorRate
+        const MeshOptimizationOptions& options
     )
     {
         // Indices are 32 bit, can't have more vertices 
@@ -1375,7 +1339,7 @@ namespace Gradient::Rendering
         assert(vertices.size() < UINT32_MAX);
 
         ProceduralMesh primitive;
-        primitive.Initialize(device, cq, vertices, indices, simplificationRate, errorRate);
+        primitive.Initialize(device, cq, vertices, indices, options);
 
         return primitive;
     }
@@ -1384,8 +1348,7 @@ namespace Gradient::Rendering
         ID3D12Device* device,
         ID3D12CommandQueue* cq,
         const MeshPart& part,
-        float simplificationRate,
-        float errorRate
+        const MeshOptimizationOptions& options
     )
     {
         return ProceduralMesh::CreateFromVertices(
@@ -1393,8 +1356,7 @@ namespace Gradient::Rendering
             cq,
             part.Vertices,
             part.Indices,
-            simplificationRate,
-            errorRate
+            options
         );
     }
 
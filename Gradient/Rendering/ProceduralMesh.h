@@ -3,6 +3,9 @@
 #include "pch.h"
 #include <memory>
 #include "Gradient/Rendering/IDrawable.h"
+#include "Gradient/Rendering/MeshOptimization.h"
+#include "Gradient/Rendering/Meshlets.h"
+#include "Gradient/UploadScheduler.h"
 #include <directxtk12/VertexTypes.h>
 #include <directxtk12/SimpleMath.h>
 
@@ -22,6 +25,13 @@ namespace Gradient::Rendering
         virtual void Draw(ID3D12GraphicsCommandList* cl, uint32_t numInstances = 1) override;
 
         const DirectX::BoundingBox& GetBoundingBox() const;
+        // The later of the vertex and index buffer uploads, so waiting on it
+        // covers both
+        UploadTicket GetUploadTicket() const;
+        // Empty unless the mesh was created with BuildMeshlets. Vertex
+        // indices refer to this mesh's vertex buffer.
+        const MeshletData& GetMeshlets() const;
+        const MeshOptimizationReport& GetOptimizationReport() const;
 
         struct MeshPart
         {
@@ -42,7 +52,8 @@ namespace Gradient::Rendering
             ID3D12CommandQueue* cq,
             const DirectX::XMFLOAT3& size,
             bool rhcoords = true,
-            bool invertn = false);
+            bool invertn = false,
+            const MeshOptimizationOptions& options = {});
 
         static ProceduralMesh CreateSphere(
             ID3D12Device* device,
@@ -50,14 +61,16 @@ namespace Gradient::Rendering
             float diameter = 1,
             size_t tessellation = 16,
             bool rhcoords = true,
-            bool invertn = false);
+            bool invertn = false,
+            const MeshOptimizationOptions& options = {});
 
         static ProceduralMesh CreateGeoSphere(
             ID3D12Device* device,
             ID3D12CommandQueue* cq,
             float diameter = 1,
             size_t tessellation = 3,
-            bool rhcoords = true);
+            bool rhcoords = true,
+            const MeshOptimizationOptions& options = {});
 
         static ProceduralMesh CreateGrid(
             ID3D12Device* device,
@@ -65,20 +78,23 @@ namespace Gradient::Rendering
             const float& width = 10,
             const float& height = 10,
             const float& divisions = 10,
-            bool tiled = true);
+            bool tiled = true,
+            const MeshOptimizationOptions& options = {});
 
         static ProceduralMesh CreateBillboard(
             ID3D12Device* device,
             ID3D12CommandQueue* cq,
             const float& width = 1,
-            const float& height = 1);
+            const float& height = 1,
+            const MeshOptimizationOptions& options = {});
 
         static ProceduralMesh CreateFrustum(
             ID3D12Device* device,
             ID3D12CommandQueue* cq,
             const float& topRadius = 1,
             const float& bottomRadius = 1,
-            const float& height = 3);
+            const float& height = 3,
+            const MeshOptimizationOptions& options = {});
 
         static MeshPart CreateAngledFrustumPart(
             float bottomRadius,
@@ -94,23 +110,22 @@ namespace Gradient::Rendering
             const float& bottomRadius = 1,
             const float& topRadius = 1,
             const DirectX::SimpleMath::Vector3& topCentre = { 0, 3, 0 },
-            const DirectX::SimpleMath::Quaternion& topRotation = DirectX::SimpleMath::Quaternion::Identity);
+            const DirectX::SimpleMath::Quaternion& topRotation = DirectX::SimpleMath::Quaternion::Identity,
+            const MeshOptimizationOptions& options = {});
 
         static ProceduralMesh CreateFromVertices(
             ID3D12Device* device,
             ID3D12CommandQueue* cq,
             const VertexCollection& vertices,
             const IndexCollection& indices,
-            float simplificationRate = 0.f,
-            float errorRate = 0.1f
+            const MeshOptimizationOptions& options = {}
         );
 
         static ProceduralMesh CreateFromPart(
             ID3D12Device* device,
             ID3D12CommandQueue* cq,
             const MeshPart& part,
-            float simplificationRate = 0.f,
-            float errorRate = 0.1f
+            const MeshOptimizationOptions& options = {}
         );
 
     private:
@@ -120,8 +135,7 @@ namespace Gradient::Rendering
             ID3D12CommandQueue* cq,
             const VertexCollection& vertices,
             const IndexCollection& indices,
-            float simplificationRate = 0.f,
-            float errorRate = 0.1f);
+            const MeshOptimizationOptions& options = {});
 
         Microsoft::WRL::ComPtr<ID3D12Resource> m_vertexBuffer;
         Microsoft::WRL::ComPtr<ID3D12Resource> m_indexBuffer;
@@ -131,5 +145,9 @@ namespace Gradient::Rendering
         D3D12_VERTEX_BUFFER_VIEW m_vbv;
         D3D12_INDEX_BUFFER_VIEW m_ibv;
         DirectX::BoundingBox m_boundingBox;
+        UploadTicket m_vertexUpload;
+        UploadTicket m_indexUpload;
+        MeshletData m_meshlets;
+        MeshOptimizationReport m_optimizationReport;
     };
 }
\ No newline at end of file
@@ -0,0 +1,303 @@
+#include "pch.h"
+
+#include "Gradient/UploadManager.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Gradient
+{
+    std::unique_ptr<UploadManager> UploadManager::s_instance;
+
+    void UploadManager::Initialize(ID3D12Device* device)
+    {
+        s_instance = std::make_unique<UploadManager>(device);
+    }
+
+    void UploadManager::Shutdown()
+    {
+        s_instance.reset();
+    }
+
+    UploadManager* UploadManager::Get()
+    {
+        return s_instance.get();
+    }
+
+    UploadManager::UploadManager(ID3D12Device* device)
+        : m_device(device),
+        m_scheduler(*this, StagingSize, MaxBatchesInFlight, MaxBatchBytes)
+    {
+        auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+        auto desc = CD3DX12_RESOURCE_DESC::Buffer(StagingSize);
+
+        DX::ThrowIfFailed(
+            device->CreateCommittedResource(
+                &heapProperties,
+                D3D12_HEAP_FLAG_NONE,
+                &desc,
+                D3D12_RESOURCE_STATE_GENERIC_READ,
+                nullptr,
+                IID_PPV_ARGS(m_staging.ReleaseAndGetAddressOf())));
+        m_staging->SetName(L"Upload Staging Ring");
+
+        const auto readRange = CD3DX12_RANGE(0, 0);
+        void* mapped = nullptr;
+        DX::ThrowIfFailed(m_staging->Map(0, &readRange, &mapped));
+        m_stagingData = static_cast<uint8_t*>(mapped);
+
+        DX::ThrowIfFailed(
+            device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(m_fence.ReleaseAndGetAddressOf())));
+        m_fence->SetName(L"Upload Fence");
+    }
+
+    UploadManager::~UploadManager()
+    {
+        // The staging ring and destinations must outlive the copies
+        std::lock_guard lock(m_mutex);
+        m_scheduler.WaitForAll();
+    }
+
+    UploadTicket UploadManager::CreateStaticBuffer(ID3D12Device* device,
+        ID3D12CommandQueue* cq,
+        const void* data,
+        uint64_t size,
+        D3D12_RESOURCE_STATES afterState,
+        ID3D12Resource** buffer,
+        D3D12_RESOURCE_FLAGS flags)
+    {
+        if (size == 0)
+        {
+            throw std::runtime_error("Cannot create an empty static buffer");
+        }
+
+        // Buffers always start in the common state, and are promoted to
+        // copy dest by the copy
+        auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+        auto desc = CD3DX12_RESOURCE_DESC::Buffer(size, flags);
+
+        DX::ThrowIfFailed(
+            device->CreateCommittedResource(
+                &heapProperties,
+                D3D12_HEAP_FLAG_NONE,
+                &desc,
+                D3D12_RESOURCE_STATE_COMMON,
+                nullptr,
+                IID_PPV_ARGS(buffer)));
+
+        return UploadBuffer(cq, *buffer, data, size, afterState);
+    }
+
+    UploadTicket UploadManager::UploadBuffer(ID3D12CommandQueue* cq,
+        ID3D12Resource* destination,
+        const void* data,
+        uint64_t size,
+        D3D12_RESOURCE_STATES afterState)
+    {
+        std::lock_guard lock(m_mutex);
+
+        SetQueue(cq);
+        ReleaseCompletedResources();
+
+        const auto reservation = m_scheduler.Reserve(size, D3D12_RAW_UAV_SRV_BYTE_ALIGNMENT);
+
+        ID3D12Resource* source = m_staging.Get();
+        uint64_t sourceOffset = reservation.Offset;
+
+        if (reservation.Offset == UploadScheduler::InvalidOffset)
+        {
+            // Too big for the ring; stage it in a buffer of its own
+            Microsoft::WRL::ComPtr<ID3D12Resource> staging;
+
+            auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+            auto desc = CD3DX12_RESOURCE_DESC::Buffer(size);
+
+            DX::ThrowIfFailed(
+                m_device->CreateCommittedResource(
+                    &heapProperties,
+                    D3D12_HEAP_FLAG_NONE,
+                    &desc,
+                    D3D12_RESOURCE_STATE_GENERIC_READ,
+                    nullptr,
+                    IID_PPV_ARGS(staging.ReleaseAndGetAddressOf())));
+
+            const auto readRange = CD3DX12_RANGE(0, 0);
+            void* mapped = nullptr;
+            DX::ThrowIfFailed(staging->Map(0, &readRange, &mapped));
+            std::memcpy(mapped, data, size);
+            staging->Unmap(0, nullptr);
+
+            source = staging.Get();
+            sourceOffset = 0;
+            m_inFlightResources.push_back({ reservation.Ticket.Batch, staging });
+        }
+        else
+        {
+            std::memcpy(m_stagingData + reservation.Offset, data, size);
+        }
+
+        BeginRecording();
+
+        m_commandList->CopyBufferRegion(destination, 0, source, sourceOffset, size);
+
+        if (afterState != D3D12_RESOURCE_STATE_COPY_DEST)
+        {
+            const auto barrier = CD3DX12_RESOURCE_BARRIER::Transition(destination,
+                D3D12_RESOURCE_STATE_COPY_DEST,
+                afterState);
+            m_commandList->ResourceBarrier(1, &barrier);
+        }
+
+        m_inFlightResources.push_back({ reservation.Ticket.Batch, destination });
+
+        return reservation.Ticket;
+    }
+
+    void UploadManager::Submit(UploadTicket ticket)
+    {
+        if (ticket.Batch <= m_submittedBatch.load(std::memory_order_acquire))
+            return;
+
+        std::lock_guard lock(m_mutex);
+        m_scheduler.Submit(ticket);
+    }
+
+    void UploadManager::Wait(UploadTicket ticket)
+    {
+        Submit(ticket);
+
+        // Waiting on the fence needs no lock, so other threads can keep
+        // uploading meanwhile
+        if (m_fence->GetCompletedValue() < ticket.Batch)
+        {
+            DX::ThrowIfFailed(m_fence->SetEventOnCompletion(ticket.Batch, nullptr));
+        }
+    }
+
+    UploadTicket UploadManager::Flush()
+    {
+        std::lock_guard lock(m_mutex);
+        return m_scheduler.Flush();
+    }
+
+    void UploadManager::WaitForAll()
+    {
+        std::lock_guard lock(m_mutex);
+        m_scheduler.WaitForAll();
+        ReleaseCompletedResources();
+    }
+
+    UploadScheduler::Stats UploadManager::GetStats()
+    {
+        std::lock_guard lock(m_mutex);
+        return m_scheduler.GetStats();
+    }
+
+    void UploadManager::SubmitBatch(uint64_t batch)
+    {
+        if (m_recording)
+        {
+            DX::ThrowIfFailed(m_commandList->Close());
+
+            ID3D12CommandList* lists[] = { m_commandList.Get() };
+            m_queue->ExecuteCommandLists(1, lists);
+            m_recording = false;
+
+            for (auto& allocator : m_allocators)
+            {
+                if (allocator.Batch == UINT64_MAX)
+                {
+                    allocator.Batch = batch;
+                }
+            }
+        }
+
+        DX::ThrowIfFailed(m_queue->Signal(m_fence.Get(), batch));
+        m_submittedBatch.store(batch, std::memory_order_release);
+    }
+
+    uint64_t UploadManager::GetCompletedBatch()
+    {
+        return m_fence->GetCompletedValue();
+    }
+
+    void UploadManager::WaitForBatch(uint64_t batch)
+    {
+        if (m_fence->GetCompletedValue() < batch)
+        {
+            DX::ThrowIfFailed(m_fence->SetEventOnCompletion(batch, nullptr));
+        }
+    }
+
+    void UploadManager::SetQueue(ID3D12CommandQueue* cq)
+    {
+        if (cq == m_queue)
+            return;
+
+        // The open batch goes to the queue its uploads were made for
+        if (m_queue != nullptr)
+        {
+            m_scheduler.Flush();
+        }
+
+        m_queue = cq;
+    }
+
+    void UploadManager::BeginRecording()
+    {
+        if (m_recording)
+            return;
+
+        // Reuse the allocator of a batch the GPU has finished with
+        const uint64_t completed = m_fence->GetCompletedValue();
+        auto allocator = std::find_if(m_allocators.begin(), m_allocators.end(), [completed](const BatchAllocator& a)
+            {
+                return a.Batch <= completed;
+            });
+
+        if (allocator == m_allocators.end())
+        {
+            BatchAllocator created = { nullptr, 0 };
+            DX::ThrowIfFailed(
+                m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT,
+                    IID_PPV_ARGS(created.Allocator.ReleaseAndGetAddressOf())));
+            created.Allocator->SetName(L"Upload Command Allocator");
+
+            m_allocators.push_back(created);
+            allocator = m_allocators.end() - 1;
+        }
+        else
+        {
+            DX::ThrowIfFailed(allocator->Allocator->Reset());
+        }
+
+        allocator->Batch = UINT64_MAX;
+
+        if (m_commandList == nullptr)
+        {
+            DX::ThrowIfFailed(
+                m_device->CreateCommandList(0,
+                    D3D12_COMMAND_LIST_TYPE_DIRECT,
+                    allocator->Allocator.Get(),
+                    nullptr,
+                    IID_PPV_ARGS(m_commandList.ReleaseAndGetAddressOf())));
+            m_commandList->SetName(L"Upload Command List");
+        }
+        else
+        {
+            DX::ThrowIfFailed(m_commandList->Reset(allocator->Allocator.Get(), nullptr));
+        }
+
+        m_recording = true;
+    }
+
+    void UploadManager::ReleaseCompletedResources()
+    {
+        const uint64_t completed = m_fence->GetCompletedValue();
+
+        std::erase_if(m_inFlightResources, [completed](const InFlightResource& resource)
+            {
+                return resource.Batch <= completed;
+            });
+    }
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "pch.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "Gradient/UploadScheduler.h"
+
+namespace Gradient
+{
+    // Uploads buffer data through one persistently mapped staging ring
+    // and batches the copies, so creating many buffers costs a handful of
+    // submissions and no waits. UploadScheduler decides the staging space
+    // and batching; this records the copies and submits each batch to the
+    // queue the uploads were made for, followed by a fence signal.
+    //
+    // Uploads return a ticket. Work submitted to the same queue after the
+    // ticket's batch sees the data, so the GPU never needs the CPU to wait:
+    // Game flushes the open batch before each frame's command list is
+    // executed, and the frame's first use of a buffer is ordered after its
+    // copy. Wait blocks the CPU until a copy is done, for anything that
+    // uses the data some other way. Safe to call from any thread.
+    class UploadManager : private UploadScheduler::Backend
+    {
+    public:
+        static void Initialize(ID3D12Device* device);
+        static void Shutdown();
+        static UploadManager* Get();
+
+        explicit UploadManager(ID3D12Device* device);
+        ~UploadManager();
+
+        // Creates a default heap buffer holding a copy of data. The buffer
+        // reaches afterState once the ticket's batch has run.
+        UploadTicket CreateStaticBuffer(ID3D12Device* device,
+            ID3D12CommandQueue* cq,
+            const void* data,
+            uint64_t size,
+            D3D12_RESOURCE_STATES afterState,
+            ID3D12Resource** buffer,
+            D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE);
+
+        // Copies data to the start of destination, which must be in the
+        // common or copy dest state and not in use until the ticket's
+        // batch has run
+        UploadTicket UploadBuffer(ID3D12CommandQueue* cq,
+            ID3D12Resource* destination,
+            const void* data,
+            uint64_t size,
+            D3D12_RESOURCE_STATES afterState);
+
+        // Cheap once the ticket's batch has been submitted
+        void Submit(UploadTicket ticket);
+        void Wait(UploadTicket ticket);
+        UploadTicket Flush();
+        void WaitForAll();
+
+        UploadScheduler::Stats GetStats();
+
+    private:
+        // 32 MB of staging covers every buffer the scene creates
+        static constexpr uint64_t StagingSize = 32 * 1024 * 1024;
+        static constexpr uint64_t MaxBatchBytes = 8 * 1024 * 1024;
+        static constexpr uint32_t MaxBatchesInFlight = 8;
+
+        struct BatchAllocator
+        {
+            Microsoft::WRL::ComPtr<ID3D12CommandAllocator> Allocator;
+            // UINT64_MAX while recording the open batch
+            uint64_t Batch;
+        };
+
+        struct InFlightResource
+        {
+            uint64_t Batch;
+            Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+        };
+
+        void SubmitBatch(uint64_t batch) override;
+        uint64_t GetCompletedBatch() override;
+        void WaitForBatch(uint64_t batch) override;
+
+        void SetQueue(ID3D12CommandQueue* cq);
+        void BeginRecording();
+        void ReleaseCompletedResources();
+
+        static std::unique_ptr<UploadManager> s_instance;
+
+        ID3D12Device* m_device;
+
+        std::mutex m_mutex;
+        UploadScheduler m_scheduler;
+
+        Microsoft::WRL::ComPtr<ID3D12Resource> m_staging;
+        uint8_t* m_stagingData = nullptr;
+
+        Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> m_commandList;
+        std::vector<BatchAllocator> m_allocators;
+        bool m_recording = false;
+        ID3D12CommandQueue* m_queue = nullptr;
+
+        Microsoft::WRL::ComPtr<ID3D12Fence> m_fence;
+        std::atomic<uint64_t> m_submittedBatch = 0;
+
+        // Destinations and one-off staging buffers, kept alive until the
+        // copies that use them have run
+        std::vector<InFlightResource> m_inFlightResources;
+    };
+}
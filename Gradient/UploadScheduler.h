@@ -0,0 +1,281 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+#include "Gradient/LinearRingAllocator.h"
+
+namespace Gradient
+{
+    // Identifies the batch an upload went out in. Batch 0 means there is
+    // nothing to wait for.
+    struct UploadTicket
+    {
+        uint64_t Batch = 0;
+    };
+
+    // Decides where uploads are staged and when they are submitted,
+    // independent of the graphics API. The backend records the copies and
+    // submits them; this class hands out staging space from a ring and
+    // groups uploads into batches, so many uploads share one submission
+    // and nothing waits for the GPU until something needs the data.
+    //
+    //  auto reservation = scheduler.Reserve(bytes, alignment);
+    //  std::memcpy(staging + reservation.Offset, data, bytes);
+    //  // record a copy from the staging offset to the destination
+    //  ...
+    //  scheduler.Wait(reservation.Ticket); // only when the data is needed
+    //
+    // The open batch is submitted when it has grown past maxBatchBytes,
+    // when its staging space is needed, or when one of its tickets is
+    // waited on or submitted explicitly. Staging space goes back to the
+    // ring once the GPU reports the batch complete; if the ring is full,
+    // Reserve waits for the oldest batch.
+    class UploadScheduler
+    {
+    public:
+        static constexpr uint64_t InvalidOffset = LinearRingAllocator::InvalidOffset;
+
+        class Backend
+        {
+        public:
+            virtual ~Backend() = default;
+
+            // Submit every copy recorded since the last submission. The
+            // batch counts as complete once the GPU passes batch.
+            virtual void SubmitBatch(uint64_t batch) = 0;
+            // The newest batch the GPU has completed
+            virtual uint64_t GetCompletedBatch() = 0;
+            // Block until the GPU completes batch
+            virtual void WaitForBatch(uint64_t batch) = 0;
+        };
+
+        struct Reservation
+        {
+            // Into the staging ring, InvalidOffset if the upload is larger
+            // than the ring; the caller then stages it elsewhere, and the
+            // ticket still says when it is done
+            uint64_t Offset;
+            UploadTicket Ticket;
+        };
+
+        struct Stats
+        {
+            uint64_t Uploads = 0;
+            uint64_t StagedBytes = 0;
+            uint64_t OversizedUploads = 0;
+            uint64_t Batches = 0;
+            // Times the CPU waited on the GPU, for staging space or a ticket
+            uint64_t Stalls = 0;
+        };
+
+        UploadScheduler(Backend& backend,
+            uint64_t stagingCapacity,
+            uint32_t maxBatchesInFlight,
+            uint64_t maxBatchBytes);
+
+        // Staging space for one upload in the open batch. The copy must be
+        // recorded before the next call into the scheduler.
+        Reservation Reserve(uint64_t size, uint64_t alignment);
+
+        // Submits the open batch, if it has any uploads. Returns the ticket
+        // of the newest submitted batch.
+        UploadTicket Flush();
+
+        // Submits the ticket's batch if it is still open, without waiting.
+        // Work submitted afterwards on the same queue sees the data.
+        void Submit(UploadTicket ticket);
+        bool IsSubmitted(UploadTicket ticket) const;
+        bool IsComplete(UploadTicket ticket);
+        // Submits the ticket's batch if needed and waits for the GPU
+        void Wait(UploadTicket ticket);
+        // Submits and waits for everything
+        void WaitForAll();
+
+        uint64_t GetOpenBatch() const;
+        uint64_t GetOpenBatchBytes() const;
+        uint64_t GetStagingCapacity() const;
+        uint64_t GetStagingUsedBytes() const;
+        const Stats& GetStats() const;
+
+    private:
+        void ReleaseCompleted();
+        void WaitForBatch(uint64_t batch);
+
+        Backend& m_backend;
+        LinearRingAllocator m_staging;
+        uint64_t m_maxBatchBytes;
+
+        // Batches are numbered from 1; m_openBatch collects uploads until
+        // it is submitted
+        uint64_t m_openBatch = 1;
+        uint32_t m_openUploads = 0;
+        uint64_t m_completedBatch = 0;
+
+        Stats m_stats;
+    };
+
+    inline UploadScheduler::UploadScheduler(Backend& backend,
+        uint64_t stagingCapacity,
+        uint32_t maxBatchesInFlight,
+        uint64_t maxBatchBytes)
+        : m_backend(backend),
+        m_staging(stagingCapacity, maxBatchesInFlight),
+        m_maxBatchBytes(std::max<uint64_t>(maxBatchBytes, 1))
+    {
+    }
+
+    inline UploadScheduler::Reservation UploadScheduler::Reserve(uint64_t size, uint64_t alignment)
+    {
+        if (m_staging.GetFrameBytes() >= m_maxBatchBytes)
+        {
+            Flush();
+        }
+
+        m_stats.Uploads++;
+
+        if (size > m_staging.GetCapacity())
+        {
+            m_stats.OversizedUploads++;
+            m_openUploads++;
+            return { InvalidOffset, { m_openBatch } };
+        }
+
+        ReleaseCompleted();
+
+        while (true)
+        {
+            const uint64_t offset = m_staging.Allocate(size, alignment);
+            if (offset != InvalidOffset)
+            {
+                m_stats.StagedBytes += size;
+                m_openUploads++;
+                return { offset, { m_openBatch } };
+            }
+
+            // Make room: the open batch's space only comes back once it
+            // has been submitted, and older batches once they complete
+            if (m_openUploads > 0)
+            {
+                Flush();
+            }
+
+            const uint64_t oldest = m_staging.GetOldestPendingFence();
+            if (oldest == 0)
+            {
+                throw std::runtime_error("UploadScheduler could not free staging space");
+            }
+
+            WaitForBatch(oldest);
+        }
+    }
+
+    inline UploadTicket UploadScheduler::Flush()
+    {
+        if (m_openUploads == 0)
+        {
+            return { m_openBatch - 1 };
+        }
+
+        // The ring tracks a fixed number of batches; wait for a slot
+        ReleaseCompleted();
+        if (m_staging.GetPendingFrameCount() == m_staging.GetMaxFramesInFlight())
+        {
+            WaitForBatch(m_staging.GetOldestPendingFence());
+        }
+
+        const uint64_t batch = m_openBatch++;
+        m_staging.EndFrame(batch);
+        m_openUploads = 0;
+        m_stats.Batches++;
+
+        m_backend.SubmitBatch(batch);
+        return { batch };
+    }
+
+    inline void UploadScheduler::Submit(UploadTicket ticket)
+    {
+        if (!IsSubmitted(ticket))
+        {
+            Flush();
+        }
+    }
+
+    inline bool UploadScheduler::IsSubmitted(UploadTicket ticket) const
+    {
+        return ticket.Batch < m_openBatch || m_openUploads == 0;
+    }
+
+    inline bool UploadScheduler::IsComplete(UploadTicket ticket)
+    {
+        if (ticket.Batch <= m_completedBatch)
+            return true;
+
+        if (ticket.Batch >= m_openBatch)
+            return m_openUploads == 0;
+
+        m_completedBatch = std::max(m_completedBatch, m_backend.GetCompletedBatch());
+        return ticket.Batch <= m_completedBatch;
+    }
+
+    inline void UploadScheduler::Wait(UploadTicket ticket)
+    {
+        if (IsComplete(ticket))
+            return;
+
+        Submit(ticket);
+        WaitForBatch(ticket.Batch);
+    }
+
+    inline void UploadScheduler::WaitForAll()
+    {
+        const UploadTicket last = Flush();
+        if (!IsComplete(last))
+        {
+            WaitForBatch(last.Batch);
+        }
+    }
+
+    inline uint64_t UploadScheduler::GetOpenBatch() const
+    {
+        return m_openBatch;
+    }
+
+    inline uint64_t UploadScheduler::GetOpenBatchBytes() const
+    {
+        return m_staging.GetFrameBytes();
+    }
+
+    inline uint64_t UploadScheduler::GetStagingCapacity() const
+    {
+        return m_staging.GetCapacity();
+    }
+
+    inline uint64_t UploadScheduler::GetStagingUsedBytes() const
+    {
+        return m_staging.GetUsedBytes();
+    }
+
+    inline const UploadScheduler::Stats& UploadScheduler::GetStats() const
+    {
+        return m_stats;
+    }
+
+    inline void UploadScheduler::ReleaseCompleted()
+    {
+        if (m_staging.GetPendingFrameCount() == 0)
+            return;
+
+        m_completedBatch = std::max(m_completedBatch, m_backend.GetCompletedBatch());
+        m_staging.ReleaseCompletedFrames(m_completedBatch);
+    }
+
+    inline void UploadScheduler::WaitForBatch(uint64_t batch)
+    {
+        m_stats.Stalls++;
+        m_backend.WaitForBatch(batch);
+        m_completedBatch = std::max(m_completedBatch, batch);
+        m_staging.ReleaseCompletedFrames(m_completedBatch);
+    }
+}
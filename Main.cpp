@@ -9,6 +9,12 @@
 #include <directxtk12/Mouse.h>
 
 #include "imgui_impl_win32.h"
+#include "Core/BenchmarkSweep.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <shellapi.h>
 
 using namespace DirectX;
 
@@ -29,6 +35,136 @@ extern "C"
 namespace
 {
     std::unique_ptr<Game> g_game;
+
+    // Adds path, or every .json file in it if it is a directory, in name order
+    void AddPresetFiles(const std::filesystem::path& path, std::vector<std::filesystem::path>& files)
+    {
+        if (!std::filesystem::is_directory(path))
+        {
+            files.push_back(path);
+            return;
+        }
+
+        std::vector<std::filesystem::path> found;
+        for (const auto& entry : std::filesystem::directory_iterator(path))
+        {
+            if (entry.is_regular_file() && entry.path().extension() == L".json")
+            {
+                found.push_back(entry.path());
+            }
+        }
+
+        std::sort(found.begin(), found.end());
+        files.insert(files.end(), found.begin(), found.end());
+    }
+
+    // Loads a preset, naming the file in the error if it can't be read
+    ISV::ScenePreset LoadPreset(const std::filesystem::path& path)
+    {
+        try
+        {
+            return ISV::ScenePreset::Load(path.string());
+        }
+        catch (const std::exception& e)
+        {
+            throw std::runtime_error("Could not load preset " + path.string() + ": " + e.what());
+        }
+    }
+
+    // Benchmark runs are usually scripted, so their errors go to stderr and
+    // the debugger rather than a message box that would hold the run up
+    void ReportCommandLineError(HWND hwnd, const std::string& message, bool benchmark)
+    {
+        OutputDebugStringA(("ERROR: " + message + "\n").c_str());
+
+        if (benchmark)
+        {
+            std::fprintf(stderr, "%s\n", message.c_str());
+            std::fflush(stderr);
+        }
+        else
+        {
+            MessageBoxA(hwnd, message.c_str(), "Command line error", MB_OK | MB_ICONERROR);
+        }
+    }
+
+    // --preset <file>                      Start with the given preset
+    // --benchmark <file or directory>...   Run every preset, write the timings and exit
+    // --sweep <file>                       Same for every preset of a BenchmarkSweep
+    // --results <file>                     Where the benchmark writes its timings, as
+    //                                      JSON if it ends in .json and CSV otherwise
+    //
+    // Returns false if a preset or sweep couldn't be loaded, after reporting
+    // why, so the caller can exit with an error instead of running without it.
+    bool HandleCommandLine(Game& game, HWND hwnd, LPWSTR commandLine)
+    {
+        int argc = 0;
+        LPWSTR* argv = CommandLineToArgvW(commandLine, &argc);
+        if (argv == nullptr)
+            return true;
+
+        std::vector<std::wstring> args(argv, argv + argc);
+        LocalFree(argv);
+
+        const bool benchmark = std::any_of(args.begin(), args.end(), [](const std::wstring& arg)
+            {
+                return arg == L"--benchmark" || arg == L"--sweep";
+            });
+
+        std::vector<ISV::ScenePreset> presets;
+        std::string resultsPath = "benchmark_results.csv";
+
+        try
+        {
+            for (size_t i = 0; i < args.size(); i++)
+            {
+                // CommandLineToArgvW puts the program name first when given an
+                // empty string, so skip anything that isn't an option
+                if (args[i] == L"--preset" && i + 1 < args.size())
+                {
+                    game.ApplyPreset(LoadPreset(args[++i]));
+                }
+                else if (args[i] == L"--sweep" && i + 1 < args.size())
+                {
+                    const auto sweep = ISV::BenchmarkSweep::Load(std::filesystem::path(args[++i]).string()).Expand();
+                    presets.insert(presets.end(), sweep.begin(), sweep.end());
+                }
+                else if (args[i] == L"--results" && i + 1 < args.size())
+                {
+                    resultsPath = std::filesystem::path(args[++i]).string();
+                }
+                else if (args[i] == L"--trace" && i + 1 < args.size())
+                {
+                    game.StartCpuTrace(std::filesystem::path(args[++i]).string());
+                }
+                else if (args[i] == L"--benchmark")
+                {
+                    std::vector<std::filesystem::path> files;
+                    while (i + 1 < args.size() && args[i + 1].rfind(L"--", 0) != 0)
+                    {
+                        AddPresetFiles(args[++i], files);
+                    }
+
+                    for (const auto& file : files)
+                    {
+                        presets.push_back(LoadPreset(file));
+                    }
+                }
+            }
+
+            if (!presets.empty())
+            {
+                game.StartBenchmark(std::move(presets), resultsPath);
+            }
+        }
+        catch (const std::exception& e)
+        {
+            ReportCommandLineError(hwnd, e.what(), benchmark);
+            return false;
+        }
+
+        return true;
+    }
 }
 
 LPCWSTR g_szAppName = L"IntervalShadedVolumetrics";
@@ -40,7 +176,6 @@ void ExitGame() noexcept;
 int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPWSTR lpCmdLine, _In_ int nCmdShow)
 {
     UNREFERENCED_PARAMETER(hPrevInstance);
-    UNREFERENCED_PARAMETER(lpCmdLine);
 
     if (!XMVerifyCPUSupport())
         return 1;
@@ -107,6 +242,13 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
                 GetClientRect(hwnd, &rc);
 
                 g_game->Initialize(hwnd, rc.right - rc.left, rc.bottom - rc.top);
+
+                if (!HandleCommandLine(*g_game, hwnd, lpCmdLine))
+                {
+                    g_game.reset();
+                    CoUninitialize();
+                    return 1;
+                }
             }
 
             // Main message loop
@@ -130,7 +272,7 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
 
             return static_cast<int>(msg.wParam);
         }
-        catch (std::exception e)
+        catch (const std::exception& e)
         {
             MessageBoxA(hwnd, e.what(), "Fatal error", MB_OK);
         }
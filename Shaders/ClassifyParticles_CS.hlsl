@@ -0,0 +1,92 @@
+#include "SimulateParticles.hlsli"
+
+// Decides which particles need simulating this step and compacts their
+// indices into ActiveIndices. A particle falls asleep after staying under
+// both thresholds for SleepSteps steps in a row, and wakes when a bullet
+// ray passes within WakeRadius of it.
+
+struct ParticleActivity
+{
+    float3 PreviousVelocity;
+    uint CalmSteps;
+};
+
+cbuffer ActivityConstants : register(b1, space0)
+{
+    float g_VelocityThreshold;
+    float g_AccelerationThreshold;
+    float g_WakeRadius;
+    uint g_SleepSteps;
+
+    uint g_WakeAll;
+    float3 g_ActivityPadding;
+};
+
+RWStructuredBuffer<ParticleActivity> Activity : register(u2, space0);
+RWStructuredBuffer<uint> ActiveIndices : register(u3, space0);
+
+// Element 0 is the active count. Elements 1 to 3 are filled with the
+// dispatch arguments by WriteSimulationArgs_CS.
+RWStructuredBuffer<uint> ActiveCount : register(u4, space0);
+
+[numthreads(32, 1, 1)]
+void ClassifyParticles_CS(uint3 DTid : SV_DispatchThreadID)
+{
+    uint index = DTid.x;
+    bool isActive = false;
+
+    if (index < uint(g_NumInstances))
+    {
+        ParticleActivity activity = Activity[index];
+        float3 velocity = SimulationData[index].Velocity;
+
+        float speed = length(velocity);
+        float acceleration = length(velocity - activity.PreviousVelocity) / max(g_DeltaTime, 1e-5);
+
+        bool isCalm = speed < g_VelocityThreshold && acceleration < g_AccelerationThreshold;
+        activity.CalmSteps = isCalm ? min(activity.CalmSteps + 1, g_SleepSteps) : 0;
+
+        bool wake = g_WakeAll != 0;
+        if (g_DidShoot > 0)
+        {
+            float3 l2p = LineToPoint(g_ShootRayStart,
+                normalize(g_ShootRayEnd - g_ShootRayStart),
+                Instances[index].WorldPosition);
+
+            wake = wake || length(l2p) < g_WakeRadius;
+        }
+
+        if (wake)
+        {
+            activity.CalmSteps = 0;
+        }
+
+        isActive = activity.CalmSteps < g_SleepSteps;
+
+        if (!isActive)
+        {
+            // Settle completely so the particle doesn't drift while asleep
+            SimulationData[index].Velocity = 0.xxx;
+            velocity = 0.xxx;
+        }
+
+        activity.PreviousVelocity = velocity;
+        Activity[index] = activity;
+    }
+
+    // One atomic per wave
+    uint laneOffset = WavePrefixCountBits(isActive);
+    uint waveCount = WaveActiveCountBits(isActive);
+
+    uint waveOffset = 0;
+    if (WaveIsFirstLane() && waveCount > 0)
+    {
+        InterlockedAdd(ActiveCount[0], waveCount, waveOffset);
+    }
+    waveOffset = WaveReadLaneFirst(waveOffset);
+
+    if (isActive)
+    {
+        ActiveIndices[waveOffset + laneOffset] = index;
+    }
+}
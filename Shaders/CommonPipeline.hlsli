@@ -48,19 +48,30 @@ cbuffer Constants : register(b0, space0)
 
     float g_RenderTargetWidth;
     float g_RenderTargetHeight;
-    float g_Padding1;
-    float g_Padding2;
+    uint g_VolShadowRepresentation;
+    uint g_VolShadowFormat;
+    
+    float g_VolShadowTexelSize;
+    float g_VolShadowLodScale;
+    uint g_VolShadowMipCount;
+    uint g_CompressedInstances;
 };
 
+// Instance state is split by who reads it. Every particle pass reads
+// InstanceData; only the simulation touches InstanceSimulationData.
 struct InstanceData
 {
     float3 WorldPosition;
+    float Scale;
+    float4 RotationQuat;
     float ExtinctionScale;
+};
+
+struct InstanceSimulationData
+{
     float3 Velocity;
     float Mass;
     float3 TargetPosition;
-    float Scale;
-    float4 RotationQuat;
 };
 
 static const float EXTINCTION_SCALE = 1 / 10000.f;
@@ -0,0 +1,61 @@
+#include "InstanceCompression.hlsli"
+
+// Writes the compressed instance stream read by the particle passes when
+// compressed instances are enabled. Each group handles one cluster: it
+// reduces the cluster's bounds, then quantises positions against them.
+
+StructuredBuffer<InstanceData> Instances : register(t0, space0);
+RWStructuredBuffer<uint4> CompressedInstancesOut : register(u0, space0);
+RWStructuredBuffer<InstanceCluster> InstanceClustersOut : register(u1, space0);
+
+groupshared float3 s_boundsMin[INSTANCE_CLUSTER_SIZE];
+groupshared float3 s_boundsMax[INSTANCE_CLUSTER_SIZE];
+
+[numthreads(INSTANCE_CLUSTER_SIZE, 1, 1)]
+void EncodeInstances_CS(
+    uint3 Gid : SV_GroupID,
+    uint3 DTid : SV_DispatchThreadID,
+    uint GI : SV_GroupIndex)
+{
+    uint index = DTid.x;
+    bool valid = index < uint(g_NumInstances);
+
+    InstanceData instance = (InstanceData) 0;
+    if (valid)
+    {
+        instance = Instances[index];
+    }
+
+    // Out of range threads don't widen the bounds. Every dispatched group
+    // has at least one valid instance.
+    s_boundsMin[GI] = valid ? instance.WorldPosition : float3(1e30, 1e30, 1e30);
+    s_boundsMax[GI] = valid ? instance.WorldPosition : float3(-1e30, -1e30, -1e30);
+    GroupMemoryBarrierWithGroupSync();
+
+    [unroll]
+    for (uint stride = INSTANCE_CLUSTER_SIZE / 2; stride > 0; stride >>= 1)
+    {
+        if (GI < stride)
+        {
+            s_boundsMin[GI] = min(s_boundsMin[GI], s_boundsMin[GI + stride]);
+            s_boundsMax[GI] = max(s_boundsMax[GI], s_boundsMax[GI + stride]);
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    float3 size = s_boundsMax[0] - s_boundsMin[0];
+
+    InstanceCluster cluster;
+    cluster.Origin = s_boundsMin[0];
+    cluster.Extent = max(max(size.x, size.y), max(size.z, 1e-6));
+
+    if (GI == 0)
+    {
+        InstanceClustersOut[Gid.x] = cluster;
+    }
+
+    if (valid)
+    {
+        CompressedInstancesOut[index] = EncodeInstance(instance, cluster);
+    }
+}
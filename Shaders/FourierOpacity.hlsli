@@ -0,0 +1,88 @@
+#ifndef __FOURIER_OPACITY_HLSLI__
+#define __FOURIER_OPACITY_HLSLI__
+
+#include "Utils.hlsli"
+
+// Optical thickness along each light ray is stored as a truncated Fourier
+// series of the extinction density over normalised light depth z in [0, 1].
+// Low = (a0, a1, b1, a2), High = (b2, a3, b3, unused)
+// Keep this in sync with Core/FourierOpacityMap.h
+
+#define FOURIER_HARMONIC_COUNT 3
+
+static const uint VOL_SHADOW_SLICE_VOLUME = 0;
+static const uint VOL_SHADOW_FOURIER_OPACITY = 1;
+
+struct FourierCoefficients
+{
+    float4 Low : SV_Target0;
+    float4 High : SV_Target1;
+};
+
+FourierCoefficients IntervalFourierCoefficients(float zmin, float zmax, float opticalThickness)
+{
+    float a[FOURIER_HARMONIC_COUNT];
+    float b[FOURIER_HARMONIC_COUNT];
+
+    float width = zmax - zmin;
+    float zCentre = 0.5 * (zmin + zmax);
+
+    [unroll]
+    for (uint k = 1; k <= FOURIER_HARMONIC_COUNT; k++)
+    {
+        float w = 2 * PI * k;
+
+        if (abs(width) > EPSILON)
+        {
+            a[k - 1] = 2 * opticalThickness * (sin(w * zmax) - sin(w * zmin)) / (w * width);
+            b[k - 1] = 2 * opticalThickness * (cos(w * zmin) - cos(w * zmax)) / (w * width);
+        }
+        else
+        {
+            a[k - 1] = 2 * opticalThickness * cos(w * zCentre);
+            b[k - 1] = 2 * opticalThickness * sin(w * zCentre);
+        }
+    }
+
+    FourierCoefficients output;
+    output.Low = float4(opticalThickness, a[0], b[0], a[1]);
+    output.High = float4(b[1], a[2], b[2], 0);
+    return output;
+}
+
+float ReconstructFourierOpticalThickness(float4 low, float4 high, float z)
+{
+    float a[FOURIER_HARMONIC_COUNT] = { low.y, low.w, high.y };
+    float b[FOURIER_HARMONIC_COUNT] = { low.z, high.x, high.z };
+
+    z = saturate(z);
+    float ot = low.x * z;
+
+    [unroll]
+    for (uint k = 1; k <= FOURIER_HARMONIC_COUNT; k++)
+    {
+        float w = 2 * PI * k;
+
+        // Lanczos sigma factor to damp the ringing from truncating the series
+        float x = PI * k / (FOURIER_HARMONIC_COUNT + 1.f);
+        float sigma = sin(x) / x;
+
+        ot += sigma * (a[k - 1] * sin(w * z) + b[k - 1] * (1 - cos(w * z))) / w;
+    }
+
+    return max(0, ot);
+}
+
+float SampleFourierOpticalThickness(
+    Texture2DArray<float4> coefficients,
+    SamplerState linearSampler,
+    float2 uv,
+    float z)
+{
+    float4 low = coefficients.SampleLevel(linearSampler, float3(uv, 0), 0);
+    float4 high = coefficients.SampleLevel(linearSampler, float3(uv, 1), 0);
+
+    return ReconstructFourierOpticalThickness(low, high, z);
+}
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef __INSTANCE_COMPRESSION_HLSLI__
+#define __INSTANCE_COMPRESSION_HLSLI__
+
+#include "CommonPipeline.hlsli"
+#include "Quaternion.hlsli"
+
+// Compressed copy of InstanceData, 16 bytes instead of 36.
+// Must match Core/InstanceCompression.h.
+//
+//   x: position x (16 bit) | position y (16 bit)
+//   y: position z (16 bit) | scale (half)
+//   z: rotation, smallest three at 10:10:10 plus the dropped component's index
+//   w: extinction scale (8 bit UNORM), upper 24 bits unused
+//
+// Positions are stored relative to the bounds of their cluster of
+// INSTANCE_CLUSTER_SIZE consecutive instances. The compressed stream is
+// derived from the full precision one after simulation, so quantisation
+// error never feeds back into the simulation.
+
+#define INSTANCE_CLUSTER_SIZE 256
+#define MAX_COMPRESSED_EXTINCTION_SCALE 8.f
+
+struct InstanceCluster
+{
+    float3 Origin;
+    // Positions span [Origin, Origin + Extent] on every axis
+    float Extent;
+};
+
+StructuredBuffer<uint4> CompressedInstances : register(t6, space0);
+StructuredBuffer<InstanceCluster> InstanceClusters : register(t7, space0);
+
+uint EncodeQuaternion(Quaternion q)
+{
+    float4 packed = PackQuaternion(q);
+    uint3 components = uint3(round(saturate(packed.xyz) * 1023.f));
+    uint maxCompIdx = uint(round(packed.w * 3.f));
+
+    return components.x | (components.y << 10) | (components.z << 20) | (maxCompIdx << 30);
+}
+
+Quaternion DecodeQuaternion(uint packed)
+{
+    float3 components = float3(
+        packed & 0x3ff,
+        (packed >> 10) & 0x3ff,
+        (packed >> 20) & 0x3ff) / 1023.f;
+
+    // Centre the index in its bucket so UnpackQuaternion's truncation can't
+    // round it down
+    float maxCompIdx = ((packed >> 30) + 0.5f) / 3.f;
+
+    return normalize(UnpackQuaternion(float4(components, maxCompIdx)));
+}
+
+uint4 EncodeInstance(InstanceData instance, InstanceCluster cluster)
+{
+    float3 relative = saturate((instance.WorldPosition - cluster.Origin) / cluster.Extent);
+    uint3 position = uint3(round(relative * 65535.f));
+
+    uint extinction = uint(round(saturate(instance.ExtinctionScale
+        / MAX_COMPRESSED_EXTINCTION_SCALE) * 255.f));
+
+    return uint4(
+        position.x | (position.y << 16),
+        position.z | (f32tof16(instance.Scale) << 16),
+        EncodeQuaternion(instance.RotationQuat),
+        extinction);
+}
+
+InstanceData DecodeInstance(uint4 packed, InstanceCluster cluster)
+{
+    float3 relative = float3(
+        packed.x & 0xffff,
+        packed.x >> 16,
+        packed.y & 0xffff) / 65535.f;
+
+    InstanceData instance;
+    instance.WorldPosition = cluster.Origin + relative * cluster.Extent;
+    instance.Scale = f16tof32(packed.y >> 16);
+    instance.RotationQuat = DecodeQuaternion(packed.z);
+    instance.ExtinctionScale = (packed.w & 0xff) / 255.f * MAX_COMPRESSED_EXTINCTION_SCALE;
+
+    return instance;
+}
+
+InstanceData LoadCompressedInstance(uint index)
+{
+    return DecodeInstance(CompressedInstances[index],
+        InstanceClusters[index / INSTANCE_CLUSTER_SIZE]);
+}
+
+#endif
@@ -24,8 +24,8 @@ float IntegrateVanillaTransmittance(
     float Zmin = length(g_CameraPosition - minpoint);
     float Zmax = length(g_CameraPosition - maxpoint);
     
-    float Omin = SampleOpticalThickness(minpoint);
-    float Omax = SampleOpticalThickness(maxpoint);
+    float Omin = SampleOpticalThickness(minpoint, abs(Zmax - Zmin));
+    float Omax = SampleOpticalThickness(maxpoint, abs(Zmax - Zmin));
     
     float denominator = ZeroCutoff(Omax - Omin + extinction * (Zmax - Zmin), EPSILON);
     
@@ -70,8 +70,8 @@ float IntegrateTaylorTransmittance(
     float falloffRadius
 )
 {
-    float Omin = SampleOpticalThickness(minpoint);
-    float Omax = SampleOpticalThickness(maxpoint);
+    float Omin = SampleOpticalThickness(minpoint, Zmax - Zmin);
+    float Omax = SampleOpticalThickness(maxpoint, Zmax - Zmin);
     
     return max(0, IntegrateTaylorSeries(
         4,
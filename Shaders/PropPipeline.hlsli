@@ -19,6 +19,9 @@ cbuffer Constants : register(b0, space0)
     float4x4 g_VolumetricShadowTransform;
     float3 g_CameraPosition;
     uint g_RenderingMethod;
+    uint g_VolShadowRepresentation;
+    uint g_VolShadowFormat;
+    float2 g_Padding;
 };
 
 #endif
\ No newline at end of file
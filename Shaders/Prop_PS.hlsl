@@ -1,9 +1,12 @@
 #include "PropPipeline.hlsli"
 #include "PBRLighting.hlsli"
 #include "ShadowMapping.hlsli"
+#include "FourierOpacity.hlsli"
+#include "VolShadowEncoding.hlsli"
 
 Texture2D shadowMap : register(t0, space0);
 Texture3D<float> VolumetricShadowMap : register(t1, space0);
+Texture2DArray<float4> FourierOpacityMap : register(t2, space0);
 
 SamplerState LinearSampler : register(s0, space0);
 SamplerComparisonState shadowMapSampler : register(s1, space0);
@@ -21,8 +24,14 @@ float SampleOpticalThickness(float3 worldPosition)
         uvw.xy = 1 - uvw.xy; // why is this necessary?
     }
     
+    [branch]
+    if (g_VolShadowRepresentation == VOL_SHADOW_FOURIER_OPACITY)
+    {
+        return SampleFourierOpticalThickness(FourierOpacityMap, LinearSampler, uvw.xy, transformed.z);
+    }
+    
     // Z should already be linear since the projection is orthographic
-    return VolumetricShadowMap.Sample(LinearSampler, uvw);
+    return DecodeOpticalThickness(VolumetricShadowMap.SampleLevel(LinearSampler, uvw, 0), g_VolShadowFormat);
 }
 
 float4 Prop_PS(VertexType input) : SV_TARGET
@@ -0,0 +1,14 @@
+#include "SimulateParticles.hlsli"
+
+// Written by ClassifyParticles_CS
+StructuredBuffer<uint> ActiveIndices : register(t0, space0);
+StructuredBuffer<uint> ActiveCount : register(t1, space0);
+
+[numthreads(32, 1, 1)]
+void SimulateActiveParticles_CS(uint3 DTid : SV_DispatchThreadID)
+{
+    if (DTid.x >= ActiveCount[0])
+        return;
+
+    SimulateParticle(ActiveIndices[DTid.x]);
+}
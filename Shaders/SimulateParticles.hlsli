@@ -0,0 +1,80 @@
+#ifndef __SIMULATE_PARTICLES_HLSLI__
+#define __SIMULATE_PARTICLES_HLSLI__
+
+#include "TetrahedronPipeline.hlsli"
+#include "Quaternion.hlsli"
+
+RWStructuredBuffer<InstanceData> Instances : register(u0, space0);
+RWStructuredBuffer<InstanceSimulationData> SimulationData : register(u1, space0);
+
+float3 LineToPoint(float3 lineStart, float3 lineDirection, float3 p)
+{
+    float3 lineProjection = dot(lineStart - p, lineDirection) * lineDirection;
+
+    float3 pointToLine = lineStart - p - lineProjection;
+    return -pointToLine;
+}
+
+float3 GetLocalTargetPosition(uint index)
+{
+    float angularVelocity = 3.f + 100.f * frac(353435.22425 * index);
+    float angle = angularVelocity * g_totalTime;
+    
+    Quaternion rotationQuat = QuatFromAxisAngle(float3(0, 1, 0), angle);
+    float3 targetPosition = mul(SimulationData[index].TargetPosition, QuatTo3x3(rotationQuat)) 
+        * (1 + 3.xxx * sin(3 * g_totalTime + index));
+    
+    return targetPosition;
+}
+
+void SimulateParticle(uint index)
+{
+    float3 worldPosition = Instances[index].WorldPosition;
+    
+    float3 targetPosition = mul(float4(GetLocalTargetPosition(index), 1), g_TargetWorld)
+        .xyz;
+    
+    float3 attractionVector = targetPosition - worldPosition;
+    
+    // Like gravity, this is independent of mass
+    float3 attractionAcceleration = 150.f * 
+        normalize(targetPosition - worldPosition);
+    
+    if (length(attractionVector) < 0.0001)
+    {
+        attractionAcceleration = 0.xxx;
+    }
+    
+    // This is not independent of mass
+    float3 dampingForce = -4.f * SimulationData[index].Velocity;
+    
+    
+    float3 l2p = LineToPoint(g_ShootRayStart,
+        normalize(g_ShootRayEnd - g_ShootRayStart),
+        worldPosition);
+    
+    float lineDistance = length(l2p);
+    
+    float3 bulletScatterVelocity 
+        = g_DidShoot * 10 * normalize(l2p) / pow(lineDistance, 2);
+    
+    
+    float3 dampingVelocityChange = (dampingForce / SimulationData[index].Mass) * g_DeltaTime;
+    
+    if (length(dampingVelocityChange) < length(SimulationData[index].Velocity))
+    {
+        SimulationData[index].Velocity += dampingVelocityChange;
+    }
+    else
+    {
+        SimulationData[index].Velocity = 0.xxx;
+    }
+    
+    SimulationData[index].Velocity += attractionAcceleration * g_DeltaTime + bulletScatterVelocity;    
+    Instances[index].WorldPosition += SimulationData[index].Velocity * g_DeltaTime;
+    float scale = 0.2 + sin(2 * g_totalTime + index * 2.3);
+    scale *= scale;
+    Instances[index].Scale = scale;
+}
+
+#endif
@@ -4,13 +4,19 @@
 #include "TetrahedronPipeline.hlsli"
 #include "Quaternion.hlsli"
 #include "Culling.hlsli"
+#include "InstanceCompression.hlsli"
 
 StructuredBuffer<InstanceData> Instances : register(t0, space0);
 StructuredBuffer<uint> Indices : register(t1, space0);
 
 InstanceData GetInstanceData(uint index)
 {
-    return Instances[Indices[index]];
+    uint instanceIndex = Indices[index];
+    if (g_CompressedInstances)
+    {
+        return LoadCompressedInstance(instanceIndex);
+    }
+    return Instances[instanceIndex];
 }
 
 // Tetrahedron whose vertices are on the unit sphere
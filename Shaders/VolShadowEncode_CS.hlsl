@@ -0,0 +1,23 @@
+#include "VolShadowEncoding.hlsli"
+
+cbuffer EncodeConstants : register(b0, space0)
+{
+    uint g_Slice;
+    uint g_Format;
+    uint g_Width;
+    uint g_Height;
+};
+
+Texture2D<float> g_Scratch : register(t0, space0);
+RWTexture3D<float> g_Volume : register(u0, space0);
+
+// Copies one slice of accumulated optical thickness into the volume,
+// encoding it for the volume's storage format on the way.
+[numthreads(8, 8, 1)]
+void VolShadowEncode_CS(uint3 DTid : SV_DispatchThreadID)
+{
+    if (any(DTid.xy >= uint2(g_Width, g_Height)))
+        return;
+    
+    g_Volume[uint3(DTid.xy, g_Slice)] = EncodeOpticalThickness(g_Scratch[DTid.xy], g_Format);
+}
@@ -0,0 +1,39 @@
+#ifndef __VOL_SHADOW_ENCODING_HLSLI__
+#define __VOL_SHADOW_ENCODING_HLSLI__
+
+// Storage formats for the optical thickness volume.
+// Keep this in sync with Core/VolShadowEncoding.h
+static const uint VOL_SHADOW_FORMAT_FLOAT32 = 0;
+static const uint VOL_SHADOW_FORMAT_FLOAT16 = 1;
+static const uint VOL_SHADOW_FORMAT_LOG_UNORM16 = 2;
+static const uint VOL_SHADOW_FORMAT_LOG_UNORM8 = 3;
+
+// Transmittance is below 1e-13 past this, so clamping here is invisible
+static const float VOL_SHADOW_LOG_MAX_OPTICAL_THICKNESS = 32.f;
+
+bool IsLogEncoded(uint format)
+{
+    return format == VOL_SHADOW_FORMAT_LOG_UNORM16 || format == VOL_SHADOW_FORMAT_LOG_UNORM8;
+}
+
+float EncodeOpticalThickness(float opticalThickness, uint format)
+{
+    if (IsLogEncoded(format))
+    {
+        return saturate(log2(1 + max(0, opticalThickness)) / log2(1 + VOL_SHADOW_LOG_MAX_OPTICAL_THICKNESS));
+    }
+    
+    return opticalThickness;
+}
+
+float DecodeOpticalThickness(float stored, uint format)
+{
+    if (IsLogEncoded(format))
+    {
+        return exp2(stored * log2(1 + VOL_SHADOW_LOG_MAX_OPTICAL_THICKNESS)) - 1;
+    }
+    
+    return stored;
+}
+
+#endif
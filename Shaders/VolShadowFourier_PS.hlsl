@@ -0,0 +1,74 @@
+#include "TetrahedronPipeline.hlsli"
+#include "Utils.hlsli"
+#include "RenderingEquation.hlsli"
+#include "FourierOpacity.hlsli"
+
+SamplerState LinearSampler : register(s0, space0);
+
+float VanillaOpticalThickness(
+    float3 minpoint,
+    float3 maxpoint,
+    float extinction
+)
+{
+    return length(minpoint - maxpoint) * extinction;
+}
+
+float FadedOpticalThickness(
+    float3 minpoint,
+    float3 maxpoint,
+    float extinction,
+    float3 centrePos,
+    float falloffRadius)
+{
+    float Zmin = 0;
+    float Zmax = length(maxpoint - minpoint);
+    
+    float3 V = normalize(maxpoint - minpoint);
+    float3 toCentre = normalize(centrePos - minpoint);
+    float d = length(centrePos - minpoint);
+    float cosAlpha = clamp(dot(V, toCentre), -1, 1);
+    
+    return FadedOpticalThickness(Zmin, Zmax, d, cosAlpha, extinction, falloffRadius, LinearSampler);
+}
+
+float LightDepth(float3 worldPosition)
+{
+    // The volumetric shadow projection is orthographic, so no divide is needed
+    return mul(float4(worldPosition, 1), g_VolumetricShadowTransform).z;
+}
+
+FourierCoefficients VolShadowFourier_PS(VertexType input)
+{
+    float4 maxpoint = float4(input.A.xy, input.A.z, 1.0);
+    float4 minpoint = float4(input.A.xy, input.A.w, 1.0);
+    
+    float4 a = mul(minpoint, g_InverseViewProj);
+    float4 b = mul(maxpoint, g_InverseViewProj);
+    a = a / a.w;
+    b = b / b.w;
+
+    float extinction = input.ExtinctionScale * g_Extinction * EXTINCTION_SCALE;
+    extinction = max(EPSILON, extinction);
+    
+    float tau = 0;
+    
+    [branch]
+    if (g_RenderingMethod == 0)
+    {
+        tau = VanillaOpticalThickness(a.xyz, b.xyz, extinction);
+    }
+    else
+    {
+        tau = FadedOpticalThickness(a.xyz,
+                    b.xyz,
+                    extinction,
+                    input.WorldPosition,
+                    g_ExtinctionFalloffRadius * input.Scale);
+    }
+    
+    float za = LightDepth(a.xyz);
+    float zb = LightDepth(b.xyz);
+    
+    return IntervalFourierCoefficients(min(za, zb), max(za, zb), tau);
+}
@@ -0,0 +1,52 @@
+#include "VolShadowEncoding.hlsli"
+
+cbuffer MipConstants : register(b0, space0)
+{
+    uint g_Format;
+    uint3 g_Padding;
+};
+
+RWTexture3D<float> g_Source : register(u0, space0);
+RWTexture3D<float> g_Destination : register(u1, space0);
+
+// Box filters one mip of the optical thickness volume into the next.
+// Averaging happens on decoded values so log encoded volumes stay correct.
+[numthreads(4, 4, 4)]
+void VolShadowMip_CS(uint3 DTid : SV_DispatchThreadID)
+{
+    uint3 srcSize;
+    uint3 dstSize;
+    g_Source.GetDimensions(srcSize.x, srcSize.y, srcSize.z);
+    g_Destination.GetDimensions(dstSize.x, dstSize.y, dstSize.z);
+    
+    if (any(DTid >= dstSize))
+        return;
+    
+    uint3 first = DTid * 2;
+    uint3 last = min(first + 1, srcSize - 1);
+    
+    // Odd sized axes fold their last texel into the last destination texel
+    if (DTid.x == dstSize.x - 1)
+        last.x = srcSize.x - 1;
+    if (DTid.y == dstSize.y - 1)
+        last.y = srcSize.y - 1;
+    if (DTid.z == dstSize.z - 1)
+        last.z = srcSize.z - 1;
+    
+    float sum = 0;
+    uint count = 0;
+    
+    for (uint z = first.z; z <= last.z; z++)
+    {
+        for (uint y = first.y; y <= last.y; y++)
+        {
+            for (uint x = first.x; x <= last.x; x++)
+            {
+                sum += DecodeOpticalThickness(g_Source[uint3(x, y, z)], g_Format);
+                count++;
+            }
+        }
+    }
+    
+    g_Destination[DTid] = EncodeOpticalThickness(sum / count, g_Format);
+}
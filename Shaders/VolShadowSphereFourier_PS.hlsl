@@ -0,0 +1,92 @@
+#include "CommonPipeline.hlsli"
+#include "SpherePipeline.hlsli"
+#include "RenderingEquation.hlsli"
+#include "FourierOpacity.hlsli"
+
+SamplerState LinearSampler : register(s0, space0);
+
+float VanillaOpticalThickness(
+    float3 minpoint,
+    float3 maxpoint,
+    float extinction
+)
+{
+    return length(minpoint - maxpoint) * extinction;
+}
+
+float FadedOpticalThicknessForShadow(
+    float3 minpoint,
+    float3 maxpoint,
+    float extinction,
+    float3 centrePos,
+    float falloffRadius)
+{
+    float Zmin = 0;
+    float Zmax = length(maxpoint - minpoint);
+    
+    float3 V = normalize(maxpoint - minpoint);
+    float3 toCentre = normalize(centrePos - minpoint);
+    float d = length(centrePos - minpoint);
+    float cosAlpha = clamp(dot(V, toCentre), -1, 1);
+    
+    return FadedOpticalThickness(Zmin, Zmax, d, cosAlpha, extinction, falloffRadius, LinearSampler);
+}
+
+float LightDepth(float3 worldPosition)
+{
+    // The volumetric shadow projection is orthographic, so no divide is needed
+    return mul(float4(worldPosition, 1), g_VolumetricShadowTransform).z;
+}
+
+FourierCoefficients VolShadowSphereFourier_PS(SphereVertexType input)
+{
+    FourierCoefficients output = (FourierCoefficients) 0;
+    
+    float2 screenSize = float2(g_RenderTargetWidth, g_RenderTargetHeight);
+    float2 ndc;
+    ndc.x = (input.Position.x / screenSize.x) * 2.0 - 1.0;
+    ndc.y = 1.0 - (input.Position.y / screenSize.y) * 2.0;
+    
+    float4 nearPoint = mul(float4(ndc, 0.0, 1.0), g_InverseViewProj);
+    float4 farPoint = mul(float4(ndc, 1.0, 1.0), g_InverseViewProj);
+    nearPoint /= nearPoint.w;
+    farPoint /= farPoint.w;
+    
+    float3 rayOrigin = nearPoint.xyz;
+    float3 rayDir = normalize(farPoint.xyz - nearPoint.xyz);
+    
+    float tNear, tFar;
+    bool hit = RaySphereIntersect(rayOrigin, rayDir, input.SphereCenter, input.SphereRadius, tNear, tFar);
+    
+    if (!hit || tFar < 0)
+    {
+        return output;
+    }
+    
+    tNear = max(tNear, 0);
+    
+    float3 minpoint = rayOrigin + rayDir * tNear;
+    float3 maxpoint = rayOrigin + rayDir * tFar;
+    
+    float extinction = input.ExtinctionScale * g_Extinction * EXTINCTION_SCALE;
+    extinction = max(EPSILON, extinction);
+    
+    float tau = 0;
+    
+    [branch]
+    if (g_RenderingMethod == 0)
+    {
+        tau = VanillaOpticalThickness(minpoint, maxpoint, extinction);
+    }
+    else
+    {
+        tau = FadedOpticalThicknessForShadow(
+                    minpoint,
+                    maxpoint,
+                    extinction,
+                    input.SphereCenter,
+                    g_ExtinctionFalloffRadius * input.SphereRadius);
+    }
+    
+    return IntervalFourierCoefficients(LightDepth(minpoint), LightDepth(maxpoint), tau);
+}
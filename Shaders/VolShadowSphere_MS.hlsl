@@ -1,13 +1,19 @@
 #include "CommonPipeline.hlsli"
 #include "Culling.hlsli"
 #include "SpherePipeline.hlsli"
+#include "InstanceCompression.hlsli"
 
 StructuredBuffer<InstanceData> Instances : register(t0, space0);
 StructuredBuffer<uint> Indices : register(t1, space0);
 
 InstanceData GetInstanceData(uint index)
 {
-    return Instances[Indices[index]];
+    uint instanceIndex = Indices[index];
+    if (g_CompressedInstances)
+    {
+        return LoadCompressedInstance(instanceIndex);
+    }
+    return Instances[instanceIndex];
 }
 
 #define MAX_VERTS_PER_SPHERE PROXY_SIDES
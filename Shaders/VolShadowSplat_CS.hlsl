@@ -0,0 +1,167 @@
+#include "CommonPipeline.hlsli"
+#include "SpherePipeline.hlsli"
+#include "VolShadowEncoding.hlsli"
+#include "InstanceCompression.hlsli"
+
+#define SPLAT_TILE_SIZE 8
+#define SPLAT_GROUP_SIZE (SPLAT_TILE_SIZE * SPLAT_TILE_SIZE)
+#define MAX_SPLAT_SLICES 16
+
+cbuffer SplatConstants : register(b1, space0)
+{
+    float4x4 g_LightViewProj;
+    float4x4 g_LightInverseViewProj;
+    uint g_VolumeWidth;
+    uint g_VolumeDepth;
+    float g_LightDepthRange;
+    float g_NdcPerWorldUnit;
+    uint g_FlipLayout;
+    float3 g_SplatPadding;
+};
+
+StructuredBuffer<InstanceData> Instances : register(t0, space0);
+RWTexture3D<float> VolumetricShadowMap : register(u0, space0);
+
+SamplerState LinearSampler : register(s0, space0);
+
+groupshared float4 s_spheres[SPLAT_GROUP_SIZE];
+groupshared float s_extinctions[SPLAT_GROUP_SIZE];
+groupshared uint s_visibleCount;
+
+void SplatSphere(
+    float4 sphere,
+    float extinction,
+    float3 rayOrigin,
+    float3 rayDir,
+    float sliceThickness,
+    inout float opticalThickness[MAX_SPLAT_SLICES])
+{
+    float tNear, tFar;
+    if (!RaySphereIntersect(rayOrigin, rayDir, sphere.xyz, sphere.w, tNear, tFar) || tFar < 0)
+    {
+        return;
+    }
+    
+    tNear = max(tNear, 0);
+    
+    float3 minpoint = rayOrigin + rayDir * tNear;
+    float3 toCentre = sphere.xyz - minpoint;
+    float d = length(toCentre);
+    float cosAlpha = d > EPSILON ? clamp(dot(rayDir, toCentre / d), -1, 1) : 1;
+    float falloffRadius = g_ExtinctionFalloffRadius * sphere.w;
+    
+    [unroll]
+    for (uint slice = 1; slice < MAX_SPLAT_SLICES; slice++)
+    {
+        if (slice >= g_VolumeDepth)
+            break;
+        
+        float zmax = min(tFar, slice * sliceThickness) - tNear;
+        if (zmax <= 0)
+            continue;
+        
+        [branch]
+        if (g_RenderingMethod == 0)
+        {
+            opticalThickness[slice] += zmax * extinction;
+        }
+        else
+        {
+            opticalThickness[slice] += FadedOpticalThickness(0, zmax, d, cosAlpha, extinction, falloffRadius, LinearSampler);
+        }
+    }
+}
+
+// Evaluates the closed form optical thickness of every particle along 
+// each texel's light ray, clipped to each slice's depth.
+// Floats can't be atomically added to a typed UAV, so instead of scattering
+// particles into the volume, each group gathers the particles that overlap
+// its tile of rays, a batch at a time through groupshared memory.
+[numthreads(SPLAT_TILE_SIZE, SPLAT_TILE_SIZE, 1)]
+void VolShadowSplat_CS(
+    uint3 DTid : SV_DispatchThreadID,
+    uint3 Gid : SV_GroupID,
+    uint GI : SV_GroupIndex)
+{
+    float2 uv = (DTid.xy + 0.5) / g_VolumeWidth;
+    float2 tileMinUV = (Gid.xy * SPLAT_TILE_SIZE) / (float) g_VolumeWidth;
+    float2 tileMaxUV = ((Gid.xy + 1) * SPLAT_TILE_SIZE) / (float) g_VolumeWidth;
+    
+    // The tetrahedron path renders with a flipped view
+    if (g_FlipLayout)
+    {
+        uv = 1 - uv;
+        float2 flippedMin = 1 - tileMaxUV;
+        tileMaxUV = 1 - tileMinUV;
+        tileMinUV = flippedMin;
+    }
+    
+    float2 ndc = float2(uv.x * 2 - 1, 1 - uv.y * 2);
+    float2 tileNdcMin = float2(tileMinUV.x * 2 - 1, 1 - tileMaxUV.y * 2);
+    float2 tileNdcMax = float2(tileMaxUV.x * 2 - 1, 1 - tileMinUV.y * 2);
+    
+    float4 nearPoint = mul(float4(ndc, 0.0, 1.0), g_LightInverseViewProj);
+    float4 farPoint = mul(float4(ndc, 1.0, 1.0), g_LightInverseViewProj);
+    nearPoint /= nearPoint.w;
+    farPoint /= farPoint.w;
+    
+    float3 rayOrigin = nearPoint.xyz;
+    float3 rayDir = normalize(farPoint.xyz - nearPoint.xyz);
+    float sliceThickness = g_LightDepthRange / (g_VolumeDepth - 1.f);
+    
+    float opticalThickness[MAX_SPLAT_SLICES];
+    [unroll]
+    for (uint i = 0; i < MAX_SPLAT_SLICES; i++)
+    {
+        opticalThickness[i] = 0;
+    }
+    
+    uint particleCount = (uint) g_NumInstances;
+    
+    for (uint batchStart = 0; batchStart < particleCount; batchStart += SPLAT_GROUP_SIZE)
+    {
+        if (GI == 0)
+        {
+            s_visibleCount = 0;
+        }
+        GroupMemoryBarrierWithGroupSync();
+        
+        uint particleIndex = batchStart + GI;
+        if (particleIndex < particleCount)
+        {
+            InstanceData instance = g_CompressedInstances
+                ? LoadCompressedInstance(particleIndex)
+                : Instances[particleIndex];
+            float radius = g_Scale * instance.Scale;
+            float2 centreNdc = mul(float4(instance.WorldPosition, 1), g_LightViewProj).xy;
+            float ndcRadius = radius * g_NdcPerWorldUnit;
+            
+            if (radius > 0
+                && all(centreNdc + ndcRadius >= tileNdcMin)
+                && all(centreNdc - ndcRadius <= tileNdcMax))
+            {
+                uint slot;
+                InterlockedAdd(s_visibleCount, 1, slot);
+                s_spheres[slot] = float4(instance.WorldPosition, radius);
+                s_extinctions[slot] = max(EPSILON, instance.ExtinctionScale * g_Extinction * EXTINCTION_SCALE);
+            }
+        }
+        GroupMemoryBarrierWithGroupSync();
+        
+        uint visibleCount = s_visibleCount;
+        for (uint j = 0; j < visibleCount; j++)
+        {
+            SplatSphere(s_spheres[j], s_extinctions[j], rayOrigin, rayDir, sliceThickness, opticalThickness);
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+    
+    if (any(DTid.xy >= g_VolumeWidth))
+        return;
+    
+    for (uint slice = 0; slice < g_VolumeDepth; slice++)
+    {
+        VolumetricShadowMap[uint3(DTid.xy, slice)] 
+            = EncodeOpticalThickness(opticalThickness[min(slice, MAX_SPLAT_SLICES - 1)], g_VolShadowFormat);
+    }
+}
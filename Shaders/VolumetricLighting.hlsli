@@ -4,9 +4,12 @@
 #include "RenderingEquation.hlsli"
 #include "ShadowMapping.hlsli"
 #include "CommonPipeline.hlsli"
+#include "FourierOpacity.hlsli"
+#include "VolShadowEncoding.hlsli"
 
 Texture3D<float> VolumetricShadowMap : register(t2, space0);
 Texture2D ShadowMap : register(t3, space0);
+Texture2DArray<float4> FourierOpacityMap : register(t5, space0);
 
 SamplerState LinearSampler : register(s0, space0);
 SamplerComparisonState ShadowMapSampler : register(s1, space0);
@@ -49,7 +52,20 @@ float ReflectivePhase(float3 L, float3 V, float3 N, float asymmetry, float direc
     return lerp(constant, hg2, directionality);
 }
 
-float SampleOpticalThickness(float3 worldPosition)
+// Picks a coarser mip when a lookup stands in for a long stretch of the ray,
+// so large steps read a prefiltered value instead of one point of mip 0.
+float VolumetricShadowLod(float footprint)
+{
+    if (g_VolShadowLodScale <= 0)
+    {
+        return 0;
+    }
+    
+    float texels = footprint * g_VolShadowLodScale / g_VolShadowTexelSize;
+    return clamp(log2(max(1, texels)), 0, g_VolShadowMipCount - 1.f);
+}
+
+float SampleOpticalThickness(float3 worldPosition, float footprint)
 {
     float4 transformed = mul(float4(worldPosition, 1), g_VolumetricShadowTransform);
     transformed /= transformed.w;
@@ -58,7 +74,21 @@ float SampleOpticalThickness(float3 worldPosition)
     #else
     float3 uvw = transformed.xyz;
     #endif
-    return VolumetricShadowMap.Sample(LinearSampler, uvw);
+    
+    [branch]
+    if (g_VolShadowRepresentation == VOL_SHADOW_FOURIER_OPACITY)
+    {
+        // The coefficients are encoded against the un-inverted light depth
+        return SampleFourierOpticalThickness(FourierOpacityMap, LinearSampler, uvw.xy, transformed.z);
+    }
+    
+    float lod = VolumetricShadowLod(footprint);
+    return DecodeOpticalThickness(VolumetricShadowMap.SampleLevel(LinearSampler, uvw, lod), g_VolShadowFormat);
+}
+
+float SampleOpticalThickness(float3 worldPosition)
+{
+    return SampleOpticalThickness(worldPosition, 0);
 }
 
 
@@ -114,10 +144,10 @@ float IntegrateSimpsonTransmittance(
         float d = length(centrePos - start);
         float cosAlpha = clamp(dot(-V, toCentre), -1, 1);
         
-        float Omax = SampleOpticalThickness(end);
+        float Omax = SampleOpticalThickness(end, stepSize);
         if (i == 0)
         {
-            Omin = SampleOpticalThickness(start);
+            Omin = SampleOpticalThickness(start, stepSize);
             fmin = f(minZ, minZ, maxZ, Omin, Omax, d, cosAlpha, extinction, falloffRadius, Visibility(start), LinearSampler);
         }
         
@@ -0,0 +1,11 @@
+// Turns the active particle count from ClassifyParticles_CS into
+// arguments for an indirect dispatch of SimulateActiveParticles_CS.
+RWStructuredBuffer<uint> ActiveCount : register(u0, space0);
+
+[numthreads(1, 1, 1)]
+void WriteSimulationArgs_CS(uint3 DTid : SV_DispatchThreadID)
+{
+    ActiveCount[1] = (ActiveCount[0] + 31) / 32;
+    ActiveCount[2] = 1;
+    ActiveCount[3] = 1;
+}
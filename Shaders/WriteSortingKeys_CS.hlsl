@@ -1,4 +1,5 @@
 #include "TetrahedronPipeline.hlsli"
+#include "InstanceCompression.hlsli"
 
 StructuredBuffer<InstanceData> Instances : register(t0, space0);
 RWStructuredBuffer<float> g_outKeys : register(u0, space0);
@@ -7,7 +8,9 @@ RWStructuredBuffer<uint> g_outIndices : register(u1, space0);
 [numthreads(32, 1, 1)]
 void WriteSortingKeys_CS( uint3 DTid : SV_DispatchThreadID )
 {
-    float3 worldPosition = Instances[DTid.x].WorldPosition;
+    float3 worldPosition = g_CompressedInstances
+        ? LoadCompressedInstance(DTid.x).WorldPosition
+        : Instances[DTid.x].WorldPosition;
     float3 viewPosition = mul(float4(worldPosition, 1), view).xyz;
 
     g_outIndices[DTid.x] = DTid.x;    
@@ -8,6 +8,11 @@
 #include <cstdint>
 #include <exception>
 
+#ifndef _WIN32
+#include <chrono>
+#endif
+
+#include "Core/FrameTimeHistogram.h"
 
 namespace DX
 {
@@ -22,22 +27,16 @@ namespace DX
             m_frameCount(0),
             m_framesPerSecond(0),
             m_framesThisSecond(0),
-            m_qpcSecondCounter(0),
+            m_counterSecondCounter(0),
+            m_lastFrameTicks(0),
             m_isFixedTimeStep(false),
             m_targetElapsedTicks(TicksPerSecond / 60)
         {
-            if (!QueryPerformanceFrequency(&m_qpcFrequency))
-            {
-                throw std::exception();
-            }
-
-            if (!QueryPerformanceCounter(&m_qpcLastTime))
-            {
-                throw std::exception();
-            }
+            m_counterFrequency = QueryCounterFrequency();
+            m_counterLastTime = QueryCounter();
 
             // Initialize max delta to 1/10 of a second.
-            m_qpcMaxDelta = static_cast<uint64_t>(m_qpcFrequency.QuadPart / 10);
+            m_counterMaxDelta = m_counterFrequency / 10;
         }
 
         // Get elapsed time since the previous Update call.
@@ -54,6 +53,15 @@ namespace DX
         // Get the current framerate.
         uint32_t GetFramesPerSecond() const noexcept { return m_framesPerSecond; }
 
+        // Get the wall clock time between the last two Tick calls. Unlike the
+        // elapsed time this is never clamped or snapped to the fixed timestep,
+        // so it is what frame time measurements should use.
+        double GetLastFrameSeconds() const noexcept { return TicksToSeconds(m_lastFrameTicks); }
+
+        // Wall clock times of recent frames, for percentiles and histograms.
+        const ISV::FrameTimeHistogram& GetFrameTimes() const noexcept { return m_frameTimes; }
+        void ResetFrameTimes() noexcept { m_frameTimes.Reset(); }
+
         // Set whether to use fixed or variable timestep mode.
         void SetFixedTimeStep(bool isFixedTimestep) noexcept { m_isFixedTimeStep = isFixedTimestep; }
 
@@ -73,15 +81,12 @@ namespace DX
 
         void ResetElapsedTime()
         {
-            if (!QueryPerformanceCounter(&m_qpcLastTime))
-            {
-                throw std::exception();
-            }
+            m_counterLastTime = QueryCounter();
 
             m_leftOverTicks = 0;
             m_framesPerSecond = 0;
             m_framesThisSecond = 0;
-            m_qpcSecondCounter = 0;
+            m_counterSecondCounter = 0;
         }
 
         // Update timer state, calling the specified Update function the appropriate number of times.
@@ -89,27 +94,25 @@ namespace DX
         void Tick(const TUpdate& update)
         {
             // Query the current time.
-            LARGE_INTEGER currentTime;
+            const uint64_t currentTime = QueryCounter();
 
-            if (!QueryPerformanceCounter(&currentTime))
-            {
-                throw std::exception();
-            }
+            uint64_t timeDelta = currentTime - m_counterLastTime;
 
-            uint64_t timeDelta = static_cast<uint64_t>(currentTime.QuadPart - m_qpcLastTime.QuadPart);
+            m_counterLastTime = currentTime;
+            m_counterSecondCounter += timeDelta;
 
-            m_qpcLastTime = currentTime;
-            m_qpcSecondCounter += timeDelta;
+            // Record the real frame time before any clamping.
+            m_lastFrameTicks = CounterToTicks(timeDelta);
+            m_frameTimes.AddFrame(TicksToSeconds(m_lastFrameTicks));
 
             // Clamp excessively large time deltas (e.g. after paused in the debugger).
-            if (timeDelta > m_qpcMaxDelta)
+            if (timeDelta > m_counterMaxDelta)
             {
-                timeDelta = m_qpcMaxDelta;
+                timeDelta = m_counterMaxDelta;
             }
 
-            // Convert QPC units into a canonical tick format. This cannot overflow due to the previous clamp.
-            timeDelta *= TicksPerSecond;
-            timeDelta /= static_cast<uint64_t>(m_qpcFrequency.QuadPart);
+            // Convert counter units into a canonical tick format.
+            timeDelta = CounterToTicks(timeDelta);
 
             const uint32_t lastFrameCount = m_frameCount;
 
@@ -158,19 +161,68 @@ namespace DX
                 m_framesThisSecond++;
             }
 
-            if (m_qpcSecondCounter >= static_cast<uint64_t>(m_qpcFrequency.QuadPart))
+            if (m_counterSecondCounter >= m_counterFrequency)
             {
                 m_framesPerSecond = m_framesThisSecond;
                 m_framesThisSecond = 0;
-                m_qpcSecondCounter %= static_cast<uint64_t>(m_qpcFrequency.QuadPart);
+                m_counterSecondCounter %= m_counterFrequency;
             }
         }
 
     private:
-        // Source timing data uses QPC units.
-        LARGE_INTEGER m_qpcFrequency;
-        LARGE_INTEGER m_qpcLastTime;
-        uint64_t m_qpcMaxDelta;
+        // The time source. QueryPerformanceCounter on Windows and the
+        // monotonic clock (clock_gettime(CLOCK_MONOTONIC) on Linux)
+        // everywhere else.
+#ifdef _WIN32
+        static uint64_t QueryCounterFrequency()
+        {
+            LARGE_INTEGER frequency;
+            if (!QueryPerformanceFrequency(&frequency))
+            {
+                throw std::exception();
+            }
+
+            return static_cast<uint64_t>(frequency.QuadPart);
+        }
+
+        static uint64_t QueryCounter()
+        {
+            LARGE_INTEGER counter;
+            if (!QueryPerformanceCounter(&counter))
+            {
+                throw std::exception();
+            }
+
+            return static_cast<uint64_t>(counter.QuadPart);
+        }
+#else
+        static uint64_t QueryCounterFrequency() noexcept
+        {
+            using Period = std::chrono::steady_clock::period;
+            static_assert(Period::num == 1, "Expected a clock with a whole number of ticks per second");
+
+            return static_cast<uint64_t>(Period::den);
+        }
+
+        static uint64_t QueryCounter() noexcept
+        {
+            return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+        }
+#endif
+
+        // Splits the conversion so that long deltas from high frequency
+        // counters can't overflow.
+        uint64_t CounterToTicks(uint64_t counterDelta) const noexcept
+        {
+            const uint64_t seconds = counterDelta / m_counterFrequency;
+            const uint64_t remainder = counterDelta % m_counterFrequency;
+            return seconds * TicksPerSecond + remainder * TicksPerSecond / m_counterFrequency;
+        }
+
+        // Source timing data uses counter units.
+        uint64_t m_counterFrequency;
+        uint64_t m_counterLastTime;
+        uint64_t m_counterMaxDelta;
 
         // Derived timing data uses a canonical tick format.
         uint64_t m_elapsedTicks;
@@ -181,7 +233,11 @@ namespace DX
         uint32_t m_frameCount;
         uint32_t m_framesPerSecond;
         uint32_t m_framesThisSecond;
-        uint64_t m_qpcSecondCounter;
+        uint64_t m_counterSecondCounter;
+
+        // Unclamped wall clock frame times.
+        uint64_t m_lastFrameTicks;
+        ISV::FrameTimeHistogram m_frameTimes;
 
         // Members for configuring fixed timestep mode.
         bool m_isFixedTimeStep;
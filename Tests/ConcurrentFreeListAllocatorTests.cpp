@@ -0,0 +1,298 @@
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Gradient/ConcurrentFreeListAllocator.h"
+
+namespace
+{
+    // Small blocks so the tests cross block boundaries
+    using Allocator = Gradient::ConcurrentFreeListAllocator<uint64_t, 16, 1024>;
+    using Handle = Allocator::Handle;
+
+    constexpr uint32_t ThreadCount = 8;
+
+    // Tags a value with the thread that owns it
+    uint64_t MakeValue(uint32_t thread, uint32_t i)
+    {
+        return (static_cast<uint64_t>(thread) << 32) | i;
+    }
+
+    std::multiset<uint64_t> Contents(const Allocator& allocator)
+    {
+        std::multiset<uint64_t> contents;
+        allocator.ForEach([&contents](const uint64_t& value)
+            {
+                contents.insert(value);
+            });
+        return contents;
+    }
+
+    template <typename Fn>
+    void RunThreads(uint32_t count, Fn&& fn)
+    {
+        std::vector<std::thread> threads;
+        for (uint32_t t = 0; t < count; t++)
+        {
+            threads.emplace_back(fn, t);
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    }
+}
+
+TEST(ConcurrentFreeListAllocator, RejectsStaleAndDefaultHandles)
+{
+    Allocator allocator;
+    const Handle removed = allocator.Allocate(1);
+    allocator.Remove(removed);
+
+    EXPECT_FALSE(allocator.IsValid(Handle{}));
+    EXPECT_EQ(allocator.Get(Handle{}), nullptr);
+    EXPECT_FALSE(allocator.IsValid(removed));
+
+    const Handle reused = allocator.Allocate(2);
+    EXPECT_EQ(reused.Index, removed.Index);
+    EXPECT_EQ(allocator.Get(removed), nullptr);
+
+    // Removing through the stale handle leaves the new element alone
+    allocator.Remove(removed);
+    allocator.Remove(Handle{});
+    ASSERT_NE(allocator.Get(reused), nullptr);
+    EXPECT_EQ(*allocator.Get(reused), 2u);
+    EXPECT_EQ(allocator.Size(), 1u);
+}
+
+TEST(ConcurrentFreeListAllocator, ThrowsWhenFull)
+{
+    Gradient::ConcurrentFreeListAllocator<int, 4, 2> allocator;
+    std::vector<Gradient::ConcurrentFreeListAllocator<int, 4, 2>::Handle> handles;
+    for (int i = 0; i < 8; i++)
+    {
+        handles.push_back(allocator.Allocate(i));
+    }
+
+    EXPECT_THROW(allocator.Allocate(8), std::runtime_error);
+    EXPECT_EQ(allocator.Size(), 8u);
+
+    // Freed slots can be taken again
+    allocator.Remove(handles[3]);
+    EXPECT_EQ(allocator.Allocate(9).Index, handles[3].Index);
+}
+
+TEST(ConcurrentFreeListAllocator, ForEachVisitsEveryLiveElementOnce)
+{
+    Allocator allocator;
+    std::vector<Handle> handles;
+    for (uint64_t i = 0; i < 100; i++)
+    {
+        handles.push_back(allocator.Allocate(i));
+    }
+
+    // Empties the second block entirely and leaves holes elsewhere
+    std::multiset<uint64_t> expected;
+    for (uint64_t i = 0; i < 100; i++)
+    {
+        if ((i >= 16 && i < 32) || i % 3 == 0)
+        {
+            allocator.Remove(handles[i]);
+        }
+        else
+        {
+            expected.insert(i);
+        }
+    }
+
+    EXPECT_EQ(Contents(allocator), expected);
+
+    // Elements can be changed in place
+    allocator.ForEach([](uint64_t& value)
+        {
+            value += 1000;
+        });
+    EXPECT_EQ(*allocator.Get(handles[1]), 1001u);
+}
+
+TEST(ConcurrentFreeListAllocator, HoldsMoveOnlyElements)
+{
+    Gradient::ConcurrentFreeListAllocator<std::unique_ptr<int>> allocator;
+    const auto a = allocator.Allocate(std::make_unique<int>(1));
+    const auto b = allocator.Allocate(std::make_unique<int>(2));
+
+    allocator.Remove(a);
+    ASSERT_NE(allocator.Get(b), nullptr);
+    EXPECT_EQ(**allocator.Get(b), 2);
+}
+
+// The stress tests below are the ones to run under ThreadSanitizer, see
+// ISV_TSAN in CMakeLists.txt
+
+TEST(ConcurrentFreeListAllocator, ThreadsChurningTheirOwnElementsNeverSeeEachOthers)
+{
+    constexpr uint32_t LivePerThread = 64;
+    constexpr uint32_t Operations = 20000;
+
+    Allocator allocator;
+    std::atomic<uint32_t> mismatches{ 0 };
+
+    RunThreads(ThreadCount, [&](uint32_t t)
+        {
+            std::mt19937 rng(t);
+            std::vector<std::pair<uint64_t, Handle>> live;
+            for (uint32_t i = 0; i < LivePerThread; i++)
+            {
+                const uint64_t value = MakeValue(t, i);
+                live.push_back({ value, allocator.Allocate(value) });
+            }
+
+            for (uint32_t i = 0; i < Operations; i++)
+            {
+                auto& [value, handle] = live[rng() % LivePerThread];
+
+                const uint64_t* element = allocator.Get(handle);
+                if (element == nullptr || *element != value)
+                {
+                    mismatches++;
+                }
+
+                allocator.Remove(handle);
+                if (allocator.IsValid(handle))
+                {
+                    mismatches++;
+                }
+
+                value = MakeValue(t, LivePerThread + i);
+                handle = allocator.Allocate(value);
+            }
+
+            for (const auto& [value, handle] : live)
+            {
+                allocator.Remove(handle);
+            }
+        });
+
+    EXPECT_EQ(mismatches.load(), 0u);
+    EXPECT_EQ(allocator.Size(), 0u);
+    EXPECT_TRUE(Contents(allocator).empty());
+}
+
+TEST(ConcurrentFreeListAllocator, RacingRemovesFreeEachSlotOnce)
+{
+    constexpr uint32_t Rounds = 200;
+    constexpr uint32_t PerRound = 64;
+
+    Allocator allocator;
+
+    for (uint32_t round = 0; round < Rounds; round++)
+    {
+        std::vector<Handle> handles;
+        for (uint32_t i = 0; i < PerRound; i++)
+        {
+            handles.push_back(allocator.Allocate(i));
+        }
+
+        // Every thread removes every handle
+        RunThreads(ThreadCount, [&](uint32_t t)
+            {
+                for (uint32_t i = 0; i < PerRound; i++)
+                {
+                    allocator.Remove(handles[(i + t) % PerRound]);
+                }
+            });
+
+        ASSERT_EQ(allocator.Size(), 0u);
+    }
+
+    // A slot pushed on the free list twice would be handed out twice
+    std::set<uint32_t> indices;
+    for (uint32_t i = 0; i < PerRound; i++)
+    {
+        indices.insert(allocator.Allocate(i).Index);
+    }
+    EXPECT_EQ(indices.size(), PerRound);
+}
+
+TEST(ConcurrentFreeListAllocator, ConcurrentAllocationsGetDistinctSlots)
+{
+    constexpr uint32_t PerThread = 1000;
+
+    Allocator allocator;
+    std::vector<std::vector<Handle>> handles(ThreadCount);
+
+    // Enough to create new blocks from several threads at once
+    RunThreads(ThreadCount, [&](uint32_t t)
+        {
+            for (uint32_t i = 0; i < PerThread; i++)
+            {
+                handles[t].push_back(allocator.Allocate(MakeValue(t, i)));
+            }
+        });
+
+    std::set<uint32_t> indices;
+    for (uint32_t t = 0; t < ThreadCount; t++)
+    {
+        for (uint32_t i = 0; i < PerThread; i++)
+        {
+            indices.insert(handles[t][i].Index);
+            ASSERT_EQ(*allocator.Get(handles[t][i]), MakeValue(t, i));
+        }
+    }
+
+    EXPECT_EQ(indices.size(), ThreadCount * PerThread);
+    EXPECT_EQ(allocator.Size(), ThreadCount * PerThread);
+    EXPECT_EQ(Contents(allocator).size(), ThreadCount * PerThread);
+}
+
+TEST(ConcurrentFreeListAllocator, ForEachSeesEarlierElementsWhileOthersAllocate)
+{
+    constexpr uint32_t Existing = 500;
+    constexpr uint32_t PerThread = 2000;
+
+    Allocator allocator;
+    for (uint32_t i = 0; i < Existing; i++)
+    {
+        allocator.Allocate(MakeValue(ThreadCount, i));
+    }
+
+    std::atomic<uint32_t> shortPasses{ 0 };
+
+    // Thread 0 iterates while the others allocate, so every pass must see
+    // at least the elements that were there before it started
+    RunThreads(ThreadCount, [&](uint32_t t)
+        {
+            if (t == 0)
+            {
+                for (uint32_t pass = 0; pass < 50; pass++)
+                {
+                    uint32_t visited = 0;
+                    allocator.ForEach([&visited](const uint64_t&)
+                        {
+                            visited++;
+                        });
+
+                    if (visited < Existing)
+                    {
+                        shortPasses++;
+                    }
+                }
+                return;
+            }
+
+            for (uint32_t i = 0; i < PerThread; i++)
+            {
+                allocator.Allocate(MakeValue(t, i));
+            }
+        });
+
+    EXPECT_EQ(shortPasses.load(), 0u);
+    EXPECT_EQ(Contents(allocator).size(), Existing + (ThreadCount - 1) * PerThread);
+}
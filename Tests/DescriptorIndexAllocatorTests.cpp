@@ -0,0 +1,228 @@
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Gradient/DescriptorIndexAllocator.h"
+
+namespace
+{
+    using Gradient::DescriptorIndexAllocator;
+
+    constexpr uint32_t Invalid = DescriptorIndexAllocator::InvalidIndex;
+
+    // Capacities around word and summary word boundaries
+    constexpr uint32_t Capacities[] = { 1, 2, 63, 64, 65, 100, 4095, 4096, 4097, 64 * 64 * 3 + 17 };
+
+    DescriptorIndexAllocator Full(uint32_t capacity)
+    {
+        DescriptorIndexAllocator allocator(capacity);
+        allocator.AllocateRange(capacity);
+        return allocator;
+    }
+
+    // First fit over a flag per index, to check AllocateRange against
+    uint32_t FirstFit(const std::vector<bool>& taken, uint32_t count)
+    {
+        uint32_t run = 0;
+        for (uint32_t i = 0; i < taken.size(); i++)
+        {
+            run = taken[i] ? 0 : run + 1;
+            if (run == count)
+            {
+                return i + 1 - count;
+            }
+        }
+        return Invalid;
+    }
+}
+
+TEST(DescriptorIndexAllocator, AllocatesLowestFirst)
+{
+    DescriptorIndexAllocator allocator(200);
+    for (uint32_t i = 0; i < 130; i++)
+    {
+        ASSERT_EQ(allocator.Allocate(), i);
+    }
+
+    allocator.Free(100);
+    allocator.Free(3);
+    EXPECT_EQ(allocator.Allocate(), 3u);
+    EXPECT_EQ(allocator.Allocate(), 100u);
+    EXPECT_EQ(allocator.Allocate(), 130u);
+    EXPECT_EQ(allocator.GetFreeCount(), 200u - 131u);
+}
+
+TEST(DescriptorIndexAllocator, FillsCapacitiesThatAreNotWholeWords)
+{
+    for (const uint32_t capacity : Capacities)
+    {
+        DescriptorIndexAllocator allocator(capacity);
+        EXPECT_EQ(allocator.GetCapacity(), capacity);
+
+        for (uint32_t i = 0; i < capacity; i++)
+        {
+            ASSERT_EQ(allocator.Allocate(), i) << "capacity " << capacity;
+        }
+
+        // Bits past the capacity are never handed out
+        EXPECT_EQ(allocator.Allocate(), Invalid) << "capacity " << capacity;
+        EXPECT_EQ(allocator.AllocateRange(2), Invalid) << "capacity " << capacity;
+        EXPECT_EQ(allocator.GetFreeCount(), 0u);
+        EXPECT_FALSE(allocator.IsAllocated(capacity));
+
+        allocator.FreeRange(0, capacity);
+        EXPECT_EQ(allocator.GetFreeCount(), capacity);
+        EXPECT_EQ(allocator.AllocateRange(capacity + 1), Invalid) << "capacity " << capacity;
+        EXPECT_EQ(allocator.AllocateRange(capacity), 0u) << "capacity " << capacity;
+    }
+}
+
+TEST(DescriptorIndexAllocator, FindsRangesAtTheEndOfTheHeap)
+{
+    for (const uint32_t capacity : Capacities)
+    {
+        if (capacity < 8)
+            continue;
+
+        DescriptorIndexAllocator allocator = Full(capacity);
+        allocator.FreeRange(capacity - 5, 5);
+
+        EXPECT_EQ(allocator.AllocateRange(6), Invalid) << "capacity " << capacity;
+        EXPECT_EQ(allocator.AllocateRange(5), capacity - 5) << "capacity " << capacity;
+        EXPECT_EQ(allocator.GetFreeCount(), 0u);
+    }
+}
+
+TEST(DescriptorIndexAllocator, FindsRangesAcrossWordAndSummaryBoundaries)
+{
+    const uint32_t capacity = 64 * 64 * 3 + 17;
+
+    // Runs that straddle a word, a group of 64 words and the last word
+    for (const auto& [first, count] : { std::pair<uint32_t, uint32_t>{ 60, 10 },
+        { 64 * 64 - 3, 7 },
+        { 64 * 64 - 70, 200 },
+        { 64 * 64 * 2 - 1, 64 * 64 + 2 },
+        { capacity - 80, 80 } })
+    {
+        DescriptorIndexAllocator allocator = Full(capacity);
+        allocator.FreeRange(first, count);
+
+        EXPECT_EQ(allocator.AllocateRange(count + 1), Invalid) << "first " << first;
+        EXPECT_EQ(allocator.AllocateRange(count), first) << "first " << first;
+        EXPECT_EQ(allocator.GetFreeCount(), 0u);
+    }
+}
+
+TEST(DescriptorIndexAllocator, PassesOverHolesTooSmallForARange)
+{
+    const uint32_t capacity = 64 * 64 * 2;
+    DescriptorIndexAllocator allocator = Full(capacity);
+
+    // A free index in every other word of the first group, then a run
+    // starting in the first group's last word that has no whole free word
+    // before it
+    for (uint32_t w = 0; w < 63; w += 2)
+    {
+        allocator.Free(w * 64 + 5);
+    }
+    allocator.FreeRange(64 * 64 - 10, 300);
+
+    EXPECT_EQ(allocator.AllocateRange(2), 64u * 64u - 10u);
+    EXPECT_EQ(allocator.AllocateRange(298), 64u * 64u - 8u);
+    EXPECT_EQ(allocator.Allocate(), 5u);
+}
+
+TEST(DescriptorIndexAllocator, LargeRangesSpanWholeFreeGroups)
+{
+    DescriptorIndexAllocator allocator(64 * 64 * 4);
+    ASSERT_EQ(allocator.Allocate(), 0u);
+    ASSERT_EQ(allocator.AllocateRange(5), 1u);
+
+    EXPECT_EQ(allocator.AllocateRange(64 * 64 * 2), 6u);
+    EXPECT_TRUE(allocator.IsAllocated(6 + 64 * 64 * 2 - 1));
+    EXPECT_FALSE(allocator.IsAllocated(6 + 64 * 64 * 2));
+
+    // What's left is one run from there to the end
+    const uint32_t rest = allocator.GetFreeCount();
+    EXPECT_EQ(allocator.AllocateRange(rest + 1), Invalid);
+    EXPECT_EQ(allocator.AllocateRange(rest), 6u + 64u * 64u * 2u);
+}
+
+TEST(DescriptorIndexAllocator, FreeingTwiceIsHarmless)
+{
+    DescriptorIndexAllocator allocator(100);
+    const uint32_t first = allocator.AllocateRange(10);
+    const uint32_t other = allocator.Allocate();
+
+    allocator.Free(first + 3);
+    allocator.Free(first + 3);
+    EXPECT_EQ(allocator.GetFreeCount(), 100u - 11u + 1u);
+
+    // Overlapping an already free index, and past the capacity
+    allocator.FreeRange(first, 10);
+    allocator.FreeRange(first, 10);
+    allocator.Free(100);
+    allocator.Free(Invalid);
+    allocator.FreeRange(95, 20);
+    EXPECT_EQ(allocator.GetFreeCount(), 99u);
+    EXPECT_TRUE(allocator.IsAllocated(other));
+
+    // Each index was put back once, so it's handed out once
+    EXPECT_EQ(allocator.AllocateRange(10), 0u);
+    EXPECT_EQ(allocator.Allocate(), 11u);
+    EXPECT_EQ(allocator.GetFreeCount(), 100u - 12u);
+}
+
+TEST(DescriptorIndexAllocator, MatchesFirstFitUnderRandomChurn)
+{
+    const uint32_t capacity = 64 * 64 + 1000;
+    DescriptorIndexAllocator allocator(capacity);
+    std::vector<bool> taken(capacity, false);
+    std::vector<std::pair<uint32_t, uint32_t>> live;
+    std::mt19937 rng(1);
+
+    for (int step = 0; step < 20000; step++)
+    {
+        // Allocating more often than freeing keeps the heap close to full and
+        // fragmented
+        if (!live.empty() && rng() % 5 < 2)
+        {
+            const std::size_t pick = rng() % live.size();
+            const auto [first, count] = live[pick];
+            allocator.FreeRange(first, count);
+            for (uint32_t i = first; i < first + count; i++)
+            {
+                taken[i] = false;
+            }
+            live[pick] = live.back();
+            live.pop_back();
+            continue;
+        }
+
+        // Mostly descriptor table sizes, sometimes a long run
+        const uint32_t count = rng() % 10 == 0 ? 100 + rng() % 400 : 1 + rng() % 16;
+        const uint32_t expected = FirstFit(taken, count);
+        const uint32_t first = allocator.AllocateRange(count);
+        ASSERT_EQ(first, expected) << "step " << step << ", count " << count;
+
+        if (first != Invalid)
+        {
+            for (uint32_t i = first; i < first + count; i++)
+            {
+                taken[i] = true;
+            }
+            live.push_back({ first, count });
+        }
+    }
+
+    uint32_t freeCount = 0;
+    for (uint32_t i = 0; i < capacity; i++)
+    {
+        ASSERT_EQ(allocator.IsAllocated(i), taken[i]) << "index " << i;
+        freeCount += taken[i] ? 0 : 1;
+    }
+    EXPECT_EQ(allocator.GetFreeCount(), freeCount);
+}
@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Gradient/DirtyRangeTracker.h"
+
+namespace
+{
+    using Gradient::DirtyRangeTracker;
+    using Ranges = std::vector<std::pair<uint32_t, uint32_t>>;
+
+    Ranges Collect(DirtyRangeTracker& tracker, uint32_t mergeGap)
+    {
+        std::vector<DirtyRangeTracker::Range> out;
+        tracker.Collect(mergeGap, out);
+
+        Ranges ranges;
+        for (const auto& range : out)
+        {
+            ranges.push_back({ range.First, range.Count });
+        }
+        return ranges;
+    }
+
+    // Coalesces a flag per element the slow way, to check Collect against
+    Ranges Expected(const std::vector<bool>& dirty, uint32_t mergeGap)
+    {
+        Ranges ranges;
+        uint32_t end = 0;
+
+        for (uint32_t i = 0; i < dirty.size(); i++)
+        {
+            if (!dirty[i])
+                continue;
+
+            if (!ranges.empty() && i - end <= mergeGap)
+            {
+                ranges.back().second = i + 1 - ranges.back().first;
+            }
+            else
+            {
+                ranges.push_back({ i, 1 });
+            }
+            end = i + 1;
+        }
+        return ranges;
+    }
+}
+
+TEST(DirtyRangeTracker, MergesAdjacentAndOverlappingMarks)
+{
+    DirtyRangeTracker tracker(1000);
+
+    tracker.Mark(10, 5);
+    tracker.Mark(15, 5);
+    EXPECT_EQ(Collect(tracker, 0), (Ranges{ { 10, 10 } }));
+
+    tracker.Mark(100, 50);
+    tracker.Mark(120, 100);
+    tracker.Mark(130, 10);
+    EXPECT_EQ(Collect(tracker, 0), (Ranges{ { 100, 120 } }));
+}
+
+TEST(DirtyRangeTracker, KeepsDisjointRangesApartInOrder)
+{
+    DirtyRangeTracker tracker(1000);
+
+    // Marked out of order, within a word and across words
+    tracker.Mark(900, 3);
+    tracker.Mark(2, 1);
+    tracker.Mark(60, 10);
+    tracker.Mark(5, 2);
+
+    EXPECT_EQ(Collect(tracker, 0), (Ranges{ { 2, 1 }, { 5, 2 }, { 60, 10 }, { 900, 3 } }));
+}
+
+TEST(DirtyRangeTracker, MergesRunsUpToTheGap)
+{
+    for (const uint32_t gap : { 1u, 3u, 64u, 100u })
+    {
+        DirtyRangeTracker tracker(1000);
+
+        // Exactly gap clean elements apart, then one more than that
+        tracker.Mark(10, 2);
+        tracker.Mark(12 + gap, 2);
+        tracker.Mark(14 + gap + gap + 1, 2);
+
+        EXPECT_EQ(Collect(tracker, gap), (Ranges{ { 10, 4 + gap }, { 14 + gap + gap + 1, 2 } })) << "gap " << gap;
+    }
+}
+
+TEST(DirtyRangeTracker, CollectClearsEveryMark)
+{
+    DirtyRangeTracker tracker(300);
+    EXPECT_TRUE(tracker.Empty());
+
+    tracker.Mark(3, 200);
+    tracker.Mark(299, 1);
+    EXPECT_FALSE(tracker.Empty());
+    EXPECT_TRUE(tracker.IsDirty(3));
+    EXPECT_TRUE(tracker.IsDirty(299));
+    EXPECT_FALSE(tracker.IsDirty(2));
+
+    std::vector<DirtyRangeTracker::Range> out;
+    tracker.Collect(0, out);
+    EXPECT_EQ(out.size(), 2u);
+
+    EXPECT_TRUE(tracker.Empty());
+    for (uint32_t i = 0; i < 300; i++)
+    {
+        ASSERT_FALSE(tracker.IsDirty(i)) << "index " << i;
+    }
+
+    // Nothing left, and out's old contents go
+    tracker.Collect(0, out);
+    EXPECT_TRUE(out.empty());
+
+    // Marks after a collect start from scratch
+    tracker.Mark(50, 1);
+    EXPECT_EQ(Collect(tracker, 1000), (Ranges{ { 50, 1 } }));
+}
+
+TEST(DirtyRangeTracker, MarksUpToTheCapacityOnly)
+{
+    for (const uint32_t capacity : { 1u, 63u, 64u, 65u, 1000u })
+    {
+        DirtyRangeTracker tracker(capacity);
+        tracker.MarkAll();
+        EXPECT_EQ(Collect(tracker, 0), (Ranges{ { 0, capacity } })) << "capacity " << capacity;
+
+        EXPECT_THROW(tracker.Mark(capacity, 1), std::runtime_error);
+        EXPECT_THROW(tracker.Mark(0, capacity + 1), std::runtime_error);
+        EXPECT_THROW(tracker.Mark(1, UINT32_MAX), std::runtime_error);
+        EXPECT_FALSE(tracker.IsDirty(capacity));
+
+        // An empty range is fine anywhere
+        tracker.Mark(capacity + 10, 0);
+        EXPECT_TRUE(tracker.Empty());
+    }
+}
+
+TEST(DirtyRangeTracker, MatchesAFlagPerElementUnderRandomMarks)
+{
+    const uint32_t capacity = 64 * 40 + 13;
+    DirtyRangeTracker tracker(capacity);
+    std::mt19937 rng(5);
+
+    for (int round = 0; round < 200; round++)
+    {
+        std::vector<bool> dirty(capacity, false);
+
+        const int marks = 1 + static_cast<int>(rng() % 40);
+        for (int m = 0; m < marks; m++)
+        {
+            // Mostly a few elements, sometimes a long run
+            const uint32_t first = rng() % capacity;
+            const uint32_t count = 1 + (rng() % 8 == 0 ? rng() % 300 : rng() % 4);
+            const uint32_t clamped = std::min(count, capacity - first);
+
+            tracker.Mark(first, clamped);
+            for (uint32_t i = first; i < first + clamped; i++)
+            {
+                dirty[i] = true;
+            }
+        }
+
+        const uint32_t gap = rng() % 3 == 0 ? 0 : rng() % 100;
+        ASSERT_EQ(Collect(tracker, gap), Expected(dirty, gap)) << "round " << round << ", gap " << gap;
+    }
+}
@@ -0,0 +1,233 @@
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Gradient/FreeListAllocator.h"
+
+namespace
+{
+    using Allocator = Gradient::FreeListAllocator<int>;
+    using Handle = Allocator::Handle;
+
+    std::vector<int> Contents(const Allocator& allocator)
+    {
+        return std::vector<int>(allocator.begin(), allocator.end());
+    }
+}
+
+TEST(FreeListAllocator, DefaultHandleIsInvalid)
+{
+    Allocator allocator;
+    allocator.Allocate(1);
+
+    EXPECT_FALSE(allocator.IsValid(Handle{}));
+    EXPECT_EQ(allocator.Get(Handle{}), nullptr);
+
+    // Does nothing
+    allocator.Remove(Handle{});
+    EXPECT_EQ(allocator.Size(), 1u);
+}
+
+TEST(FreeListAllocator, GetsWhatWasAllocated)
+{
+    Allocator allocator;
+    const Handle a = allocator.Allocate(10);
+    const Handle b = allocator.Allocate(20);
+
+    ASSERT_NE(allocator.Get(a), nullptr);
+    ASSERT_NE(allocator.Get(b), nullptr);
+    EXPECT_EQ(*allocator.Get(a), 10);
+    EXPECT_EQ(*allocator.Get(b), 20);
+
+    const Allocator& constAllocator = allocator;
+    EXPECT_EQ(*constAllocator.Get(b), 20);
+    EXPECT_EQ(allocator.Size(), 2u);
+    EXPECT_FALSE(allocator.Empty());
+}
+
+TEST(FreeListAllocator, RejectsStaleHandles)
+{
+    Allocator allocator;
+    const Handle removed = allocator.Allocate(1);
+    allocator.Remove(removed);
+
+    EXPECT_FALSE(allocator.IsValid(removed));
+    EXPECT_EQ(allocator.Get(removed), nullptr);
+
+    // The slot is reused, but the old handle must not alias the new element
+    const Handle reused = allocator.Allocate(2);
+    EXPECT_EQ(reused.Index, removed.Index);
+    EXPECT_NE(reused.Generation, removed.Generation);
+    EXPECT_FALSE(allocator.IsValid(removed));
+    EXPECT_EQ(allocator.Get(removed), nullptr);
+
+    // Removing through the stale handle leaves the new element alone
+    allocator.Remove(removed);
+    ASSERT_NE(allocator.Get(reused), nullptr);
+    EXPECT_EQ(*allocator.Get(reused), 2);
+}
+
+TEST(FreeListAllocator, RemovingTwiceIsHarmless)
+{
+    Allocator allocator;
+    const Handle a = allocator.Allocate(1);
+    const Handle b = allocator.Allocate(2);
+
+    allocator.Remove(a);
+    allocator.Remove(a);
+
+    EXPECT_EQ(allocator.Size(), 1u);
+    EXPECT_EQ(*allocator.Get(b), 2);
+
+    // The slot went on the free list once, so two allocations take
+    // distinct slots
+    const Handle c = allocator.Allocate(3);
+    const Handle d = allocator.Allocate(4);
+    EXPECT_NE(c.Index, d.Index);
+}
+
+TEST(FreeListAllocator, ReusesFreedSlotsBeforeGrowing)
+{
+    Allocator allocator;
+    std::vector<Handle> handles;
+    for (int i = 0; i < 8; i++)
+    {
+        handles.push_back(allocator.Allocate(i));
+    }
+
+    allocator.Remove(handles[2]);
+    allocator.Remove(handles[5]);
+
+    const Handle a = allocator.Allocate(100);
+    const Handle b = allocator.Allocate(101);
+    const Handle c = allocator.Allocate(102);
+
+    // Most recently freed first, then a new slot
+    EXPECT_EQ(a.Index, handles[5].Index);
+    EXPECT_EQ(b.Index, handles[2].Index);
+    EXPECT_EQ(c.Index, 8u);
+    EXPECT_EQ(allocator.Size(), 9u);
+}
+
+TEST(FreeListAllocator, RemoveMovesTheLastElementIntoTheHole)
+{
+    Allocator allocator;
+    std::vector<Handle> handles;
+    for (int i = 0; i < 5; i++)
+    {
+        handles.push_back(allocator.Allocate(i));
+    }
+
+    allocator.Remove(handles[1]);
+    EXPECT_EQ(Contents(allocator), (std::vector<int>{ 0, 4, 2, 3 }));
+
+    // Removing the last element moves nothing
+    allocator.Remove(handles[3]);
+    EXPECT_EQ(Contents(allocator), (std::vector<int>{ 0, 4, 2 }));
+
+    allocator.Remove(handles[0]);
+    EXPECT_EQ(Contents(allocator), (std::vector<int>{ 2, 4 }));
+
+    // Handles follow their elements through the moves
+    EXPECT_EQ(*allocator.Get(handles[2]), 2);
+    EXPECT_EQ(*allocator.Get(handles[4]), 4);
+
+    for (std::size_t i = 0; i < allocator.Size(); i++)
+    {
+        const Handle handle = allocator.GetHandleAt(i);
+        EXPECT_TRUE(allocator.IsValid(handle));
+        EXPECT_EQ(allocator.Get(handle), &*(allocator.begin() + static_cast<std::ptrdiff_t>(i)));
+    }
+}
+
+TEST(FreeListAllocator, ClearInvalidatesEveryHandle)
+{
+    Allocator allocator;
+    std::vector<Handle> handles;
+    for (int i = 0; i < 4; i++)
+    {
+        handles.push_back(allocator.Allocate(i));
+    }
+
+    allocator.Clear();
+
+    EXPECT_TRUE(allocator.Empty());
+    EXPECT_EQ(allocator.begin(), allocator.end());
+    for (const Handle handle : handles)
+    {
+        EXPECT_FALSE(allocator.IsValid(handle));
+    }
+
+    // Slots are reused without growing
+    for (int i = 0; i < 4; i++)
+    {
+        EXPECT_LT(allocator.Allocate(i).Index, 4u);
+    }
+    EXPECT_EQ(allocator.Allocate(4).Index, 4u);
+}
+
+TEST(FreeListAllocator, HoldsMoveOnlyElements)
+{
+    Gradient::FreeListAllocator<std::unique_ptr<int>> allocator;
+    const auto a = allocator.Allocate(std::make_unique<int>(1));
+    const auto b = allocator.Allocate(std::make_unique<int>(2));
+
+    allocator.Remove(a);
+    ASSERT_NE(allocator.Get(b), nullptr);
+    EXPECT_EQ(**allocator.Get(b), 2);
+}
+
+TEST(FreeListAllocator, MatchesAReferenceUnderRandomChurn)
+{
+    Allocator allocator;
+    std::vector<std::pair<int, Handle>> live;
+    std::vector<Handle> dead;
+    std::mt19937 rng(1);
+    int next = 0;
+
+    for (int step = 0; step < 100000; step++)
+    {
+        if (live.empty() || rng() % 3 != 0)
+        {
+            live.push_back({ next, allocator.Allocate(next) });
+            next++;
+        }
+        else
+        {
+            const std::size_t pick = rng() % live.size();
+            allocator.Remove(live[pick].second);
+            dead.push_back(live[pick].second);
+            live[pick] = live.back();
+            live.pop_back();
+        }
+    }
+
+    ASSERT_EQ(allocator.Size(), live.size());
+    for (const auto& [value, handle] : live)
+    {
+        ASSERT_NE(allocator.Get(handle), nullptr);
+        ASSERT_EQ(*allocator.Get(handle), value);
+    }
+
+    for (const Handle handle : dead)
+    {
+        ASSERT_FALSE(allocator.IsValid(handle));
+    }
+
+    // Iteration visits every live element once
+    std::map<int, int> seen;
+    for (const int value : allocator)
+    {
+        seen[value]++;
+    }
+    ASSERT_EQ(seen.size(), live.size());
+    for (const auto& [value, handle] : live)
+    {
+        ASSERT_EQ(seen[value], 1);
+    }
+}
@@ -0,0 +1,324 @@
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Core/GpuTimestampRing.h"
+
+namespace
+{
+    using ISV::GpuTimestampRing;
+
+    // Stands in for a query heap and its readback buffer. Timestamps
+    // written take the current value of Now; resolving copies them to
+    // where ReadTimestamps sees them.
+    class MockQuerySource : public GpuTimestampRing::QuerySource
+    {
+    public:
+        explicit MockQuerySource(uint32_t queryCount, uint64_t frequency = 1000000)
+            : Queries(queryCount, 0),
+            Resolved(queryCount, 0),
+            Frequency(frequency)
+        {
+        }
+
+        void WriteTimestamp(uint32_t query) override
+        {
+            Written.push_back(query);
+            Queries.at(query) = Now;
+        }
+
+        void ResolveTimestamps(uint32_t first, uint32_t count) override
+        {
+            Resolves++;
+            for (uint32_t i = first; i < first + count; i++)
+            {
+                Resolved.at(i) = Queries.at(i);
+            }
+        }
+
+        void ReadTimestamps(uint32_t first, uint32_t count, uint64_t* timestamps) override
+        {
+            Reads++;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                timestamps[i] = Resolved.at(first + i);
+            }
+        }
+
+        uint64_t GetFrequency() const override
+        {
+            return Frequency;
+        }
+
+        std::vector<uint64_t> Queries;
+        std::vector<uint64_t> Resolved;
+        std::vector<uint32_t> Written;
+        uint64_t Frequency;
+        uint64_t Now = 0;
+        uint32_t Resolves = 0;
+        uint32_t Reads = 0;
+    };
+
+    // One frame with a single zone lasting ms at the mock's 1 MHz clock.
+    // Returns the frame number.
+    uint64_t RecordFrame(GpuTimestampRing& ring,
+        MockQuerySource& source,
+        uint64_t completedFrame,
+        const char* name,
+        double ms)
+    {
+        const uint64_t frame = ring.BeginFrame(completedFrame);
+        const auto zone = ring.BeginZone(name);
+        source.Now += static_cast<uint64_t>(ms * 1000.0);
+        ring.EndZone(zone);
+        ring.EndFrame();
+        return frame;
+    }
+}
+
+TEST(GpuTimestampRing, ReadsAFrameOnlyOnceItCompletes)
+{
+    MockQuerySource source(3 * 4 * 2);
+    GpuTimestampRing ring(source, 3, 4);
+
+    EXPECT_EQ(ring.GetQueryCount(), 24u);
+    EXPECT_EQ(RecordFrame(ring, source, 0, "render", 1.0), 1u);
+
+    ring.ReadCompletedFrames(0);
+    EXPECT_EQ(ring.GetLastReadFrame(), 0u);
+    EXPECT_EQ(ring.FindZone("render"), nullptr);
+    EXPECT_EQ(source.Reads, 0u);
+
+    ring.ReadCompletedFrames(1);
+    ASSERT_NE(ring.FindZone("render"), nullptr);
+    EXPECT_DOUBLE_EQ(ring.FindZone("render")->LastMs, 1.0);
+    EXPECT_EQ(ring.FindZone("render")->LastFrame, 1u);
+    EXPECT_EQ(ring.GetLastReadFrame(), 1u);
+
+    // Each frame is read once
+    ring.ReadCompletedFrames(1);
+    EXPECT_EQ(source.Reads, 1u);
+    EXPECT_EQ(ring.FindZone("render")->History.GetFrameCount(), 1u);
+}
+
+TEST(GpuTimestampRing, EachFrameUsesItsOwnSlotOfQueries)
+{
+    MockQuerySource source(3 * 2 * 2);
+    GpuTimestampRing ring(source, 3, 2);
+
+    for (uint64_t frame = 1; frame <= 4; frame++)
+    {
+        source.Written.clear();
+        RecordFrame(ring, source, frame - 1, "pass", 0.5);
+
+        const uint32_t first = static_cast<uint32_t>(frame % 3) * 2 * 2;
+        EXPECT_EQ(source.Written, (std::vector<uint32_t>{ first, first + 1 })) << "frame " << frame;
+    }
+}
+
+TEST(GpuTimestampRing, RingWrapDropsFramesTheGpuHasNotFinished)
+{
+    MockQuerySource source(2 * 1 * 2);
+    GpuTimestampRing ring(source, 2, 1);
+
+    // The GPU never catches up, so frame 3 takes frame 1's slot and frame
+    // 4 takes frame 2's
+    RecordFrame(ring, source, 0, "pass", 1.0);
+    RecordFrame(ring, source, 0, "pass", 2.0);
+    RecordFrame(ring, source, 0, "pass", 3.0);
+    EXPECT_EQ(ring.GetDroppedFrames(), 1u);
+    RecordFrame(ring, source, 0, "pass", 4.0);
+    EXPECT_EQ(ring.GetDroppedFrames(), 2u);
+
+    ring.ReadCompletedFrames(4);
+    ASSERT_NE(ring.FindZone("pass"), nullptr);
+    EXPECT_DOUBLE_EQ(ring.FindZone("pass")->LastMs, 4.0);
+    EXPECT_EQ(ring.FindZone("pass")->LastFrame, 4u);
+    EXPECT_EQ(ring.FindZone("pass")->History.GetFrameCount(), 2u);
+    EXPECT_EQ(source.Reads, 2u);
+}
+
+TEST(GpuTimestampRing, KeepingUpWithTheRingDropsNothing)
+{
+    MockQuerySource source(3 * 1 * 2);
+    GpuTimestampRing ring(source, 3, 1);
+
+    // The GPU finishes each frame two frames later
+    for (uint64_t frame = 1; frame <= 100; frame++)
+    {
+        RecordFrame(ring, source, frame > 2 ? frame - 2 : 0, "pass", 1.0);
+    }
+
+    EXPECT_EQ(ring.GetDroppedFrames(), 0u);
+    EXPECT_EQ(ring.GetLastReadFrame(), 98u);
+    EXPECT_EQ(ring.FindZone("pass")->History.GetTotalFrameCount(), 98u);
+}
+
+TEST(GpuTimestampRing, UnresolvedFramesAreNotRead)
+{
+    MockQuerySource source(2 * 1 * 2);
+    GpuTimestampRing ring(source, 2, 1);
+
+    // Frame 1 is still being recorded, so even a fence past it reads nothing
+    ring.BeginFrame(0);
+    ring.BeginZone("pass");
+    ring.ReadCompletedFrames(10);
+
+    EXPECT_EQ(source.Resolves, 0u);
+    EXPECT_EQ(source.Reads, 0u);
+    EXPECT_EQ(ring.GetLastReadFrame(), 0u);
+
+    ring.EndFrame();
+    EXPECT_EQ(source.Resolves, 1u);
+
+    ring.ReadCompletedFrames(1);
+    EXPECT_EQ(source.Reads, 1u);
+    EXPECT_EQ(ring.GetLastReadFrame(), 1u);
+}
+
+TEST(GpuTimestampRing, ReadsFramesOldestFirst)
+{
+    MockQuerySource source(3 * 1 * 2);
+    GpuTimestampRing ring(source, 3, 1);
+
+    RecordFrame(ring, source, 0, "pass", 1.0);
+    RecordFrame(ring, source, 0, "pass", 2.0);
+    RecordFrame(ring, source, 0, "pass", 3.0);
+
+    // Frame 3 sits in slot 0, before frames 1 and 2
+    ring.ReadCompletedFrames(3);
+
+    const auto* zone = ring.FindZone("pass");
+    ASSERT_NE(zone, nullptr);
+    EXPECT_DOUBLE_EQ(zone->LastMs, 3.0);
+    EXPECT_EQ(zone->LastFrame, 3u);
+
+    const auto history = zone->History.GetHistory();
+    ASSERT_EQ(history.size(), 3u);
+    EXPECT_FLOAT_EQ(history[0], 1.f);
+    EXPECT_FLOAT_EQ(history[1], 2.f);
+    EXPECT_FLOAT_EQ(history[2], 3.f);
+}
+
+TEST(GpuTimestampRing, SumsZonesWithTheSameName)
+{
+    MockQuerySource source(2 * 4 * 2);
+    GpuTimestampRing ring(source, 2, 4);
+
+    ring.BeginFrame(0);
+    auto a = ring.BeginZone("shadows");
+    source.Now += 1000;
+    ring.EndZone(a);
+    auto b = ring.BeginZone("render");
+    source.Now += 2000;
+    ring.EndZone(b);
+    auto c = ring.BeginZone("shadows");
+    source.Now += 500;
+    ring.EndZone(c);
+    ring.EndFrame();
+
+    ring.ReadCompletedFrames(1);
+
+    ASSERT_EQ(ring.GetZoneStats().size(), 2u);
+    EXPECT_EQ(ring.GetZoneStats()[0].Name, "shadows");
+    EXPECT_DOUBLE_EQ(ring.FindZone("shadows")->LastMs, 1.5);
+    EXPECT_DOUBLE_EQ(ring.FindZone("render")->LastMs, 2.0);
+}
+
+TEST(GpuTimestampRing, ClosesOpenZonesAtTheEndOfTheFrame)
+{
+    MockQuerySource source(1 * 2 * 2);
+    GpuTimestampRing ring(source, 1, 2);
+
+    ring.BeginFrame(0);
+    // Never ended
+    ring.BeginZone("outer");
+    source.Now += 1000;
+    auto inner = ring.BeginZone("inner");
+    source.Now += 1000;
+    ring.EndZone(inner);
+    // Ending twice is ignored
+    ring.EndZone(inner);
+    source.Now += 1000;
+    ring.EndFrame();
+
+    ring.ReadCompletedFrames(1);
+    EXPECT_DOUBLE_EQ(ring.FindZone("outer")->LastMs, 3.0);
+    EXPECT_DOUBLE_EQ(ring.FindZone("inner")->LastMs, 1.0);
+    EXPECT_EQ(source.Written.size(), 4u);
+}
+
+TEST(GpuTimestampRing, CountsZonesPastTheLimit)
+{
+    MockQuerySource source(1 * 2 * 2);
+    GpuTimestampRing ring(source, 1, 2);
+
+    ring.BeginFrame(0);
+    ring.EndZone(ring.BeginZone("a"));
+    ring.EndZone(ring.BeginZone("b"));
+    const auto dropped = ring.BeginZone("c");
+    ring.EndZone(dropped);
+    ring.EndFrame();
+
+    EXPECT_EQ(dropped.Index, UINT32_MAX);
+    EXPECT_EQ(ring.GetDroppedZones(), 1u);
+    EXPECT_EQ(source.Written.size(), 4u);
+
+    ring.ReadCompletedFrames(1);
+    EXPECT_EQ(ring.FindZone("c"), nullptr);
+}
+
+TEST(GpuTimestampRing, FramesWithoutZonesTouchNoQueries)
+{
+    MockQuerySource source(2 * 1 * 2);
+    GpuTimestampRing ring(source, 2, 1);
+
+    // Profiling turned off for a while: frames still run, but record nothing
+    for (uint64_t frame = 1; frame <= 5; frame++)
+    {
+        ring.BeginFrame(frame - 1);
+        ring.EndFrame();
+    }
+    ring.ReadCompletedFrames(5);
+
+    EXPECT_TRUE(source.Written.empty());
+    EXPECT_EQ(source.Resolves, 0u);
+    EXPECT_EQ(source.Reads, 0u);
+    EXPECT_EQ(ring.GetLastReadFrame(), 5u);
+    EXPECT_EQ(ring.GetDroppedFrames(), 0u);
+    EXPECT_TRUE(ring.GetZoneStats().empty());
+}
+
+TEST(GpuTimestampRing, RetiresFramesWithoutResultsWhenTimestampsAreUnsupported)
+{
+    MockQuerySource source(2 * 1 * 2, 0);
+    GpuTimestampRing ring(source, 2, 1);
+
+    for (uint64_t frame = 1; frame <= 5; frame++)
+    {
+        RecordFrame(ring, source, frame - 1, "pass", 1.0);
+    }
+    ring.ReadCompletedFrames(5);
+
+    EXPECT_EQ(source.Reads, 0u);
+    EXPECT_EQ(ring.GetLastReadFrame(), 5u);
+    EXPECT_EQ(ring.GetDroppedFrames(), 0u);
+    EXPECT_TRUE(ring.GetZoneStats().empty());
+}
+
+TEST(GpuTimestampRing, RejectsMisuse)
+{
+    MockQuerySource source(2);
+
+    EXPECT_THROW(GpuTimestampRing(source, 0, 1), std::runtime_error);
+    EXPECT_THROW(GpuTimestampRing(source, 1, 0), std::runtime_error);
+
+    GpuTimestampRing ring(source, 1, 1);
+    EXPECT_THROW(ring.BeginZone("outside"), std::runtime_error);
+    EXPECT_THROW(ring.EndFrame(), std::runtime_error);
+
+    ring.BeginFrame(0);
+    EXPECT_THROW(ring.BeginFrame(0), std::runtime_error);
+}
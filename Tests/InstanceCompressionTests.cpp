@@ -0,0 +1,162 @@
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Core/InstanceCompression.h"
+
+namespace
+{
+    using ISV::InstanceCompression;
+    using RenderInstance = InstanceCompression::RenderInstance;
+
+    // Spread like Game::CreateTetrahedronInstances spreads them, with a
+    // random rotation per instance
+    std::vector<RenderInstance> CreateInstances(std::size_t count, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> position(-40.f, 40.f);
+        std::uniform_real_distribution<float> scale(0.1f, 2.f);
+        std::uniform_real_distribution<float> extinction(0.f, InstanceCompression::MaxExtinctionScale);
+        std::normal_distribution<float> normal;
+
+        std::vector<RenderInstance> instances(count);
+        for (auto& instance : instances)
+        {
+            instance.Position = { position(rng), position(rng) * 0.25f, position(rng) };
+            instance.Scale = scale(rng);
+            instance.ExtinctionScale = extinction(rng);
+
+            std::array<float, 4> q = { normal(rng), normal(rng), normal(rng), normal(rng) };
+            const float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+            for (auto& component : q)
+            {
+                component /= length;
+            }
+            instance.RotationQuat = q;
+        }
+
+        return instances;
+    }
+
+    float RotationError(const std::array<float, 4>& a, const std::array<float, 4>& b)
+    {
+        const float dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+        return 2.f * std::acos(std::min(1.f, std::abs(dot)));
+    }
+}
+
+TEST(InstanceCompression, RoundTripErrorStaysWithinQuantisation)
+{
+    const auto instances = CreateInstances(100000, 1);
+
+    std::vector<InstanceCompression::CompressedInstance> compressed;
+    std::vector<InstanceCompression::Cluster> clusters;
+    std::vector<RenderInstance> decoded;
+    InstanceCompression::EncodeAll(instances, compressed, clusters);
+    InstanceCompression::DecodeAll(compressed, clusters, decoded);
+
+    ASSERT_EQ(decoded.size(), instances.size());
+    ASSERT_EQ(clusters.size(), InstanceCompression::GetClusterCount(instances.size()));
+
+    for (std::size_t i = 0; i < instances.size(); i++)
+    {
+        const auto& a = instances[i];
+        const auto& b = decoded[i];
+        const auto& cluster = clusters[i / InstanceCompression::ClusterSize];
+
+        // Half a 16 bit step of the cluster extent, plus float rounding
+        const float positionBound = cluster.Extent / 65535.f * 0.5f + 1e-4f;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            ASSERT_LE(std::abs(a.Position[axis] - b.Position[axis]), positionBound) << "instance " << i;
+        }
+
+        // Half precision keeps 11 significant bits
+        ASSERT_LE(std::abs(a.Scale - b.Scale), a.Scale * std::ldexp(1.f, -11)) << "instance " << i;
+
+        ASSERT_LE(std::abs(a.ExtinctionScale - b.ExtinctionScale),
+            InstanceCompression::MaxExtinctionScale / 255.f * 0.5f + 1e-5f) << "instance " << i;
+
+        // Three 10 bit components over +-1/sqrt(2)
+        ASSERT_LE(RotationError(a.RotationQuat, b.RotationQuat), 0.005f) << "instance " << i;
+    }
+}
+
+TEST(InstanceCompression, MeasureMatchesTheRoundTrip)
+{
+    const auto instances = CreateInstances(1000, 2);
+    const auto report = InstanceCompression::Measure(instances);
+
+    EXPECT_EQ(report.RawBytes, instances.size() * sizeof(RenderInstance));
+    EXPECT_EQ(report.CompressedBytes, instances.size() * 16 + InstanceCompression::GetClusterCount(instances.size()) * 16);
+    EXPECT_GT(report.MaxPositionError, 0.f);
+    EXPECT_LT(report.MaxPositionError, 0.01f);
+    EXPECT_LT(report.MaxRotationError, 0.005f);
+    EXPECT_LE(report.MaxExtinctionError, InstanceCompression::MaxExtinctionScale / 255.f * 0.5f + 1e-5f);
+}
+
+TEST(InstanceCompression, ClampsExtinctionAboveTheMaximum)
+{
+    RenderInstance instance = { { 0.f, 0.f, 0.f }, 1.f, { 0.f, 0.f, 0.f, 1.f }, 20.f };
+    const InstanceCompression::Cluster cluster = { { 0.f, 0.f, 0.f }, 1.f };
+
+    const auto decoded = InstanceCompression::Decode(InstanceCompression::Encode(instance, cluster), cluster);
+
+    EXPECT_FLOAT_EQ(decoded.ExtinctionScale, InstanceCompression::MaxExtinctionScale);
+}
+
+TEST(InstanceCompression, EncodesBothSignsOfAQuaternionAsTheSameRotation)
+{
+    const std::array<float, 4> q = { 0.1f, -0.7f, 0.3f, 0.64031242f };
+    const std::array<float, 4> negated = { -q[0], -q[1], -q[2], -q[3] };
+
+    EXPECT_EQ(InstanceCompression::EncodeQuaternion(q), InstanceCompression::EncodeQuaternion(negated));
+    EXPECT_LE(RotationError(q, InstanceCompression::DecodeQuaternion(InstanceCompression::EncodeQuaternion(q))), 0.005f);
+}
+
+TEST(InstanceCompression, KeepsAxisAlignedRotationsExact)
+{
+    for (int axis = 0; axis < 4; axis++)
+    {
+        std::array<float, 4> q = { 0.f, 0.f, 0.f, 0.f };
+        q[axis] = 1.f;
+
+        const auto decoded = InstanceCompression::DecodeQuaternion(InstanceCompression::EncodeQuaternion(q));
+        EXPECT_NEAR(std::abs(decoded[axis]), 1.f, 1e-3f) << "axis " << axis;
+    }
+}
+
+TEST(InstanceCompression, DecodesClusterCornersExactly)
+{
+    const InstanceCompression::Cluster cluster = { { -5.f, 2.f, 10.f }, 8.f };
+    RenderInstance low = { { -5.f, 2.f, 10.f }, 1.f, { 0.f, 0.f, 0.f, 1.f }, 0.f };
+    RenderInstance high = { { 3.f, 10.f, 18.f }, 1.f, { 0.f, 0.f, 0.f, 1.f }, 0.f };
+
+    const auto decodedLow = InstanceCompression::Decode(InstanceCompression::Encode(low, cluster), cluster);
+    const auto decodedHigh = InstanceCompression::Decode(InstanceCompression::Encode(high, cluster), cluster);
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        EXPECT_FLOAT_EQ(decodedLow.Position[axis], low.Position[axis]);
+        EXPECT_FLOAT_EQ(decodedHigh.Position[axis], high.Position[axis]);
+    }
+}
+
+TEST(InstanceCompression, ThreadedEncodeMatchesSingleThreaded)
+{
+    const auto instances = CreateInstances(10000, 3);
+
+    std::vector<InstanceCompression::CompressedInstance> single;
+    std::vector<InstanceCompression::CompressedInstance> threaded;
+    std::vector<InstanceCompression::Cluster> singleClusters;
+    std::vector<InstanceCompression::Cluster> threadedClusters;
+
+    InstanceCompression::EncodeAll(instances, single, singleClusters, 1);
+    InstanceCompression::EncodeAll(instances, threaded, threadedClusters, 4);
+
+    EXPECT_EQ(single, threaded);
+}
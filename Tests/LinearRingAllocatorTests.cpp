@@ -0,0 +1,129 @@
+#include <cstdint>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include "Gradient/LinearRingAllocator.h"
+
+namespace
+{
+    using Gradient::LinearRingAllocator;
+
+    constexpr uint64_t Invalid = LinearRingAllocator::InvalidOffset;
+}
+
+TEST(LinearRingAllocator, BumpsAndAlignsWithinAFrame)
+{
+    LinearRingAllocator ring(1024, 4);
+
+    EXPECT_EQ(ring.Allocate(10, 4), 0u);
+    EXPECT_EQ(ring.Allocate(10, 256), 256u);
+    EXPECT_EQ(ring.Allocate(4, 4), 268u);
+
+    // Padding counts against the frame
+    EXPECT_EQ(ring.GetFrameBytes(), 272u);
+    EXPECT_EQ(ring.GetUsedBytes(), 272u);
+
+    EXPECT_THROW(ring.Allocate(4, 3), std::runtime_error);
+    EXPECT_THROW(ring.Allocate(4, 2048), std::runtime_error);
+    EXPECT_THROW(LinearRingAllocator(0, 4), std::runtime_error);
+    EXPECT_THROW(LinearRingAllocator(1024, 0), std::runtime_error);
+}
+
+TEST(LinearRingAllocator, WrapsRatherThanStraddlingTheEnd)
+{
+    LinearRingAllocator ring(1024, 4);
+
+    ring.Allocate(300, 4);
+    ring.Allocate(300, 4);
+    ring.EndFrame(1);
+    EXPECT_EQ(ring.Allocate(300, 4), 600u);
+    ring.ReleaseCompletedFrames(1);
+
+    // 124 bytes are left before the end, so this starts again at 0 and
+    // the skipped bytes stay with the frame
+    EXPECT_EQ(ring.Allocate(300, 4), 0u);
+    EXPECT_EQ(ring.GetUsedBytes(), 724u);
+    EXPECT_EQ(ring.GetFrameBytes(), 724u);
+
+    // The open frame still holds [600, 1024), so only 300 bytes are left
+    EXPECT_EQ(ring.Allocate(301, 4), Invalid);
+    EXPECT_EQ(ring.Allocate(300, 4), 300u);
+    EXPECT_EQ(ring.Allocate(4, 4), Invalid);
+}
+
+TEST(LinearRingAllocator, FitsAWholeRingAllocationWhenEmpty)
+{
+    LinearRingAllocator ring(1024, 4);
+    EXPECT_EQ(ring.Allocate(1025, 4), Invalid);
+    EXPECT_EQ(ring.Allocate(1024, 4), 0u);
+    ring.EndFrame(1);
+    ring.ReleaseCompletedFrames(1);
+
+    // Part way round the ring, with nothing live
+    ring.Allocate(100, 4);
+    ring.EndFrame(2);
+    ring.ReleaseCompletedFrames(2);
+    EXPECT_EQ(ring.GetUsedBytes(), 0u);
+
+    EXPECT_EQ(ring.Allocate(1024, 4), 0u);
+    EXPECT_EQ(ring.GetUsedBytes(), 1024u);
+    EXPECT_EQ(ring.Allocate(4, 4), Invalid);
+
+    // With anything live it can't fit
+    ring.EndFrame(3);
+    ring.ReleaseCompletedFrames(3);
+    ring.Allocate(4, 4);
+    EXPECT_EQ(ring.Allocate(1024, 4), Invalid);
+}
+
+TEST(LinearRingAllocator, ReleasingAnEmptyFrameDoesNotMoveTheTailBack)
+{
+    LinearRingAllocator ring(1024, 4);
+
+    ring.Allocate(100, 4);
+    ring.EndFrame(1);
+    ring.ReleaseCompletedFrames(1);
+
+    // Frame 2 is empty and ends at 100, behind where the next allocation
+    // moves the tail to
+    ring.EndFrame(2);
+    EXPECT_EQ(ring.Allocate(1024, 4), 0u);
+    ring.ReleaseCompletedFrames(2);
+
+    EXPECT_EQ(ring.GetUsedBytes(), 1024u);
+    EXPECT_EQ(ring.Allocate(4, 4), Invalid);
+}
+
+TEST(LinearRingAllocator, ReleasesFramesOnceTheirFenceCompletes)
+{
+    LinearRingAllocator ring(1024, 3);
+
+    for (uint64_t fence = 1; fence <= 3; fence++)
+    {
+        ASSERT_NE(ring.Allocate(300, 4), Invalid);
+        ring.EndFrame(fence);
+    }
+
+    EXPECT_EQ(ring.GetPendingFrameCount(), 3u);
+    EXPECT_EQ(ring.GetOldestPendingFence(), 1u);
+    EXPECT_THROW(ring.EndFrame(4), std::runtime_error);
+    EXPECT_EQ(ring.Allocate(300, 4), Invalid);
+
+    // Nothing has completed yet
+    ring.ReleaseCompletedFrames(0);
+    EXPECT_EQ(ring.GetUsedBytes(), 900u);
+
+    // Completing fence 2 releases the first two frames together
+    ring.ReleaseCompletedFrames(2);
+    EXPECT_EQ(ring.GetPendingFrameCount(), 1u);
+    EXPECT_EQ(ring.GetOldestPendingFence(), 3u);
+    EXPECT_EQ(ring.GetUsedBytes(), 300u);
+    EXPECT_EQ(ring.Allocate(300, 4), 0u);
+
+    ring.EndFrame(4);
+    ring.ReleaseCompletedFrames(4);
+    EXPECT_EQ(ring.GetPendingFrameCount(), 0u);
+    EXPECT_EQ(ring.GetOldestPendingFence(), 0u);
+    EXPECT_EQ(ring.GetUsedBytes(), 0u);
+}
@@ -0,0 +1,190 @@
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Core/ParallelFor.h"
+
+namespace
+{
+    using ISV::ParallelFor;
+    using ISV::WorkerPool;
+
+    // Runs ParallelFor and records which thread index covered each element
+    std::vector<uint32_t> Owners(uint32_t count, uint32_t threadCount)
+    {
+        std::vector<uint32_t> owners(count, UINT32_MAX);
+        ParallelFor(count, threadCount, [&owners](uint32_t begin, uint32_t end, uint32_t t)
+            {
+                for (uint32_t i = begin; i < end; i++)
+                {
+                    owners[i] = t;
+                }
+            });
+        return owners;
+    }
+}
+
+TEST(ParallelFor, CoversEveryElementOnceInOrderedRanges)
+{
+    for (const uint32_t threadCount : { 1u, 2u, 3u, 4u, 7u })
+    {
+        for (const uint32_t count : { 0u, 1u, 5u, 100u, 1001u })
+        {
+            const std::vector<uint32_t> owners = Owners(count, threadCount);
+
+            // Ranges are contiguous and assigned by thread index
+            for (uint32_t i = 0; i < count; i++)
+            {
+                ASSERT_LT(owners[i], threadCount) << "count " << count << ", threads " << threadCount;
+                if (i > 0)
+                {
+                    ASSERT_GE(owners[i], owners[i - 1]);
+                }
+            }
+        }
+    }
+}
+
+TEST(ParallelFor, RunsRangeZeroOnTheCallingThread)
+{
+    const std::thread::id caller = std::this_thread::get_id();
+    std::vector<std::thread::id> ids(4);
+
+    ParallelFor(4, 4, [&ids](uint32_t, uint32_t, uint32_t t)
+        {
+            ids[t] = std::this_thread::get_id();
+        });
+
+    EXPECT_EQ(ids[0], caller);
+    for (uint32_t t = 1; t < 4; t++)
+    {
+        EXPECT_NE(ids[t], caller);
+    }
+}
+
+TEST(ParallelFor, ReusesTheSameWorkers)
+{
+    ParallelFor(64, 4, [](uint32_t, uint32_t, uint32_t) {});
+    const uint32_t workers = WorkerPool::Get().GetWorkerCount();
+    EXPECT_GE(workers, 3u);
+
+    std::vector<std::thread::id> first(4);
+    ParallelFor(4, 4, [&first](uint32_t, uint32_t, uint32_t t)
+        {
+            first[t] = std::this_thread::get_id();
+        });
+
+    for (int call = 0; call < 100; call++)
+    {
+        std::vector<std::thread::id> ids(4);
+        ParallelFor(4, 4, [&ids](uint32_t, uint32_t, uint32_t t)
+            {
+                ids[t] = std::this_thread::get_id();
+            });
+        ASSERT_EQ(ids, first) << "call " << call;
+    }
+
+    // Fewer threads than the pool holds leaves the rest asleep
+    EXPECT_EQ(Owners(10, 2), (std::vector<uint32_t>{ 0, 0, 0, 0, 0, 1, 1, 1, 1, 1 }));
+    EXPECT_EQ(WorkerPool::Get().GetWorkerCount(), workers);
+}
+
+TEST(ParallelFor, NestedCallsRunOnTheirOwnThread)
+{
+    std::vector<std::vector<uint32_t>> inner(4);
+    std::vector<uint8_t> sameThread(4, 0);
+
+    ParallelFor(4, 4, [&](uint32_t, uint32_t, uint32_t t)
+        {
+            const std::thread::id outer = std::this_thread::get_id();
+            bool same = true;
+
+            inner[t].assign(100, UINT32_MAX);
+            ParallelFor(100, 4, [&](uint32_t begin, uint32_t end, uint32_t innerThread)
+                {
+                    same = same && std::this_thread::get_id() == outer;
+                    for (uint32_t i = begin; i < end; i++)
+                    {
+                        inner[t][i] = innerThread;
+                    }
+                });
+
+            sameThread[t] = same ? 1 : 0;
+        });
+
+    for (uint32_t t = 0; t < 4; t++)
+    {
+        EXPECT_EQ(sameThread[t], 1) << "outer range " << t;
+        EXPECT_EQ(inner[t][0], 0u);
+        EXPECT_EQ(inner[t][99], 3u);
+    }
+}
+
+TEST(ParallelFor, RethrowsAfterEveryRangeFinishes)
+{
+    for (const uint32_t throwing : { 0u, 2u })
+    {
+        std::atomic<uint32_t> finished{ 0 };
+
+        EXPECT_THROW(ParallelFor(4, 4, [&](uint32_t, uint32_t, uint32_t t)
+            {
+                if (t == throwing)
+                {
+                    throw std::runtime_error("range failed");
+                }
+                finished++;
+            }), std::runtime_error);
+
+        EXPECT_EQ(finished.load(), 3u) << "throwing range " << throwing;
+    }
+
+    // The pool still works afterwards
+    EXPECT_EQ(Owners(4, 4), (std::vector<uint32_t>{ 0, 1, 2, 3 }));
+}
+
+TEST(ParallelFor, CallsFromSeveralThreadsTakeTurns)
+{
+    constexpr uint32_t Callers = 4;
+    constexpr uint32_t Calls = 200;
+
+    std::atomic<uint32_t> mismatches{ 0 };
+    std::vector<std::thread> callers;
+
+    for (uint32_t c = 0; c < Callers; c++)
+    {
+        callers.emplace_back([&mismatches, c]()
+            {
+                for (uint32_t call = 0; call < Calls; call++)
+                {
+                    const uint32_t count = 50 + c;
+                    std::vector<uint32_t> values(count, 0);
+                    ParallelFor(count, 3, [&values, c](uint32_t begin, uint32_t end, uint32_t)
+                        {
+                            for (uint32_t i = begin; i < end; i++)
+                            {
+                                values[i] += c + 1;
+                            }
+                        });
+
+                    for (const uint32_t value : values)
+                    {
+                        if (value != c + 1)
+                        {
+                            mismatches++;
+                        }
+                    }
+                }
+            });
+    }
+
+    for (auto& caller : callers)
+    {
+        caller.join();
+    }
+
+    EXPECT_EQ(mismatches.load(), 0u);
+}
@@ -0,0 +1,234 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Core/ParticleSnapshot.h"
+
+namespace
+{
+    using ISV::ParticleSnapshot;
+    using Frame = ParticleSnapshot::Frame;
+    using FrameRecord = ParticleSnapshot::FrameRecord;
+    using FrameType = ParticleSnapshot::FrameType;
+
+    // Whole pages per section, so a delta that changes everything is
+    // bigger than a keyframe
+    constexpr uint32_t ParticleCount = 1024;
+    constexpr uint32_t ConstantsSize = 4096;
+    constexpr uint32_t KeyframeInterval = 4;
+    constexpr uint32_t FrameCount = 11;
+
+    // Frame n moves a few particles and changes the constants, like a
+    // simulation where most particles are asleep. Frame 6 changes every
+    // word, so it's written as a keyframe.
+    Frame MakeFrame(uint32_t n)
+    {
+        Frame frame;
+        frame.Resize(ParticleCount, ConstantsSize);
+
+        for (uint32_t i = 0; i < ParticleCount; i++)
+        {
+            const float moved = i % 50 < n ? static_cast<float>(n) : 0.f;
+            const float all = n >= 6 ? 0.5f : 0.f;
+            frame.Positions[i] = { i + moved + all, 2.f * i + all, -1.f * i + all };
+            frame.Scales[i] = 1.f + all;
+            frame.Rotations[i] = { all, all, all, 1.f + all };
+            frame.ExtinctionScales[i] = 0.25f * (i % 4) + all;
+        }
+
+        for (uint32_t b = 0; b < ConstantsSize; b++)
+        {
+            frame.Constants[b] = static_cast<uint8_t>(n * 7 + b);
+        }
+
+        return frame;
+    }
+
+    void ExpectSameFrame(const Frame& actual, const Frame& expected, uint32_t n)
+    {
+        EXPECT_EQ(actual.Positions, expected.Positions) << "frame " << n;
+        EXPECT_EQ(actual.Scales, expected.Scales) << "frame " << n;
+        EXPECT_EQ(actual.Rotations, expected.Rotations) << "frame " << n;
+        EXPECT_EQ(actual.ExtinctionScales, expected.ExtinctionScales) << "frame " << n;
+        EXPECT_EQ(actual.Constants, expected.Constants) << "frame " << n;
+    }
+
+    std::vector<char> ReadBytes(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        return { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+    }
+
+    void WriteBytes(const std::string& path, const std::vector<char>& bytes)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    class ParticleSnapshotTest : public testing::Test
+    {
+    protected:
+        void SetUp() override
+        {
+            const std::string name = testing::UnitTest::GetInstance()->current_test_info()->name();
+            m_path = (std::filesystem::temp_directory_path() / ("isv_snapshot_" + name + ".bin")).string();
+            m_corruptPath = m_path + ".corrupt";
+
+            ParticleSnapshot::Writer writer(m_path, ParticleCount, ConstantsSize, KeyframeInterval);
+            for (uint32_t n = 0; n < FrameCount; n++)
+            {
+                writer.WriteFrame(MakeFrame(n));
+            }
+            writer.Close();
+
+            m_bytes = ReadBytes(m_path);
+            std::memcpy(&m_header, m_bytes.data(), sizeof(m_header));
+        }
+
+        void TearDown() override
+        {
+            std::error_code error;
+            std::filesystem::remove(m_path, error);
+            std::filesystem::remove(m_corruptPath, error);
+        }
+
+        FrameRecord& Record(std::vector<char>& bytes, uint32_t frame)
+        {
+            return *reinterpret_cast<FrameRecord*>(bytes.data() + m_header.IndexOffset + frame * sizeof(FrameRecord));
+        }
+
+        // Opens a copy of the file with the given change made to it
+        template <typename Fn>
+        void OpenCorrupted(Fn&& corrupt)
+        {
+            std::vector<char> bytes = m_bytes;
+            corrupt(bytes);
+            WriteBytes(m_corruptPath, bytes);
+            ParticleSnapshot::Reader reader(m_corruptPath);
+        }
+
+        std::string m_path;
+        std::string m_corruptPath;
+        std::vector<char> m_bytes;
+        ParticleSnapshot::FileHeader m_header = {};
+    };
+}
+
+TEST_F(ParticleSnapshotTest, ReadsBackEveryFrameInAnyOrder)
+{
+    ParticleSnapshot::Reader reader(m_path);
+    EXPECT_EQ(reader.GetFrameCount(), FrameCount);
+    EXPECT_EQ(reader.GetParticleCount(), ParticleCount);
+    EXPECT_EQ(reader.GetConstantsSize(), ConstantsSize);
+    EXPECT_EQ(reader.GetKeyframeInterval(), KeyframeInterval);
+
+    for (uint32_t n = 0; n < FrameCount; n++)
+    {
+        ExpectSameFrame(reader.ReadFrame(n), MakeFrame(n), n);
+    }
+
+    // Backwards and at random, so frames are decoded from their keyframe
+    for (uint32_t n = FrameCount; n-- > 0;)
+    {
+        ExpectSameFrame(reader.ReadFrame(n), MakeFrame(n), n);
+    }
+
+    std::mt19937 rng(3);
+    for (int i = 0; i < 30; i++)
+    {
+        const uint32_t n = rng() % FrameCount;
+        ExpectSameFrame(reader.ReadFrame(n), MakeFrame(n), n);
+    }
+}
+
+TEST_F(ParticleSnapshotTest, WritesKeyframesOnTheIntervalAndForBigDeltas)
+{
+    ParticleSnapshot::Reader reader(m_path);
+
+    for (uint32_t n = 0; n < FrameCount; n++)
+    {
+        const bool keyframe = n % KeyframeInterval == 0 || n == 6;
+        EXPECT_EQ(reader.IsKeyframe(n), keyframe) << "frame " << n;
+    }
+
+    EXPECT_EQ(reader.GetRecord(7).Keyframe, 6u);
+    EXPECT_EQ(reader.GetRecord(8).Keyframe, 8u);
+    EXPECT_THROW(reader.GetRecord(FrameCount), std::out_of_range);
+    EXPECT_THROW(reader.GetKeyframeView(1), std::runtime_error);
+
+    // A keyframe can be used in place
+    const ParticleSnapshot::FrameView view = reader.GetKeyframeView(4);
+    const Frame expected = MakeFrame(4);
+    ASSERT_EQ(view.ParticleCount, ParticleCount);
+    EXPECT_EQ(view.Positions[1000], expected.Positions[1000]);
+    EXPECT_EQ(view.ExtinctionScales[3], expected.ExtinctionScales[3]);
+    EXPECT_EQ(std::memcmp(view.Constants, expected.Constants.data(), ConstantsSize), 0);
+}
+
+TEST_F(ParticleSnapshotTest, RejectsFilesThatAreNotSnapshots)
+{
+    EXPECT_THROW(OpenCorrupted([](std::vector<char>& bytes) { bytes.resize(16); }), std::runtime_error);
+    EXPECT_THROW(OpenCorrupted([](std::vector<char>& bytes) { bytes[0] ^= 1; }), std::runtime_error);
+
+    EXPECT_THROW(OpenCorrupted([](std::vector<char>& bytes)
+        {
+            bytes[offsetof(ParticleSnapshot::FileHeader, Version)] = 2;
+        }), std::runtime_error);
+}
+
+TEST_F(ParticleSnapshotTest, RejectsTruncatedFiles)
+{
+    // Cut into the index, and before it
+    for (const std::size_t cut : { sizeof(FrameRecord), std::size_t(m_bytes.size() / 2) })
+    {
+        EXPECT_THROW(OpenCorrupted([cut](std::vector<char>& bytes) { bytes.resize(bytes.size() - cut); }),
+            std::runtime_error) << "cut " << cut;
+    }
+}
+
+TEST_F(ParticleSnapshotTest, RejectsCorruptIndexRecords)
+{
+    // A keyframe that claims to belong to an earlier keyframe
+    EXPECT_THROW(OpenCorrupted([this](std::vector<char>& bytes) { Record(bytes, 4).Keyframe = 0; }),
+        std::runtime_error);
+
+    // A delta that skips over the keyframe before it
+    EXPECT_THROW(OpenCorrupted([this](std::vector<char>& bytes) { Record(bytes, 5).Keyframe = 0; }),
+        std::runtime_error);
+
+    // A delta with no frame before it, and a record past the frame data
+    EXPECT_THROW(OpenCorrupted([this](std::vector<char>& bytes) { Record(bytes, 0).Type = FrameType::Delta; }),
+        std::runtime_error);
+    EXPECT_THROW(OpenCorrupted([this](std::vector<char>& bytes) { Record(bytes, 2).Offset = m_header.IndexOffset; }),
+        std::runtime_error);
+    EXPECT_THROW(OpenCorrupted([this](std::vector<char>& bytes) { Record(bytes, 3).Type = static_cast<FrameType>(7); }),
+        std::runtime_error);
+
+    // Unchanged, it still opens
+    EXPECT_NO_THROW(OpenCorrupted([](std::vector<char>&) {}));
+}
+
+TEST_F(ParticleSnapshotTest, TruncatedDeltasThrowWithoutBreakingOtherFrames)
+{
+    std::vector<char> bytes = m_bytes;
+    Record(bytes, 2).Size = 8;
+    WriteBytes(m_corruptPath, bytes);
+
+    ParticleSnapshot::Reader reader(m_corruptPath);
+    ExpectSameFrame(reader.ReadFrame(1), MakeFrame(1), 1);
+    EXPECT_THROW(reader.ReadFrame(2), std::runtime_error);
+    EXPECT_THROW(reader.ReadFrame(3), std::runtime_error);
+
+    // The half applied frame isn't mistaken for a good one
+    ExpectSameFrame(reader.ReadFrame(1), MakeFrame(1), 1);
+    ExpectSameFrame(reader.ReadFrame(5), MakeFrame(5), 5);
+}
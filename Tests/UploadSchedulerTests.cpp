@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "Gradient/UploadScheduler.h"
+
+namespace
+{
+    using Gradient::UploadScheduler;
+    using Gradient::UploadTicket;
+
+    constexpr uint64_t MB = 1024 * 1024;
+
+    // Stands in for a queue and fence. The GPU finishes a batch when the
+    // test moves Completed on, or when the scheduler waits for it.
+    class MockBackend : public UploadScheduler::Backend
+    {
+    public:
+        void SubmitBatch(uint64_t batch) override
+        {
+            Submitted.push_back(batch);
+        }
+
+        uint64_t GetCompletedBatch() override
+        {
+            return Completed;
+        }
+
+        void WaitForBatch(uint64_t batch) override
+        {
+            Waits.push_back(batch);
+            Completed = std::max(Completed, batch);
+        }
+
+        std::vector<uint64_t> Submitted;
+        std::vector<uint64_t> Waits;
+        uint64_t Completed = 0;
+    };
+}
+
+TEST(UploadScheduler, BatchesUploadsUntilFlushed)
+{
+    MockBackend backend;
+    UploadScheduler scheduler(backend, 1024, 4, MB);
+
+    const auto a = scheduler.Reserve(100, 4);
+    const auto b = scheduler.Reserve(100, 4);
+
+    EXPECT_EQ(a.Offset, 0u);
+    EXPECT_EQ(b.Offset, 100u);
+    EXPECT_EQ(a.Ticket.Batch, 1u);
+    EXPECT_EQ(b.Ticket.Batch, 1u);
+    EXPECT_TRUE(backend.Submitted.empty());
+    EXPECT_FALSE(scheduler.IsSubmitted(a.Ticket));
+
+    EXPECT_EQ(scheduler.Flush().Batch, 1u);
+    EXPECT_EQ(backend.Submitted, (std::vector<uint64_t>{ 1 }));
+    EXPECT_TRUE(scheduler.IsSubmitted(b.Ticket));
+    EXPECT_EQ(scheduler.GetOpenBatch(), 2u);
+
+    // Nothing open, so nothing to submit
+    EXPECT_EQ(scheduler.Flush().Batch, 1u);
+    EXPECT_EQ(backend.Submitted.size(), 1u);
+    EXPECT_EQ(scheduler.GetStats().Batches, 1u);
+    EXPECT_EQ(scheduler.GetStats().Uploads, 2u);
+    EXPECT_EQ(scheduler.GetStats().StagedBytes, 200u);
+}
+
+TEST(UploadScheduler, SplitsBatchesAtTheByteLimit)
+{
+    MockBackend backend;
+    UploadScheduler scheduler(backend, 32 * MB, 8, 8 * MB);
+
+    std::vector<UploadTicket> tickets;
+    for (int i = 0; i < 20; i++)
+    {
+        tickets.push_back(scheduler.Reserve(MB, 256).Ticket);
+    }
+
+    // A batch closes once it holds 8 MB, before the next upload
+    for (int i = 0; i < 20; i++)
+    {
+        EXPECT_EQ(tickets[i].Batch, static_cast<uint64_t>(i / 8 + 1)) << "upload " << i;
+    }
+    EXPECT_EQ(backend.Submitted, (std::vector<uint64_t>{ 1, 2 }));
+    EXPECT_EQ(scheduler.GetOpenBatchBytes(), 4 * MB);
+    EXPECT_EQ(scheduler.GetStats().Stalls, 0u);
+}
+
+TEST(UploadScheduler, OvershootsTheLimitByAtMostOneUpload)
+{
+    MockBackend backend;
+    UploadScheduler scheduler(backend, 32 * MB, 8, 8 * MB);
+
+    const auto small = scheduler.Reserve(MB, 256);
+    const auto large = scheduler.Reserve(12 * MB, 256);
+    const auto next = scheduler.Reserve(MB, 256);
+
+    // The batch only closes after crossing the limit, so the large upload
+    // joins the open batch and the one after it starts a new one
+    EXPECT_EQ(small.Ticket.Batch, 1u);
+    EXPECT_EQ(large.Ticket.Batch, 1u);
+    EXPECT_EQ(next.Ticket.Batch, 2u);
+    EXPECT_EQ(backend.Submitted, (std::vector<uint64_t>{ 1 }));
+}
+
+TEST(UploadScheduler, LeavesUploadsLargerThanTheRingToTheCaller)
+{
+    MockBackend backend;
+    UploadScheduler scheduler(backend, 1024, 4, MB);
+
+    const auto staged = scheduler.Reserve(100, 4);
+    const auto oversized = scheduler.Reserve(2000, 4);
+
+    EXPECT_EQ(oversized.Offset, UploadScheduler::InvalidOffset);
+    EXPECT_EQ(oversized.Ticket.Batch, staged.Ticket.Batch);
+    EXPECT_EQ(scheduler.GetStagingUsedBytes(), 100u);
+    EXPECT_EQ(scheduler.GetStats().OversizedUploads, 1u);
+    EXPECT_EQ(scheduler.GetStats().StagedBytes, 100u);
+
+    // Its ticket still submits and completes with the batch
+    scheduler.Wait(oversized.Ticket);
+    EXPECT_EQ(backend.Submitted, (std::vector<uint64_t>{ 1 }));
+    EXPECT_EQ(backend.Waits, (std::vector<uint64_t>{ 1 }));
+    EXPECT_TRUE(scheduler.IsComplete(staged.Ticket));
+}
+
+TEST(UploadScheduler, AnOversizedUploadAloneStillMakesABatch)
+{
+    MockBackend backend;
+    UploadScheduler scheduler(backend, 1024, 4, MB);
+
+    const auto oversized = scheduler.Reserve(4096, 4);
+    EXPECT_FALSE(scheduler.IsSubmitted(oversized.Ticket));
+    EXPECT_FALSE(scheduler.IsComplete(oversized.Ticket));
+
+    EXPECT_EQ(scheduler.Flush().Batch, 1u);
+    EXPECT_EQ(backend.Submitted, (std::vector<uint64_t>{ 1 }));
+}
+
+TEST(UploadScheduler, ReusesStagingOnlyOnceTheGpuIsDone)
+{
+    MockBackend backend;
+    UploadScheduler scheduler(backend, 1024, 4, MB);
+
+    scheduler.Reserve(300, 4);
+    scheduler.Reserve(300, 4);
+    scheduler.Reserve(300, 4);
+    scheduler.Flush();
+
+    // Submitted but not complete: the space is still the GPU's
+    EXPECT_EQ(scheduler.GetStagingUsedBytes(), 900u);
+
+    backend.Completed = 1;
+    const auto wrapped = scheduler.Reserve(300, 4);
+
+    // The 124 bytes at the end are skipped rather than straddled
+    EXPECT_EQ(wrapped.Offset, 0u);
+    EXPECT_EQ(wrapped.Ticket.Batch, 2u);
+    EXPECT_EQ(scheduler.GetStagingUsedBytes(), 300u);
+    EXPECT_TRUE(backend.Waits.empty());
+    EXPECT_EQ(scheduler.GetStats().Stalls, 0u);
+}
+
+TEST(UploadScheduler, WaitsForTheOldestBatchWhenTheRingIsFull)
+{
+    MockBackend backend;
+    UploadScheduler scheduler(backend, 1024, 4, MB);
+
+    scheduler.Reserve(300, 4);
+    scheduler.Reserve(300, 4);
+    scheduler.Reserve(300, 4);
+    scheduler.Flush();
+    scheduler.Reserve(100, 4);
+    scheduler.Flush();
+
+    // Batches 1 and 2 hold the ring; only waiting on batch 1 frees enough
+    const auto wrapped = scheduler.Reserve(300, 4);
+
+    EXPECT_EQ(wrapped.Offset, 0u);
+    EXPECT_EQ(backend.Waits, (std::vector<uint64_t>{ 1 }));
+    EXPECT_EQ(scheduler.GetStats().Stalls, 1u);
+    EXPECT_FALSE(scheduler.IsComplete({ 2 }));
+}
+
+TEST(UploadScheduler, SubmitsTheOpenBatchToFreeItsOwnSpace)
+{
+    MockBackend backend;
+    UploadScheduler scheduler(backend, 1024, 4, MB);
+
+    const auto first = scheduler.Reserve(600, 4);
+    const auto second = scheduler.Reserve(600, 4);
+
+    // The open batch held the only space, so it went out and was waited on
+    EXPECT_EQ(first.Ticket.Batch, 1u);
+    EXPECT_EQ(second.Ticket.Batch, 2u);
+    EXPECT_EQ(second.Offset, 0u);
+    EXPECT_EQ(backend.Submitted, (std::vector<uint64_t>{ 1 }));
+    EXPECT_EQ(backend.Waits, (std::vector<uint64_t>{ 1 }));
+}
+
+TEST(UploadScheduler, WaitsForASlotWhenTooManyBatchesAreInFlight)
+{
+    MockBackend backend;
+    UploadScheduler scheduler(backend, 1024, 2, MB);
+
+    for (int i = 0; i < 3; i++)
+    {
+        scheduler.Reserve(10, 4);
+        scheduler.Flush();
+    }
+
+    EXPECT_EQ(backend.Submitted, (std::vector<uint64_t>{ 1, 2, 3 }));
+    EXPECT_EQ(backend.Waits, (std::vector<uint64_t>{ 1 }));
+}
+
+TEST(UploadScheduler, TicketsReportSubmissionAndCompletion)
+{
+    MockBackend backend;
+    UploadScheduler scheduler(backend, 1024, 4, MB);
+
+    // Batch 0 is never waited on
+    EXPECT_TRUE(scheduler.IsComplete(UploadTicket{}));
+    scheduler.Wait(UploadTicket{});
+    EXPECT_TRUE(backend.Waits.empty());
+
+    const auto ticket = scheduler.Reserve(100, 4).Ticket;
+    EXPECT_FALSE(scheduler.IsComplete(ticket));
+
+    // Submitting doesn't wait
+    scheduler.Submit(ticket);
+    scheduler.Submit(ticket);
+    EXPECT_EQ(backend.Submitted, (std::vector<uint64_t>{ 1 }));
+    EXPECT_TRUE(backend.Waits.empty());
+    EXPECT_FALSE(scheduler.IsComplete(ticket));
+
+    backend.Completed = 1;
+    EXPECT_TRUE(scheduler.IsComplete(ticket));
+    scheduler.Wait(ticket);
+    EXPECT_TRUE(backend.Waits.empty());
+}
+
+TEST(UploadScheduler, WaitForAllSubmitsAndWaitsOnce)
+{
+    MockBackend backend;
+    UploadScheduler scheduler(backend, 1024, 4, MB);
+
+    scheduler.Reserve(100, 4);
+    scheduler.WaitForAll();
+    scheduler.WaitForAll();
+
+    EXPECT_EQ(backend.Submitted, (std::vector<uint64_t>{ 1 }));
+    EXPECT_EQ(backend.Waits, (std::vector<uint64_t>{ 1 }));
+    EXPECT_EQ(scheduler.GetStagingUsedBytes(), 0u);
+}
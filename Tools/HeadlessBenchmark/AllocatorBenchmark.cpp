@@ -0,0 +1,506 @@
+// Compares Gradient::FreeListAllocator with the optional-per-slot
+// allocator it replaced, and with Gradient::ConcurrentFreeListAllocator,
+// over allocate, remove, get and iterate mixes. Each timing is the fastest
+// of --repeats runs. Then it times whole frames, each replacing a fraction
+// of the elements and iterating over all of them once, and reports the
+// churn per frame at which the dense layout stops paying for itself. Last
+// it measures ConcurrentFreeListAllocator against a FreeListAllocator
+// behind a mutex at 1 to --threads threads.
+//
+//  AllocatorBenchmark [--elements <count>] [--operations <count>] [--threads <count>]
+//                     [--repeats <count>]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Gradient/ConcurrentFreeListAllocator.h"
+#include "Gradient/FreeListAllocator.h"
+
+namespace
+{
+    // The allocator before generational handles, kept for comparison
+    template <typename T>
+    class LegacyFreeListAllocator
+    {
+    public:
+        using Handle = std::size_t;
+
+        Handle Allocate(const T& in)
+        {
+            if (!m_freeHandles.empty())
+            {
+                Handle handle = m_freeHandles.back();
+                m_freeHandles.pop_back();
+                m_elements[handle] = in;
+                return handle;
+            }
+
+            m_elements.emplace_back(in);
+            return m_elements.size() - 1;
+        }
+
+        void Remove(Handle handle)
+        {
+            if (handle < m_elements.size())
+            {
+                m_freeHandles.push_back(handle);
+                m_elements[handle].reset();
+            }
+        }
+
+        T* Get(Handle handle)
+        {
+            return handle < m_elements.size() && m_elements[handle] ? &*m_elements[handle] : nullptr;
+        }
+
+        template <typename Fn>
+        void ForEach(Fn&& fn)
+        {
+            for (auto& element : m_elements)
+            {
+                if (element)
+                {
+                    fn(*element);
+                }
+            }
+        }
+
+    private:
+        std::vector<std::optional<T>> m_elements;
+        std::vector<Handle> m_freeHandles;
+    };
+
+    template <typename T>
+    class DenseAdapter : public Gradient::FreeListAllocator<T>
+    {
+    public:
+        template <typename Fn>
+        void ForEach(Fn&& fn)
+        {
+            for (auto& element : *this)
+            {
+                fn(element);
+            }
+        }
+    };
+
+    // About the size of a small component
+    struct Element
+    {
+        float Values[16];
+    };
+
+    volatile float g_sink = 0.f;
+
+    template <typename Fn>
+    double TimeNs(Fn&& fn)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+
+    struct Timings
+    {
+        double AllocateNs;
+        double GetNs;
+        double ChurnNs;
+        double IterateNs;
+    };
+
+    // elements are allocated, half are removed at random, then a mix of
+    // remove and allocate keeps the allocator half full with holes spread
+    // through it, which is where the two layouts differ
+    template <typename Allocator>
+    Timings Run(uint32_t elements, uint32_t operations)
+    {
+        using Handle = decltype(std::declval<Allocator>().Allocate(Element{}));
+
+        Allocator allocator;
+        std::vector<Handle> handles;
+        handles.reserve(elements);
+        std::mt19937 rng(1);
+
+        Timings timings = {};
+
+        timings.AllocateNs = TimeNs([&]()
+            {
+                for (uint32_t i = 0; i < elements; i++)
+                {
+                    Element element = {};
+                    element.Values[0] = static_cast<float>(i);
+                    handles.push_back(allocator.Allocate(element));
+                }
+            }) / elements;
+
+        std::shuffle(handles.begin(), handles.end(), rng);
+        for (uint32_t i = 0; i < elements / 2; i++)
+        {
+            allocator.Remove(handles.back());
+            handles.pop_back();
+        }
+
+        std::vector<uint32_t> picks(operations);
+        for (auto& pick : picks)
+        {
+            pick = static_cast<uint32_t>(rng() % handles.size());
+        }
+
+        timings.GetNs = TimeNs([&]()
+            {
+                float sum = 0.f;
+                for (uint32_t pick : picks)
+                {
+                    sum += allocator.Get(handles[pick])->Values[0];
+                }
+                g_sink = sum;
+            }) / operations;
+
+        timings.ChurnNs = TimeNs([&]()
+            {
+                for (uint32_t pick : picks)
+                {
+                    allocator.Remove(handles[pick]);
+                    handles[pick] = allocator.Allocate(Element{});
+                }
+            }) / operations;
+
+        const uint32_t passes = std::max(1u, operations / elements);
+        timings.IterateNs = TimeNs([&]()
+            {
+                float sum = 0.f;
+                for (uint32_t pass = 0; pass < passes; pass++)
+                {
+                    allocator.ForEach([&sum](const Element& element)
+                        {
+                            sum += element.Values[0];
+                        });
+                }
+                g_sink = sum;
+            }) / (static_cast<double>(passes) * handles.size());
+
+        return timings;
+    }
+
+    Timings Fastest(const Timings& a, const Timings& b)
+    {
+        return {
+            std::min(a.AllocateNs, b.AllocateNs),
+            std::min(a.GetNs, b.GetNs),
+            std::min(a.ChurnNs, b.ChurnNs),
+            std::min(a.IterateNs, b.IterateNs)
+        };
+    }
+
+    template <typename Allocator>
+    Timings RunFastest(uint32_t elements, uint32_t operations, uint32_t repeats)
+    {
+        Timings timings = Run<Allocator>(elements, operations);
+        for (uint32_t r = 1; r < repeats; r++)
+        {
+            timings = Fastest(timings, Run<Allocator>(elements, operations));
+        }
+        return timings;
+    }
+
+    // A frame replaces churn random live elements and then iterates over
+    // all of them, the way the render thread walks its lists. Returns the fastest
+    // ns per frame over repeats runs of frames frames.
+    template <typename Allocator>
+    double RunFrames(uint32_t elements, uint32_t churn, uint32_t frames, uint32_t repeats)
+    {
+        using Handle = decltype(std::declval<Allocator>().Allocate(Element{}));
+
+        // Half full with holes spread through it, as in Run
+        Allocator allocator;
+        std::vector<Handle> handles;
+        for (uint32_t i = 0; i < elements; i++)
+        {
+            handles.push_back(allocator.Allocate(Element{}));
+        }
+
+        std::mt19937 rng(1);
+        std::shuffle(handles.begin(), handles.end(), rng);
+        for (uint32_t i = 0; i < elements / 2; i++)
+        {
+            allocator.Remove(handles.back());
+            handles.pop_back();
+        }
+
+        std::vector<uint32_t> picks(static_cast<std::size_t>(churn) * frames);
+        for (auto& pick : picks)
+        {
+            pick = static_cast<uint32_t>(rng() % handles.size());
+        }
+
+        double fastest = 0.0;
+        for (uint32_t r = 0; r < repeats; r++)
+        {
+            const double ns = TimeNs([&]()
+                {
+                    float sum = 0.f;
+                    for (uint32_t frame = 0; frame < frames; frame++)
+                    {
+                        for (uint32_t i = 0; i < churn; i++)
+                        {
+                            auto& handle = handles[picks[static_cast<std::size_t>(frame) * churn + i]];
+                            allocator.Remove(handle);
+                            handle = allocator.Allocate(Element{});
+                        }
+
+                        allocator.ForEach([&sum](const Element& element)
+                            {
+                                sum += element.Values[0];
+                            });
+                    }
+                    g_sink = sum;
+                }) / frames;
+
+            fastest = r == 0 ? ns : std::min(fastest, ns);
+        }
+
+        return fastest;
+    }
+
+    template <typename T>
+    class LockedFreeListAllocator
+    {
+    public:
+        using Handle = typename Gradient::FreeListAllocator<T>::Handle;
+
+        Handle Allocate(const T& in)
+        {
+            std::lock_guard lock(m_mutex);
+            return m_allocator.Allocate(in);
+        }
+
+        void Remove(Handle handle)
+        {
+            std::lock_guard lock(m_mutex);
+            m_allocator.Remove(handle);
+        }
+
+        // Copies out, since a pointer into dense storage could move as
+        // soon as the lock is released
+        bool Read(Handle handle, T& out)
+        {
+            std::lock_guard lock(m_mutex);
+            const T* element = m_allocator.Get(handle);
+            if (element != nullptr)
+            {
+                out = *element;
+            }
+            return element != nullptr;
+        }
+
+    private:
+        std::mutex m_mutex;
+        Gradient::FreeListAllocator<T> m_allocator;
+    };
+
+    template <typename T>
+    class ConcurrentAdapter : public Gradient::ConcurrentFreeListAllocator<T>
+    {
+    public:
+        bool Read(typename Gradient::ConcurrentFreeListAllocator<T>::Handle handle, T& out)
+        {
+            const T* element = this->Get(handle);
+            if (element != nullptr)
+            {
+                out = *element;
+            }
+            return element != nullptr;
+        }
+    };
+
+    // Each thread keeps a few elements of its own and, per operation,
+    // reads four of them and replaces one, roughly what loading threads
+    // and the render thread do to the buffer lists. Returns millions of
+    // operations per second over every thread.
+    template <typename Allocator>
+    double RunContended(uint32_t threadCount, uint32_t operationsPerThread)
+    {
+        using Handle = decltype(std::declval<Allocator>().Allocate(Element{}));
+        constexpr uint32_t LivePerThread = 64;
+
+        Allocator allocator;
+        std::vector<std::thread> threads;
+
+        const double ns = TimeNs([&]()
+            {
+                for (uint32_t t = 0; t < threadCount; t++)
+                {
+                    threads.emplace_back([&allocator, operationsPerThread, t]()
+                        {
+                            std::mt19937 rng(t);
+                            std::vector<Handle> handles;
+                            for (uint32_t i = 0; i < LivePerThread; i++)
+                            {
+                                handles.push_back(allocator.Allocate(Element{}));
+                            }
+
+                            Element element;
+                            float sum = 0.f;
+                            for (uint32_t i = 0; i < operationsPerThread; i++)
+                            {
+                                for (uint32_t read = 0; read < 4; read++)
+                                {
+                                    if (allocator.Read(handles[rng() % LivePerThread], element))
+                                    {
+                                        sum += element.Values[0];
+                                    }
+                                }
+
+                                auto& replaced = handles[rng() % LivePerThread];
+                                allocator.Remove(replaced);
+                                replaced = allocator.Allocate(Element{});
+                            }
+
+                            for (auto handle : handles)
+                            {
+                                allocator.Remove(handle);
+                            }
+                            g_sink = sum;
+                        });
+                }
+
+                for (auto& thread : threads)
+                {
+                    thread.join();
+                }
+            });
+
+        return static_cast<double>(threadCount) * operationsPerThread / ns * 1000.0;
+    }
+
+    void Print(const char* name, const Timings& timings)
+    {
+        std::cout << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(12) << timings.AllocateNs
+            << std::setw(12) << timings.GetNs
+            << std::setw(12) << timings.ChurnNs
+            << std::setw(12) << timings.IterateNs << "\n";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        uint32_t elements = 1 << 20;
+        uint32_t operations = 1 << 22;
+        uint32_t maxThreads = 64;
+        uint32_t repeats = 5;
+
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--elements" && i + 1 < argc)
+            {
+                elements = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--operations" && i + 1 < argc)
+            {
+                operations = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--threads" && i + 1 < argc)
+            {
+                maxThreads = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--repeats" && i + 1 < argc)
+            {
+                repeats = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else
+            {
+                throw std::runtime_error("Unknown or incomplete option " + arg);
+            }
+        }
+
+        if (elements < 2 || operations == 0 || repeats == 0)
+        {
+            throw std::runtime_error("Expected at least 2 elements, 1 operation and 1 repeat");
+        }
+
+        std::cout << elements << " elements, " << operations << " operations, ns per element or operation\n"
+            << std::left << std::setw(12) << "" << std::right
+            << std::setw(12) << "allocate"
+            << std::setw(12) << "get"
+            << std::setw(12) << "churn"
+            << std::setw(12) << "iterate" << "\n";
+
+        const Timings optional = RunFastest<LegacyFreeListAllocator<Element>>(elements, operations, repeats);
+        const Timings dense = RunFastest<DenseAdapter<Element>>(elements, operations, repeats);
+        Print("optional", optional);
+        Print("dense", dense);
+        Print("concurrent", RunFastest<ConcurrentAdapter<Element>>(elements, operations, repeats));
+
+        // Iterating at half occupancy, the optional layout visits two slots
+        // per live element
+        const double savedPerElement = optional.IterateNs - dense.IterateNs;
+        const double extraPerChurn = dense.ChurnNs - optional.ChurnNs;
+        if (extraPerChurn > 0.0)
+        {
+            std::cout << "Dense pays off while fewer than " << std::setprecision(1)
+                << 100.0 * savedPerElement / extraPerChurn
+                << "% of the live elements are replaced per pass over them\n";
+        }
+
+        std::cout << "\nFrames replacing a share of the live elements, then iterating over them, ns per frame\n"
+            << std::setw(10) << "replaced" << std::setw(14) << "optional"
+            << std::setw(14) << "dense" << std::setw(10) << "speedup"
+            << std::setw(14) << "concurrent" << "\n";
+
+        const uint32_t frames = std::max(1u, operations / elements);
+        for (const double share : { 0.0, 0.001, 0.01, 0.1, 0.5 })
+        {
+            const auto churn = static_cast<uint32_t>(share * (elements / 2));
+            const double optionalNs = RunFrames<LegacyFreeListAllocator<Element>>(elements, churn, frames, repeats);
+            const double denseNs = RunFrames<DenseAdapter<Element>>(elements, churn, frames, repeats);
+            const double concurrentNs = RunFrames<ConcurrentAdapter<Element>>(elements, churn, frames, repeats);
+
+            std::cout << std::setw(9) << std::setprecision(1) << share * 100.0 << "%"
+                << std::setprecision(0)
+                << std::setw(14) << optionalNs
+                << std::setw(14) << denseNs
+                << std::setprecision(2) << std::setw(10) << optionalNs / denseNs
+                << std::setprecision(0) << std::setw(14) << concurrentNs << "\n";
+        }
+
+        std::cout << "\n" << std::thread::hardware_concurrency() << " hardware threads, "
+            << "millions of operations per second\n"
+            << std::setw(8) << "threads"
+            << std::setw(12) << "mutex"
+            << std::setw(12) << "lock-free" << "\n";
+
+        // The same total work at every thread count
+        for (uint32_t threads = 1; threads <= maxThreads; threads *= 2)
+        {
+            const uint32_t perThread = std::max(1u, operations / 4 / threads);
+
+            std::cout << std::setw(8) << threads << std::setprecision(2)
+                << std::setw(12) << RunContended<LockedFreeListAllocator<Element>>(threads, perThread)
+                << std::setw(12) << RunContended<ConcurrentAdapter<Element>>(threads, perThread) << "\n";
+        }
+
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
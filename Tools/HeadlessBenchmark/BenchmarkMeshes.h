@@ -0,0 +1,235 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace ISV
+{
+    // Primitives shaped like the ones ProceduralMesh generates, for the
+    // mesh benchmarks. ProceduralMesh's own generators need DirectXMath,
+    // so these are rebuilt here with the same vertex layout and winding:
+    // counter-clockwise triangles seen from outside, so the cross product
+    // of the first two edges points out of the surface.
+    namespace BenchmarkMeshes
+    {
+        // Same layout as DirectX::VertexPositionNormalTexture
+        struct Vertex
+        {
+            std::array<float, 3> Position;
+            std::array<float, 3> Normal;
+            std::array<float, 2> TexCoord;
+        };
+
+        static_assert(sizeof(Vertex) == 32, "Must match ProceduralMesh::VertexType");
+
+        struct Mesh
+        {
+            std::vector<Vertex> Vertices;
+            std::vector<uint32_t> Indices;
+        };
+
+        // Latitude and longitude rings, like ProceduralMesh::CreateSphere
+        inline Mesh Sphere(uint32_t tessellation, float radius = 1.f)
+        {
+            Mesh mesh;
+            const uint32_t rings = tessellation + 1;
+
+            for (uint32_t y = 0; y < rings; y++)
+            {
+                const float v = static_cast<float>(y) / tessellation;
+                const float theta = v * 3.14159265f;
+
+                for (uint32_t x = 0; x < rings; x++)
+                {
+                    const float u = static_cast<float>(x) / tessellation;
+                    const float phi = u * 6.28318531f;
+
+                    const float nx = std::sin(theta) * std::cos(phi);
+                    const float ny = std::cos(theta);
+                    const float nz = std::sin(theta) * std::sin(phi);
+                    mesh.Vertices.push_back({ { nx * radius, ny * radius, nz * radius }, { nx, ny, nz }, { u, v } });
+                }
+            }
+
+            for (uint32_t y = 0; y < tessellation; y++)
+            {
+                for (uint32_t x = 0; x < tessellation; x++)
+                {
+                    const uint32_t i = y * rings + x;
+
+                    // The triangles touching a pole would be degenerate
+                    if (y != 0)
+                    {
+                        mesh.Indices.insert(mesh.Indices.end(), { i, i + 1, i + rings });
+                    }
+                    if (y != tessellation - 1)
+                    {
+                        mesh.Indices.insert(mesh.Indices.end(), { i + 1, i + rings + 1, i + rings });
+                    }
+                }
+            }
+
+            return mesh;
+        }
+
+        // A subdivided icosahedron, like ProceduralMesh::CreateGeoSphere
+        inline Mesh GeoSphere(uint32_t subdivisions, float radius = 1.f)
+        {
+            const float t = (1.f + std::sqrt(5.f)) / 2.f;
+
+            std::vector<std::array<float, 3>> points = {
+                { -1, t, 0 }, { 1, t, 0 }, { -1, -t, 0 }, { 1, -t, 0 },
+                { 0, -1, t }, { 0, 1, t }, { 0, -1, -t }, { 0, 1, -t },
+                { t, 0, -1 }, { t, 0, 1 }, { -t, 0, -1 }, { -t, 0, 1 },
+            };
+
+            std::vector<uint32_t> indices = {
+                0, 11, 5, 0, 5, 1, 0, 1, 7, 0, 7, 10, 0, 10, 11,
+                1, 5, 9, 5, 11, 4, 11, 10, 2, 10, 7, 6, 7, 1, 8,
+                3, 9, 4, 3, 4, 2, 3, 2, 6, 3, 6, 8, 3, 8, 9,
+                4, 9, 5, 2, 4, 11, 6, 2, 10, 8, 6, 7, 9, 8, 1,
+            };
+
+            auto normalise = [](std::array<float, 3> p)
+                {
+                    const float length = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+                    return std::array<float, 3>{ p[0] / length, p[1] / length, p[2] / length };
+                };
+
+            for (auto& point : points)
+            {
+                point = normalise(point);
+            }
+
+            for (uint32_t s = 0; s < subdivisions; s++)
+            {
+                // Edges shared by two triangles get one midpoint
+                std::map<std::pair<uint32_t, uint32_t>, uint32_t> midpoints;
+
+                auto midpoint = [&](uint32_t a, uint32_t b)
+                    {
+                        const auto key = std::make_pair(std::min(a, b), std::max(a, b));
+                        const auto found = midpoints.find(key);
+                        if (found != midpoints.end())
+                            return found->second;
+
+                        const auto& pa = points[a];
+                        const auto& pb = points[b];
+                        points.push_back(normalise({ pa[0] + pb[0], pa[1] + pb[1], pa[2] + pb[2] }));
+
+                        const auto index = static_cast<uint32_t>(points.size() - 1);
+                        midpoints.emplace(key, index);
+                        return index;
+                    };
+
+                std::vector<uint32_t> subdivided;
+                subdivided.reserve(indices.size() * 4);
+
+                for (std::size_t i = 0; i < indices.size(); i += 3)
+                {
+                    const uint32_t a = indices[i];
+                    const uint32_t b = indices[i + 1];
+                    const uint32_t c = indices[i + 2];
+                    const uint32_t ab = midpoint(a, b);
+                    const uint32_t bc = midpoint(b, c);
+                    const uint32_t ca = midpoint(c, a);
+
+                    subdivided.insert(subdivided.end(), { a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca });
+                }
+
+                indices = std::move(subdivided);
+            }
+
+            Mesh mesh;
+            mesh.Indices = std::move(indices);
+            mesh.Vertices.reserve(points.size());
+
+            for (const auto& p : points)
+            {
+                const float u = 0.5f + std::atan2(p[2], p[0]) / 6.28318531f;
+                const float v = std::acos(p[1]) / 3.14159265f;
+                mesh.Vertices.push_back({ { p[0] * radius, p[1] * radius, p[2] * radius }, p, { u, v } });
+            }
+
+            return mesh;
+        }
+
+        // A square of divisions x divisions quads around centre,
+        // facing along cross(u, v)
+        inline void AppendFace(Mesh& mesh,
+            const std::array<float, 3>& centre,
+            const std::array<float, 3>& u,
+            const std::array<float, 3>& v,
+            float halfSize,
+            uint32_t divisions)
+        {
+            const std::array<float, 3> normal = {
+                u[1] * v[2] - u[2] * v[1],
+                u[2] * v[0] - u[0] * v[2],
+                u[0] * v[1] - u[1] * v[0]
+            };
+
+            const auto base = static_cast<uint32_t>(mesh.Vertices.size());
+            const uint32_t row = divisions + 1;
+
+            for (uint32_t j = 0; j <= divisions; j++)
+            {
+                for (uint32_t i = 0; i <= divisions; i++)
+                {
+                    const float s = static_cast<float>(i) / divisions;
+                    const float t = static_cast<float>(j) / divisions;
+                    const float a = (2.f * s - 1.f) * halfSize;
+                    const float b = (2.f * t - 1.f) * halfSize;
+
+                    mesh.Vertices.push_back({
+                        {
+                            centre[0] + a * u[0] + b * v[0],
+                            centre[1] + a * u[1] + b * v[1],
+                            centre[2] + a * u[2] + b * v[2]
+                        },
+                        normal,
+                        { s, t } });
+                }
+            }
+
+            for (uint32_t j = 0; j < divisions; j++)
+            {
+                for (uint32_t i = 0; i < divisions; i++)
+                {
+                    const uint32_t a = base + j * row + i;
+                    mesh.Indices.insert(mesh.Indices.end(), { a, a + 1, a + row, a + 1, a + row + 1, a + row });
+                }
+            }
+        }
+
+        // A cube with each face split into quads, like
+        // ProceduralMesh::CreateBox with hard edges between faces
+        inline Mesh Box(uint32_t divisions, float size = 1.f)
+        {
+            Mesh mesh;
+            const float h = size / 2.f;
+
+            AppendFace(mesh, { h, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 }, h, divisions);
+            AppendFace(mesh, { -h, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 }, h, divisions);
+            AppendFace(mesh, { 0, h, 0 }, { 0, 0, 1 }, { 1, 0, 0 }, h, divisions);
+            AppendFace(mesh, { 0, -h, 0 }, { 1, 0, 0 }, { 0, 0, 1 }, h, divisions);
+            AppendFace(mesh, { 0, 0, h }, { 1, 0, 0 }, { 0, 1, 0 }, h, divisions);
+            AppendFace(mesh, { 0, 0, -h }, { 0, 1, 0 }, { 1, 0, 0 }, h, divisions);
+
+            return mesh;
+        }
+
+        // A flat square facing +y, like ProceduralMesh::CreateGrid
+        inline Mesh Grid(uint32_t divisions, float size = 10.f)
+        {
+            Mesh mesh;
+            AppendFace(mesh, { 0, 0, 0 }, { 0, 0, 1 }, { 1, 0, 0 }, size / 2.f, divisions);
+            return mesh;
+        }
+    }
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "CpuFrame.h"
+#include "Core/ScenePreset.h"
+#include "Core/VolShadowSplatter.h"
+
+namespace ISV
+{
+    // The optical thickness volume CpuFrame splats for a preset, at its
+    // starting particle positions, for the volumetric shadow benchmarks.
+    namespace BenchmarkVolumes
+    {
+        struct Volume
+        {
+            uint32_t Width = 0;
+            uint32_t Depth = 0;
+            // Cumulative optical thickness, x fastest, then y, then slice
+            std::vector<float> Texels;
+        };
+
+        inline std::vector<VolShadowSplatter::Particle> CreateSpheres(const ScenePreset& preset, uint32_t seed = 1)
+        {
+            const auto particles = Detail::CreateParticles(preset.ParticleCount, seed);
+
+            std::vector<VolShadowSplatter::Particle> spheres(particles.size());
+            for (std::size_t i = 0; i < particles.size(); i++)
+            {
+                spheres[i].Position = particles[i].Position;
+                spheres[i].Radius = preset.Scale * particles[i].Scale;
+                spheres[i].Extinction = std::max(1e-6f,
+                    particles[i].ExtinctionScale * preset.Extinction * CpuFrame::ExtinctionScale);
+            }
+
+            return spheres;
+        }
+
+        inline VolShadowSplatter::Light CreateLight(const ScenePreset& preset)
+        {
+            VolShadowSplatter::Light light;
+            light.SceneCentre = { 0.f, 0.f, 0.f };
+            light.Direction = preset.LightDirection;
+            light.SceneRadius = CpuFrame::VolShadowSceneRadius;
+            return light;
+        }
+
+        inline VolShadowSplatter::Settings CreateSettings(const ScenePreset& preset, uint32_t width, uint32_t depth)
+        {
+            VolShadowSplatter::Settings settings;
+            settings.Width = width;
+            settings.Depth = depth;
+            settings.FalloffRadius = preset.ExtinctionFalloff;
+            return settings;
+        }
+
+        // Same basis as VolShadowSplatter::MakeLightBasis
+        struct LightBasis
+        {
+            std::array<float, 3> Eye;
+            std::array<float, 3> Forward;
+            std::array<float, 3> Right;
+            std::array<float, 3> Up;
+        };
+
+        inline LightBasis MakeLightBasis(const VolShadowSplatter::Light& light)
+        {
+            const auto& d = light.Direction;
+            const float length = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+
+            LightBasis basis;
+            basis.Forward = { d[0] / length, d[1] / length, d[2] / length };
+            basis.Eye = {
+                light.SceneCentre[0] - light.SceneRadius * basis.Forward[0],
+                light.SceneCentre[1] - light.SceneRadius * basis.Forward[1],
+                light.SceneCentre[2] - light.SceneRadius * basis.Forward[2]
+            };
+
+            // cross(UnitY, -Forward), then cross(-Forward, Right)
+            const auto& f = basis.Forward;
+            const float rightLength = std::sqrt(f[0] * f[0] + f[2] * f[2]);
+            basis.Right = { -f[2] / rightLength, 0.f, f[0] / rightLength };
+            basis.Up = {
+                -f[1] * basis.Right[2],
+                f[0] * basis.Right[2] - f[2] * basis.Right[0],
+                f[1] * basis.Right[0]
+            };
+
+            return basis;
+        }
+
+        // A sphere in the volume's normalised coordinates: u and v across
+        // the light's view, w along the light direction. Extinction is per
+        // world unit, as in VolShadowSplatter::Particle.
+        struct LightSpaceSphere
+        {
+            std::array<float, 3> Centre;
+            float Radius;
+            float Extinction;
+        };
+
+        inline std::vector<LightSpaceSphere> ToLightSpace(const std::vector<VolShadowSplatter::Particle>& spheres,
+            const VolShadowSplatter::Light& light)
+        {
+            auto dot = [](const std::array<float, 3>& a, const std::array<float, 3>& b)
+                {
+                    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+                };
+
+            const LightBasis basis = MakeLightBasis(light);
+            const float R = light.SceneRadius;
+
+            std::vector<LightSpaceSphere> out(spheres.size());
+            for (std::size_t i = 0; i < spheres.size(); i++)
+            {
+                const std::array<float, 3> toSphere = {
+                    spheres[i].Position[0] - basis.Eye[0],
+                    spheres[i].Position[1] - basis.Eye[1],
+                    spheres[i].Position[2] - basis.Eye[2]
+                };
+
+                out[i].Centre = {
+                    0.5f * dot(toSphere, basis.Right) / R + 0.5f,
+                    0.5f - 0.5f * dot(toSphere, basis.Up) / R,
+                    dot(toSphere, basis.Forward) / (2 * R)
+                };
+                out[i].Radius = spheres[i].Radius / (2 * R);
+                out[i].Extinction = spheres[i].Extinction;
+            }
+
+            return out;
+        }
+
+        inline Volume Splat(const ScenePreset& preset, uint32_t width, uint32_t depth)
+        {
+            Volume volume;
+            volume.Width = width;
+            volume.Depth = depth;
+            volume.Texels = VolShadowSplatter::Splat(CreateSpheres(preset),
+                CreateLight(preset),
+                CreateSettings(preset, width, depth));
+            return volume;
+        }
+
+        // The default preset, or the one at path
+        inline ScenePreset LoadPreset(const std::string& path)
+        {
+            return path.empty() ? ScenePreset() : ScenePreset::Load(path);
+        }
+    }
+}
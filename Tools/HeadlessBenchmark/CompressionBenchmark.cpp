@@ -0,0 +1,142 @@
+// Times ISV::InstanceCompression encoding and decoding a preset's particles,
+// 1M by default, at several thread counts, and reports the worst error per
+// field the round trip leaves. Fails if the threaded encodings differ from
+// the single threaded one.
+//
+//  CompressionBenchmark [--particles <count>] [--threads <count>]... [--repeats <count>]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "CpuFrame.h"
+#include "Core/InstanceCompression.h"
+#include "Core/InstanceLayout.h"
+
+namespace
+{
+    using ISV::InstanceCompression;
+    using Clock = std::chrono::steady_clock;
+
+    double MsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        uint32_t particleCount = 1000000;
+        std::vector<uint32_t> threadCounts;
+        uint32_t repeats = 10;
+
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--particles" && i + 1 < argc)
+            {
+                particleCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--threads" && i + 1 < argc)
+            {
+                threadCounts.push_back(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+            }
+            else if (arg == "--repeats" && i + 1 < argc)
+            {
+                repeats = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else
+            {
+                throw std::runtime_error("Unknown or incomplete option " + arg);
+            }
+        }
+
+        if (threadCounts.empty())
+        {
+            threadCounts = { 1, ISV::GetDefaultThreadCount() };
+            threadCounts.erase(std::unique(threadCounts.begin(), threadCounts.end()), threadCounts.end());
+        }
+
+        if (particleCount == 0 || repeats == 0
+            || std::find(threadCounts.begin(), threadCounts.end(), 0u) != threadCounts.end())
+        {
+            throw std::runtime_error("Expected particles, at least 1 repeat and 1 thread");
+        }
+
+        std::vector<ISV::InstanceLayout::RenderInstance> instances;
+        std::vector<ISV::InstanceLayout::SimulationInstance> simulation;
+        ISV::InstanceLayout::Split(ISV::Detail::CreateParticles(particleCount, 1), instances, simulation);
+
+        const auto report = InstanceCompression::Measure(instances);
+
+        std::cout << particleCount << " instances, "
+            << std::fixed << std::setprecision(2)
+            << report.RawBytes / (1024.0 * 1024.0) << " MB raw, "
+            << report.CompressedBytes / (1024.0 * 1024.0) << " MB compressed\n"
+            << std::setprecision(6)
+            << "Max error: position " << report.MaxPositionError
+            << ", scale " << report.MaxScaleError
+            << ", rotation " << report.MaxRotationError << " rad"
+            << ", extinction " << report.MaxExtinctionError << "\n"
+            << std::setw(9) << "threads"
+            << std::setw(12) << "encode ms" << std::setw(12) << "Minst/s"
+            << std::setw(12) << "decode ms" << std::setw(12) << "Minst/s" << "\n";
+
+        std::vector<InstanceCompression::CompressedInstance> reference;
+        std::vector<InstanceCompression::Cluster> referenceClusters;
+        InstanceCompression::EncodeAll(instances, reference, referenceClusters);
+
+        std::vector<InstanceCompression::CompressedInstance> compressed;
+        std::vector<InstanceCompression::Cluster> clusters;
+        std::vector<ISV::InstanceLayout::RenderInstance> decoded;
+
+        for (const uint32_t threads : threadCounts)
+        {
+            // Once to size the outputs, then timed
+            InstanceCompression::EncodeAll(instances, compressed, clusters, threads);
+            InstanceCompression::DecodeAll(compressed, clusters, decoded, threads);
+
+            if (compressed != reference)
+            {
+                throw std::runtime_error("The threaded encoding differs from the single threaded one");
+            }
+
+            auto start = Clock::now();
+            for (uint32_t r = 0; r < repeats; r++)
+            {
+                InstanceCompression::EncodeAll(instances, compressed, clusters, threads);
+            }
+            const double encodeMs = MsSince(start) / repeats;
+
+            start = Clock::now();
+            for (uint32_t r = 0; r < repeats; r++)
+            {
+                InstanceCompression::DecodeAll(compressed, clusters, decoded, threads);
+            }
+            const double decodeMs = MsSince(start) / repeats;
+
+            std::cout << std::setw(9) << threads
+                << std::setprecision(2)
+                << std::setw(12) << encodeMs
+                << std::setw(12) << particleCount / encodeMs / 1e3
+                << std::setw(12) << decodeMs
+                << std::setw(12) << particleCount / decodeMs / 1e3 << "\n";
+        }
+
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
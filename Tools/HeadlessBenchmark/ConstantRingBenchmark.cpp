@@ -0,0 +1,264 @@
+// Measures Gradient::LinearRingAllocator, which backs
+// GraphicsMemoryManager::AllocateConstant, against a model of the path it
+// replaced: a locked page allocator handing out reference counted
+// GraphicsResources that are kept in a vector until the frame is
+// committed. Counts heap allocations per frame once warmed up, and fails
+// if the ring makes any.
+//
+//  ConstantRingBenchmark [--frames <count>] [--constants <per frame>]
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Gradient/LinearRingAllocator.h"
+
+namespace
+{
+    std::atomic<uint64_t> g_heapAllocations = 0;
+}
+
+void* operator new(std::size_t size)
+{
+    g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace
+{
+    constexpr uint64_t Alignment = 256;
+    constexpr uint32_t FramesInFlight = 3;
+
+    // Sizes of the constant structs the passes upload, roughly
+    constexpr uint64_t ConstantSizes[] = { 64, 80, 144, 208, 256, 320 };
+
+    struct Constants
+    {
+        uint8_t Bytes[320];
+    };
+
+    class RingPath
+    {
+    public:
+        explicit RingPath(uint64_t capacity)
+            : m_ring(capacity, FramesInFlight),
+            m_memory(capacity)
+        {
+        }
+
+        uint64_t Allocate(const Constants& data, uint64_t size)
+        {
+            const uint64_t offset = m_ring.Allocate(size, Alignment);
+            if (offset == Gradient::LinearRingAllocator::InvalidOffset)
+            {
+                throw std::runtime_error("Constant ring is full");
+            }
+
+            std::memcpy(m_memory.data() + offset, &data, size);
+            return offset;
+        }
+
+        void Commit(uint64_t frame)
+        {
+            // The GPU is FramesInFlight - 1 frames behind
+            if (frame >= FramesInFlight)
+            {
+                m_ring.ReleaseCompletedFrames(frame - FramesInFlight + 1);
+            }
+
+            m_ring.EndFrame(frame + 1);
+        }
+
+    private:
+        Gradient::LinearRingAllocator m_ring;
+        std::vector<uint8_t> m_memory;
+    };
+
+    // GraphicsMemory::AllocateConstant takes a lock, bumps within a page
+    // and returns a GraphicsResource that holds a reference on the page.
+    // The manager kept every one in a vector that Commit cleared.
+    class GraphicsResourcePath
+    {
+    public:
+        struct Page
+        {
+            std::vector<uint8_t> Memory;
+            uint64_t Offset = 0;
+        };
+
+        static constexpr uint64_t PageSize = 64 * 1024;
+
+        uint64_t Allocate(const Constants& data, uint64_t size)
+        {
+            std::lock_guard lock(m_mutex);
+
+            const uint64_t aligned = (size + Alignment - 1) & ~(Alignment - 1);
+            if (!m_page || m_page->Offset + aligned > PageSize)
+            {
+                m_page = std::make_shared<Page>();
+                m_page->Memory.resize(PageSize);
+            }
+
+            const uint64_t offset = m_page->Offset;
+            m_page->Offset += aligned;
+            std::memcpy(m_page->Memory.data() + offset, &data, size);
+
+            m_frameResources.push_back(m_page);
+            return offset;
+        }
+
+        void Commit(uint64_t)
+        {
+            // Pages go back once the GPU is done with them; here they are
+            // simply released
+            m_frameResources.clear();
+            m_page.reset();
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::shared_ptr<Page> m_page;
+        std::vector<std::shared_ptr<Page>> m_frameResources;
+    };
+
+    struct Result
+    {
+        double AllocationsPerSecond;
+        double HeapAllocationsPerFrame;
+    };
+
+    template <typename Path>
+    Result Run(Path& path, uint32_t frames, uint32_t constantsPerFrame)
+    {
+        Constants data = {};
+        uint64_t sum = 0;
+
+        auto frame = [&](uint64_t f)
+            {
+                for (uint32_t i = 0; i < constantsPerFrame; i++)
+                {
+                    const uint64_t size = ConstantSizes[(f + i) % std::size(ConstantSizes)];
+                    data.Bytes[0] = static_cast<uint8_t>(i);
+                    sum += path.Allocate(data, size);
+                }
+                path.Commit(f);
+            };
+
+        // Warm up, so vectors have grown and the ring has wrapped
+        const uint32_t warmup = 64;
+        for (uint64_t f = 0; f < warmup; f++)
+        {
+            frame(f);
+        }
+
+        const uint64_t heapBefore = g_heapAllocations.load(std::memory_order_relaxed);
+        const auto start = std::chrono::steady_clock::now();
+
+        for (uint64_t f = warmup; f < warmup + frames; f++)
+        {
+            frame(f);
+        }
+
+        const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const uint64_t heapAllocations = g_heapAllocations.load(std::memory_order_relaxed) - heapBefore;
+
+        if (sum == 1)
+        {
+            std::cout << "";
+        }
+
+        return {
+            static_cast<double>(frames) * constantsPerFrame / seconds,
+            static_cast<double>(heapAllocations) / frames
+        };
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        uint32_t frames = 20000;
+        uint32_t constantsPerFrame = 200;
+
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--frames" && i + 1 < argc)
+            {
+                frames = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--constants" && i + 1 < argc)
+            {
+                constantsPerFrame = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else
+            {
+                throw std::runtime_error("Unknown or incomplete option " + arg);
+            }
+        }
+
+        if (frames == 0 || constantsPerFrame == 0)
+        {
+            throw std::runtime_error("Expected at least 1 frame and 1 constant");
+        }
+
+        // Room for every frame in flight, as GraphicsMemoryManager sizes it
+        RingPath ring(4 * 1024 * 1024);
+        GraphicsResourcePath resources;
+
+        const Result ringResult = Run(ring, frames, constantsPerFrame);
+        const Result resourceResult = Run(resources, frames, constantsPerFrame);
+
+        std::cout << constantsPerFrame << " constants per frame, " << frames << " frames\n"
+            << std::setw(22) << "" << std::setw(16) << "allocs/s" << std::setw(20) << "heap allocs/frame" << "\n"
+            << std::fixed;
+
+        auto print = [](const char* name, const Result& result)
+            {
+                std::cout << std::setw(22) << name
+                    << std::setw(16) << std::setprecision(0) << result.AllocationsPerSecond
+                    << std::setw(20) << std::setprecision(2) << result.HeapAllocationsPerFrame << "\n";
+            };
+
+        print("ring", ringResult);
+        print("graphics resources", resourceResult);
+
+        if (ringResult.HeapAllocationsPerFrame != 0.0)
+        {
+            std::cerr << "The constant ring allocated from the heap" << std::endl;
+            return 1;
+        }
+
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
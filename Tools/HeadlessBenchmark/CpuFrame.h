@@ -0,0 +1,739 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Core/ParallelFor.h"
+#include "Core/ParticleSimulation.h"
+#include "Core/PresetBenchmark.h"
+#include "Core/Profiler.h"
+#include "Core/ScenePreset.h"
+#include "Core/VolShadowSplatter.h"
+
+namespace ISV
+{
+    // Runs the passes of Game::Render on the CPU so that the benchmark
+    // harness can be exercised without a GPU. The simulation and the
+    // volumetric shadow splat reuse the CPU mirrors in Core. The prop shadow
+    // map, the sort and the particle render are stand-ins of similar shape:
+    // they scale with the same parameters as the GPU passes (particle count,
+    // step count, coverage) but are not pixel accurate. The render traces
+    // the geometry of the preset's rendering method, tetrahedra or sphere
+    // proxies, but not the integration of each method's pixel shader, so
+    // methods that share a geometry cost the same.
+    class CpuFrame
+    {
+    public:
+        using Vector3 = std::array<float, 3>;
+        using PassTimes = PresetBenchmark::PassTimes;
+
+        // What a rendering method draws for each particle
+        enum class Geometry : uint32_t
+        {
+            Tetrahedra,
+            SphereProxies
+        };
+
+        struct Settings
+        {
+            uint32_t Width = 320;
+            uint32_t Height = 180;
+            uint32_t VolumeWidth = 256;
+            uint32_t VolumeDepth = 10;
+            uint32_t ShadowMapWidth = 512;
+            uint32_t ThreadCount = 1;
+            uint32_t Seed = 1;
+        };
+
+        // Same as the GPU side
+        static constexpr float ExtinctionScale = 1.f / 10000.f;
+        static constexpr float VolShadowSceneRadius = 30.f;
+        static constexpr float ShadowSceneRadius = 50.f;
+        static constexpr float FieldOfView = 3.14159265f / 3.f;
+        static constexpr float NearPlane = 0.1f;
+        static constexpr uint32_t TileSize = 16;
+
+        CpuFrame(const ScenePreset& preset, const Settings& settings);
+
+        // Renders one frame and returns how long each pass took, in ms
+        PassTimes Render(const ScenePreset::CameraPose& camera, double elapsedSeconds);
+
+        // RGB, row major
+        const std::vector<float>& GetImage() const;
+
+        // Same split as Game::Render
+        static Geometry GetGeometry(uint32_t renderingMethod);
+
+    private:
+        void Simulate(double elapsedSeconds);
+        void RenderVolumetricShadows();
+        void RenderShadowMap();
+        void SortParticles(const ScenePreset::CameraPose& camera);
+        void RenderParticles(const ScenePreset::CameraPose& camera);
+
+        float SampleShadowTransmittance(const Vector3& position) const;
+
+        static float Dot(const Vector3& a, const Vector3& b);
+        static Vector3 Cross(const Vector3& a, const Vector3& b);
+        static Vector3 Normalize(const Vector3& v);
+        static Vector3 Sub(const Vector3& a, const Vector3& b);
+        static Vector3 MultiplyAdd(const Vector3& a, float s, const Vector3& b);
+        static Vector3 Rotate(const ParticleSimulation::Vector4& quat, const Vector3& v);
+
+        static bool RayBoxIntersect(const Vector3& rayOrigin,
+            const Vector3& rayDir,
+            const Vector3& boxMin,
+            const Vector3& boxMax,
+            float& tNear);
+
+        // normals are the outward face normals of a regular tetrahedron with
+        // its vertices on the sphere of the given radius
+        static bool RayTetrahedronIntersect(const Vector3& rayOrigin,
+            const Vector3& rayDir,
+            const Vector3& centre,
+            float radius,
+            const std::array<Vector3, 4>& normals,
+            float& tNear,
+            float& tFar);
+
+        ScenePreset m_preset;
+        Settings m_settings;
+
+        ParticleSimulation m_simulation;
+
+        Vector3 m_lightDirection;
+        Vector3 m_lightEye;
+        Vector3 m_lightRight;
+        Vector3 m_lightUp;
+
+        std::vector<VolShadowSplatter::Particle> m_spheres;
+        std::vector<float> m_volShadows;
+        std::vector<float> m_shadowMap;
+        std::vector<float> m_keys;
+        std::vector<uint32_t> m_sortedIndices;
+        std::vector<std::array<Vector3, 4>> m_tetNormals;
+        std::vector<std::vector<uint32_t>> m_tiles;
+        std::vector<float> m_image;
+    };
+
+    namespace Detail
+    {
+        inline std::vector<ParticleSimulation::Particle> CreateParticles(uint32_t count, uint32_t seed)
+        {
+            // Same distribution as Game::CreateTetrahedronInstances
+            std::mt19937 generator(seed);
+            std::uniform_real_distribution<float> random(0.f, 1.f);
+
+            auto coordinate = [&]()
+                {
+                    const float sign = random(generator) < 0.5f ? 1.f : -1.f;
+                    return sign * (random(generator) * 5.f + 5.f);
+                };
+
+            std::vector<ParticleSimulation::Particle> particles(count);
+            for (auto& particle : particles)
+            {
+                const ParticleSimulation::Vector3 position = { coordinate(), coordinate(), coordinate() };
+                const float densityMultiplier = std::abs(random(generator) * 10.f - 5.f);
+
+                ParticleSimulation::Vector3 axis = {
+                    random(generator) * 2.f - 1.f,
+                    random(generator) * 2.f - 1.f,
+                    random(generator) * 2.f - 1.f
+                };
+                const float length = std::max(1e-6f,
+                    std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]));
+                for (auto& component : axis)
+                {
+                    component /= length;
+                }
+
+                const float halfAngle = random(generator) * 3.14159265f;
+
+                particle.Position = {
+                    position[0] + 2.f * axis[0],
+                    position[1] + 2.f * axis[1],
+                    position[2] + 2.f * axis[2]
+                };
+                particle.ExtinctionScale = densityMultiplier;
+                particle.Velocity = { 0.f, 0.f, 0.f };
+                particle.Mass = densityMultiplier * 0.5f;
+                particle.TargetPosition = position;
+                particle.Scale = 1.f;
+                particle.RotationQuat = {
+                    axis[0] * std::sin(halfAngle),
+                    axis[1] * std::sin(halfAngle),
+                    axis[2] * std::sin(halfAngle),
+                    std::cos(halfAngle)
+                };
+            }
+
+            return particles;
+        }
+
+        inline ParticleSimulation::Settings GetSimulationSettings(const ScenePreset& preset)
+        {
+            ParticleSimulation::Settings settings;
+            settings.FixedStep = 1.0 / std::max(1u, preset.SimulationRate);
+            settings.Substeps = std::max(1u, preset.Substeps);
+            settings.SleepVelocityThreshold = preset.SleepVelocityThreshold;
+            settings.SleepAccelerationThreshold = preset.SleepAccelerationThreshold;
+            settings.WakeRadius = preset.WakeRadius;
+            settings.SleepSteps = preset.ParticleSleeping ? preset.SleepSteps : 0;
+            return settings;
+        }
+    }
+
+    inline CpuFrame::CpuFrame(const ScenePreset& preset, const Settings& settings)
+        : m_preset(preset),
+        m_settings(settings),
+        m_simulation(Detail::CreateParticles(preset.ParticleCount, settings.Seed),
+            Detail::GetSimulationSettings(preset))
+    {
+        // Same construction as VolShadowSplatter, so shadow lookups line up
+        // with the splatted volume
+        m_lightDirection = Normalize(preset.LightDirection);
+        m_lightEye = {
+            -VolShadowSceneRadius * m_lightDirection[0],
+            -VolShadowSceneRadius * m_lightDirection[1],
+            -VolShadowSceneRadius * m_lightDirection[2]
+        };
+        const Vector3 zAxis = { -m_lightDirection[0], -m_lightDirection[1], -m_lightDirection[2] };
+        m_lightRight = Normalize(Cross({ 0.f, 1.f, 0.f }, zAxis));
+        m_lightUp = Cross(zAxis, m_lightRight);
+
+        const uint32_t tilesX = (settings.Width + TileSize - 1) / TileSize;
+        const uint32_t tilesY = (settings.Height + TileSize - 1) / TileSize;
+        m_tiles.resize(static_cast<std::size_t>(tilesX) * tilesY);
+        m_image.resize(static_cast<std::size_t>(settings.Width) * settings.Height * 3);
+    }
+
+    inline CpuFrame::PassTimes CpuFrame::Render(const ScenePreset::CameraPose& camera, double elapsedSeconds)
+    {
+        ISV_PROFILE_ZONE("CpuFrame::Render");
+
+        using Clock = std::chrono::steady_clock;
+
+        PassTimes passMs = {};
+        auto time = [&passMs](PresetBenchmark::Pass pass, auto&& fn)
+            {
+                const auto start = Clock::now();
+                fn();
+                passMs[static_cast<uint32_t>(pass)]
+                    = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            };
+
+        if (m_preset.SimulationEnabled)
+        {
+            time(PresetBenchmark::Pass::Simulation, [&]() { Simulate(elapsedSeconds); });
+        }
+
+        time(PresetBenchmark::Pass::VolumetricShadows, [&]() { RenderVolumetricShadows(); });
+        time(PresetBenchmark::Pass::ShadowMap, [&]() { RenderShadowMap(); });
+        time(PresetBenchmark::Pass::Sort, [&]() { SortParticles(camera); });
+        time(PresetBenchmark::Pass::Render, [&]() { RenderParticles(camera); });
+
+        return passMs;
+    }
+
+    inline const std::vector<float>& CpuFrame::GetImage() const
+    {
+        return m_image;
+    }
+
+    inline CpuFrame::Geometry CpuFrame::GetGeometry(uint32_t renderingMethod)
+    {
+        const std::string_view name = ScenePreset::RenderingMethodNames.at(renderingMethod);
+        return name == "SphericalProxy" || name == "WastedPixelsSphere"
+            ? Geometry::SphereProxies
+            : Geometry::Tetrahedra;
+    }
+
+    inline void CpuFrame::Simulate(double elapsedSeconds)
+    {
+        ISV_PROFILE_ZONE("Simulate");
+
+        ParticleSimulation::StepInput input;
+        input.TargetWorld = ParticleSimulation::Translation(m_preset.TargetPosition[0],
+            m_preset.TargetPosition[1],
+            m_preset.TargetPosition[2]);
+
+        m_simulation.Advance(elapsedSeconds, input);
+    }
+
+    inline void CpuFrame::RenderVolumetricShadows()
+    {
+        ISV_PROFILE_ZONE("RenderVolumetricShadows");
+
+        const auto& particles = m_simulation.GetParticles();
+
+        m_spheres.resize(particles.size());
+        for (std::size_t i = 0; i < particles.size(); i++)
+        {
+            m_spheres[i].Position = particles[i].Position;
+            m_spheres[i].Radius = m_preset.Scale * particles[i].Scale;
+            m_spheres[i].Extinction = std::max(1e-6f,
+                particles[i].ExtinctionScale * m_preset.Extinction * ExtinctionScale);
+        }
+
+        VolShadowSplatter::Light light;
+        light.SceneCentre = { 0.f, 0.f, 0.f };
+        light.Direction = m_lightDirection;
+        light.SceneRadius = VolShadowSceneRadius;
+
+        VolShadowSplatter::Settings settings;
+        settings.Width = m_settings.VolumeWidth;
+        settings.Depth = m_settings.VolumeDepth;
+        settings.FalloffRadius = m_preset.ExtinctionFalloff;
+
+        // Each thread splats a contiguous range of particles into its own
+        // volume, then the volumes are summed in thread order
+        const uint32_t threadCount = std::max(1u, m_settings.ThreadCount);
+        std::vector<std::vector<float>> partialVolumes(threadCount);
+
+        ParallelFor(static_cast<uint32_t>(m_spheres.size()), threadCount,
+            [&](uint32_t begin, uint32_t end, uint32_t thread)
+            {
+                ISV_PROFILE_ZONE("SplatRange");
+
+                const std::vector<VolShadowSplatter::Particle> range(m_spheres.begin() + begin,
+                    m_spheres.begin() + end);
+                partialVolumes[thread] = VolShadowSplatter::Splat(range, light, settings);
+            });
+
+        ISV_PROFILE_ZONE("SumVolumes");
+        m_volShadows.assign(static_cast<std::size_t>(settings.Width) * settings.Width * settings.Depth, 0.f);
+        for (const auto& partial : partialVolumes)
+        {
+            for (std::size_t i = 0; i < partial.size(); i++)
+            {
+                m_volShadows[i] += partial[i];
+            }
+        }
+    }
+
+    inline void CpuFrame::RenderShadowMap()
+    {
+        ISV_PROFILE_ZONE("RenderShadowMap");
+
+        // Depth from the light to the floor, box and sphere props, traced
+        // per texel. The animated box is traced at rest.
+        const uint32_t width = m_settings.ShadowMapWidth;
+        const float R = ShadowSceneRadius;
+
+        const Vector3 eye = {
+            -2.f * R * m_lightDirection[0],
+            -2.f * R * m_lightDirection[1],
+            -2.f * R * m_lightDirection[2]
+        };
+
+        const Vector3 floorMin = { -25.f, -10.25f, -25.f };
+        const Vector3 floorMax = { 25.f, -9.75f, 25.f };
+        const Vector3 boxMin = MultiplyAdd(m_preset.BoxPosition, -1.5f, { 1.f, 1.f, 1.f });
+        const Vector3 boxMax = MultiplyAdd(m_preset.BoxPosition, 1.5f, { 1.f, 1.f, 1.f });
+
+        m_shadowMap.resize(static_cast<std::size_t>(width) * width);
+
+        ParallelFor(width, m_settings.ThreadCount, [&](uint32_t begin, uint32_t end, uint32_t)
+            {
+                ISV_PROFILE_ZONE("ShadowMapRows");
+
+                for (uint32_t y = begin; y < end; y++)
+                {
+                    for (uint32_t x = 0; x < width; x++)
+                    {
+                        const float ndcX = (x + 0.5f) / width * 2.f - 1.f;
+                        const float ndcY = 1.f - (y + 0.5f) / width * 2.f;
+
+                        Vector3 origin = MultiplyAdd(eye, R * ndcX, m_lightRight);
+                        origin = MultiplyAdd(origin, R * ndcY, m_lightUp);
+
+                        float depth = 1e30f;
+                        float t;
+
+                        if (RayBoxIntersect(origin, m_lightDirection, floorMin, floorMax, t))
+                            depth = std::min(depth, t);
+                        if (RayBoxIntersect(origin, m_lightDirection, boxMin, boxMax, t))
+                            depth = std::min(depth, t);
+
+                        float tFar;
+                        if (VolShadowSplatter::RaySphereIntersect(origin, m_lightDirection,
+                            m_preset.SpherePosition, 1.f, t, tFar))
+                        {
+                            depth = std::min(depth, t);
+                        }
+
+                        m_shadowMap[static_cast<std::size_t>(y) * width + x] = depth;
+                    }
+                }
+            });
+    }
+
+    inline void CpuFrame::SortParticles(const ScenePreset::CameraPose& camera)
+    {
+        ISV_PROFILE_ZONE("SortParticles");
+
+        const auto& particles = m_simulation.GetParticles();
+        const uint32_t count = static_cast<uint32_t>(particles.size());
+
+        // Same key as WriteSortingKeys_CS, sorted ascending like the
+        // FidelityFX sort, which draws the furthest particles first
+        m_keys.resize(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const Vector3 toParticle = Sub(particles[i].Position, camera.Position);
+            m_keys[i] = 10000.f - Dot(toParticle, toParticle);
+        }
+
+        m_sortedIndices.resize(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            m_sortedIndices[i] = i;
+        }
+
+        std::stable_sort(m_sortedIndices.begin(), m_sortedIndices.end(),
+            [this](uint32_t a, uint32_t b) { return m_keys[a] < m_keys[b]; });
+    }
+
+    inline void CpuFrame::RenderParticles(const ScenePreset::CameraPose& camera)
+    {
+        ISV_PROFILE_ZONE("RenderParticles");
+
+        const uint32_t width = m_settings.Width;
+        const uint32_t height = m_settings.Height;
+        const uint32_t tilesX = (width + TileSize - 1) / TileSize;
+        const uint32_t tilesY = (height + TileSize - 1) / TileSize;
+
+        const float aspect = static_cast<float>(width) / height;
+        const float tanHalfFov = std::tan(FieldOfView / 2.f);
+
+        const Vector3 forward = camera.Direction;
+        const Vector3 right = Normalize(Cross(forward, { 0.f, 1.f, 0.f }));
+        const Vector3 up = Cross(right, forward);
+
+        const bool tetrahedra = GetGeometry(m_preset.RenderingMethod) == Geometry::Tetrahedra;
+        const auto& particles = m_simulation.GetParticles();
+
+        if (tetrahedra)
+        {
+            // Each face of a regular tetrahedron faces away from the vertex
+            // opposite it. Vertices as in Tetrahedron_MS.
+            static const std::array<Vector3, 4> vertices = { {
+                { std::sqrt(8.f / 9.f), 0.f, -1.f / 3.f },
+                { -std::sqrt(2.f / 9.f), std::sqrt(2.f / 3.f), -1.f / 3.f },
+                { -std::sqrt(2.f / 9.f), -std::sqrt(2.f / 3.f), -1.f / 3.f },
+                { 0.f, 0.f, 1.f }
+            } };
+
+            m_tetNormals.resize(particles.size());
+            for (std::size_t i = 0; i < particles.size(); i++)
+            {
+                for (uint32_t face = 0; face < 4; face++)
+                {
+                    const Vector3 vertex = Rotate(particles[i].RotationQuat, vertices[face]);
+                    m_tetNormals[i][face] = { -vertex[0], -vertex[1], -vertex[2] };
+                }
+            }
+        }
+
+        // Bin the particles into screen tiles, keeping the back to front order
+        for (auto& tile : m_tiles)
+        {
+            tile.clear();
+        }
+
+        for (uint32_t index : m_sortedIndices)
+        {
+            const auto& sphere = m_spheres[index];
+            const Vector3 toParticle = Sub(sphere.Position, camera.Position);
+            const float z = Dot(toParticle, forward);
+
+            if (z + sphere.Radius < NearPlane)
+                continue;
+
+            // Tetrahedron_MS drops particles whose bounding sphere crosses
+            // the near plane
+            if (tetrahedra && z - sphere.Radius < NearPlane)
+                continue;
+
+            uint32_t x0 = 0, x1 = tilesX - 1, y0 = 0, y1 = tilesY - 1;
+
+            if (z - sphere.Radius > NearPlane)
+            {
+                // Conservative screen bounds of the sphere
+                const float ndcX = Dot(toParticle, right) / (z * tanHalfFov * aspect);
+                const float ndcY = Dot(toParticle, up) / (z * tanHalfFov);
+                const float ndcRadiusY = sphere.Radius / ((z - sphere.Radius) * tanHalfFov);
+                const float ndcRadiusX = ndcRadiusY / aspect;
+
+                if (ndcX + ndcRadiusX < -1.f || ndcX - ndcRadiusX > 1.f
+                    || ndcY + ndcRadiusY < -1.f || ndcY - ndcRadiusY > 1.f)
+                {
+                    continue;
+                }
+
+                auto toTile = [](float ndc, uint32_t pixels, uint32_t tiles, bool flip)
+                    {
+                        const float uv = flip ? 0.5f - 0.5f * ndc : 0.5f * ndc + 0.5f;
+                        const int tile = static_cast<int>(std::floor(uv * pixels / TileSize));
+                        return static_cast<uint32_t>(std::clamp(tile, 0, static_cast<int>(tiles) - 1));
+                    };
+
+                x0 = toTile(ndcX - ndcRadiusX, width, tilesX, false);
+                x1 = toTile(ndcX + ndcRadiusX, width, tilesX, false);
+                y0 = toTile(ndcY + ndcRadiusY, height, tilesY, true);
+                y1 = toTile(ndcY - ndcRadiusY, height, tilesY, true);
+            }
+
+            for (uint32_t ty = y0; ty <= y1; ty++)
+            {
+                for (uint32_t tx = x0; tx <= x1; tx++)
+                {
+                    m_tiles[static_cast<std::size_t>(ty) * tilesX + tx].push_back(index);
+                }
+            }
+        }
+
+        const uint32_t stepCount = std::max(1u, m_preset.StepCount);
+        const float brightness = m_preset.LightBrightness;
+
+        ParallelFor(height, m_settings.ThreadCount, [&](uint32_t begin, uint32_t end, uint32_t)
+            {
+                ISV_PROFILE_ZONE("RenderRows");
+
+                for (uint32_t y = begin; y < end; y++)
+                {
+                    for (uint32_t x = 0; x < width; x++)
+                    {
+                        const float ndcX = (x + 0.5f) / width * 2.f - 1.f;
+                        const float ndcY = 1.f - (y + 0.5f) / height * 2.f;
+
+                        Vector3 rayDir = MultiplyAdd(forward, ndcX * tanHalfFov * aspect, right);
+                        rayDir = Normalize(MultiplyAdd(rayDir, ndcY * tanHalfFov, up));
+
+                        Vector3 colour = { 0.f, 0.f, 0.f };
+
+                        const auto& tile = m_tiles[static_cast<std::size_t>(y / TileSize) * tilesX + x / TileSize];
+                        for (uint32_t index : tile)
+                        {
+                            const auto& sphere = m_spheres[index];
+
+                            float tNear, tFar;
+                            const bool hit = tetrahedra
+                                ? RayTetrahedronIntersect(camera.Position, rayDir,
+                                    sphere.Position, sphere.Radius, m_tetNormals[index], tNear, tFar)
+                                : VolShadowSplatter::RaySphereIntersect(camera.Position, rayDir,
+                                    sphere.Position, sphere.Radius, tNear, tFar);
+
+                            if (!hit || tFar < NearPlane)
+                            {
+                                continue;
+                            }
+
+                            tNear = std::max(tNear, NearPlane);
+
+                            float opticalThickness;
+                            if (tetrahedra)
+                            {
+                                // Constant extinction over the interval, as
+                                // VanillaTransmittance in Interval_PS
+                                opticalThickness = sphere.Extinction * (tFar - tNear);
+                            }
+                            else
+                            {
+                                const Vector3 entry = MultiplyAdd(camera.Position, tNear, rayDir);
+                                const Vector3 toCentre = Sub(sphere.Position, entry);
+                                const float d = std::sqrt(Dot(toCentre, toCentre));
+                                const float cosAlpha = d > 0.00001f
+                                    ? std::clamp(Dot(rayDir, toCentre) / d, -1.f, 1.f)
+                                    : 1.f;
+
+                                opticalThickness = VolShadowSplatter::FadedOpticalThickness(0.f,
+                                    tFar - tNear,
+                                    d,
+                                    cosAlpha,
+                                    sphere.Extinction,
+                                    m_preset.ExtinctionFalloff * sphere.Radius);
+                            }
+                            const float transmittance = std::exp(-opticalThickness);
+
+                            // StepCount shadow lookups along the interval, like
+                            // the integration steps in Interval_PS
+                            float shadow = 0.f;
+                            for (uint32_t step = 0; step < stepCount; step++)
+                            {
+                                const float t = tNear + (tFar - tNear) * (step + 0.5f) / stepCount;
+                                shadow += SampleShadowTransmittance(MultiplyAdd(camera.Position, t, rayDir));
+                            }
+                            shadow /= stepCount;
+
+                            const float scattered = (1.f - transmittance) * shadow * brightness
+                                * particles[index].ExtinctionScale / 5.f;
+
+                            for (int c = 0; c < 3; c++)
+                            {
+                                colour[c] = colour[c] * transmittance
+                                    + scattered * m_preset.Albedo[c] * m_preset.LightColor[c];
+                            }
+                        }
+
+                        const std::size_t pixel = (static_cast<std::size_t>(y) * width + x) * 3;
+                        m_image[pixel + 0] = colour[0];
+                        m_image[pixel + 1] = colour[1];
+                        m_image[pixel + 2] = colour[2];
+                    }
+                }
+            });
+    }
+
+    inline float CpuFrame::SampleShadowTransmittance(const Vector3& position) const
+    {
+        const uint32_t width = m_settings.VolumeWidth;
+        const uint32_t depth = m_settings.VolumeDepth;
+        const float R = VolShadowSceneRadius;
+
+        if (m_volShadows.empty() || depth < 2)
+            return 1.f;
+
+        const Vector3 fromEye = Sub(position, m_lightEye);
+        const float u = 0.5f * Dot(fromEye, m_lightRight) / R + 0.5f;
+        const float v = 0.5f - 0.5f * Dot(fromEye, m_lightUp) / R;
+        const float slice = Dot(fromEye, m_lightDirection) / (2.f * R) * (depth - 1);
+
+        if (u < 0.f || u >= 1.f || v < 0.f || v >= 1.f || slice <= 0.f)
+            return 1.f;
+
+        const uint32_t x = static_cast<uint32_t>(u * width);
+        const uint32_t y = static_cast<uint32_t>(v * width);
+        const float clampedSlice = std::min(slice, depth - 1.f);
+        const uint32_t slice0 = std::min(static_cast<uint32_t>(clampedSlice), depth - 2);
+        const float blend = clampedSlice - slice0;
+
+        const std::size_t slicePitch = static_cast<std::size_t>(width) * width;
+        const std::size_t texel = static_cast<std::size_t>(y) * width + x;
+
+        const float opticalThickness = m_volShadows[slice0 * slicePitch + texel] * (1.f - blend)
+            + m_volShadows[(slice0 + 1) * slicePitch + texel] * blend;
+
+        return std::exp(-opticalThickness);
+    }
+
+    inline float CpuFrame::Dot(const Vector3& a, const Vector3& b)
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    inline CpuFrame::Vector3 CpuFrame::Cross(const Vector3& a, const Vector3& b)
+    {
+        return {
+            a[1] * b[2] - a[2] * b[1],
+            a[2] * b[0] - a[0] * b[2],
+            a[0] * b[1] - a[1] * b[0]
+        };
+    }
+
+    inline CpuFrame::Vector3 CpuFrame::Normalize(const Vector3& v)
+    {
+        const float length = std::sqrt(Dot(v, v));
+        if (length <= 0.f)
+        {
+            return v;
+        }
+
+        return { v[0] / length, v[1] / length, v[2] / length };
+    }
+
+    inline CpuFrame::Vector3 CpuFrame::Sub(const Vector3& a, const Vector3& b)
+    {
+        return { a[0] - b[0], a[1] - b[1], a[2] - b[2] };
+    }
+
+    inline CpuFrame::Vector3 CpuFrame::MultiplyAdd(const Vector3& a, float s, const Vector3& b)
+    {
+        return { a[0] + s * b[0], a[1] + s * b[1], a[2] + s * b[2] };
+    }
+
+    inline CpuFrame::Vector3 CpuFrame::Rotate(const ParticleSimulation::Vector4& quat, const Vector3& v)
+    {
+        // v + 2w(q x v) + 2q x (q x v)
+        const Vector3 q = { quat[0], quat[1], quat[2] };
+        const Vector3 t = MultiplyAdd(Cross(q, v), quat[3], v);
+        return MultiplyAdd(v, 2.f, Cross(q, t));
+    }
+
+    inline bool CpuFrame::RayBoxIntersect(const Vector3& rayOrigin,
+        const Vector3& rayDir,
+        const Vector3& boxMin,
+        const Vector3& boxMax,
+        float& tNear)
+    {
+        float t0 = -1e30f;
+        float t1 = 1e30f;
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (std::abs(rayDir[axis]) < 1e-8f)
+            {
+                if (rayOrigin[axis] < boxMin[axis] || rayOrigin[axis] > boxMax[axis])
+                    return false;
+                continue;
+            }
+
+            float a = (boxMin[axis] - rayOrigin[axis]) / rayDir[axis];
+            float b = (boxMax[axis] - rayOrigin[axis]) / rayDir[axis];
+            if (a > b)
+                std::swap(a, b);
+
+            t0 = std::max(t0, a);
+            t1 = std::min(t1, b);
+        }
+
+        tNear = t0;
+        return t0 <= t1 && t1 >= 0.f;
+    }
+
+    inline bool CpuFrame::RayTetrahedronIntersect(const Vector3& rayOrigin,
+        const Vector3& rayDir,
+        const Vector3& centre,
+        float radius,
+        const std::array<Vector3, 4>& normals,
+        float& tNear,
+        float& tFar)
+    {
+        // The inside of each face is a half space. A regular tetrahedron's
+        // faces are a third of its circumradius from the centre.
+        const float faceDistance = radius / 3.f;
+        const Vector3 toOrigin = Sub(rayOrigin, centre);
+
+        tNear = -1e30f;
+        tFar = 1e30f;
+
+        for (const Vector3& normal : normals)
+        {
+            const float distance = faceDistance - Dot(normal, toOrigin);
+            const float speed = Dot(normal, rayDir);
+
+            if (std::abs(speed) < 1e-8f)
+            {
+                if (distance < 0.f)
+                    return false;
+                continue;
+            }
+
+            const float t = distance / speed;
+            if (speed < 0.f)
+                tNear = std::max(tNear, t);
+            else
+                tFar = std::min(tFar, t);
+        }
+
+        return tNear <= tFar;
+    }
+}
@@ -0,0 +1,248 @@
+// Compares Gradient::DescriptorIndexAllocator with the std::set free list
+// and CPU handle hash map GraphicsMemoryManager used before it, then times
+// AllocateRange for descriptor tables of 1 to 16 and, on heaps of 4096 or
+// more, bindless ranges of 64 to 1024.
+//
+//  DescriptorAllocatorBenchmark [--operations <count>]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Gradient/DescriptorIndexAllocator.h"
+
+namespace
+{
+    // Stand-ins for the descriptor heap's handle arithmetic
+    constexpr uint64_t HeapStart = 0x10000;
+    constexpr uint64_t Increment = 32;
+
+    // GraphicsMemoryManager's SRV allocation before the bitmaps: reuse the
+    // lowest freed index, otherwise bump, and track every CPU handle
+    class LegacyDescriptorAllocator
+    {
+    public:
+        explicit LegacyDescriptorAllocator(uint32_t capacity)
+            : m_capacity(capacity)
+        {
+        }
+
+        uint32_t Allocate()
+        {
+            uint32_t index;
+            if (!m_free.empty())
+            {
+                index = *m_free.begin();
+                m_free.erase(m_free.begin());
+            }
+            else if (m_top < m_capacity)
+            {
+                index = m_top++;
+            }
+            else
+            {
+                return UINT32_MAX;
+            }
+
+            m_handleToIndex.insert({ HeapStart + index * Increment, index });
+            return index;
+        }
+
+        void Free(uint32_t index)
+        {
+            m_handleToIndex.erase(HeapStart + index * Increment);
+            m_free.insert(index);
+        }
+
+        void FreeByHandle(uint64_t handle)
+        {
+            if (auto it = m_handleToIndex.find(handle); it != m_handleToIndex.end())
+            {
+                Free(it->second);
+            }
+        }
+
+    private:
+        uint32_t m_capacity;
+        uint32_t m_top = 0;
+        std::set<uint32_t> m_free;
+        std::unordered_map<uint64_t, uint32_t> m_handleToIndex;
+    };
+
+    class BitmapDescriptorAllocator
+    {
+    public:
+        explicit BitmapDescriptorAllocator(uint32_t capacity)
+            : m_indices(capacity)
+        {
+        }
+
+        uint32_t Allocate()
+        {
+            return m_indices.Allocate();
+        }
+
+        void Free(uint32_t index)
+        {
+            m_indices.Free(index);
+        }
+
+        void FreeByHandle(uint64_t handle)
+        {
+            if (handle >= HeapStart && (handle - HeapStart) % Increment == 0)
+            {
+                m_indices.Free(static_cast<uint32_t>((handle - HeapStart) / Increment));
+            }
+        }
+
+    private:
+        Gradient::DescriptorIndexAllocator m_indices;
+    };
+
+    // Fills the heap to three quarters, then frees and allocates at
+    // random, freeing every other descriptor by its CPU handle the way
+    // ImGui does. Returns ns per free and allocate pair.
+    template <typename Allocator>
+    double Run(uint32_t capacity, uint32_t operations)
+    {
+        Allocator allocator(capacity);
+        std::vector<uint32_t> live;
+        for (uint32_t i = 0; i < capacity * 3 / 4; i++)
+        {
+            live.push_back(allocator.Allocate());
+        }
+
+        std::mt19937 rng(1);
+        std::vector<uint32_t> picks(operations);
+        for (auto& pick : picks)
+        {
+            pick = static_cast<uint32_t>(rng() % live.size());
+        }
+
+        uint64_t sum = 0;
+        const auto start = std::chrono::steady_clock::now();
+
+        for (uint32_t i = 0; i < operations; i++)
+        {
+            auto& index = live[picks[i]];
+            if (i & 1)
+            {
+                allocator.FreeByHandle(HeapStart + index * Increment);
+            }
+            else
+            {
+                allocator.Free(index);
+            }
+
+            index = allocator.Allocate();
+            sum += index;
+        }
+
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+        if (sum == 0)
+        {
+            std::cout << "";
+        }
+
+        return static_cast<double>(ns) / operations;
+    }
+
+    // Ranges of minCount to maxCount, on a heap kept half full
+    double RunRanges(uint32_t capacity, uint32_t operations, uint32_t minCount, uint32_t maxCount)
+    {
+        Gradient::DescriptorIndexAllocator allocator(capacity);
+        std::vector<std::pair<uint32_t, uint32_t>> live;
+        std::mt19937 rng(1);
+
+        const auto start = std::chrono::steady_clock::now();
+
+        for (uint32_t i = 0; i < operations; i++)
+        {
+            if (allocator.GetFreeCount() < capacity / 2 && !live.empty())
+            {
+                const auto pick = rng() % live.size();
+                allocator.FreeRange(live[pick].first, live[pick].second);
+                live[pick] = live.back();
+                live.pop_back();
+            }
+
+            const uint32_t count = minCount + rng() % (maxCount - minCount + 1);
+            const uint32_t first = allocator.AllocateRange(count);
+            if (first != Gradient::DescriptorIndexAllocator::InvalidIndex)
+            {
+                live.push_back({ first, count });
+            }
+        }
+
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        return static_cast<double>(ns) / operations;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        uint32_t operations = 1 << 22;
+
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--operations" && i + 1 < argc)
+            {
+                operations = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else
+            {
+                throw std::runtime_error("Unknown or incomplete option " + arg);
+            }
+        }
+
+        if (operations == 0)
+        {
+            throw std::runtime_error("Expected at least 1 operation");
+        }
+
+        std::cout << "ns per free and allocate\n"
+            << std::setw(10) << "capacity"
+            << std::setw(12) << "set + map"
+            << std::setw(12) << "bitmap"
+            << std::setw(12) << "ranges"
+            << std::setw(14) << "big ranges" << "\n"
+            << std::fixed << std::setprecision(2);
+
+        for (uint32_t capacity : { 64u, 256u, 4096u, 65536u, 1u << 20 })
+        {
+            std::cout << std::setw(10) << capacity
+                << std::setw(12) << Run<LegacyDescriptorAllocator>(capacity, operations)
+                << std::setw(12) << Run<BitmapDescriptorAllocator>(capacity, operations)
+                << std::setw(12) << RunRanges(capacity, operations / 16, 1, 16);
+
+            if (capacity >= 4096)
+            {
+                std::cout << std::setw(14) << RunRanges(capacity, operations / 64, 64, 1024);
+            }
+            std::cout << "\n";
+        }
+
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
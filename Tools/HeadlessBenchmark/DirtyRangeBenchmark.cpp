@@ -0,0 +1,228 @@
+// Times turning a frame's partial instance updates into copy ranges with
+// Gradient::DirtyRangeTracker, against collecting the updated ranges in a
+// list and sorting and merging it, for a million particles.
+//
+//  DirtyRangeBenchmark [--particles <count>] [--frames <count>] [--gap <elements>]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Gradient/DirtyRangeTracker.h"
+
+namespace
+{
+    using Range = Gradient::DirtyRangeTracker::Range;
+
+    // Bytes per particle in a dynamic instance buffer
+    constexpr uint64_t ElementSize = 32;
+
+    class SortedRangeList
+    {
+    public:
+        void Mark(uint32_t first, uint32_t count)
+        {
+            m_ranges.push_back({ first, count });
+        }
+
+        void Collect(uint32_t mergeGap, std::vector<Range>& out)
+        {
+            out.clear();
+            std::sort(m_ranges.begin(), m_ranges.end(), [](const Range& a, const Range& b)
+                {
+                    return a.First < b.First;
+                });
+
+            for (const auto& range : m_ranges)
+            {
+                if (!out.empty() && range.First <= out.back().First + out.back().Count + mergeGap)
+                {
+                    const uint32_t end = std::max(out.back().First + out.back().Count, range.First + range.Count);
+                    out.back().Count = end - out.back().First;
+                }
+                else
+                {
+                    out.push_back(range);
+                }
+            }
+
+            m_ranges.clear();
+        }
+
+    private:
+        std::vector<Range> m_ranges;
+    };
+
+    // The ranges one frame updates
+    using Pattern = std::function<void(std::mt19937&, uint32_t particles, std::vector<Range>&)>;
+
+    struct Result
+    {
+        double Us;
+        std::size_t Ranges;
+        double CopiedMb;
+    };
+
+    template <typename Tracker>
+    Result Run(Tracker& tracker,
+        const std::vector<std::vector<Range>>& frames,
+        uint32_t mergeGap)
+    {
+        std::vector<Range> out;
+        std::size_t ranges = 0;
+        uint64_t copied = 0;
+
+        const auto start = std::chrono::steady_clock::now();
+
+        for (const auto& frame : frames)
+        {
+            for (const auto& update : frame)
+            {
+                tracker.Mark(update.First, update.Count);
+            }
+
+            tracker.Collect(mergeGap, out);
+
+            ranges += out.size();
+            for (const auto& range : out)
+            {
+                copied += range.Count * ElementSize;
+            }
+        }
+
+        const auto us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+        return {
+            us / frames.size(),
+            ranges / frames.size(),
+            static_cast<double>(copied) / frames.size() / (1024.0 * 1024.0)
+        };
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        uint32_t particles = 1 << 20;
+        uint32_t frameCount = 20;
+        uint32_t mergeGap = 8;
+
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--particles" && i + 1 < argc)
+            {
+                particles = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--frames" && i + 1 < argc)
+            {
+                frameCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--gap" && i + 1 < argc)
+            {
+                mergeGap = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else
+            {
+                throw std::runtime_error("Unknown or incomplete option " + arg);
+            }
+        }
+
+        if (particles < 1024 || frameCount == 0)
+        {
+            throw std::runtime_error("Expected at least 1024 particles and 1 frame");
+        }
+
+        auto scattered = [](double fraction) -> Pattern
+            {
+                return [fraction](std::mt19937& rng, uint32_t n, std::vector<Range>& out)
+                    {
+                        for (uint32_t i = 0; i < static_cast<uint32_t>(n * fraction); i++)
+                        {
+                            out.push_back({ static_cast<uint32_t>(rng() % n), 1 });
+                        }
+                    };
+            };
+
+        const std::pair<const char*, Pattern> patterns[] = {
+            { "1% scattered", scattered(0.01) },
+            { "10% scattered", scattered(0.10) },
+            { "10% in clusters of 64", [](std::mt19937& rng, uint32_t n, std::vector<Range>& out)
+                {
+                    for (uint32_t i = 0; i < n / 10 / 64; i++)
+                    {
+                        out.push_back({ static_cast<uint32_t>(rng() % (n - 64)), 64 });
+                    }
+                } },
+            { "every 4th", [](std::mt19937&, uint32_t n, std::vector<Range>& out)
+                {
+                    for (uint32_t i = 0; i < n; i += 4)
+                    {
+                        out.push_back({ i, 1 });
+                    }
+                } },
+            { "everything", [](std::mt19937&, uint32_t n, std::vector<Range>& out)
+                {
+                    out.push_back({ 0, n });
+                } },
+        };
+
+        std::cout << particles << " particles of " << ElementSize << " bytes, merge gap " << mergeGap
+            << ", per frame\n"
+            << std::setw(24) << ""
+            << std::setw(12) << "list us" << std::setw(12) << "bitmap us"
+            << std::setw(10) << "ranges" << std::setw(12) << "copied MB"
+            << std::setw(12) << "ranges/0" << std::setw(12) << "MB/0" << "\n"
+            << std::fixed;
+
+        for (const auto& [name, pattern] : patterns)
+        {
+            std::mt19937 rng(1);
+            std::vector<std::vector<Range>> frames(frameCount);
+            for (auto& frame : frames)
+            {
+                pattern(rng, particles, frame);
+            }
+
+            SortedRangeList list;
+            Gradient::DirtyRangeTracker bitmap(particles);
+            Gradient::DirtyRangeTracker exact(particles);
+
+            const Result listResult = Run(list, frames, mergeGap);
+            const Result bitmapResult = Run(bitmap, frames, mergeGap);
+            const Result exactResult = Run(exact, frames, 0);
+
+            if (listResult.Ranges != bitmapResult.Ranges)
+            {
+                throw std::runtime_error(std::string("Range counts differ for ") + name);
+            }
+
+            std::cout << std::setw(24) << name
+                << std::setprecision(0)
+                << std::setw(12) << listResult.Us
+                << std::setw(12) << bitmapResult.Us
+                << std::setw(10) << bitmapResult.Ranges
+                << std::setprecision(2)
+                << std::setw(12) << bitmapResult.CopiedMb
+                << std::setw(12) << exactResult.Ranges
+                << std::setw(12) << exactResult.CopiedMb << "\n";
+        }
+
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
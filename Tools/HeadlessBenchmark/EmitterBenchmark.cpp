@@ -0,0 +1,264 @@
+// Runs ISV::ParticleEmitter at a sustained spawn rate, 1M particles per
+// simulated second by default, with short lifetimes so slots recycle
+// through its FreeSlotStack many times over. Reports wall time against
+// simulated time and counts heap allocations once warmed up. Fails if any
+// spawn is dropped, or if any thread count allocates after warm-up; the
+// warm-up is also where ParallelFor's worker pool starts its threads.
+//
+// Then hammers a bare FreeSlotStack with pop and push pairs from several
+// threads, and checks every slot is still there exactly once afterwards.
+//
+//  EmitterBenchmark [--rate <spawns per second>] [--seconds <simulated>]
+//                   [--threads <count>]... [--stack-ops <per thread>]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Core/ParticleEmitter.h"
+#include "Gradient/FreeSlotStack.h"
+
+namespace
+{
+    std::atomic<uint64_t> g_heapAllocations = 0;
+}
+
+void* operator new(std::size_t size)
+{
+    g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace
+{
+    using Gradient::FreeSlotStack;
+    using ISV::ParticleEmitter;
+
+    constexpr float FrameTime = 1.f / 60.f;
+    constexpr float WarmupSeconds = 1.f;
+
+    struct EmitterResult
+    {
+        uint64_t Spawned = 0;
+        uint64_t Dropped = 0;
+        uint32_t PeakAlive = 0;
+        double WallSeconds = 0.0;
+        uint64_t Allocations = 0;
+    };
+
+    EmitterResult RunEmitter(float rate, float seconds, uint32_t threads)
+    {
+        ParticleEmitter::Settings settings;
+        settings.SpawnRate = rate;
+        settings.MinLifetime = 0.05f;
+        settings.MaxLifetime = 0.15f;
+        settings.Distribution = ParticleEmitter::VelocityDistribution::Sphere;
+
+        // Room for the longest lifetime plus a frame of spawns, with slack
+        const auto capacity = static_cast<uint32_t>(rate * (settings.MaxLifetime + FrameTime) * 1.25f) + 1024;
+        ParticleEmitter emitter(capacity, settings);
+
+        const auto warmupFrames = static_cast<uint32_t>(std::round(WarmupSeconds / FrameTime));
+        const auto frames = static_cast<uint32_t>(std::round(seconds / FrameTime));
+
+        EmitterResult result;
+        uint64_t allocationsBefore = 0;
+        std::chrono::steady_clock::time_point start;
+
+        for (uint32_t frame = 0; frame < warmupFrames + frames; frame++)
+        {
+            if (frame == warmupFrames)
+            {
+                allocationsBefore = g_heapAllocations.load();
+                start = std::chrono::steady_clock::now();
+            }
+
+            const auto stats = emitter.Update(FrameTime, threads);
+
+            if (frame >= warmupFrames)
+            {
+                result.Spawned += stats.Spawned;
+                result.Dropped += stats.Dropped;
+                result.PeakAlive = std::max(result.PeakAlive, emitter.GetAliveCount());
+            }
+        }
+
+        result.WallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.Allocations = g_heapAllocations.load() - allocationsBefore;
+        return result;
+    }
+
+    // Each thread pops a slot and pushes it back, ops times
+    double RunStack(uint32_t capacity, uint32_t threads, uint32_t ops)
+    {
+        FreeSlotStack stack(capacity);
+        stack.Fill();
+
+        std::atomic<bool> go(false);
+        std::vector<std::thread> workers;
+
+        for (uint32_t t = 0; t < threads; t++)
+        {
+            workers.emplace_back([&]()
+                {
+                    while (!go.load(std::memory_order_acquire))
+                    {
+                    }
+
+                    for (uint32_t i = 0; i < ops; i++)
+                    {
+                        const uint32_t slot = stack.Pop();
+                        if (slot == FreeSlotStack::InvalidSlot)
+                            continue;
+
+                        stack.Push(slot);
+                    }
+                });
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        go.store(true, std::memory_order_release);
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::vector<uint8_t> seen(capacity, 0);
+        for (uint32_t i = 0; i < capacity; i++)
+        {
+            const uint32_t slot = stack.Pop();
+            if (slot == FreeSlotStack::InvalidSlot || seen[slot])
+            {
+                throw std::runtime_error("The free slot stack lost or duplicated a slot");
+            }
+            seen[slot] = 1;
+        }
+
+        if (stack.Pop() != FreeSlotStack::InvalidSlot)
+        {
+            throw std::runtime_error("The free slot stack holds more slots than its capacity");
+        }
+
+        return 2.0 * threads * ops / seconds;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        float rate = 1000000.f;
+        float seconds = 10.f;
+        std::vector<uint32_t> threadCounts;
+        uint32_t stackOps = 1000000;
+
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--rate" && i + 1 < argc)
+            {
+                rate = std::strtof(argv[++i], nullptr);
+            }
+            else if (arg == "--seconds" && i + 1 < argc)
+            {
+                seconds = std::strtof(argv[++i], nullptr);
+            }
+            else if (arg == "--threads" && i + 1 < argc)
+            {
+                threadCounts.push_back(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+            }
+            else if (arg == "--stack-ops" && i + 1 < argc)
+            {
+                stackOps = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else
+            {
+                throw std::runtime_error("Unknown or incomplete option " + arg);
+            }
+        }
+
+        if (threadCounts.empty())
+        {
+            threadCounts = { 1, 2, 4 };
+        }
+
+        if (rate <= 0.f || seconds < FrameTime
+            || std::find(threadCounts.begin(), threadCounts.end(), 0u) != threadCounts.end())
+        {
+            throw std::runtime_error("Expected a positive rate, at least a frame and 1 thread");
+        }
+
+        std::cout << static_cast<uint64_t>(rate) << " spawns per simulated second, 0.05 to 0.15 s lifetimes, "
+            << seconds << " simulated seconds after " << WarmupSeconds << " of warm-up\n"
+            << std::setw(9) << "threads" << std::setw(12) << "spawned" << std::setw(9) << "dropped"
+            << std::setw(11) << "peak alive" << std::setw(10) << "wall s"
+            << std::setw(14) << "Mspawns/s" << std::setw(12) << "x realtime"
+            << std::setw(10) << "allocs" << "\n"
+            << std::fixed;
+
+        for (const uint32_t threads : threadCounts)
+        {
+            const EmitterResult result = RunEmitter(rate, seconds, threads);
+
+            std::cout << std::setw(9) << threads
+                << std::setw(12) << result.Spawned
+                << std::setw(9) << result.Dropped
+                << std::setw(11) << result.PeakAlive
+                << std::setprecision(2)
+                << std::setw(10) << result.WallSeconds
+                << std::setw(14) << result.Spawned / result.WallSeconds / 1e6
+                << std::setw(12) << seconds / result.WallSeconds
+                << std::setw(10) << result.Allocations << "\n";
+
+            if (result.Dropped > 0)
+            {
+                throw std::runtime_error("The emitter dropped spawns");
+            }
+
+            if (result.Allocations > 0)
+            {
+                throw std::runtime_error("The emitter allocated from the heap after warm-up");
+            }
+        }
+
+        std::cout << "\nFreeSlotStack, " << stackOps << " pop and push pairs per thread\n"
+            << std::setw(9) << "threads" << std::setw(14) << "Mops/s" << "\n";
+
+        for (const uint32_t threads : threadCounts)
+        {
+            std::cout << std::setw(9) << threads
+                << std::setw(14) << RunStack(1024, threads, stackOps) / 1e6 << "\n";
+        }
+
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,240 @@
+// Compares the two volumetric shadow representations, the slice volume and
+// ISV::FourierOpacityMap, on a preset's particles: memory per light texel,
+// optical thickness and transmittance error at random points, and lookups
+// per second. The reference is the same splat with many more slices.
+// Lookups follow SampleOpticalThickness in VolumetricLighting.hlsli: the
+// slice volume is sampled trilinearly at the normalised light depth, the
+// Fourier map bilinearly and reconstructed there.
+//
+//  FourierOpacityBenchmark [--preset <file>] [--width <texels>] [--slices <count>]
+//                          [--reference <slices>] [--samples <count>]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "BenchmarkVolumes.h"
+#include "Core/FourierOpacityMap.h"
+#include "Core/OpticalThicknessMipChain.h"
+
+namespace
+{
+    using ISV::BenchmarkVolumes::Volume;
+    using Clock = std::chrono::steady_clock;
+
+    struct Point
+    {
+        float U;
+        float V;
+        float Z;
+    };
+
+    ISV::OpticalThicknessMipChain::Level ToLevel(const Volume& volume)
+    {
+        return { volume.Width, volume.Width, volume.Depth, volume.Texels };
+    }
+
+    struct Result
+    {
+        double MaxOpticalThicknessError = 0.0;
+        double MeanOpticalThicknessError = 0.0;
+        double MaxTransmittanceError = 0.0;
+        double MeanTransmittanceError = 0.0;
+        double MSamplesPerSecond = 0.0;
+    };
+
+    Result Measure(const std::function<float(const Point&)>& sample,
+        const std::vector<Point>& points,
+        const std::vector<float>& reference)
+    {
+        Result result;
+
+        std::vector<float> values(points.size());
+
+        const auto start = Clock::now();
+        for (std::size_t i = 0; i < points.size(); i++)
+        {
+            values[i] = sample(points[i]);
+        }
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        result.MSamplesPerSecond = points.size() / seconds / 1e6;
+
+        for (std::size_t i = 0; i < points.size(); i++)
+        {
+            const double otError = std::abs(values[i] - reference[i]);
+            const double tError = std::abs(std::exp(-static_cast<double>(values[i])) - std::exp(-static_cast<double>(reference[i])));
+
+            result.MaxOpticalThicknessError = std::max(result.MaxOpticalThicknessError, otError);
+            result.MeanOpticalThicknessError += otError;
+            result.MaxTransmittanceError = std::max(result.MaxTransmittanceError, tError);
+            result.MeanTransmittanceError += tError;
+        }
+
+        result.MeanOpticalThicknessError /= points.size();
+        result.MeanTransmittanceError /= points.size();
+        return result;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        std::string presetPath;
+        uint32_t width = 128;
+        uint32_t slices = 10;
+        uint32_t referenceSlices = 129;
+        uint32_t sampleCount = 1000000;
+
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--preset" && i + 1 < argc)
+            {
+                presetPath = argv[++i];
+            }
+            else if (arg == "--width" && i + 1 < argc)
+            {
+                width = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--slices" && i + 1 < argc)
+            {
+                slices = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--reference" && i + 1 < argc)
+            {
+                referenceSlices = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--samples" && i + 1 < argc)
+            {
+                sampleCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else
+            {
+                throw std::runtime_error("Unknown or incomplete option " + arg);
+            }
+        }
+
+        if (width == 0 || slices < 2 || referenceSlices <= slices || sampleCount == 0)
+        {
+            throw std::runtime_error("Expected a width, at least 2 slices, more reference slices than that, and samples");
+        }
+
+        const ISV::ScenePreset preset = ISV::BenchmarkVolumes::LoadPreset(presetPath);
+
+        auto start = Clock::now();
+        const Volume reference = ISV::BenchmarkVolumes::Splat(preset, width, referenceSlices);
+        const double referenceMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        // The slice volume at the shipped depth, and at the depth that takes
+        // the same memory as the Fourier map's two RGBA targets
+        const uint32_t matchedSlices = static_cast<uint32_t>(sizeof(ISV::FourierOpacityMap::Coefficients) / sizeof(float));
+        const Volume coarse = ISV::BenchmarkVolumes::Splat(preset, width, slices);
+        const Volume matched = ISV::BenchmarkVolumes::Splat(preset, width, matchedSlices);
+
+        const auto referenceLevel = ToLevel(reference);
+        const auto coarseLevel = ToLevel(coarse);
+        const auto matchedLevel = ToLevel(matched);
+
+        ISV::FourierOpacityMap fromSlices(width, width);
+        start = Clock::now();
+        fromSlices.EncodeSliceVolume(coarse.Texels.data(), coarse.Depth);
+        const double fromSlicesMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        ISV::FourierOpacityMap fromReference(width, width);
+        start = Clock::now();
+        fromReference.EncodeSliceVolume(reference.Texels.data(), reference.Depth);
+        const double fromReferenceMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        // Slice s of the reference holds the optical thickness at depth
+        // s / (slices - 1), so it is read back between texel centres
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+        std::vector<Point> points(sampleCount);
+        std::vector<float> expected(sampleCount);
+        for (uint32_t i = 0; i < sampleCount; i++)
+        {
+            points[i] = { unit(rng), unit(rng), unit(rng) };
+            const float w = (points[i].Z * (referenceSlices - 1) + 0.5f) / referenceSlices;
+            expected[i] = referenceLevel.Sample(points[i].U, points[i].V, w);
+        }
+
+        // EncodeMs is negative for the slice volumes, which need no encoding
+        struct Row
+        {
+            std::string Name;
+            std::size_t BytesPerTexel;
+            double EncodeMs;
+            std::function<float(const Point&)> Sample;
+        };
+
+        const std::size_t fourierBytes = fromSlices.GetSizeInBytes() / (static_cast<std::size_t>(width) * width);
+
+        const Row rows[] = {
+            { "slices " + std::to_string(slices), slices * sizeof(float), -1.0,
+                [&](const Point& p) { return coarseLevel.Sample(p.U, p.V, p.Z); } },
+            { "slices " + std::to_string(matchedSlices), matchedSlices * sizeof(float), -1.0,
+                [&](const Point& p) { return matchedLevel.Sample(p.U, p.V, p.Z); } },
+            { "fourier, " + std::to_string(slices) + " slices", fourierBytes, fromSlicesMs,
+                [&](const Point& p) { return fromSlices.SampleOpticalThickness(p.U, p.V, p.Z); } },
+            { "fourier, " + std::to_string(referenceSlices) + " slices", fourierBytes, fromReferenceMs,
+                [&](const Point& p) { return fromReference.SampleOpticalThickness(p.U, p.V, p.Z); } },
+        };
+
+        std::cout << preset.Name << ", " << preset.ParticleCount << " particles, "
+            << width << "x" << width << " texels, against " << referenceSlices << " slices ("
+            << std::fixed << std::setprecision(1) << referenceMs << " ms to splat), "
+            << sampleCount << " lookups\n"
+            << std::setw(22) << ""
+            << std::setw(10) << "B/texel" << std::setw(10) << "MB"
+            << std::setw(12) << "encode ms"
+            << std::setw(12) << "OT max" << std::setw(12) << "OT mean"
+            << std::setw(12) << "T max" << std::setw(12) << "T mean"
+            << std::setw(12) << "Mlookup/s" << "\n";
+
+        for (const auto& row : rows)
+        {
+            const Result result = Measure(row.Sample, points, expected);
+            const double megabytes = row.BytesPerTexel * static_cast<double>(width) * width / (1024.0 * 1024.0);
+
+            std::cout << std::setw(22) << row.Name
+                << std::setw(10) << row.BytesPerTexel
+                << std::setprecision(2) << std::setw(10) << megabytes;
+
+            if (row.EncodeMs < 0.0)
+            {
+                std::cout << std::setw(12) << "-";
+            }
+            else
+            {
+                std::cout << std::setw(12) << row.EncodeMs;
+            }
+
+            std::cout << std::setprecision(4)
+                << std::setw(12) << result.MaxOpticalThicknessError
+                << std::setw(12) << result.MeanOpticalThicknessError
+                << std::setw(12) << result.MaxTransmittanceError
+                << std::setw(12) << result.MeanTransmittanceError
+                << std::setprecision(1)
+                << std::setw(12) << result.MSamplesPerSecond << "\n";
+        }
+
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,257 @@
+// Runs preset benchmarks and sweeps with the CPU implementations of each
+// pass, so the harness and the result files can be checked without a GPU.
+//
+//  HeadlessBenchmark --sweep Presets/Sweeps/StepCount.json --results steps.csv
+//  HeadlessBenchmark --benchmark Presets --results presets.json
+//
+// Options:
+//  --sweep <file>                      Add every preset of a sweep
+//  --benchmark <file or directory>...  Add presets, or every .json in a directory
+//  --results <file>                    CSV, or JSON if it ends in .json
+//  --width <pixels> --height <pixels>  Particle render resolution
+//  --threads <count>                   Worker threads for the render passes
+//  --warmup <frames> --frames <frames> Override every preset's frame counts,
+//                                      the CPU passes are slow at high counts
+//  --trace <file>                      Record CPU profiler zones and write
+//                                      them as a Chrome trace
+//
+// The CPU render draws tetrahedra or sphere proxies but doesn't reproduce
+// the integration of each rendering method, so of presets that differ only
+// in methods with the same geometry just the first is run. The others are
+// listed as skipped and left out of the results.
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Core/BenchmarkSweep.h"
+#include "Core/PresetBenchmark.h"
+#include "Core/Profiler.h"
+#include "Core/ScenePreset.h"
+#include "StepTimer.h"
+#include "CpuFrame.h"
+
+namespace
+{
+    void AddPresetFiles(const std::filesystem::path& path, std::vector<ISV::ScenePreset>& presets)
+    {
+        if (!std::filesystem::is_directory(path))
+        {
+            presets.push_back(ISV::ScenePreset::Load(path.string()));
+            return;
+        }
+
+        std::vector<std::filesystem::path> found;
+        for (const auto& entry : std::filesystem::directory_iterator(path))
+        {
+            if (entry.is_regular_file() && entry.path().extension() == ".json")
+            {
+                found.push_back(entry.path());
+            }
+        }
+
+        std::sort(found.begin(), found.end());
+        for (const auto& file : found)
+        {
+            presets.push_back(ISV::ScenePreset::Load(file.string()));
+        }
+    }
+
+    uint32_t ParseCount(const std::string& value, const std::string& option)
+    {
+        const long count = std::strtol(value.c_str(), nullptr, 10);
+        if (count <= 0)
+        {
+            throw std::runtime_error("Expected a positive number for " + option);
+        }
+
+        return static_cast<uint32_t>(count);
+    }
+
+    // Drops presets that would run the same CpuFrame as an earlier one
+    std::vector<ISV::ScenePreset> CollapseRenderingMethods(std::vector<ISV::ScenePreset> presets)
+    {
+        std::vector<ISV::ScenePreset> kept;
+        std::vector<std::string> keys;
+
+        for (auto& preset : presets)
+        {
+            // The preset as CpuFrame sees it: the name aside, and with the
+            // method replaced by the first method of the same geometry
+            ISV::ScenePreset key = preset;
+            key.Name.clear();
+            for (uint32_t method = 0; method < ISV::ScenePreset::RenderingMethodNames.size(); method++)
+            {
+                if (ISV::CpuFrame::GetGeometry(method) == ISV::CpuFrame::GetGeometry(preset.RenderingMethod))
+                {
+                    key.RenderingMethod = method;
+                    break;
+                }
+            }
+
+            const std::string json = key.ToJson().dump();
+            const auto found = std::find(keys.begin(), keys.end(), json);
+            if (found != keys.end())
+            {
+                const auto& same = kept[found - keys.begin()];
+                std::cout << "Skipping " << preset.Name << ": the CPU render draws "
+                    << ISV::ScenePreset::RenderingMethodNames.at(preset.RenderingMethod) << " the same as "
+                    << ISV::ScenePreset::RenderingMethodNames.at(same.RenderingMethod)
+                    << ", run as " << same.Name << std::endl;
+                continue;
+            }
+
+            keys.push_back(json);
+            kept.push_back(std::move(preset));
+        }
+
+        return kept;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        std::vector<std::string> args(argv + 1, argv + argc);
+
+        std::vector<ISV::ScenePreset> presets;
+        std::string resultsPath = "benchmark_results.csv";
+        ISV::CpuFrame::Settings settings;
+        settings.ThreadCount = ISV::GetDefaultThreadCount();
+        uint32_t warmupFrames = 0;
+        uint32_t measuredFrames = 0;
+        std::string tracePath;
+
+        for (size_t i = 0; i < args.size(); i++)
+        {
+            const bool hasValue = i + 1 < args.size();
+
+            if (args[i] == "--sweep" && hasValue)
+            {
+                const auto sweep = ISV::BenchmarkSweep::Load(args[++i]).Expand();
+                presets.insert(presets.end(), sweep.begin(), sweep.end());
+            }
+            else if (args[i] == "--benchmark")
+            {
+                while (i + 1 < args.size() && args[i + 1].rfind("--", 0) != 0)
+                {
+                    AddPresetFiles(args[++i], presets);
+                }
+            }
+            else if (args[i] == "--results" && hasValue)
+            {
+                resultsPath = args[++i];
+            }
+            else if (args[i] == "--width" && hasValue)
+            {
+                settings.Width = ParseCount(args[i + 1], args[i]);
+                i++;
+            }
+            else if (args[i] == "--height" && hasValue)
+            {
+                settings.Height = ParseCount(args[i + 1], args[i]);
+                i++;
+            }
+            else if (args[i] == "--threads" && hasValue)
+            {
+                settings.ThreadCount = ParseCount(args[i + 1], args[i]);
+                i++;
+            }
+            else if (args[i] == "--warmup" && hasValue)
+            {
+                warmupFrames = ParseCount(args[i + 1], args[i]);
+                i++;
+            }
+            else if (args[i] == "--frames" && hasValue)
+            {
+                measuredFrames = ParseCount(args[i + 1], args[i]);
+                i++;
+            }
+            else if (args[i] == "--trace" && hasValue)
+            {
+                tracePath = args[++i];
+            }
+            else
+            {
+                throw std::runtime_error("Unknown or incomplete option " + args[i]);
+            }
+        }
+
+        if (presets.empty())
+        {
+            throw std::runtime_error("Nothing to run, pass --sweep or --benchmark");
+        }
+
+        presets = CollapseRenderingMethods(std::move(presets));
+
+        for (auto& preset : presets)
+        {
+            preset.WarmupFrames = warmupFrames > 0 ? warmupFrames : preset.WarmupFrames;
+            preset.MeasuredFrames = measuredFrames > 0 ? measuredFrames : preset.MeasuredFrames;
+        }
+
+        ISV::PresetBenchmark benchmark(std::move(presets));
+        DX::StepTimer timer;
+
+        // Each thread keeps its most recent zones, so a long run traces
+        // its last few frames
+        ISV::Profiler::Get().SetEnabled(!tracePath.empty());
+
+        while (!benchmark.IsFinished())
+        {
+            const auto& preset = benchmark.GetPreset();
+            std::cout << "[" << benchmark.GetPresetIndex() + 1 << "/" << benchmark.GetPresetCount() << "] "
+                << preset.Name << std::endl;
+
+            ISV::CpuFrame frame(preset, settings);
+
+            // The simulation advances by the camera path's frame length, so
+            // every run simulates and renders the same frames
+            const double frameLength = 1.0 / preset.CameraFrameRate;
+
+            // Frame to frame time, the same as the app measures
+            timer.ResetElapsedTime();
+            timer.ResetFrameTimes();
+
+            bool nextPreset = false;
+            while (!nextPreset && !benchmark.IsFinished())
+            {
+                ISV_PROFILE_ZONE("Frame");
+
+                const auto camera = preset.EvaluateCamera(benchmark.GetCameraTime());
+                const auto passMs = frame.Render(camera, frameLength);
+
+                timer.Tick([]() {});
+                nextPreset = benchmark.EndFrame(timer.GetLastFrameSeconds(), passMs);
+            }
+
+            // Includes the warmup frames, unlike the results
+            const auto summary = timer.GetFrameTimes().GetSummary();
+            std::cout << "    p50 " << summary.P50Ms
+                << " ms, p95 " << summary.P95Ms
+                << " ms, p99 " << summary.P99Ms << " ms" << std::endl;
+        }
+
+        benchmark.WriteResults(resultsPath);
+        std::cout << "Wrote " << resultsPath << std::endl;
+
+        if (!tracePath.empty())
+        {
+            ISV::Profiler::Get().SetEnabled(false);
+            ISV::Profiler::Get().WriteChromeTrace(tracePath);
+            std::cout << "Wrote " << tracePath << std::endl;
+        }
+
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
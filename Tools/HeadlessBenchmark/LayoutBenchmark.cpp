@@ -0,0 +1,250 @@
+// Measures the bytes each GPU pass touches per particle with the old
+// interleaved 64 byte instance record and with the split render and
+// simulation streams of ISV::InstanceLayout. For every pass it reports
+// the bytes the pass uses, the bytes fetched in whole sectors as
+// InstanceLayout::MeasureTraffic models them, and the time per particle of
+// a CPU kernel that reads and writes the same fields from each layout,
+// with the fetched bytes it moves per second.
+//
+//  LayoutBenchmark [--particles <count>] [--sector <bytes>] [--repeats <count>]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "CpuFrame.h"
+#include "Core/InstanceLayout.h"
+
+namespace
+{
+    using ISV::InstanceLayout;
+    using Pass = InstanceLayout::Pass;
+    using Layout = InstanceLayout::Layout;
+
+    // The traffic model walks every field of every particle through a hash
+    // set, and the layouts repeat every few particles, so a sample will do
+    constexpr uint32_t TrafficSampleParticles = 65536;
+
+    constexpr float Dt = 1.f / 60.f;
+
+    struct InterleavedView
+    {
+        std::vector<InstanceLayout::InterleavedInstance>& Instances;
+
+        auto& Position(std::size_t i) { return Instances[i].Position; }
+        float Scale(std::size_t i) const { return Instances[i].Scale; }
+        float Extinction(std::size_t i) const { return Instances[i].ExtinctionScale; }
+        const auto& Rotation(std::size_t i) const { return Instances[i].RotationQuat; }
+        auto& Velocity(std::size_t i) { return Instances[i].Velocity; }
+        float Mass(std::size_t i) const { return Instances[i].Mass; }
+        const auto& Target(std::size_t i) const { return Instances[i].TargetPosition; }
+    };
+
+    struct SplitView
+    {
+        std::vector<InstanceLayout::RenderInstance>& Render;
+        std::vector<InstanceLayout::SimulationInstance>& Simulation;
+
+        auto& Position(std::size_t i) { return Render[i].Position; }
+        float Scale(std::size_t i) const { return Render[i].Scale; }
+        float Extinction(std::size_t i) const { return Render[i].ExtinctionScale; }
+        const auto& Rotation(std::size_t i) const { return Render[i].RotationQuat; }
+        auto& Velocity(std::size_t i) { return Simulation[i].Velocity; }
+        float Mass(std::size_t i) const { return Simulation[i].Mass; }
+        const auto& Target(std::size_t i) const { return Simulation[i].TargetPosition; }
+    };
+
+    // Touches the fields InstanceLayout::GetFields lists for the pass. The
+    // returned sum keeps the reads from being optimised away.
+    template <typename View>
+    float Kernel(Pass pass, View& view, std::size_t count, std::vector<float>& keys)
+    {
+        float sum = 0.f;
+
+        switch (pass)
+        {
+        case Pass::WriteSortingKeys:
+            for (std::size_t i = 0; i < count; i++)
+            {
+                const auto& p = view.Position(i);
+                keys[i] = p[0] * 0.6f + p[1] * 0.48f + p[2] * 0.64f;
+            }
+            break;
+        case Pass::SphereProxies:
+            for (std::size_t i = 0; i < count; i++)
+            {
+                const auto& p = view.Position(i);
+                sum += (p[0] + p[1] + p[2]) * view.Scale(i) * view.Extinction(i);
+            }
+            break;
+        case Pass::Tetrahedra:
+            for (std::size_t i = 0; i < count; i++)
+            {
+                const auto& p = view.Position(i);
+                const auto& q = view.Rotation(i);
+                sum += (p[0] * q[0] + p[1] * q[1] + p[2] * q[2] + q[3]) * view.Scale(i) * view.Extinction(i);
+            }
+            break;
+        default:
+            for (std::size_t i = 0; i < count; i++)
+            {
+                auto& p = view.Position(i);
+                auto& v = view.Velocity(i);
+                const auto& t = view.Target(i);
+                const float k = Dt / (view.Mass(i) * view.Scale(i));
+
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    v[axis] += (t[axis] - p[axis]) * k;
+                    p[axis] += v[axis] * Dt;
+                }
+            }
+            break;
+        }
+
+        return sum;
+    }
+
+    template <typename View>
+    double TimeKernel(Pass pass, View& view, std::size_t count, uint32_t repeats, std::vector<float>& keys, float& sink)
+    {
+        // Once to fault the pages in, then timed
+        sink += Kernel(pass, view, count, keys);
+
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t r = 0; r < repeats; r++)
+        {
+            sink += Kernel(pass, view, count, keys);
+        }
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count()
+            / (static_cast<double>(count) * repeats);
+    }
+
+    const char* GetPassName(Pass pass)
+    {
+        switch (pass)
+        {
+        case Pass::WriteSortingKeys:
+            return "sort keys";
+        case Pass::SphereProxies:
+            return "spheres";
+        case Pass::Tetrahedra:
+            return "tetrahedra";
+        default:
+            return "simulate";
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        uint32_t particleCount = 1 << 20;
+        uint32_t sectorSize = 32;
+        uint32_t repeats = 20;
+
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--particles" && i + 1 < argc)
+            {
+                particleCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--sector" && i + 1 < argc)
+            {
+                sectorSize = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--repeats" && i + 1 < argc)
+            {
+                repeats = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else
+            {
+                throw std::runtime_error("Unknown or incomplete option " + arg);
+            }
+        }
+
+        if (particleCount == 0 || sectorSize == 0 || repeats == 0)
+        {
+            throw std::runtime_error("Expected particles, a sector size and at least 1 repeat");
+        }
+
+        const auto particles = ISV::Detail::CreateParticles(particleCount, 1);
+
+        std::vector<InstanceLayout::InterleavedInstance> interleaved(particleCount);
+        for (uint32_t i = 0; i < particleCount; i++)
+        {
+            const auto& p = particles[i];
+            interleaved[i] = { p.Position, p.ExtinctionScale, p.Velocity, p.Mass, p.TargetPosition, p.Scale, p.RotationQuat };
+        }
+
+        std::vector<InstanceLayout::RenderInstance> render;
+        std::vector<InstanceLayout::SimulationInstance> simulation;
+        InstanceLayout::Split(particles, render, simulation);
+
+        InterleavedView interleavedView{ interleaved };
+        SplitView splitView{ render, simulation };
+        std::vector<float> keys(particleCount);
+        float sink = 0.f;
+
+        const uint32_t trafficParticles = std::min(particleCount, TrafficSampleParticles);
+
+        std::cout << particleCount << " particles, " << sectorSize << " byte sectors, "
+            << sizeof(InstanceLayout::InterleavedInstance) << " bytes interleaved, "
+            << sizeof(InstanceLayout::RenderInstance) << " + " << sizeof(InstanceLayout::SimulationInstance)
+            << " bytes split\n"
+            << std::setw(12) << "pass" << std::setw(13) << "layout"
+            << std::setw(9) << "useful" << std::setw(9) << "fetched"
+            << std::setw(11) << "efficiency"
+            << std::setw(13) << "ns/particle" << std::setw(14) << "fetched GB/s"
+            << std::setw(10) << "speedup" << "\n"
+            << std::fixed;
+
+        for (const Pass pass : { Pass::WriteSortingKeys, Pass::SphereProxies, Pass::Tetrahedra, Pass::Simulate })
+        {
+            double interleavedNs = 0.0;
+
+            for (const Layout layout : { Layout::Interleaved, Layout::Split })
+            {
+                const auto traffic = InstanceLayout::MeasureTraffic(pass, layout, trafficParticles, sectorSize);
+                const double ns = layout == Layout::Split
+                    ? TimeKernel(pass, splitView, particleCount, repeats, keys, sink)
+                    : TimeKernel(pass, interleavedView, particleCount, repeats, keys, sink);
+
+                if (layout == Layout::Interleaved)
+                {
+                    interleavedNs = ns;
+                }
+
+                std::cout << std::setw(12) << GetPassName(pass)
+                    << std::setw(13) << (layout == Layout::Split ? "split" : "interleaved")
+                    << std::setprecision(1)
+                    << std::setw(9) << traffic.UsefulBytes
+                    << std::setw(9) << traffic.FetchedBytes
+                    << std::setw(10) << 100.0 * traffic.UsefulBytes / traffic.FetchedBytes << "%"
+                    << std::setprecision(2)
+                    << std::setw(13) << ns
+                    << std::setw(14) << traffic.FetchedBytes / ns
+                    << std::setw(10) << interleavedNs / ns << "\n";
+            }
+        }
+
+        // Printed so the kernels cannot be optimised away
+        std::cout << "checksum " << std::setprecision(3) << sink + keys[particleCount / 2] << "\n";
+
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
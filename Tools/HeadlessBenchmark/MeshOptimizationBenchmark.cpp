@@ -0,0 +1,176 @@
+// Times Gradient::Rendering::OptimizeMesh, the pass pipeline
+// ProceduralMesh::Initialize runs, on the primitives props are made of,
+// and reports post-transform cache misses (ACMR and ATVR), overdraw and
+// vertex overfetch before it, after the vertex cache pass alone, and
+// after every pass. The primitives come out of their generators in
+// scanline order, which already reuses vertices well, so each is measured
+// with its triangles shuffled too, as meshes loaded from elsewhere often
+// are.
+//
+//  MeshOptimizationBenchmark [--repeats <count>]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "BenchmarkMeshes.h"
+#include "Gradient/Rendering/MeshOptimization.h"
+
+namespace
+{
+    using Gradient::Rendering::MeshOptimizationOptions;
+    using Gradient::Rendering::MeshStatistics;
+    using ISV::BenchmarkMeshes::Mesh;
+
+    Mesh ShuffleTriangles(const Mesh& mesh, std::mt19937& rng)
+    {
+        std::vector<uint32_t> order(mesh.Indices.size() / 3);
+        for (uint32_t i = 0; i < order.size(); i++)
+        {
+            order[i] = i;
+        }
+        std::shuffle(order.begin(), order.end(), rng);
+
+        Mesh shuffled;
+        shuffled.Vertices = mesh.Vertices;
+        shuffled.Indices.reserve(mesh.Indices.size());
+        for (const uint32_t triangle : order)
+        {
+            shuffled.Indices.insert(shuffled.Indices.end(), mesh.Indices.begin() + triangle * 3, mesh.Indices.begin() + triangle * 3 + 3);
+        }
+
+        return shuffled;
+    }
+
+    struct Result
+    {
+        double Ms;
+        MeshStatistics Statistics;
+    };
+
+    // Optimises copies of the mesh, timing only the passes
+    Result Run(const Mesh& mesh, MeshOptimizationOptions options, uint32_t repeats)
+    {
+        options.CollectStatistics = false;
+
+        Mesh optimized;
+        double ms = 0.0;
+
+        for (uint32_t r = 0; r < repeats; r++)
+        {
+            optimized = mesh;
+
+            const auto start = std::chrono::steady_clock::now();
+            Gradient::Rendering::OptimizeMesh(optimized.Vertices, optimized.Indices, options);
+            ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        if (optimized.Indices.size() != mesh.Indices.size())
+        {
+            throw std::runtime_error("Optimisation changed the triangle count");
+        }
+
+        return {
+            ms / repeats,
+            MeshStatistics::Analyze(optimized.Indices.data(),
+                optimized.Indices.size(),
+                optimized.Vertices.data(),
+                optimized.Vertices.size(),
+                sizeof(ISV::BenchmarkMeshes::Vertex))
+        };
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        uint32_t repeats = 10;
+
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--repeats" && i + 1 < argc)
+            {
+                repeats = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else
+            {
+                throw std::runtime_error("Unknown or incomplete option " + arg);
+            }
+        }
+
+        if (repeats == 0)
+        {
+            throw std::runtime_error("Expected at least 1 repeat");
+        }
+
+        const std::pair<const char*, Mesh> generated[] = {
+            { "sphere 16", ISV::BenchmarkMeshes::Sphere(16) },
+            { "sphere 64", ISV::BenchmarkMeshes::Sphere(64) },
+            { "sphere 256", ISV::BenchmarkMeshes::Sphere(256) },
+            { "geosphere 5", ISV::BenchmarkMeshes::GeoSphere(5) },
+            { "box 32", ISV::BenchmarkMeshes::Box(32, 2.f) },
+            { "grid 128", ISV::BenchmarkMeshes::Grid(128, 2.f) },
+        };
+
+        MeshOptimizationOptions cacheOnly;
+        cacheOnly.OptimizeOverdraw = false;
+        cacheOnly.OptimizeVertexFetch = false;
+
+        const MeshOptimizationOptions all;
+
+        std::cout << "ACMR and ATVR with a " << MeshStatistics::CacheSize << " entry FIFO cache; "
+            << "input > vertex cache pass > all passes\n"
+            << std::setw(22) << ""
+            << std::setw(8) << "tris"
+            << std::setw(20) << "ACMR" << std::setw(20) << "ATVR"
+            << std::setw(14) << "overdraw" << std::setw(14) << "overfetch"
+            << std::setw(10) << "cache ms" << std::setw(10) << "all ms" << "\n"
+            << std::fixed << std::setprecision(3);
+
+        std::mt19937 rng(1);
+
+        for (const auto& [name, mesh] : generated)
+        {
+            const Mesh shuffled = ShuffleTriangles(mesh, rng);
+
+            for (const auto& [order, input] : { std::pair<const char*, const Mesh*>{ "", &mesh }, { " shuffled", &shuffled } })
+            {
+                const MeshStatistics before = MeshStatistics::Analyze(input->Indices.data(),
+                    input->Indices.size(),
+                    input->Vertices.data(),
+                    input->Vertices.size(),
+                    sizeof(ISV::BenchmarkMeshes::Vertex));
+
+                const Result cache = Run(*input, cacheOnly, repeats);
+                const Result full = Run(*input, all, repeats);
+
+                std::cout << std::setw(22) << (std::string(name) + order)
+                    << std::setw(8) << before.TriangleCount
+                    << std::setprecision(2)
+                    << std::setw(8) << before.Acmr << std::setw(6) << cache.Statistics.Acmr << std::setw(6) << full.Statistics.Acmr
+                    << std::setw(8) << before.Atvr << std::setw(6) << cache.Statistics.Atvr << std::setw(6) << full.Statistics.Atvr
+                    << std::setw(8) << before.Overdraw << std::setw(6) << full.Statistics.Overdraw
+                    << std::setw(8) << before.Overfetch << std::setw(6) << full.Statistics.Overfetch
+                    << std::setprecision(3)
+                    << std::setw(10) << cache.Ms << std::setw(10) << full.Ms << "\n";
+            }
+        }
+
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,296 @@
+// Times building meshlets with Gradient::Rendering::MeshletData for the
+// primitives props are made of, and measures how many triangles the
+// meshlet cones and bounding spheres cull on the CPU from random views,
+// against the triangles a per-triangle backface test would cull.
+//
+//  MeshletBenchmark [--views <count>] [--repeats <count>]
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "BenchmarkMeshes.h"
+#include "Gradient/Rendering/Meshlets.h"
+
+namespace
+{
+    using Gradient::Rendering::MeshletData;
+    using ISV::BenchmarkMeshes::Mesh;
+    using ISV::BenchmarkMeshes::Vertex;
+    using Float3 = std::array<float, 3>;
+    using Planes = std::array<std::array<float, 4>, 6>;
+
+    Float3 Subtract(const Float3& a, const Float3& b)
+    {
+        return { a[0] - b[0], a[1] - b[1], a[2] - b[2] };
+    }
+
+    Float3 Cross(const Float3& a, const Float3& b)
+    {
+        return { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+    }
+
+    float Dot(const Float3& a, const Float3& b)
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    Float3 Normalise(const Float3& a)
+    {
+        const float length = std::sqrt(Dot(a, a));
+        return { a[0] / length, a[1] / length, a[2] / length };
+    }
+
+    struct View
+    {
+        Float3 Position;
+        Planes Frustum;
+    };
+
+    // A 60 degree, 16:9 perspective camera looking at target
+    View MakeView(const Float3& position, const Float3& target)
+    {
+        constexpr float TanHalfFovY = 0.57735027f;
+        constexpr float TanHalfFovX = TanHalfFovY * 16.f / 9.f;
+        constexpr float Near = 0.1f;
+        constexpr float Far = 100.f;
+
+        const Float3 forward = Normalise(Subtract(target, position));
+        const Float3 worldUp = std::abs(forward[1]) > 0.99f ? Float3{ 1, 0, 0 } : Float3{ 0, 1, 0 };
+        const Float3 right = Normalise(Cross(forward, worldUp));
+        const Float3 up = Cross(right, forward);
+
+        auto plane = [&](const Float3& normal, float offset) -> std::array<float, 4>
+            {
+                return { normal[0], normal[1], normal[2], -Dot(normal, position) + offset };
+            };
+
+        auto side = [&](const Float3& axis, float tanHalfFov, float sign)
+            {
+                const Float3 n = Normalise({
+                    forward[0] * tanHalfFov + sign * axis[0],
+                    forward[1] * tanHalfFov + sign * axis[1],
+                    forward[2] * tanHalfFov + sign * axis[2] });
+                return plane(n, 0.f);
+            };
+
+        return {
+            position,
+            {
+                plane(forward, -Near),
+                plane({ -forward[0], -forward[1], -forward[2] }, Far),
+                side(right, TanHalfFovX, 1.f),
+                side(right, TanHalfFovX, -1.f),
+                side(up, TanHalfFovY, 1.f),
+                side(up, TanHalfFovY, -1.f),
+            }
+        };
+    }
+
+    struct CullResult
+    {
+        uint64_t ConeCulled = 0;
+        uint64_t FrustumCulled = 0;
+        uint64_t Backfacing = 0;
+        double CullUs = 0.0;
+    };
+
+    CullResult Cull(const Mesh& mesh, const MeshletData& meshlets, const std::vector<View>& views)
+    {
+        CullResult result;
+
+        std::vector<Float3> normals;
+        normals.reserve(mesh.Indices.size() / 3);
+        for (std::size_t i = 0; i < mesh.Indices.size(); i += 3)
+        {
+            const Float3& a = mesh.Vertices[mesh.Indices[i]].Position;
+            const Float3& b = mesh.Vertices[mesh.Indices[i + 1]].Position;
+            const Float3& c = mesh.Vertices[mesh.Indices[i + 2]].Position;
+            normals.push_back(Normalise(Cross(Subtract(b, a), Subtract(c, a))));
+        }
+
+        for (const auto& view : views)
+        {
+            const auto start = std::chrono::steady_clock::now();
+
+            uint64_t coneCulled = 0;
+            uint64_t frustumCulled = 0;
+
+            for (const auto& meshlet : meshlets.Meshlets)
+            {
+                if (meshlet.Bounds.IsBackfacing(view.Position))
+                {
+                    coneCulled += meshlet.TriangleCount;
+                }
+                else if (meshlet.Bounds.IsOutsideFrustum(view.Frustum))
+                {
+                    frustumCulled += meshlet.TriangleCount;
+                }
+            }
+
+            result.CullUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+            result.ConeCulled += coneCulled;
+            result.FrustumCulled += frustumCulled;
+
+            // What culling each triangle on its own would remove
+            for (std::size_t t = 0; t < normals.size(); t++)
+            {
+                const Float3& a = mesh.Vertices[mesh.Indices[t * 3]].Position;
+                if (Dot(normals[t], Subtract(a, view.Position)) >= 0.f)
+                {
+                    result.Backfacing++;
+                }
+            }
+
+            // Cones are conservative, so every triangle of a culled
+            // meshlet must face away
+            for (const auto& meshlet : meshlets.Meshlets)
+            {
+                if (!meshlet.Bounds.IsBackfacing(view.Position))
+                    continue;
+
+                for (uint32_t t = 0; t < meshlet.TriangleCount; t++)
+                {
+                    const uint8_t* triangle = &meshlets.Triangles[meshlet.TriangleOffset + t * 3];
+                    const Float3& a = mesh.Vertices[meshlets.VertexIndices[meshlet.VertexOffset + triangle[0]]].Position;
+                    const Float3& b = mesh.Vertices[meshlets.VertexIndices[meshlet.VertexOffset + triangle[1]]].Position;
+                    const Float3& c = mesh.Vertices[meshlets.VertexIndices[meshlet.VertexOffset + triangle[2]]].Position;
+
+                    const Float3 normal = Normalise(Cross(Subtract(b, a), Subtract(c, a)));
+                    if (Dot(normal, Normalise(Subtract(a, view.Position))) < -1e-3f)
+                    {
+                        throw std::runtime_error("A meshlet cone culled a front facing triangle");
+                    }
+                }
+            }
+        }
+
+        result.CullUs /= views.size();
+        return result;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        uint32_t viewCount = 1000;
+        uint32_t repeats = 10;
+
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--views" && i + 1 < argc)
+            {
+                viewCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--repeats" && i + 1 < argc)
+            {
+                repeats = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else
+            {
+                throw std::runtime_error("Unknown or incomplete option " + arg);
+            }
+        }
+
+        if (viewCount == 0 || repeats == 0)
+        {
+            throw std::runtime_error("Expected at least 1 view and 1 repeat");
+        }
+
+        const std::pair<const char*, Mesh> meshes[] = {
+            { "sphere 16", ISV::BenchmarkMeshes::Sphere(16) },
+            { "sphere 64", ISV::BenchmarkMeshes::Sphere(64) },
+            { "sphere 256", ISV::BenchmarkMeshes::Sphere(256) },
+            { "geosphere 5", ISV::BenchmarkMeshes::GeoSphere(5) },
+            { "box 32", ISV::BenchmarkMeshes::Box(32, 2.f) },
+            { "grid 128", ISV::BenchmarkMeshes::Grid(128, 2.f) },
+        };
+
+        // Cameras all around each mesh, 2 to 6 units from its centre, and
+        // aimed off centre so the frustum clips some of it. Every mesh is
+        // 2 units across.
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> unit(-1.f, 1.f);
+        std::uniform_real_distribution<float> distance(2.f, 6.f);
+
+        std::vector<View> views;
+        views.reserve(viewCount);
+        for (uint32_t i = 0; i < viewCount; i++)
+        {
+            const Float3 direction = Normalise({ unit(rng), unit(rng), unit(rng) });
+            const float d = distance(rng);
+            views.push_back(MakeView(
+                { direction[0] * d, direction[1] * d, direction[2] * d },
+                { unit(rng) * 2.f, unit(rng) * 2.f, unit(rng) * 2.f }));
+        }
+
+        std::cout << MeshletData::DefaultMaxVertices << " vertices and "
+            << MeshletData::DefaultMaxTriangles << " triangles per meshlet, "
+            << viewCount << " views\n"
+            << std::setw(14) << ""
+            << std::setw(10) << "tris" << std::setw(10) << "meshlets"
+            << std::setw(10) << "tris/m" << std::setw(10) << "build ms"
+            << std::setw(10) << "cull us"
+            << std::setw(10) << "cone %" << std::setw(10) << "frust %"
+            << std::setw(10) << "total %" << std::setw(10) << "back %" << "\n"
+            << std::fixed;
+
+        for (const auto& [name, mesh] : meshes)
+        {
+            MeshletData meshlets;
+
+            const auto start = std::chrono::steady_clock::now();
+            for (uint32_t r = 0; r < repeats; r++)
+            {
+                meshlets = MeshletData::Build(mesh.Indices.data(),
+                    mesh.Indices.size(),
+                    mesh.Vertices[0].Position.data(),
+                    mesh.Vertices.size(),
+                    sizeof(Vertex));
+            }
+            const auto buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / repeats;
+
+            const uint32_t triangles = static_cast<uint32_t>(mesh.Indices.size() / 3);
+            if (meshlets.GetTriangleCount() != triangles)
+            {
+                throw std::runtime_error(std::string("Meshlets lost triangles of ") + name);
+            }
+
+            const CullResult result = Cull(mesh, meshlets, views);
+            const double total = static_cast<double>(triangles) * views.size() / 100.0;
+
+            std::cout << std::setw(14) << name
+                << std::setw(10) << triangles
+                << std::setw(10) << meshlets.Meshlets.size()
+                << std::setprecision(1)
+                << std::setw(10) << static_cast<double>(triangles) / meshlets.Meshlets.size()
+                << std::setprecision(3)
+                << std::setw(10) << buildMs
+                << std::setprecision(2)
+                << std::setw(10) << result.CullUs
+                << std::setprecision(1)
+                << std::setw(10) << result.ConeCulled / total
+                << std::setw(10) << result.FrustumCulled / total
+                << std::setw(10) << (result.ConeCulled + result.FrustumCulled) / total
+                << std::setw(10) << result.Backfacing / total << "\n";
+        }
+
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
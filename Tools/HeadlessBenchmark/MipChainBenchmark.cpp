@@ -0,0 +1,305 @@
+// Measures what ISV::OpticalThicknessMipChain costs and buys. It reports
+// the chain's size against mip 0 and how long it takes to build. Then it
+// marches random rays through a preset's splatted volume with a fixed
+// number of steps, picking each lookup's LOD from the step length the way
+// VolumetricShadowLod does, at several cone scales. For each it reports:
+//  - the LOD, the same for every step
+//  - the distinct 64 byte cache lines each ray's trilinear fetches touch
+//  - the time per lookup
+//  - the error against a point lookup on mip 0
+//  - the error against the mean optical thickness along the step, which
+//    is what a lookup standing in for the whole step should return
+//
+//  MipChainBenchmark [--preset <file>] [--width <texels>] [--depth <slices>]
+//                    [--rays <count>] [--steps <count>]... [--lod-scale <scale>]...
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "BenchmarkVolumes.h"
+#include "Core/OpticalThicknessMipChain.h"
+
+namespace
+{
+    using ISV::OpticalThicknessMipChain;
+    using Float3 = std::array<float, 3>;
+
+    constexpr uint32_t CacheLineSize = 64;
+    constexpr uint32_t SegmentSamples = 16;
+
+    // The cache lines the eight texels Level::Sample loads fall in, with
+    // each level placed after the one before it in memory
+    void AppendCacheLines(const OpticalThicknessMipChain::Level& level,
+        std::size_t levelOffset,
+        const Float3& uvw,
+        std::vector<std::size_t>& lines)
+    {
+        const std::array<uint32_t, 3> extents = { level.Width, level.Height, level.Depth };
+        std::array<std::array<uint32_t, 2>, 3> indices;
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            const float f = std::clamp(uvw[axis], 0.f, 1.f) * extents[axis] - 0.5f;
+            const int maxIndex = static_cast<int>(extents[axis]) - 1;
+            indices[axis] = {
+                static_cast<uint32_t>(std::clamp(static_cast<int>(std::floor(f)), 0, maxIndex)),
+                static_cast<uint32_t>(std::clamp(static_cast<int>(std::floor(f)) + 1, 0, maxIndex))
+            };
+        }
+
+        for (const uint32_t z : indices[2])
+        {
+            for (const uint32_t y : indices[1])
+            {
+                for (const uint32_t x : indices[0])
+                {
+                    const std::size_t texel = (static_cast<std::size_t>(z) * level.Height + y) * level.Width + x;
+                    lines.push_back((levelOffset + texel * sizeof(float)) / CacheLineSize);
+                }
+            }
+        }
+    }
+
+    struct Ray
+    {
+        Float3 Origin;
+        Float3 Direction;
+    };
+
+    struct Result
+    {
+        double Lod = 0.0;
+        double LinesPerRay = 0.0;
+        double NsPerLookup = 0.0;
+        double ErrorToMip0 = 0.0;
+        double ErrorToStepMean = 0.0;
+        double TransmittanceErrorToStepMean = 0.0;
+    };
+
+    Result March(const OpticalThicknessMipChain& chain,
+        const std::vector<Ray>& rays,
+        uint32_t steps,
+        float lodScale)
+    {
+        Result result;
+
+        const auto& base = chain.GetLevel(0);
+        const float stepLength = 1.f / steps;
+        // Footprint and texel size in the same units, so the scene radius
+        // cancels out
+        const float lod = OpticalThicknessMipChain::SelectLod(stepLength, 1.f / base.Width, lodScale, chain.GetMipCount());
+        const uint32_t lower = static_cast<uint32_t>(std::floor(lod));
+        const uint32_t upper = std::min(lower + 1, chain.GetMipCount() - 1);
+
+        std::vector<std::size_t> levelOffsets(chain.GetMipCount(), 0);
+        for (uint32_t mip = 1; mip < chain.GetMipCount(); mip++)
+        {
+            levelOffsets[mip] = levelOffsets[mip - 1] + chain.GetLevel(mip - 1).GetSizeInBytes();
+        }
+
+        auto point = [&](const Ray& ray, float t) -> Float3
+            {
+                return {
+                    ray.Origin[0] + ray.Direction[0] * t,
+                    ray.Origin[1] + ray.Direction[1] * t,
+                    ray.Origin[2] + ray.Direction[2] * t
+                };
+            };
+
+        std::vector<float> values(rays.size() * steps);
+
+        auto lookup = [&]()
+            {
+                for (std::size_t r = 0; r < rays.size(); r++)
+                {
+                    for (uint32_t s = 0; s < steps; s++)
+                    {
+                        const Float3 p = point(rays[r], (s + 0.5f) * stepLength);
+                        values[r * steps + s] = chain.SampleLevel(p[0], p[1], p[2], lod);
+                    }
+                }
+            };
+
+        // Once to warm the caches, then timed
+        lookup();
+        const auto start = std::chrono::steady_clock::now();
+        lookup();
+        result.NsPerLookup = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / values.size();
+
+        std::vector<std::size_t> lines;
+        std::size_t lineCount = 0;
+
+        for (std::size_t r = 0; r < rays.size(); r++)
+        {
+            lines.clear();
+
+            for (uint32_t s = 0; s < steps; s++)
+            {
+                const Float3 p = point(rays[r], (s + 0.5f) * stepLength);
+                const float value = values[r * steps + s];
+
+                AppendCacheLines(chain.GetLevel(lower), levelOffsets[lower], p, lines);
+                if (upper != lower && lod != static_cast<float>(lower))
+                {
+                    AppendCacheLines(chain.GetLevel(upper), levelOffsets[upper], p, lines);
+                }
+
+                float stepMean = 0.f;
+                for (uint32_t i = 0; i < SegmentSamples; i++)
+                {
+                    const Float3 q = point(rays[r], (s + (i + 0.5f) / SegmentSamples) * stepLength);
+                    stepMean += base.Sample(q[0], q[1], q[2]);
+                }
+                stepMean /= SegmentSamples;
+
+                result.ErrorToMip0 += std::abs(value - base.Sample(p[0], p[1], p[2]));
+                result.ErrorToStepMean += std::abs(value - stepMean);
+                result.TransmittanceErrorToStepMean += std::abs(std::exp(-value) - std::exp(-stepMean));
+            }
+
+            std::sort(lines.begin(), lines.end());
+            lineCount += std::unique(lines.begin(), lines.end()) - lines.begin();
+        }
+
+        result.Lod = lod;
+        result.LinesPerRay = static_cast<double>(lineCount) / rays.size();
+        result.ErrorToMip0 /= values.size();
+        result.ErrorToStepMean /= values.size();
+        result.TransmittanceErrorToStepMean /= values.size();
+        return result;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        std::string presetPath;
+        uint32_t width = 256;
+        uint32_t depth = 10;
+        uint32_t rayCount = 4096;
+        std::vector<uint32_t> stepCounts;
+        std::vector<float> lodScales;
+
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--preset" && i + 1 < argc)
+            {
+                presetPath = argv[++i];
+            }
+            else if (arg == "--width" && i + 1 < argc)
+            {
+                width = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--depth" && i + 1 < argc)
+            {
+                depth = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--rays" && i + 1 < argc)
+            {
+                rayCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--steps" && i + 1 < argc)
+            {
+                stepCounts.push_back(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+            }
+            else if (arg == "--lod-scale" && i + 1 < argc)
+            {
+                lodScales.push_back(std::strtof(argv[++i], nullptr));
+            }
+            else
+            {
+                throw std::runtime_error("Unknown or incomplete option " + arg);
+            }
+        }
+
+        if (stepCounts.empty())
+        {
+            stepCounts = { 4, 16, 64 };
+        }
+
+        if (lodScales.empty())
+        {
+            lodScales = { 0.f, 0.5f, 1.f, 2.f };
+        }
+
+        if (width == 0 || depth < 2 || rayCount == 0
+            || std::find(stepCounts.begin(), stepCounts.end(), 0u) != stepCounts.end())
+        {
+            throw std::runtime_error("Expected a width, at least 2 slices, rays and steps");
+        }
+
+        const ISV::ScenePreset preset = ISV::BenchmarkVolumes::LoadPreset(presetPath);
+        const auto volume = ISV::BenchmarkVolumes::Splat(preset, width, depth);
+
+        const auto start = std::chrono::steady_clock::now();
+        const OpticalThicknessMipChain chain(volume.Texels.data(), width, width, depth);
+        const double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        // Rays a unit long in volume coordinates, from anywhere in the
+        // volume in any direction. Lookups past the edges are clamped.
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> unit(0.f, 1.f);
+        std::normal_distribution<float> normal;
+
+        std::vector<Ray> rays(rayCount);
+        for (auto& ray : rays)
+        {
+            ray.Origin = { unit(rng), unit(rng), unit(rng) };
+            Float3 direction = { normal(rng), normal(rng), normal(rng) };
+            const float length = std::max(1e-6f, std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]));
+            ray.Direction = { direction[0] / length, direction[1] / length, direction[2] / length };
+        }
+
+        std::cout << preset.Name << ", " << width << "x" << width << "x" << depth << ", "
+            << chain.GetMipCount() << " mips, "
+            << std::fixed << std::setprecision(2)
+            << chain.GetLevel(0).GetSizeInBytes() / (1024.0 * 1024.0) << " MB at mip 0, "
+            << chain.GetSizeInBytes() / (1024.0 * 1024.0) << " MB with the chain ("
+            << std::setprecision(1) << 100.0 * (chain.GetSizeInBytes() - chain.GetLevel(0).GetSizeInBytes()) / chain.GetLevel(0).GetSizeInBytes()
+            << "% more), built in " << buildMs << " ms, " << rayCount << " rays\n"
+            << std::setw(8) << "steps" << std::setw(8) << "scale"
+            << std::setw(8) << "LOD" << std::setw(12) << "lines/ray"
+            << std::setw(12) << "ns/lookup"
+            << std::setw(14) << "OT vs mip 0" << std::setw(14) << "OT vs step" << std::setw(14) << "T vs step" << "\n";
+
+        for (const uint32_t steps : stepCounts)
+        {
+            for (const float lodScale : lodScales)
+            {
+                const Result result = March(chain, rays, steps, lodScale);
+
+                std::cout << std::setw(8) << steps
+                    << std::setprecision(2)
+                    << std::setw(8) << lodScale
+                    << std::setw(8) << result.Lod
+                    << std::setprecision(1)
+                    << std::setw(12) << result.LinesPerRay
+                    << std::setw(12) << result.NsPerLookup
+                    << std::setprecision(5)
+                    << std::setw(14) << result.ErrorToMip0
+                    << std::setw(14) << result.ErrorToStepMean
+                    << std::setw(14) << result.TransmittanceErrorToStepMean << "\n";
+            }
+        }
+
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
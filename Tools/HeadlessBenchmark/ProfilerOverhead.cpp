@@ -0,0 +1,159 @@
+// Measures what an ISV_PROFILE_ZONE costs, enabled and disabled, and
+// fails if an enabled zone takes longer than the budget.
+//
+//  ProfilerOverhead [--zones <count>] [--budget <ns>] [--trace <file>]
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Core/Profiler.h"
+
+namespace
+{
+    volatile uint64_t g_sink = 0;
+
+    // Keeps the loop body from being optimised away without adding much
+    // work of its own
+    void Work(uint64_t i)
+    {
+        g_sink = g_sink + i;
+    }
+
+    double MeasureNs(uint64_t zones, bool withZone)
+    {
+        const uint64_t start = ISV::Profiler::Now();
+
+        for (uint64_t i = 0; i < zones; i++)
+        {
+            if (withZone)
+            {
+                ISV_PROFILE_ZONE("Zone");
+                Work(i);
+            }
+            else
+            {
+                Work(i);
+            }
+        }
+
+        return static_cast<double>(ISV::Profiler::Now() - start) / zones;
+    }
+
+    double MeasureNestedNs(uint64_t zones)
+    {
+        const uint64_t start = ISV::Profiler::Now();
+
+        for (uint64_t i = 0; i < zones / 4; i++)
+        {
+            ISV_PROFILE_ZONE("Outer");
+            {
+                ISV_PROFILE_ZONE("Middle");
+                {
+                    ISV_PROFILE_ZONE("Inner");
+                    Work(i);
+                }
+                ISV_PROFILE_ZONE("Sibling");
+                Work(i);
+            }
+        }
+
+        return static_cast<double>(ISV::Profiler::Now() - start) / (zones / 4 * 4);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        uint64_t zones = 20'000'000;
+        double budgetNs = 50.0;
+        std::string tracePath;
+
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--zones" && i + 1 < argc)
+            {
+                zones = std::strtoull(argv[++i], nullptr, 10);
+            }
+            else if (arg == "--budget" && i + 1 < argc)
+            {
+                budgetNs = std::strtod(argv[++i], nullptr);
+            }
+            else if (arg == "--trace" && i + 1 < argc)
+            {
+                tracePath = argv[++i];
+            }
+            else
+            {
+                throw std::runtime_error("Unknown or incomplete option " + arg);
+            }
+        }
+
+        zones = std::max<uint64_t>(zones, 4);
+
+        auto& profiler = ISV::Profiler::Get();
+
+        // Warm up the clock and the thread's buffer
+        profiler.SetEnabled(true);
+        MeasureNs(zones / 10, true);
+
+        const double baselineNs = MeasureNs(zones, false);
+
+        profiler.SetEnabled(false);
+        const double disabledNs = MeasureNs(zones, true) - baselineNs;
+
+        profiler.SetEnabled(true);
+        const double enabledNs = MeasureNs(zones, true) - baselineNs;
+        const double nestedNs = MeasureNestedNs(zones) - baselineNs;
+
+        // Zones on worker threads, to exercise the per-thread buffers
+        std::vector<std::thread> workers;
+        for (int t = 0; t < 4; t++)
+        {
+            workers.emplace_back([]()
+                {
+                    ISV_PROFILE_ZONE("Worker");
+                    MeasureNestedNs(1000);
+                });
+        }
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+
+        profiler.SetEnabled(false);
+
+        std::cout << "Loop body:     " << baselineNs << " ns\n"
+            << "Disabled zone: " << disabledNs << " ns\n"
+            << "Enabled zone:  " << enabledNs << " ns\n"
+            << "Nested zones:  " << nestedNs << " ns per zone\n"
+            << "Events kept:   " << profiler.Collect().size() << std::endl;
+
+        if (!tracePath.empty())
+        {
+            profiler.WriteChromeTrace(tracePath);
+            std::cout << "Wrote " << tracePath << std::endl;
+        }
+
+        if (enabledNs > budgetNs || nestedNs > budgetNs)
+        {
+            std::cerr << "Zone overhead is over the " << budgetNs << " ns budget" << std::endl;
+            return 1;
+        }
+
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,184 @@
+// Measures the cost of one simulated second of ISV::ParticleSimulation, the
+// CPU mirror of SimulateParticles_CS, at several substep counts. Each run
+// starts from a preset's particles and advances at 60 frames a second,
+// firing a bullet through the cloud twice a second. Besides the cost it
+// reports how far the particles end up from the run with the most
+// substeps, as a measure of what the extra substeps buy.
+//
+//  SimulationBenchmark [--preset <file>] [--particles <count>]...
+//                      [--substeps <count>]... [--seconds <simulated>]
+//                      [--interaction-radius <radius>]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "CpuFrame.h"
+#include "Core/ParticleSimulation.h"
+
+namespace
+{
+    using ISV::ParticleSimulation;
+
+    struct Result
+    {
+        double Ms = 0.0;
+        uint64_t Steps = 0;
+        std::vector<ParticleSimulation::Particle> Particles;
+    };
+
+    Result Run(const ISV::ScenePreset& preset, uint32_t substeps, double seconds, float interactionRadius)
+    {
+        auto settings = ISV::Detail::GetSimulationSettings(preset);
+        settings.Substeps = substeps;
+        if (interactionRadius > 0.f)
+        {
+            settings.InteractionRadius = interactionRadius;
+            settings.SeparationStrength = 1.f;
+            settings.CohesionStrength = 0.1f;
+        }
+
+        ParticleSimulation simulation(ISV::Detail::CreateParticles(preset.ParticleCount, 1), settings);
+
+        constexpr double FrameTime = 1.0 / 60.0;
+        const auto frames = static_cast<uint32_t>(std::round(seconds / FrameTime));
+
+        Result result;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t frame = 0; frame < frames; frame++)
+        {
+            ParticleSimulation::StepInput input;
+            input.DidShoot = frame % 30 == 0;
+            input.ShootRayStart = { -20.f, 6.f, -20.f };
+            input.ShootRayEnd = { 20.f, 6.f, 20.f };
+
+            result.Steps += simulation.Advance(FrameTime, input);
+        }
+        result.Ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        result.Particles = simulation.GetParticles();
+
+        return result;
+    }
+
+    double MeanDistance(const std::vector<ParticleSimulation::Particle>& a,
+        const std::vector<ParticleSimulation::Particle>& b)
+    {
+        double sum = 0.0;
+        for (std::size_t i = 0; i < a.size(); i++)
+        {
+            const double dx = a[i].Position[0] - b[i].Position[0];
+            const double dy = a[i].Position[1] - b[i].Position[1];
+            const double dz = a[i].Position[2] - b[i].Position[2];
+            sum += std::sqrt(dx * dx + dy * dy + dz * dz);
+        }
+
+        return a.empty() ? 0.0 : sum / a.size();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        std::string presetPath;
+        std::vector<uint32_t> particleCounts;
+        std::vector<uint32_t> substepCounts;
+        double seconds = 2.0;
+        float interactionRadius = 0.f;
+
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--preset" && i + 1 < argc)
+            {
+                presetPath = argv[++i];
+            }
+            else if (arg == "--particles" && i + 1 < argc)
+            {
+                particleCounts.push_back(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+            }
+            else if (arg == "--substeps" && i + 1 < argc)
+            {
+                substepCounts.push_back(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+            }
+            else if (arg == "--seconds" && i + 1 < argc)
+            {
+                seconds = std::strtod(argv[++i], nullptr);
+            }
+            else if (arg == "--interaction-radius" && i + 1 < argc)
+            {
+                interactionRadius = std::strtof(argv[++i], nullptr);
+            }
+            else
+            {
+                throw std::runtime_error("Unknown or incomplete option " + arg);
+            }
+        }
+
+        if (particleCounts.empty())
+        {
+            particleCounts = { 4000, 65536 };
+        }
+
+        if (substepCounts.empty())
+        {
+            substepCounts = { 1, 2, 4, 8 };
+        }
+
+        if (seconds <= 0.0 || std::find(substepCounts.begin(), substepCounts.end(), 0u) != substepCounts.end())
+        {
+            throw std::runtime_error("Expected a positive duration and at least 1 substep");
+        }
+
+        ISV::ScenePreset preset = presetPath.empty() ? ISV::ScenePreset() : ISV::ScenePreset::Load(presetPath);
+        const uint32_t finest = *std::max_element(substepCounts.begin(), substepCounts.end());
+
+        std::cout << preset.Name << ", " << preset.SimulationRate << " Hz, "
+            << seconds << " simulated seconds"
+            << (interactionRadius > 0.f ? ", with interactions" : "") << "\n"
+            << std::setw(10) << "particles" << std::setw(10) << "substeps"
+            << std::setw(8) << "steps"
+            << std::setw(14) << "ms per sim s" << std::setw(14) << "ns per p-sub"
+            << std::setw(16) << "drift vs " + std::to_string(finest) << "\n"
+            << std::fixed;
+
+        for (const uint32_t particleCount : particleCounts)
+        {
+            preset.ParticleCount = particleCount;
+
+            const Result reference = Run(preset, finest, seconds, interactionRadius);
+
+            for (const uint32_t substeps : substepCounts)
+            {
+                const Result result = substeps == finest ? reference : Run(preset, substeps, seconds, interactionRadius);
+                const double msPerSecond = result.Ms / seconds;
+                const double substepsRun = static_cast<double>(result.Steps) * substeps;
+
+                std::cout << std::setw(10) << particleCount
+                    << std::setw(10) << substeps
+                    << std::setw(8) << result.Steps
+                    << std::setprecision(1)
+                    << std::setw(14) << msPerSecond
+                    << std::setw(14) << result.Ms * 1e6 / (substepsRun * particleCount)
+                    << std::setprecision(4)
+                    << std::setw(16) << MeanDistance(result.Particles, reference.Particles) << "\n";
+            }
+        }
+
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
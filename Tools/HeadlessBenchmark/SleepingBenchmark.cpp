@@ -0,0 +1,158 @@
+// Measures ISV::ParticleSimulation throughput against the fraction of
+// particles asleep. Each run restores a checkpoint in which that fraction
+// of the particles, picked at random, has been calm for SleepSteps steps,
+// so they start asleep and stay asleep while nothing wakes them. The
+// throughput counts every particle, asleep or not, per substep, and is
+// compared with the same simulation with sleeping turned off, which skips
+// the classification pass entirely.
+//
+//  SleepingBenchmark [--particles <count>] [--steps <count>] [--asleep <percent>]...
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "CpuFrame.h"
+#include "Core/ParticleSimulation.h"
+
+namespace
+{
+    using ISV::ParticleSimulation;
+
+    struct Result
+    {
+        double Ms = 0.0;
+        double AsleepFraction = 0.0;
+    };
+
+    Result Run(ParticleSimulation& simulation, uint32_t steps)
+    {
+        const ParticleSimulation::StepInput input;
+        const double count = static_cast<double>(simulation.GetParticles().size());
+
+        Result result;
+
+        for (uint32_t s = 0; s < steps; s++)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            simulation.Step(input);
+            result.Ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            result.AsleepFraction += 1.0 - simulation.GetActiveIndices().size() / count;
+        }
+
+        result.AsleepFraction /= steps;
+        return result;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        uint32_t particleCount = 100000;
+        uint32_t steps = 120;
+        std::vector<double> asleepPercents;
+
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--particles" && i + 1 < argc)
+            {
+                particleCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--steps" && i + 1 < argc)
+            {
+                steps = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--asleep" && i + 1 < argc)
+            {
+                asleepPercents.push_back(std::strtod(argv[++i], nullptr));
+            }
+            else
+            {
+                throw std::runtime_error("Unknown or incomplete option " + arg);
+            }
+        }
+
+        if (asleepPercents.empty())
+        {
+            asleepPercents = { 0, 50, 75, 90, 99 };
+        }
+
+        if (particleCount == 0 || steps == 0)
+        {
+            throw std::runtime_error("Expected particles and steps");
+        }
+
+        ISV::ScenePreset preset;
+        preset.ParticleCount = particleCount;
+        preset.ParticleSleeping = true;
+
+        const auto particles = ISV::Detail::CreateParticles(particleCount, 1);
+        const auto settings = ISV::Detail::GetSimulationSettings(preset);
+
+        auto awakeSettings = settings;
+        awakeSettings.SleepSteps = 0;
+        ParticleSimulation awake(particles, awakeSettings);
+        const Result baseline = Run(awake, steps);
+        const double baselineRate = static_cast<double>(particleCount) * steps / baseline.Ms / 1e3;
+
+        std::cout << particleCount << " particles, " << steps << " steps, "
+            << settings.SleepSteps << " calm steps to sleep\n"
+            << std::setw(10) << "asleep %" << std::setw(10) << "actual %"
+            << std::setw(10) << "ms/step" << std::setw(16) << "Mparticle-st/s"
+            << std::setw(10) << "speedup" << "\n"
+            << std::fixed << std::setprecision(2)
+            << std::setw(10) << "off" << std::setw(10) << 0.0
+            << std::setw(10) << baseline.Ms / steps
+            << std::setw(16) << baselineRate
+            << std::setw(10) << 1.0 << "\n";
+
+        ParticleSimulation simulation(particles, settings);
+        const auto initial = simulation.Save();
+
+        std::vector<uint32_t> order(particleCount);
+        std::iota(order.begin(), order.end(), 0u);
+        std::mt19937 rng(1);
+        std::shuffle(order.begin(), order.end(), rng);
+
+        for (const double percent : asleepPercents)
+        {
+            auto checkpoint = initial;
+            const auto asleepCount = static_cast<uint32_t>(std::clamp(percent, 0.0, 100.0) / 100.0 * particleCount);
+
+            for (uint32_t i = 0; i < asleepCount; i++)
+            {
+                checkpoint.Particles[order[i]].Velocity = { 0.f, 0.f, 0.f };
+                checkpoint.Activity[order[i]] = { { 0.f, 0.f, 0.f }, settings.SleepSteps };
+            }
+
+            simulation.Restore(checkpoint);
+            const Result result = Run(simulation, steps);
+            const double rate = static_cast<double>(particleCount) * steps / result.Ms / 1e3;
+
+            std::cout << std::setw(10) << percent
+                << std::setw(10) << result.AsleepFraction * 100.0
+                << std::setw(10) << result.Ms / steps
+                << std::setw(16) << rate
+                << std::setw(10) << rate / baselineRate << "\n";
+        }
+
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,315 @@
+// Writes a multi-GB ISV::ParticleSnapshot from a running simulation and
+// measures how fast it loads back:
+//  - decoding every frame in order with Reader::ReadFrame
+//  - reading every keyframe in place through Reader::GetKeyframeView,
+//    with and without MappedFile::Prefetch ahead of it
+//  - decoding random frames, each from its keyframe
+// The in order and in place reads run twice, once with the file evicted
+// from the page cache where the platform allows it and once warm. The tool
+// fails if the last frame decodes differently from how it was written.
+//
+//  SnapshotBenchmark [--output <file>] [--particles <count>] [--size-gb <size>]
+//                    [--keyframe-interval <frames>] [--random <frames>] [--keep]
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "CpuFrame.h"
+#include "Core/InstanceLayout.h"
+#include "Core/ParticleSimulation.h"
+#include "Core/ParticleSnapshot.h"
+
+namespace
+{
+    using ISV::ParticleSnapshot;
+    using Clock = std::chrono::steady_clock;
+
+    // About the size of Game's Constants
+    constexpr uint32_t ConstantsSize = 256;
+
+    double SecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // Drops the file's pages from the page cache so the next read comes
+    // from disk. Returns false where that isn't supported.
+    bool Evict(const std::string& path)
+    {
+#ifdef _WIN32
+        (void)path;
+        return false;
+#else
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        const bool evicted = fdatasync(fd) == 0 && posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+        close(fd);
+        return evicted;
+#endif
+    }
+
+    double SequentialDecode(const std::string& path)
+    {
+        ParticleSnapshot::Reader reader(path);
+
+        const auto start = Clock::now();
+        for (uint32_t f = 0; f < reader.GetFrameCount(); f++)
+        {
+            reader.ReadFrame(f);
+        }
+        return SecondsSince(start);
+    }
+
+    // Sums every element of every keyframe, so each page is read
+    double KeyframeViews(const std::string& path, bool prefetch, double& sink)
+    {
+        ParticleSnapshot::Reader reader(path);
+
+        std::vector<uint32_t> keyframes;
+        for (uint32_t f = 0; f < reader.GetFrameCount(); f++)
+        {
+            if (reader.IsKeyframe(f))
+            {
+                keyframes.push_back(f);
+            }
+        }
+
+        const auto start = Clock::now();
+        for (std::size_t k = 0; k < keyframes.size(); k++)
+        {
+            if (prefetch && k + 1 < keyframes.size())
+            {
+                const auto& next = reader.GetRecord(keyframes[k + 1]);
+                reader.GetFile().Prefetch(static_cast<std::size_t>(next.Offset), static_cast<std::size_t>(next.Size));
+            }
+
+            const auto view = reader.GetKeyframeView(keyframes[k]);
+            float sum = 0.f;
+            for (uint32_t i = 0; i < view.ParticleCount; i++)
+            {
+                sum += view.Positions[i][0] + view.Positions[i][1] + view.Positions[i][2]
+                    + view.Scales[i] + view.Rotations[i][3] + view.ExtinctionScales[i];
+            }
+            sink += sum;
+        }
+        return SecondsSince(start);
+    }
+
+    // The writer turns deltas bigger than a keyframe into keyframes, so
+    // count them from the index
+    uint64_t KeyframeBytes(const std::string& path, uint32_t& count)
+    {
+        ParticleSnapshot::Reader reader(path);
+
+        uint64_t bytes = 0;
+        count = 0;
+        for (uint32_t f = 0; f < reader.GetFrameCount(); f++)
+        {
+            if (reader.IsKeyframe(f))
+            {
+                bytes += reader.GetRecord(f).Size;
+                count++;
+            }
+        }
+        return bytes;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        std::string path = (std::filesystem::temp_directory_path() / "SnapshotBenchmark.isvsnap").string();
+        uint32_t particleCount = 1000000;
+        double sizeGb = 2.0;
+        uint32_t keyframeInterval = 30;
+        uint32_t randomFrames = 16;
+        bool keep = false;
+
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--output" && i + 1 < argc)
+            {
+                path = argv[++i];
+            }
+            else if (arg == "--particles" && i + 1 < argc)
+            {
+                particleCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--size-gb" && i + 1 < argc)
+            {
+                sizeGb = std::strtod(argv[++i], nullptr);
+            }
+            else if (arg == "--keyframe-interval" && i + 1 < argc)
+            {
+                keyframeInterval = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--random" && i + 1 < argc)
+            {
+                randomFrames = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--keep")
+            {
+                keep = true;
+            }
+            else
+            {
+                throw std::runtime_error("Unknown or incomplete option " + arg);
+            }
+        }
+
+        if (particleCount == 0 || sizeGb <= 0.0 || keyframeInterval == 0)
+        {
+            throw std::runtime_error("Expected particles, a size and a keyframe interval");
+        }
+
+        const uint64_t targetBytes = static_cast<uint64_t>(sizeGb * 1024.0 * 1024.0 * 1024.0);
+
+        // Write frames from the simulation until the file is big enough
+        ISV::ScenePreset preset;
+        preset.ParticleCount = particleCount;
+        preset.ParticleSleeping = true;
+
+        ISV::ParticleSimulation simulation(ISV::Detail::CreateParticles(particleCount, 1),
+            ISV::Detail::GetSimulationSettings(preset));
+
+        std::vector<ISV::InstanceLayout::RenderInstance> instances;
+        std::vector<ISV::InstanceLayout::SimulationInstance> simulationInstances;
+        std::array<uint8_t, ConstantsSize> constants = {};
+
+        double writeSeconds = 0.0;
+        uint32_t frameCount = 0;
+        {
+            ParticleSnapshot::Writer writer(path, particleCount, ConstantsSize, keyframeInterval);
+
+            while (writer.GetBytesWritten() < targetBytes)
+            {
+                simulation.Advance(1.0 / 60.0, {});
+                ISV::InstanceLayout::Split(simulation.GetParticles(), instances, simulationInstances);
+
+                const uint32_t frame = writer.GetFrameCount();
+                std::memcpy(constants.data(), &frame, sizeof(frame));
+
+                const auto start = Clock::now();
+                writer.WriteFrame(instances.data(), constants.data());
+                writeSeconds += SecondsSince(start);
+            }
+
+            const auto start = Clock::now();
+            writer.Close();
+            writeSeconds += SecondsSince(start);
+
+            frameCount = writer.GetFrameCount();
+        }
+
+        const double gb = std::filesystem::file_size(path) / (1024.0 * 1024.0 * 1024.0);
+        uint32_t keyframeCount = 0;
+        const double keyframeGb = KeyframeBytes(path, keyframeCount) / (1024.0 * 1024.0 * 1024.0);
+
+        std::cout << particleCount << " particles, " << frameCount << " frames, "
+            << keyframeCount << " keyframes, " << std::fixed << std::setprecision(2) << gb << " GB ("
+            << keyframeGb << " GB of keyframes), written at " << gb / writeSeconds << " GB/s\n"
+            << std::setw(26) << "read" << std::setw(8) << "cache"
+            << std::setw(10) << "s" << std::setw(10) << "GB/s" << std::setw(12) << "frames/s" << "\n";
+
+        double sink = 0.0;
+
+        auto print = [&](const char* name, const char* cache, double seconds, double bytes, double frames)
+            {
+                std::cout << std::setw(26) << name << std::setw(8) << cache
+                    << std::setprecision(3) << std::setw(10) << seconds
+                    << std::setprecision(2) << std::setw(10) << bytes / seconds
+                    << std::setprecision(1) << std::setw(12) << frames / seconds << "\n";
+            };
+
+        for (const bool cold : { true, false })
+        {
+            if (cold && !Evict(path))
+            {
+                std::cout << "Can't evict the file from the page cache here, skipping cold reads\n";
+                continue;
+            }
+
+            print("ReadFrame in order", cold ? "cold" : "warm", SequentialDecode(path), gb, frameCount);
+
+            if (cold)
+            {
+                Evict(path);
+            }
+            print("keyframe views", cold ? "cold" : "warm", KeyframeViews(path, false, sink), keyframeGb, keyframeCount);
+
+            if (cold)
+            {
+                Evict(path);
+            }
+            print("keyframe views, prefetch", cold ? "cold" : "warm", KeyframeViews(path, true, sink), keyframeGb, keyframeCount);
+        }
+
+        // Random access, each frame decoded from its keyframe
+        {
+            ParticleSnapshot::Reader reader(path);
+            std::mt19937 rng(1);
+            std::uniform_int_distribution<uint32_t> frames(0, frameCount - 1);
+
+            uint64_t deltasApplied = 0;
+            const auto start = Clock::now();
+            for (uint32_t r = 0; r < randomFrames; r++)
+            {
+                const uint32_t frame = frames(rng);
+                deltasApplied += frame - reader.GetRecord(frame).Keyframe;
+                reader.ReadFrame(frame);
+            }
+            const double seconds = SecondsSince(start);
+
+            std::cout << std::setw(26) << "ReadFrame at random" << std::setw(8) << "warm"
+                << std::setprecision(3) << std::setw(10) << seconds
+                << std::setw(10) << "-"
+                << std::setprecision(1) << std::setw(12) << randomFrames / seconds
+                << "  (" << static_cast<double>(deltasApplied) / std::max(1u, randomFrames) << " deltas each)\n";
+
+            // The writer's last frame is still in instances
+            const auto& decoded = reader.ReadFrame(frameCount - 1);
+            std::vector<ISV::InstanceLayout::RenderInstance> last;
+            decoded.GetInstances(last);
+
+            if (std::memcmp(last.data(), instances.data(), instances.size() * sizeof(instances[0])) != 0)
+            {
+                throw std::runtime_error("The last frame decoded differently from how it was written");
+            }
+        }
+
+        std::cout << "checksum " << std::setprecision(1) << sink << "\n";
+
+        if (!keep)
+        {
+            std::filesystem::remove(path);
+        }
+
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,222 @@
+// Compares the memory and fill time of ISV::SparseOpticalThicknessVolume
+// with a dense volume of the same size, for a preset's particles. Each
+// column's cumulative optical thickness rises linearly from the nearest
+// particle's front to the furthest particle's back, up to the column's
+// total, so it is zero wherever no particle's footprint reaches. Filling
+// the sparse volume that way must touch every non-zero texel, and the
+// tool fails if any lookup disagrees with the dense volume.
+//
+//  SparseVolumeBenchmark [--preset <file>] [--size <width>x<height>x<depth>]...
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "BenchmarkVolumes.h"
+#include "Core/SparseOpticalThicknessVolume.h"
+
+namespace
+{
+    using ISV::SparseOpticalThicknessVolume;
+    using ISV::BenchmarkVolumes::LightSpaceSphere;
+    using Clock = std::chrono::steady_clock;
+
+    struct Size
+    {
+        uint32_t Width;
+        uint32_t Height;
+        uint32_t Depth;
+    };
+
+    // Where each column's optical thickness starts and stops rising, in
+    // normalised light depth, and how much it holds at the back
+    class Columns
+    {
+    public:
+        Columns(const std::vector<LightSpaceSphere>& spheres, float sceneDepth, const Size& size)
+            : m_size(size),
+            m_start(static_cast<std::size_t>(size.Width) * size.Height, 1.f),
+            m_end(m_start.size(), 0.f),
+            m_total(m_start.size(), 0.f)
+        {
+            for (const auto& sphere : spheres)
+            {
+                const int x0 = std::max(0, static_cast<int>(std::floor((sphere.Centre[0] - sphere.Radius) * size.Width)));
+                const int x1 = std::min(static_cast<int>(size.Width) - 1, static_cast<int>(std::ceil((sphere.Centre[0] + sphere.Radius) * size.Width)));
+                const int y0 = std::max(0, static_cast<int>(std::floor((sphere.Centre[1] - sphere.Radius) * size.Height)));
+                const int y1 = std::min(static_cast<int>(size.Height) - 1, static_cast<int>(std::ceil((sphere.Centre[1] + sphere.Radius) * size.Height)));
+
+                for (int y = y0; y <= y1; y++)
+                {
+                    for (int x = x0; x <= x1; x++)
+                    {
+                        const float du = (x + 0.5f) / size.Width - sphere.Centre[0];
+                        const float dv = (y + 0.5f) / size.Height - sphere.Centre[1];
+                        const float squared = sphere.Radius * sphere.Radius - du * du - dv * dv;
+                        if (squared <= 0.f)
+                            continue;
+
+                        const float halfChord = std::sqrt(squared);
+                        const std::size_t column = static_cast<std::size_t>(y) * size.Width + x;
+                        m_start[column] = std::min(m_start[column], std::max(0.f, sphere.Centre[2] - halfChord));
+                        m_end[column] = std::max(m_end[column], sphere.Centre[2] + halfChord);
+                        m_total[column] += sphere.Extinction * 2 * halfChord * sceneDepth;
+                    }
+                }
+            }
+        }
+
+        float operator()(uint32_t x, uint32_t y, uint32_t z) const
+        {
+            const std::size_t column = static_cast<std::size_t>(y) * m_size.Width + x;
+            const float w = (z + 0.5f) / m_size.Depth;
+            if (m_total[column] == 0.f || w <= m_start[column])
+                return 0.f;
+
+            return m_total[column] * std::min(1.f, (w - m_start[column]) / (m_end[column] - m_start[column]));
+        }
+
+    private:
+        Size m_size;
+        std::vector<float> m_start;
+        std::vector<float> m_end;
+        std::vector<float> m_total;
+    };
+
+    double MsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        std::string presetPath;
+        std::vector<Size> sizes;
+
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            Size size;
+            if (arg == "--preset" && i + 1 < argc)
+            {
+                presetPath = argv[++i];
+            }
+            else if (arg == "--size" && i + 1 < argc
+                && std::sscanf(argv[++i], "%ux%ux%u", &size.Width, &size.Height, &size.Depth) == 3)
+            {
+                sizes.push_back(size);
+            }
+            else
+            {
+                throw std::runtime_error("Unknown or incomplete option " + arg);
+            }
+        }
+
+        if (sizes.empty())
+        {
+            sizes = { { 512, 512, 512 }, { 1024, 1024, 64 } };
+        }
+
+        const ISV::ScenePreset preset = ISV::BenchmarkVolumes::LoadPreset(presetPath);
+        const auto light = ISV::BenchmarkVolumes::CreateLight(preset);
+        const auto spheres = ISV::BenchmarkVolumes::ToLightSpace(ISV::BenchmarkVolumes::CreateSpheres(preset), light);
+
+        std::vector<SparseOpticalThicknessVolume::Bounds> bounds(spheres.size());
+        for (std::size_t i = 0; i < spheres.size(); i++)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                bounds[i].Min[axis] = spheres[i].Centre[axis] - spheres[i].Radius;
+                bounds[i].Max[axis] = spheres[i].Centre[axis] + spheres[i].Radius;
+            }
+        }
+
+        std::cout << preset.Name << ", " << preset.ParticleCount << " particles, "
+            << SparseOpticalThicknessVolume::BrickSize << "^3 bricks\n"
+            << std::setw(16) << ""
+            << std::setw(12) << "dense MB" << std::setw(12) << "sparse MB"
+            << std::setw(10) << "bricks %"
+            << std::setw(12) << "dense ms" << std::setw(12) << "build ms"
+            << std::setw(12) << "fill ms" << std::setw(12) << "sparse ms" << "\n"
+            << std::fixed;
+
+        for (const Size& size : sizes)
+        {
+            if (size.Width == 0 || size.Height == 0 || size.Depth == 0)
+            {
+                throw std::runtime_error("Volume sizes must not be zero");
+            }
+
+            const Columns columns(spheres, 2 * light.SceneRadius, size);
+
+            auto start = Clock::now();
+            std::vector<float> dense(SparseOpticalThicknessVolume::GetDenseSizeInBytes(size.Width, size.Height, size.Depth) / sizeof(float));
+            std::size_t index = 0;
+            for (uint32_t z = 0; z < size.Depth; z++)
+            {
+                for (uint32_t y = 0; y < size.Height; y++)
+                {
+                    for (uint32_t x = 0; x < size.Width; x++)
+                    {
+                        dense[index++] = columns(x, y, z);
+                    }
+                }
+            }
+            const double denseMs = MsSince(start);
+
+            SparseOpticalThicknessVolume sparse(size.Width, size.Height, size.Depth);
+
+            start = Clock::now();
+            sparse.Build(bounds);
+            const double buildMs = MsSince(start);
+
+            start = Clock::now();
+            sparse.FillWith(columns);
+            const double fillMs = MsSince(start);
+
+            // Every texel the sparse volume dropped must be zero in the dense one
+            std::mt19937 rng(1);
+            for (uint32_t i = 0; i < 1000000; i++)
+            {
+                const uint32_t x = rng() % size.Width;
+                const uint32_t y = rng() % size.Height;
+                const uint32_t z = rng() % size.Depth;
+                if (sparse.Load(x, y, z) != dense[(static_cast<std::size_t>(z) * size.Height + y) * size.Width + x])
+                {
+                    throw std::runtime_error("The sparse volume dropped a non-zero texel");
+                }
+            }
+
+            const double mb = 1024.0 * 1024.0;
+            std::cout << std::setw(16) << (std::to_string(size.Width) + "x" + std::to_string(size.Height) + "x" + std::to_string(size.Depth))
+                << std::setprecision(1)
+                << std::setw(12) << SparseOpticalThicknessVolume::GetDenseSizeInBytes(size.Width, size.Height, size.Depth) / mb
+                << std::setw(12) << sparse.GetSizeInBytes() / mb
+                << std::setw(10) << 100.0 * sparse.GetOccupiedBrickCount() / sparse.GetBrickCount()
+                << std::setw(12) << denseMs
+                << std::setw(12) << buildMs
+                << std::setw(12) << fillMs
+                << std::setw(12) << buildMs + fillMs << "\n";
+        }
+
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,178 @@
+// Measures build and query throughput of ISV::ParticleSpatialHash, the
+// neighbour search behind ParticleSimulation's interaction forces, on
+// particles spread like Game::CreateTetrahedronInstances spreads them. Each
+// query finds the neighbours of one particle within the interaction
+// radius, and is compared with a brute force search over every particle.
+// The tool fails if the two disagree.
+//
+//  SpatialHashBenchmark [--particles <count>]... [--radius <radius>]
+//                       [--threads <count>]... [--repeats <count>]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "CpuFrame.h"
+#include "Core/ParticleSpatialHash.h"
+
+namespace
+{
+    using ISV::ParticleSpatialHash;
+    using Clock = std::chrono::steady_clock;
+
+    // Enough queries for a stable brute force rate without taking minutes
+    constexpr uint32_t BruteForceQueries = 500;
+
+    double SecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        std::vector<uint32_t> particleCounts;
+        std::vector<uint32_t> threadCounts;
+        float radius = 1.5f;
+        uint32_t repeats = 10;
+
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--particles" && i + 1 < argc)
+            {
+                particleCounts.push_back(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+            }
+            else if (arg == "--radius" && i + 1 < argc)
+            {
+                radius = std::strtof(argv[++i], nullptr);
+            }
+            else if (arg == "--threads" && i + 1 < argc)
+            {
+                threadCounts.push_back(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+            }
+            else if (arg == "--repeats" && i + 1 < argc)
+            {
+                repeats = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else
+            {
+                throw std::runtime_error("Unknown or incomplete option " + arg);
+            }
+        }
+
+        if (particleCounts.empty())
+        {
+            particleCounts = { 4000, 16384, 65536 };
+        }
+
+        if (threadCounts.empty())
+        {
+            threadCounts = { 1, ISV::GetDefaultThreadCount() };
+            threadCounts.erase(std::unique(threadCounts.begin(), threadCounts.end()), threadCounts.end());
+        }
+
+        if (radius <= 0.f || repeats == 0)
+        {
+            throw std::runtime_error("Expected a positive radius and at least 1 repeat");
+        }
+
+        std::cout << "Cells of " << radius << ", table twice the particle count\n"
+            << std::setw(10) << "particles" << std::setw(9) << "threads"
+            << std::setw(11) << "build ms" << std::setw(12) << "Mp/s built"
+            << std::setw(12) << "neighbours"
+            << std::setw(12) << "kquery/s" << std::setw(12) << "Mpair/s"
+            << std::setw(14) << "brute kq/s"
+            << std::setw(10) << "MB" << "\n"
+            << std::fixed;
+
+        for (const uint32_t particleCount : particleCounts)
+        {
+            const auto particles = ISV::Detail::CreateParticles(particleCount, 1);
+
+            for (const uint32_t threads : threadCounts)
+            {
+                ParticleSpatialHash hash(radius, particleCount * 2);
+
+                auto start = Clock::now();
+                for (uint32_t r = 0; r < repeats; r++)
+                {
+                    hash.Build(particles.data(), particleCount, sizeof(particles[0]), threads);
+                }
+                const double buildSeconds = SecondsSince(start) / repeats;
+
+                uint64_t neighbours = 0;
+                start = Clock::now();
+                for (const auto& particle : particles)
+                {
+                    hash.ForEachNeighbour(particle.Position, radius, [&neighbours](uint32_t, float)
+                        {
+                            neighbours++;
+                        });
+                }
+                const double querySeconds = SecondsSince(start);
+
+                // Brute force over a spread of query particles
+                const uint32_t bruteQueries = std::min(particleCount, BruteForceQueries);
+                const uint32_t queryStride = particleCount / bruteQueries;
+                std::vector<uint32_t> found;
+                std::vector<uint32_t> expected;
+                double bruteSeconds = 0.0;
+
+                for (uint32_t q = 0; q < bruteQueries; q++)
+                {
+                    const auto& position = particles[q * queryStride].Position;
+
+                    start = Clock::now();
+                    expected.clear();
+                    for (uint32_t j = 0; j < particleCount; j++)
+                    {
+                        const float dx = particles[j].Position[0] - position[0];
+                        const float dy = particles[j].Position[1] - position[1];
+                        const float dz = particles[j].Position[2] - position[2];
+                        if (dx * dx + dy * dy + dz * dz <= radius * radius)
+                        {
+                            expected.push_back(j);
+                        }
+                    }
+                    bruteSeconds += SecondsSince(start);
+
+                    found.clear();
+                    hash.FindNeighbours(position, radius, found);
+                    std::sort(found.begin(), found.end());
+                    if (found != expected)
+                    {
+                        throw std::runtime_error("The spatial hash and brute force found different neighbours");
+                    }
+                }
+
+                std::cout << std::setw(10) << particleCount << std::setw(9) << threads
+                    << std::setprecision(3)
+                    << std::setw(11) << buildSeconds * 1e3
+                    << std::setprecision(1)
+                    << std::setw(12) << particleCount / buildSeconds / 1e6
+                    << std::setw(12) << static_cast<double>(neighbours) / particleCount
+                    << std::setw(12) << particleCount / querySeconds / 1e3
+                    << std::setw(12) << neighbours / querySeconds / 1e6
+                    << std::setw(14) << bruteQueries / bruteSeconds / 1e3
+                    << std::setw(10) << hash.GetSizeInBytes() / (1024.0 * 1024.0) << "\n";
+            }
+        }
+
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,341 @@
+// Times creating many meshes at startup with Gradient::UploadScheduler
+// batching the uploads, against submitting and waiting on every buffer
+// as ResourceUploadBatch was used before. A thread stands in for the GPU:
+// every submission costs a fixed latency and its copies run at memcpy
+// speed.
+//
+//  UploadBenchmark [--meshes <count>] [--tessellation <n>] [--submit-us <latency>]
+
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Gradient/UploadScheduler.h"
+
+namespace
+{
+    struct Vertex
+    {
+        float Position[3];
+        float Normal[3];
+        float Uv[2];
+    };
+
+    struct Mesh
+    {
+        std::vector<Vertex> Vertices;
+        std::vector<uint32_t> Indices;
+    };
+
+    // A UV sphere, so each mesh costs some CPU time to build
+    Mesh BuildSphere(uint32_t tessellation, float radius)
+    {
+        Mesh mesh;
+        const uint32_t rings = tessellation + 1;
+
+        for (uint32_t y = 0; y < rings; y++)
+        {
+            const float v = static_cast<float>(y) / tessellation;
+            const float theta = v * 3.14159265f;
+
+            for (uint32_t x = 0; x < rings; x++)
+            {
+                const float u = static_cast<float>(x) / tessellation;
+                const float phi = u * 6.28318531f;
+
+                const float nx = std::sin(theta) * std::cos(phi);
+                const float ny = std::cos(theta);
+                const float nz = std::sin(theta) * std::sin(phi);
+                mesh.Vertices.push_back({ { nx * radius, ny * radius, nz * radius }, { nx, ny, nz }, { u, v } });
+            }
+        }
+
+        for (uint32_t y = 0; y < tessellation; y++)
+        {
+            for (uint32_t x = 0; x < tessellation; x++)
+            {
+                const uint32_t i = y * rings + x;
+                mesh.Indices.insert(mesh.Indices.end(), { i, i + rings, i + 1, i + 1, i + rings, i + rings + 1 });
+            }
+        }
+
+        return mesh;
+    }
+
+    struct Copy
+    {
+        const uint8_t* Source;
+        uint8_t* Destination;
+        uint64_t Size;
+    };
+
+    // Runs submissions in order on a thread of its own
+    class FakeGpu : public Gradient::UploadScheduler::Backend
+    {
+    public:
+        explicit FakeGpu(std::chrono::microseconds submitLatency)
+            : m_submitLatency(submitLatency),
+            m_thread([this] { Run(); })
+        {
+        }
+
+        ~FakeGpu()
+        {
+            {
+                std::lock_guard lock(m_mutex);
+                m_stop = true;
+            }
+            m_wake.notify_all();
+            m_thread.join();
+        }
+
+        void RecordCopy(const uint8_t* source, uint8_t* destination, uint64_t size)
+        {
+            m_recording.push_back({ source, destination, size });
+        }
+
+        void SubmitBatch(uint64_t batch) override
+        {
+            {
+                std::lock_guard lock(m_mutex);
+                m_queue.push_back({ batch, std::move(m_recording) });
+                m_submissions++;
+            }
+            m_recording.clear();
+            m_wake.notify_all();
+        }
+
+        uint64_t GetCompletedBatch() override
+        {
+            std::lock_guard lock(m_mutex);
+            return m_completed;
+        }
+
+        void WaitForBatch(uint64_t batch) override
+        {
+            std::unique_lock lock(m_mutex);
+            m_done.wait(lock, [&] { return m_completed >= batch; });
+        }
+
+        uint64_t GetSubmissions()
+        {
+            std::lock_guard lock(m_mutex);
+            return m_submissions;
+        }
+
+    private:
+        struct Submission
+        {
+            uint64_t Batch;
+            std::vector<Copy> Copies;
+        };
+
+        void Run()
+        {
+            while (true)
+            {
+                Submission submission;
+                {
+                    std::unique_lock lock(m_mutex);
+                    m_wake.wait(lock, [&] { return m_stop || !m_queue.empty(); });
+                    if (m_queue.empty())
+                        return;
+
+                    submission = std::move(m_queue.front());
+                    m_queue.pop_front();
+                }
+
+                // Submission overhead, then the copies
+                const auto until = std::chrono::steady_clock::now() + m_submitLatency;
+                while (std::chrono::steady_clock::now() < until)
+                {
+                    std::this_thread::yield();
+                }
+
+                for (const auto& copy : submission.Copies)
+                {
+                    std::memcpy(copy.Destination, copy.Source, copy.Size);
+                }
+
+                {
+                    std::lock_guard lock(m_mutex);
+                    m_completed = submission.Batch;
+                }
+                m_done.notify_all();
+            }
+        }
+
+        std::chrono::microseconds m_submitLatency;
+
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_done;
+        std::deque<Submission> m_queue;
+        std::vector<Copy> m_recording;
+        uint64_t m_completed = 0;
+        uint64_t m_submissions = 0;
+        bool m_stop = false;
+
+        std::thread m_thread;
+    };
+
+    struct GpuBuffers
+    {
+        std::vector<std::vector<uint8_t>> Buffers;
+
+        uint8_t* Create(uint64_t size)
+        {
+            Buffers.emplace_back(size);
+            return Buffers.back().data();
+        }
+    };
+
+    struct Result
+    {
+        double Ms;
+        uint64_t Submissions;
+        uint64_t Stalls;
+    };
+
+    // Stages each buffer in memory of its own, submits it and waits
+    Result RunPerBuffer(uint32_t meshes, uint32_t tessellation, std::chrono::microseconds latency)
+    {
+        FakeGpu gpu(latency);
+        GpuBuffers buffers;
+        uint64_t batch = 0;
+
+        auto upload = [&](const void* data, uint64_t size)
+            {
+                std::vector<uint8_t> staging(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+                gpu.RecordCopy(staging.data(), buffers.Create(size), size);
+                gpu.SubmitBatch(++batch);
+                gpu.WaitForBatch(batch);
+            };
+
+        const auto start = std::chrono::steady_clock::now();
+
+        for (uint32_t i = 0; i < meshes; i++)
+        {
+            const Mesh mesh = BuildSphere(tessellation, 1.f + i * 0.01f);
+
+            // ResourceUploadBatch per mesh, as ProceduralMesh::Initialize did
+            upload(mesh.Vertices.data(), mesh.Vertices.size() * sizeof(Vertex));
+            upload(mesh.Indices.data(), mesh.Indices.size() * sizeof(uint32_t));
+        }
+
+        const auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return { ms, gpu.GetSubmissions(), batch };
+    }
+
+    Result RunBatched(uint32_t meshes, uint32_t tessellation, std::chrono::microseconds latency)
+    {
+        FakeGpu gpu(latency);
+        GpuBuffers buffers;
+
+        // The sizes UploadManager uses
+        std::vector<uint8_t> staging(32 * 1024 * 1024);
+        Gradient::UploadScheduler scheduler(gpu, staging.size(), 8, 8 * 1024 * 1024);
+
+        auto upload = [&](const void* data, uint64_t size)
+            {
+                const auto reservation = scheduler.Reserve(size, 16);
+                if (reservation.Offset == Gradient::UploadScheduler::InvalidOffset)
+                {
+                    throw std::runtime_error("Mesh larger than the staging ring");
+                }
+
+                std::memcpy(staging.data() + reservation.Offset, data, size);
+                gpu.RecordCopy(staging.data() + reservation.Offset, buffers.Create(size), size);
+            };
+
+        const auto start = std::chrono::steady_clock::now();
+
+        for (uint32_t i = 0; i < meshes; i++)
+        {
+            const Mesh mesh = BuildSphere(tessellation, 1.f + i * 0.01f);
+            upload(mesh.Vertices.data(), mesh.Vertices.size() * sizeof(Vertex));
+            upload(mesh.Indices.data(), mesh.Indices.size() * sizeof(uint32_t));
+        }
+
+        // The first frame needs every mesh
+        scheduler.WaitForAll();
+
+        const auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return { ms, gpu.GetSubmissions(), scheduler.GetStats().Stalls };
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        uint32_t meshes = 1000;
+        uint32_t tessellation = 32;
+        uint32_t submitUs = 100;
+
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--meshes" && i + 1 < argc)
+            {
+                meshes = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--tessellation" && i + 1 < argc)
+            {
+                tessellation = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--submit-us" && i + 1 < argc)
+            {
+                submitUs = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else
+            {
+                throw std::runtime_error("Unknown or incomplete option " + arg);
+            }
+        }
+
+        if (meshes == 0 || tessellation == 0)
+        {
+            throw std::runtime_error("Expected at least 1 mesh and a tessellation of 1");
+        }
+
+        const auto latency = std::chrono::microseconds(submitUs);
+        const Result perBuffer = RunPerBuffer(meshes, tessellation, latency);
+        const Result batched = RunBatched(meshes, tessellation, latency);
+
+        std::cout << meshes << " meshes, tessellation " << tessellation
+            << ", " << submitUs << " us per submission\n"
+            << std::setw(14) << "" << std::setw(12) << "ms" << std::setw(14) << "submissions" << std::setw(10) << "stalls" << "\n"
+            << std::fixed << std::setprecision(1);
+
+        auto print = [](const char* name, const Result& result)
+            {
+                std::cout << std::setw(14) << name
+                    << std::setw(12) << result.Ms
+                    << std::setw(14) << result.Submissions
+                    << std::setw(10) << result.Stalls << "\n";
+            };
+
+        print("per buffer", perBuffer);
+        print("batched", batched);
+
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,150 @@
+// Quantises an optical thickness volume into each of the formats in
+// VolShadowStorageFormat with ISV::VolShadowEncoding, the CPU mirror of
+// VolShadowEncoding.hlsli, and reports the memory and error of each. The
+// volume is either a preset's particles splatted like CpuFrame does, or a
+// raw float32 file laid out like the 3D texture: x fastest, then y, then z.
+//
+//  VolShadowQuantize [--preset <file>] [--width <texels>] [--depth <slices>]
+//  VolShadowQuantize --volume <file> --size <width>x<height>x<depth>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "BenchmarkVolumes.h"
+#include "Core/VolShadowEncoding.h"
+
+namespace
+{
+    std::vector<float> ReadVolume(const std::string& path, std::size_t texelCount)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file)
+        {
+            throw std::runtime_error("Could not open " + path);
+        }
+
+        if (static_cast<std::size_t>(file.tellg()) != texelCount * sizeof(float))
+        {
+            throw std::runtime_error(path + " does not hold " + std::to_string(texelCount) + " floats");
+        }
+
+        std::vector<float> volume(texelCount);
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(volume.data()), volume.size() * sizeof(float));
+        return volume;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        std::string presetPath;
+        std::string volumePath;
+        uint32_t width = 256;
+        uint32_t height = 256;
+        uint32_t depth = 10;
+        bool sized = false;
+
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--preset" && i + 1 < argc)
+            {
+                presetPath = argv[++i];
+            }
+            else if (arg == "--width" && i + 1 < argc)
+            {
+                width = height = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--depth" && i + 1 < argc)
+            {
+                depth = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--volume" && i + 1 < argc)
+            {
+                volumePath = argv[++i];
+            }
+            else if (arg == "--size" && i + 1 < argc
+                && std::sscanf(argv[++i], "%ux%ux%u", &width, &height, &depth) == 3)
+            {
+                sized = true;
+            }
+            else
+            {
+                throw std::runtime_error("Unknown or incomplete option " + arg);
+            }
+        }
+
+        if (!volumePath.empty() && !sized)
+        {
+            throw std::runtime_error("--volume needs --size");
+        }
+
+        if (width == 0 || height == 0 || depth == 0)
+        {
+            throw std::runtime_error("Volume sizes must not be zero");
+        }
+
+        const std::size_t texelCount = static_cast<std::size_t>(width) * height * depth;
+
+        std::vector<float> volume;
+        if (volumePath.empty())
+        {
+            const ISV::ScenePreset preset = ISV::BenchmarkVolumes::LoadPreset(presetPath);
+            volume = ISV::BenchmarkVolumes::Splat(preset, width, depth).Texels;
+            std::cout << preset.Name << ", " << preset.ParticleCount << " particles";
+        }
+        else
+        {
+            volume = ReadVolume(volumePath, texelCount);
+            std::cout << volumePath;
+        }
+
+        const auto [minimum, maximum] = std::minmax_element(volume.begin(), volume.end());
+        std::cout << ", " << width << "x" << height << "x" << depth
+            << ", optical thickness " << *minimum << " to " << *maximum << "\n"
+            << std::setw(12) << ""
+            << std::setw(10) << "B/texel" << std::setw(10) << "MB"
+            << std::setw(14) << "OT max" << std::setw(14) << "T max" << std::setw(14) << "T mean"
+            << std::setw(10) << "ms" << "\n"
+            << std::fixed;
+
+        for (uint32_t f = 0; f < ISV::ScenePreset::VolShadowFormatNames.size(); f++)
+        {
+            const auto format = static_cast<ISV::VolShadowStorageFormat>(f);
+
+            const auto start = std::chrono::steady_clock::now();
+            const auto report = ISV::VolShadowEncoding::Measure(volume.data(), volume.size(), format);
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            std::cout << std::setw(12) << ISV::ScenePreset::VolShadowFormatNames[f]
+                << std::setw(10) << ISV::VolShadowEncoding::GetBytesPerTexel(format)
+                << std::setprecision(2)
+                << std::setw(10) << report.QuantizedBytes / (1024.0 * 1024.0)
+                << std::setprecision(6)
+                << std::setw(14) << report.MaxOpticalThicknessError
+                << std::setw(14) << report.MaxTransmittanceError
+                << std::setw(14) << report.MeanTransmittanceError
+                << std::setprecision(1)
+                << std::setw(10) << ms << "\n";
+        }
+
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
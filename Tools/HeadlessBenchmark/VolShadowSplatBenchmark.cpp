@@ -0,0 +1,245 @@
+// Compares the two ways of filling the volumetric shadow volume on the
+// CPU. The raster model mirrors the proxy path: every slice is its own
+// pass that draws every particle's footprint, so each covered texel
+// intersects the particle's sphere and evaluates the faded optical
+// thickness once per slice. The splat path is ISV::VolShadowSplatter,
+// which mirrors VolShadowSplat_CS: each covered texel intersects the
+// sphere once and walks all the slices. The tool fails if the two
+// volumes differ.
+//
+// This is a model of the work each path does, not of the GPU: it leaves
+// out rasteriser and blending throughput on one side and the shader's
+// groupshared batching and tile culling on the other.
+//
+//  VolShadowSplatBenchmark [--preset <file>] [--width <texels>]
+//                          [--depth <slices>]... [--particles <count>]...
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "BenchmarkVolumes.h"
+#include "Core/VolShadowSplatter.h"
+
+namespace
+{
+    using ISV::VolShadowSplatter;
+
+    std::vector<float> RasterProxies(const std::vector<VolShadowSplatter::Particle>& particles,
+        const VolShadowSplatter::Light& light,
+        const VolShadowSplatter::Settings& settings)
+    {
+        const uint32_t width = settings.Width;
+        const uint32_t depth = settings.Depth;
+        const std::size_t slicePitch = static_cast<std::size_t>(width) * width;
+
+        std::vector<float> volume(slicePitch * depth, 0.f);
+
+        const auto basis = ISV::BenchmarkVolumes::MakeLightBasis(light);
+        const float R = light.SceneRadius;
+        const float sliceThickness = 2 * R / (depth - 1.f);
+
+        auto dot = [](const VolShadowSplatter::Vector3& a, const VolShadowSplatter::Vector3& b)
+            {
+                return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+            };
+
+        for (uint32_t slice = 1; slice < depth; slice++)
+        {
+            float* target = volume.data() + slice * slicePitch;
+
+            for (const auto& particle : particles)
+            {
+                if (particle.Radius <= 0.f)
+                    continue;
+
+                const VolShadowSplatter::Vector3 toParticle = {
+                    particle.Position[0] - basis.Eye[0],
+                    particle.Position[1] - basis.Eye[1],
+                    particle.Position[2] - basis.Eye[2]
+                };
+
+                const float ndcX = dot(toParticle, basis.Right) / R;
+                const float ndcY = dot(toParticle, basis.Up) / R;
+                const float ndcRadius = particle.Radius / R;
+
+                const int maxIndex = static_cast<int>(width) - 1;
+                const int x0 = std::clamp(static_cast<int>(std::floor((0.5f * (ndcX - ndcRadius) + 0.5f) * width - 0.5f)), 0, maxIndex);
+                const int x1 = std::clamp(static_cast<int>(std::ceil((0.5f * (ndcX + ndcRadius) + 0.5f) * width - 0.5f)), 0, maxIndex);
+                const int y0 = std::clamp(static_cast<int>(std::floor((0.5f - 0.5f * (ndcY + ndcRadius)) * width - 0.5f)), 0, maxIndex);
+                const int y1 = std::clamp(static_cast<int>(std::ceil((0.5f - 0.5f * (ndcY - ndcRadius)) * width - 0.5f)), 0, maxIndex);
+
+                const float falloffRadius = settings.FalloffRadius * particle.Radius;
+
+                for (int y = y0; y <= y1; y++)
+                {
+                    for (int x = x0; x <= x1; x++)
+                    {
+                        const float rayNdcX = (x + 0.5f) / width * 2 - 1;
+                        const float rayNdcY = 1 - (y + 0.5f) / width * 2;
+
+                        const VolShadowSplatter::Vector3 rayOrigin = {
+                            basis.Eye[0] + R * (rayNdcX * basis.Right[0] + rayNdcY * basis.Up[0]),
+                            basis.Eye[1] + R * (rayNdcX * basis.Right[1] + rayNdcY * basis.Up[1]),
+                            basis.Eye[2] + R * (rayNdcX * basis.Right[2] + rayNdcY * basis.Up[2])
+                        };
+
+                        float tNear, tFar;
+                        if (!VolShadowSplatter::RaySphereIntersect(rayOrigin, basis.Forward, particle.Position,
+                            particle.Radius, tNear, tFar) || tFar < 0)
+                        {
+                            continue;
+                        }
+
+                        tNear = std::max(tNear, 0.f);
+
+                        const float zmax = std::min(tFar, slice * sliceThickness) - tNear;
+                        if (zmax <= 0.f)
+                            continue;
+
+                        const VolShadowSplatter::Vector3 toCentre = {
+                            particle.Position[0] - (rayOrigin[0] + basis.Forward[0] * tNear),
+                            particle.Position[1] - (rayOrigin[1] + basis.Forward[1] * tNear),
+                            particle.Position[2] - (rayOrigin[2] + basis.Forward[2] * tNear)
+                        };
+                        const float d = std::sqrt(dot(toCentre, toCentre));
+                        const float cosAlpha = d > 0.00001f
+                            ? std::clamp(dot(basis.Forward, toCentre) / d, -1.f, 1.f)
+                            : 1.f;
+
+                        target[static_cast<std::size_t>(y) * width + x] += settings.Faded
+                            ? VolShadowSplatter::FadedOpticalThickness(0, zmax, d, cosAlpha, particle.Extinction, falloffRadius)
+                            : zmax * particle.Extinction;
+                    }
+                }
+            }
+        }
+
+        return volume;
+    }
+
+    template <typename Fn>
+    double TimeMs(Fn&& fn)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        std::string presetPath;
+        uint32_t width = 128;
+        std::vector<uint32_t> depths;
+        std::vector<uint32_t> particleCounts;
+
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--preset" && i + 1 < argc)
+            {
+                presetPath = argv[++i];
+            }
+            else if (arg == "--width" && i + 1 < argc)
+            {
+                width = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == "--depth" && i + 1 < argc)
+            {
+                depths.push_back(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+            }
+            else if (arg == "--particles" && i + 1 < argc)
+            {
+                particleCounts.push_back(static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+            }
+            else
+            {
+                throw std::runtime_error("Unknown or incomplete option " + arg);
+            }
+        }
+
+        if (depths.empty())
+        {
+            depths = { 10, 32 };
+        }
+
+        if (particleCounts.empty())
+        {
+            particleCounts = { 1000, 4000, 16000 };
+        }
+
+        if (width == 0 || std::any_of(depths.begin(), depths.end(), [](uint32_t depth) { return depth < 2; }))
+        {
+            throw std::runtime_error("Expected a width and at least 2 slices");
+        }
+
+        ISV::ScenePreset preset = ISV::BenchmarkVolumes::LoadPreset(presetPath);
+
+        std::cout << preset.Name << ", " << width << "x" << width << " texels\n"
+            << std::setw(10) << "particles" << std::setw(8) << "slices"
+            << std::setw(12) << "raster ms" << std::setw(12) << "splat ms"
+            << std::setw(10) << "speedup"
+            << std::setw(14) << "raster ns/p" << std::setw(14) << "splat ns/p"
+            << std::setw(12) << "max diff" << "\n"
+            << std::fixed;
+
+        for (const uint32_t particleCount : particleCounts)
+        {
+            preset.ParticleCount = particleCount;
+            const auto particles = ISV::BenchmarkVolumes::CreateSpheres(preset);
+            const auto light = ISV::BenchmarkVolumes::CreateLight(preset);
+
+            for (const uint32_t depth : depths)
+            {
+                const auto settings = ISV::BenchmarkVolumes::CreateSettings(preset, width, depth);
+
+                std::vector<float> raster;
+                std::vector<float> splat;
+                const double rasterMs = TimeMs([&]() { raster = RasterProxies(particles, light, settings); });
+                const double splatMs = TimeMs([&]() { splat = VolShadowSplatter::Splat(particles, light, settings); });
+
+                float maxDifference = 0.f;
+                float maxValue = 0.f;
+                for (std::size_t i = 0; i < splat.size(); i++)
+                {
+                    maxDifference = std::max(maxDifference, std::abs(raster[i] - splat[i]));
+                    maxValue = std::max(maxValue, splat[i]);
+                }
+
+                if (maxDifference > 1e-5f * std::max(1.f, maxValue))
+                {
+                    throw std::runtime_error("The raster model and the splatter produced different volumes");
+                }
+
+                std::cout << std::setw(10) << particleCount << std::setw(8) << depth
+                    << std::setprecision(1)
+                    << std::setw(12) << rasterMs << std::setw(12) << splatMs
+                    << std::setprecision(2)
+                    << std::setw(10) << rasterMs / splatMs
+                    << std::setprecision(0)
+                    << std::setw(14) << rasterMs * 1e6 / particleCount
+                    << std::setw(14) << splatMs * 1e6 / particleCount
+                    << std::setprecision(7)
+                    << std::setw(12) << maxDifference << "\n";
+            }
+        }
+
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}